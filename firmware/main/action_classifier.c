@@ -0,0 +1,391 @@
+#include "action_classifier.h"
+
+#include <string.h>
+
+#define SCORE_INF UINT64_MAX
+#define Q15_ONE 32768
+
+static uint16_t rd16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t rd64(const uint8_t *p)
+{
+    return (uint64_t)rd32(p) | ((uint64_t)rd32(p + 4) << 32);
+}
+
+// Python round(): ties to even. num >= 0, den > 0.
+static uint64_t div_round_even(uint64_t num, uint64_t den)
+{
+    uint64_t q = num / den;
+    uint64_t r2 = (num % den) * 2;
+    if (r2 > den || (r2 == den && (q & 1))) {
+        q++;
+    }
+    return q;
+}
+
+static size_t scale_q16(size_t v, uint32_t frac_q16)
+{
+    return (size_t)div_round_even((uint64_t)v * frac_q16, 65536);
+}
+
+static uint64_t isqrt64(uint64_t v)
+{
+    uint64_t r = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+bool action_model_load(action_model_t *m, const uint8_t *blob, size_t len)
+{
+    if (!m || !blob || ((uintptr_t)blob & 1) || len < ACTION_MODEL_HEADER_BYTES) return false;
+    if (memcmp(blob, ACTION_MODEL_MAGIC, 4) != 0 || rd16(blob + 4) != ACTION_MODEL_VERSION) {
+        return false;
+    }
+    memset(m, 0, sizeof(*m));
+    m->label_count = rd16(blob + 6);
+    m->ref_count = rd16(blob + 8);
+    m->max_points = rd16(blob + 10);
+    m->score_mode = blob[12];
+    m->use_znorm = blob[13] != 0;
+    m->q_shift = blob[14];
+    m->per_label_k = blob[15];
+    m->sample_rate_centihz = rd32(blob + 16);
+    m->window_frac_q16 = rd32(blob + 20);
+    m->xcorr_max_lag_frac_q16 = rd32(blob + 24);
+    m->xcorr_min_overlap_frac_q16 = rd32(blob + 28);
+    m->hybrid_alpha_q16 = rd32(blob + 32);
+    m->reject_margin_q16 = rd32(blob + 36);
+    m->reject_grace_q16 = rd32(blob + 40);
+    memcpy(m->unknown_label, blob + 44, ACTION_MODEL_LABEL_LEN);
+    m->unknown_label[ACTION_MODEL_LABEL_LEN - 1] = '\0';
+
+    if (m->label_count == 0 || m->label_count > ACTION_MODEL_MAX_LABELS ||
+        m->ref_count == 0 || m->ref_count > ACTION_MODEL_MAX_REFS ||
+        m->max_points == 0 || m->max_points > ACTION_MODEL_MAX_POINTS ||
+        m->score_mode > ACTION_SCORE_XCORR || m->q_shift > 12 ||
+        m->per_label_k == 0 || m->per_label_k > ACTION_MODEL_MAX_K) {
+        return false;
+    }
+
+    size_t off = ACTION_MODEL_HEADER_BYTES;
+    if (len < off + (size_t)m->label_count * ACTION_MODEL_LABEL_BYTES) return false;
+    for (uint16_t i = 0; i < m->label_count; ++i) {
+        const uint8_t *p = blob + off;
+        memcpy(m->labels[i], p, ACTION_MODEL_LABEL_LEN);
+        m->labels[i][ACTION_MODEL_LABEL_LEN - 1] = '\0';
+        m->has_threshold[i] = p[ACTION_MODEL_LABEL_LEN] != 0;
+        m->thresholds[i] = rd64(p + ACTION_MODEL_LABEL_LEN + 8);
+        off += ACTION_MODEL_LABEL_BYTES;
+    }
+
+    for (uint16_t i = 0; i < m->ref_count; ++i) {
+        if (len < off + 4) return false;
+        action_model_ref_t *r = &m->refs[i];
+        r->label = rd16(blob + off);
+        r->len = rd16(blob + off + 2);
+        off += 4;
+        size_t bytes = (size_t)r->len * ACTION_MODEL_DIMS * sizeof(int16_t);
+        if (r->label >= m->label_count || r->len == 0 || r->len > ACTION_MODEL_MAX_POINTS ||
+            len < off + bytes) {
+            return false;
+        }
+        r->points = (const int16_t *)(const void *)(blob + off);
+        off += bytes;
+    }
+    return off == len;
+}
+
+const char *action_model_label(const action_model_t *m, int label)
+{
+    if (label < 0 || label >= m->label_count) return m->unknown_label;
+    return m->labels[label];
+}
+
+// Index of point i when nearest-index resampling n points to m points
+// (dtw_baseline.downsample / resample_to_rate).
+static size_t pick_index(size_t i, size_t n, size_t m)
+{
+    if (m <= 1 || n <= 1) return 0;
+    size_t idx = (size_t)div_round_even((uint64_t)i * (n - 1), m - 1);
+    return idx < n ? idx : n - 1;
+}
+
+size_t action_classifier_prep(const action_model_t *m, const bmi270_sample_t *in, size_t n,
+                              uint32_t src_rate_hz, action_classifier_work_t *work)
+{
+    if (n == 0) return 0;
+
+    // resample_to_rate(): skipped when rates are within 10%.
+    size_t resampled = n;
+    bool resample = false;
+    if (src_rate_hz > 0 && m->sample_rate_centihz > 0) {
+        uint64_t src_c = (uint64_t)src_rate_hz * 100;
+        uint64_t dst_c = m->sample_rate_centihz;
+        uint64_t diff = src_c > dst_c ? src_c - dst_c : dst_c - src_c;
+        if (diff * 10 > dst_c) {
+            resample = true;
+            resampled = (size_t)div_round_even((uint64_t)n * dst_c, src_c);
+            if (resampled == 0) resampled = 1;
+        }
+    }
+    size_t out_len = resampled <= m->max_points ? resampled : m->max_points;
+
+    int16_t *q = work->query;
+    for (size_t i = 0; i < out_len; ++i) {
+        size_t j = resampled <= m->max_points ? i : pick_index(i, resampled, m->max_points);
+        size_t k = resample ? pick_index(j, n, resampled) : j;
+        memcpy(&q[i * ACTION_MODEL_DIMS], &in[k].ax, ACTION_MODEL_DIMS * sizeof(int16_t));
+    }
+    if (!m->use_znorm) {
+        return out_len;
+    }
+
+    // z = (x - mean) / std = (x*n - sum) / sqrt(n*sumsq - sum^2), written with
+    // q_shift fractional bits. Constant axes map to 0 like znormalize().
+    for (int d = 0; d < ACTION_MODEL_DIMS; ++d) {
+        int64_t sum = 0;
+        int64_t sumsq = 0;
+        for (size_t i = 0; i < out_len; ++i) {
+            int64_t v = q[i * ACTION_MODEL_DIMS + d];
+            sum += v;
+            sumsq += v * v;
+        }
+        int64_t nn = (int64_t)out_len;
+        uint64_t spread = (uint64_t)(nn * sumsq - sum * sum);
+        // sqrt with 7 fractional bits; spread << 14 stays in range for 256 points.
+        int64_t root_q7 = (int64_t)isqrt64(spread << 14);
+        for (size_t i = 0; i < out_len; ++i) {
+            int16_t *v = &q[i * ACTION_MODEL_DIMS + d];
+            if (root_q7 == 0) {
+                *v = 0;
+                continue;
+            }
+            int64_t z = ((int64_t)*v * nn - sum) * ((int64_t)1 << (m->q_shift + 7)) / root_q7;
+            *v = (int16_t)(z > INT16_MAX ? INT16_MAX : (z < INT16_MIN ? INT16_MIN : z));
+        }
+    }
+    return out_len;
+}
+
+static uint64_t point_cost(const int16_t *a, const int16_t *b)
+{
+    uint64_t c = 0;
+    for (int d = 0; d < ACTION_MODEL_DIMS; ++d) {
+        int32_t diff = (int32_t)a[d] - (int32_t)b[d];
+        c += (uint64_t)((int64_t)diff * diff);
+    }
+    return c;
+}
+
+static uint64_t min3(uint64_t a, uint64_t b, uint64_t c)
+{
+    uint64_t m = a < b ? a : b;
+    return m < c ? m : c;
+}
+
+// Sakoe-Chiba banded DTW, same band rule as dtw_baseline.dtw_distance().
+static uint64_t dtw_banded(const int16_t *a, size_t n, const int16_t *b, size_t m,
+                           size_t window, uint64_t (*row)[ACTION_MODEL_MAX_POINTS + 1])
+{
+    if (window == 0) window = n > m ? n : m;
+    size_t len_diff = n > m ? n - m : m - n;
+    if (window < len_diff) window = len_diff;
+
+    uint64_t *prev = row[0];
+    uint64_t *curr = row[1];
+    for (size_t j = 0; j <= m; ++j) {
+        prev[j] = SCORE_INF;
+    }
+    prev[0] = 0;
+
+    for (size_t i = 1; i <= n; ++i) {
+        size_t start = i > window ? i - window : 1;
+        size_t end = i + window < m ? i + window : m;
+        for (size_t j = 0; j <= m; ++j) {
+            curr[j] = SCORE_INF;
+        }
+        const int16_t *pa = &a[(i - 1) * ACTION_MODEL_DIMS];
+        for (size_t j = start; j <= end; ++j) {
+            uint64_t best = min3(curr[j - 1], prev[j], prev[j - 1]);
+            if (best == SCORE_INF) continue;
+            curr[j] = best + point_cost(pa, &b[(j - 1) * ACTION_MODEL_DIMS]);
+        }
+        uint64_t *t = prev;
+        prev = curr;
+        curr = t;
+    }
+    return prev[m];
+}
+
+// Best normalized cross-correlation over lags in [-max_lag, max_lag] as Q15,
+// same as dtw_baseline.max_normalized_xcorr() (clamped to [-1, 1]).
+static int32_t xcorr_best(const int16_t *a, size_t n, const int16_t *b, size_t m,
+                          size_t max_lag, size_t min_overlap, uint8_t q_shift)
+{
+    int32_t best = -Q15_ONE;
+    if (min_overlap < 1) min_overlap = 1;
+    for (long lag = -(long)max_lag; lag <= (long)max_lag; ++lag) {
+        size_t a0 = 0;
+        size_t b0 = 0;
+        long overlap;
+        if (lag >= 0) {
+            a0 = (size_t)lag;
+            overlap = (long)n - lag < (long)m ? (long)n - lag : (long)m;
+        } else {
+            b0 = (size_t)(-lag);
+            overlap = (long)n < (long)m + lag ? (long)n : (long)m + lag;
+        }
+        if (overlap < (long)min_overlap) continue;
+
+        int64_t dot = 0;
+        const int16_t *pa = &a[a0 * ACTION_MODEL_DIMS];
+        const int16_t *pb = &b[b0 * ACTION_MODEL_DIMS];
+        for (long i = 0; i < overlap * ACTION_MODEL_DIMS; ++i) {
+            dot += (int32_t)pa[i] * (int32_t)pb[i];
+        }
+        int64_t den = ((int64_t)overlap * ACTION_MODEL_DIMS) << (2 * q_shift);
+        int64_t corr = dot * Q15_ONE / den;
+        if (corr > Q15_ONE) corr = Q15_ONE;
+        if (corr < -Q15_ONE) corr = -Q15_ONE;
+        if (corr > best) best = (int32_t)corr;
+    }
+    return best;
+}
+
+void action_classifier_classify(const action_model_t *m, action_classifier_work_t *work,
+                                size_t query_len, int skip_ref, action_result_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->label = -1;
+    out->best_label = -1;
+    out->reject = ACTION_REJECT_NO_SCORES;
+    out->best_score = SCORE_INF;
+    out->second_score = SCORE_INF;
+    if (query_len == 0) return;
+
+    const int16_t *q = work->query;
+    for (uint16_t r = 0; r < m->ref_count; ++r) {
+        if ((int)r == skip_ref) continue;
+        const action_model_ref_t *ref = &m->refs[r];
+        size_t longer = query_len > ref->len ? query_len : ref->len;
+        size_t shorter = query_len < ref->len ? query_len : ref->len;
+        work->ref_dtw[r] = dtw_banded(q, query_len, ref->points, ref->len,
+                                      scale_q16(longer, m->window_frac_q16), work->row);
+        if (m->score_mode != ACTION_SCORE_DTW) {
+            size_t min_overlap = scale_q16(shorter, m->xcorr_min_overlap_frac_q16);
+            work->ref_xcorr[r] = xcorr_best(q, query_len, ref->points, ref->len,
+                                            scale_q16(longer, m->xcorr_max_lag_frac_q16),
+                                            min_overlap < 4 ? 4 : min_overlap, m->q_shift);
+        }
+    }
+
+    // Per-label mean of the k smallest DTW distances and k largest correlations.
+    uint64_t dtw_score[ACTION_MODEL_MAX_LABELS];
+    int32_t xcorr_score[ACTION_MODEL_MAX_LABELS];
+    bool present[ACTION_MODEL_MAX_LABELS] = {0};
+    uint64_t best_dtw = SCORE_INF;
+    for (uint16_t l = 0; l < m->label_count; ++l) {
+        uint64_t top_d[ACTION_MODEL_MAX_K];
+        int32_t top_x[ACTION_MODEL_MAX_K];
+        size_t cnt = 0;
+        for (uint16_t r = 0; r < m->ref_count; ++r) {
+            if ((int)r == skip_ref || m->refs[r].label != l) continue;
+            uint64_t d = work->ref_dtw[r];
+            int32_t x = m->score_mode != ACTION_SCORE_DTW ? work->ref_xcorr[r] : 0;
+            size_t slot = cnt < m->per_label_k ? cnt++ : m->per_label_k;
+            // Insertion into the two small sorted lists.
+            size_t i = slot;
+            while (i > 0 && top_d[i - 1] > d) {
+                if (i < m->per_label_k) top_d[i] = top_d[i - 1];
+                i--;
+            }
+            if (i < m->per_label_k) top_d[i] = d;
+            i = slot;
+            while (i > 0 && top_x[i - 1] < x) {
+                if (i < m->per_label_k) top_x[i] = top_x[i - 1];
+                i--;
+            }
+            if (i < m->per_label_k) top_x[i] = x;
+        }
+        if (cnt == 0) continue;
+        uint64_t dsum = 0;
+        int64_t xsum = 0;
+        for (size_t i = 0; i < cnt; ++i) {
+            dsum += top_d[i];
+            xsum += top_x[i];
+        }
+        present[l] = true;
+        dtw_score[l] = div_round_even(dsum, cnt);
+        xcorr_score[l] = (int32_t)(xsum / (int64_t)cnt);
+        if (dtw_score[l] < best_dtw) best_dtw = dtw_score[l];
+    }
+    if (best_dtw == 0) best_dtw = 1;
+
+    int best = -1;
+    int second = -1;
+    for (uint16_t l = 0; l < m->label_count; ++l) {
+        if (!present[l]) continue;
+        uint64_t s;
+        // (1 - corr01) = (1 - corr) / 2, as Q16.
+        uint64_t penalty = (uint64_t)(Q15_ONE - xcorr_score[l]);
+        if (m->score_mode == ACTION_SCORE_DTW) {
+            s = dtw_score[l];
+        } else if (m->score_mode == ACTION_SCORE_XCORR) {
+            s = penalty;
+        } else {
+            s = (dtw_score[l] << 16) / best_dtw + ((penalty * m->hybrid_alpha_q16) >> 16);
+        }
+        out->label_scores[l] = s;
+        if (best < 0 || s < out->label_scores[best]) {
+            second = best;
+            best = l;
+        } else if (second < 0 || s < out->label_scores[second]) {
+            second = l;
+        }
+    }
+    if (best < 0) return;
+
+    out->best_label = best;
+    out->best_score = out->label_scores[best];
+    out->second_score = second >= 0 ? out->label_scores[second] : SCORE_INF;
+
+    // predict_with_rejection()
+    if (m->has_threshold[best]) {
+        uint32_t grace = m->reject_grace_q16 > 65536 ? m->reject_grace_q16 : 65536;
+        uint64_t soft = (m->thresholds[best] >> 16) * grace +
+                        (((m->thresholds[best] & 0xFFFF) * grace) >> 16);
+        if (out->best_score > soft) {
+            out->reject = ACTION_REJECT_ABOVE_THRESHOLD;
+            return;
+        }
+    }
+    if (m->reject_margin_q16 > 0 && out->second_score != SCORE_INF) {
+        uint64_t best_score = out->best_score > 0 ? out->best_score : 1;
+        if ((out->second_score << 16) < best_score * m->reject_margin_q16) {
+            out->reject = ACTION_REJECT_MARGIN;
+            return;
+        }
+    }
+    out->label = best;
+    out->reject = ACTION_REJECT_NONE;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "imu_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fixed-point port of the host classifier (pc/dtw_baseline.py): prep_sequence,
+// banded DTW + normalized cross-correlation per reference, per-label top-k
+// scores and predict_with_rejection gating. Models come from
+// `pc/build_model.py --bin-out`. Platform-independent; pc/device_model.py
+// builds this file on the host for parity checks.
+//
+// Model blob (little endian, "ADM1"):
+//   header, ACTION_MODEL_HEADER_BYTES:
+//     char magic[4], uint16 version, uint16 label_count, uint16 ref_count,
+//     uint16 max_points, uint8 score_mode, uint8 use_znorm, uint8 q_shift,
+//     uint8 per_label_k, uint32 sample_rate_centihz (0 = unknown),
+//     uint32 window_frac_q16, uint32 xcorr_max_lag_frac_q16,
+//     uint32 xcorr_min_overlap_frac_q16, uint32 hybrid_alpha_q16,
+//     uint32 reject_margin_q16, uint32 reject_grace_q16,
+//     char unknown_label[ACTION_MODEL_LABEL_LEN]
+//   label_count x { char name[ACTION_MODEL_LABEL_LEN], uint8 has_threshold,
+//                   uint8 reserved[7], uint64 threshold }
+//   ref_count x { uint16 label_index, uint16 point_count,
+//                 int16 points[point_count][6] }
+// Reference points are int16 with q_shift fractional bits (z-normalized
+// models use Q10, raw models Q0). Thresholds are in score units: DTW cost
+// with 2*q_shift fractional bits for score_mode dtw, Q16 otherwise.
+
+#define ACTION_MODEL_MAGIC "ADM1"
+#define ACTION_MODEL_VERSION 1
+#define ACTION_MODEL_HEADER_BYTES 76
+#define ACTION_MODEL_LABEL_LEN 32
+#define ACTION_MODEL_LABEL_BYTES (ACTION_MODEL_LABEL_LEN + 16)
+#define ACTION_MODEL_DIMS 6
+#define ACTION_MODEL_MAX_LABELS 16
+#define ACTION_MODEL_MAX_REFS 128
+#define ACTION_MODEL_MAX_POINTS 256
+#define ACTION_MODEL_MAX_K 8
+
+typedef enum {
+    ACTION_SCORE_DTW = 0,
+    ACTION_SCORE_HYBRID = 1,
+    ACTION_SCORE_XCORR = 2,
+} action_score_mode_t;
+
+typedef struct {
+    uint16_t label;
+    uint16_t len;
+    const int16_t *points;    // len x ACTION_MODEL_DIMS, points into the blob
+} action_model_ref_t;
+
+typedef struct {
+    uint16_t label_count;
+    uint16_t ref_count;
+    uint16_t max_points;
+    uint8_t score_mode;
+    bool use_znorm;
+    uint8_t q_shift;
+    uint8_t per_label_k;
+    uint32_t sample_rate_centihz;
+    uint32_t window_frac_q16;
+    uint32_t xcorr_max_lag_frac_q16;
+    uint32_t xcorr_min_overlap_frac_q16;
+    uint32_t hybrid_alpha_q16;
+    uint32_t reject_margin_q16;
+    uint32_t reject_grace_q16;
+    char unknown_label[ACTION_MODEL_LABEL_LEN];
+    char labels[ACTION_MODEL_MAX_LABELS][ACTION_MODEL_LABEL_LEN];
+    bool has_threshold[ACTION_MODEL_MAX_LABELS];
+    uint64_t thresholds[ACTION_MODEL_MAX_LABELS];
+    action_model_ref_t refs[ACTION_MODEL_MAX_REFS];
+} action_model_t;
+
+typedef enum {
+    ACTION_REJECT_NONE = 0,
+    ACTION_REJECT_NO_SCORES,
+    ACTION_REJECT_ABOVE_THRESHOLD,
+    ACTION_REJECT_MARGIN,
+} action_reject_t;
+
+typedef struct {
+    int label;                 // accepted label index, -1 when rejected
+    int best_label;            // best-scoring label before gating, -1 if none
+    action_reject_t reject;
+    uint64_t best_score;
+    uint64_t second_score;     // UINT64_MAX when there is no runner-up
+    uint64_t label_scores[ACTION_MODEL_MAX_LABELS];
+} action_result_t;
+
+// Scratch space for one classification; large, so keep it static.
+typedef struct {
+    int16_t query[ACTION_MODEL_MAX_POINTS * ACTION_MODEL_DIMS];
+    uint64_t row[2][ACTION_MODEL_MAX_POINTS + 1];
+    uint64_t ref_dtw[ACTION_MODEL_MAX_REFS];
+    int32_t ref_xcorr[ACTION_MODEL_MAX_REFS];
+} action_classifier_work_t;
+
+// Parses a model blob in place; blob must stay valid and be 2-byte aligned.
+bool action_model_load(action_model_t *m, const uint8_t *blob, size_t len);
+
+// Resamples n raw samples from src_rate_hz to the model rate (0 = as is),
+// downsamples to max_points and z-normalizes into work->query.
+// Returns the query length in points (0 if n == 0).
+size_t action_classifier_prep(const action_model_t *m, const bmi270_sample_t *in, size_t n,
+                              uint32_t src_rate_hz, action_classifier_work_t *work);
+
+// Scores work->query (query_len points) against every reference except
+// skip_ref (-1 for none) and applies rejection gating.
+void action_classifier_classify(const action_model_t *m, action_classifier_work_t *work,
+                                size_t query_len, int skip_ref, action_result_t *out);
+
+// Label name for an index, or the model's unknown label for -1.
+const char *action_model_label(const action_model_t *m, int label);
+
+#ifdef __cplusplus
+}
+#endif
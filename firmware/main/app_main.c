@@ -11,6 +11,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_system.h"
 #include "esp_timer.h"
@@ -19,19 +20,50 @@
 #include "sdkconfig.h"
 
 #include "bmi270_i2c.h"
+#include "imu_ring.h"
+#include "motion_trigger.h"
+#include "action_classifier.h"
 #include "udp_sender.h"
 #include "speaker_audio.h"
+#include "audio_jitter.h"
+#include "audio_adpcm.h"
 #include "label_audio.h"
 
 // ESP-SensairShuttle v1.0: SDA -> GPIO2, SCL -> GPIO3 (per factory_demo)
 #define I2C_SDA_PIN 2
 #define I2C_SCL_PIN 3
 #define I2C_PORT    I2C_NUM_0
+#define I2C_CLK_HZ  CONFIG_ACTION_I2C_CLK_HZ
 
-#define SAMPLE_RATE_HZ 200
+#define IMU_ODR_HZ BMI270_ODR_HZ
+#define SAMPLE_RING_LEN 256
+#define HEARTBEAT_PERIOD_MS 1000
+#if CONFIG_ACTION_IMU_ACQ_FIFO
+#define IMU_FIFO_WATERMARK_FRAMES CONFIG_ACTION_IMU_FIFO_WATERMARK_FRAMES
+#define IMU_FIFO_DRAIN_MS ((1000 * IMU_FIFO_WATERMARK_FRAMES) / IMU_ODR_HZ)
+// At least one tick: xTaskDelayUntil() asserts on a zero increment, and a
+// small watermark at a high ODR is shorter than a 100 Hz tick.
+#define IMU_FIFO_DRAIN_TICKS (pdMS_TO_TICKS(IMU_FIFO_DRAIN_MS) > 0 ? pdMS_TO_TICKS(IMU_FIFO_DRAIN_MS) : 1)
+#define IMU_FIFO_BATCH_MAX (BMI270_FIFO_SIZE_BYTES / BMI270_FIFO_FRAME_BYTES + 1)
+#endif
+#if CONFIG_ACTION_MOTION_TRIGGER
+#define MOTION_PRE_SAMPLES ((CONFIG_ACTION_MOTION_PRE_MS * IMU_ODR_HZ + 500) / 1000 > 0 ? \
+                            (CONFIG_ACTION_MOTION_PRE_MS * IMU_ODR_HZ + 500) / 1000 : 1)
+#define MOTION_IDLE_SUMMARY_MS CONFIG_ACTION_MOTION_IDLE_SUMMARY_MS
+#endif
+#if CONFIG_ACTION_ONDEVICE_CLASSIFIER
+#define CLASSIFY_WINDOW_MAX CONFIG_ACTION_CLASSIFIER_MAX_WINDOW_SAMPLES
+#endif
 #define AUDIO_CMD_PORT CONFIG_ACTION_AUDIO_CMD_PORT
 #define AUDIO_IDLE_STOP_MS 1500
-#define AUDIO_MAX_GAP_PACKETS 24
+#define AUDIO_RELEASE_WAIT_MS 200
+// 16 slots of up to 1024 samples: 40 ms packets at 24 kHz fit with room to spare.
+#define AUDIO_JB_SLOTS 16
+#define AUDIO_JB_SLOT_SAMPLES 1024
+#define AUDIO_PLAYOUT_FRAME_MS 10
+#define AUDIO_PLAYOUT_FRAME_MAX 480   // 10 ms at 48 kHz
+#define AUDIO_EVT_START   (1u << 0)
+#define AUDIO_EVT_RELEASE (1u << 1)
 
 #define PKT_MAGIC_START "AUDS"
 #define PKT_MAGIC_DATA  "AUDD"
@@ -44,11 +76,37 @@
 
 static const char *TAG = "action_detect";
 
-static QueueHandle_t sample_q;
+static bmi270_sample_t s_sample_storage[SAMPLE_RING_LEN];
+static imu_ring_t s_sample_ring;
+static TaskHandle_t s_udp_task = NULL;
 static QueueHandle_t label_cmd_q;
 static bmi270_ctx_t s_bmi;
 static udp_sender_t s_udp;
 static bool s_bmi_present = false;
+#if CONFIG_ACTION_MOTION_TRIGGER
+static bmi270_sample_t s_motion_pre[MOTION_PRE_SAMPLES];
+static motion_trigger_t s_motion;
+#endif
+#if CONFIG_ACTION_ONDEVICE_CLASSIFIER
+extern const uint8_t _binary_action_model_bin_start[] asm("_binary_action_model_bin_start");
+extern const uint8_t _binary_action_model_bin_end[] asm("_binary_action_model_bin_end");
+static action_model_t s_model;
+static bool s_model_ready = false;
+static action_classifier_work_t s_classify_work;
+// Segment window handed from udp_task to classify_task; busy until classified.
+static bmi270_sample_t s_window[CLASSIFY_WINDOW_MAX];
+static size_t s_window_len;
+static bool s_window_recording;
+static volatile bool s_window_busy;
+static TaskHandle_t s_classify_task = NULL;
+#endif
+
+static int16_t s_jb_pcm[(AUDIO_JB_SLOTS + 1) * AUDIO_JB_SLOT_SAMPLES];
+static audio_jb_t s_jb;
+static SemaphoreHandle_t s_jb_lock;
+static TaskHandle_t s_playout_task = NULL;
+static volatile bool s_playout_busy;
+static volatile int64_t s_audio_max_rx_gap_us;
 
 #if CONFIG_FREERTOS_UNICORE
 #define APP_TASK_CORE 0
@@ -63,36 +121,206 @@ static void stop_speaker_safely(void)
     speaker_audio_stop();
 }
 
+#if CONFIG_ACTION_IMU_ACQ_FIFO
+static void sampling_task(void *arg)
+{
+    bmi270_ctx_t *bmi = (bmi270_ctx_t *)arg;
+    static bmi270_sample_t batch[IMU_FIFO_BATCH_MAX];
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        // Sensor buffers ~IMU_FIFO_WATERMARK_FRAMES frames between drains;
+        // timestamps come from FIFO sensortime, not from this wake-up.
+        vTaskDelayUntil(&last_wake, IMU_FIFO_DRAIN_TICKS);
+        int n = bmi270_fifo_read(bmi, batch, IMU_FIFO_BATCH_MAX);
+        for (int i = 0; i < n; ++i) {
+            imu_ring_push(&s_sample_ring, &batch[i]);
+        }
+        if (n > 0) {
+            // One wake-up per burst instead of one queue operation per sample.
+            xTaskNotifyGive(s_udp_task);
+        }
+    }
+}
+#else
+static void sample_timer_cb(void *arg)
+{
+    xTaskNotifyGive((TaskHandle_t)arg);
+}
+
 static void sampling_task(void *arg)
 {
     bmi270_ctx_t *bmi = (bmi270_ctx_t *)arg;
+    // Periodic esp_timer at the sensor ODR: no tick-granularity drift like vTaskDelay.
+    esp_timer_handle_t timer = NULL;
+    const esp_timer_create_args_t timer_args = {
+        .callback = sample_timer_cb,
+        .arg = xTaskGetCurrentTaskHandle(),
+        .name = "imu_sample",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(timer, 1000000 / IMU_ODR_HZ));
+    uint32_t duplicates = 0;
     while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
         int64_t ts_us = esp_timer_get_time();
         bmi270_sample_t s = {0};
-        if (bmi270_read_sample(bmi, &s) == 0) {
+        int rc = bmi270_read_sample(bmi, &s);
+        if (rc == 0) {
             s.ts_us = ts_us;
-            xQueueSend(sample_q, &s, 0);
+            imu_ring_push(&s_sample_ring, &s);
+            xTaskNotifyGive(s_udp_task);
+        } else if (rc == 1) {
+            // Timer ran ahead of the sensor clock; nothing new to ship.
+            duplicates++;
+            ESP_LOGD(TAG, "imu sample not ready (duplicates=%u)", (unsigned)duplicates);
         }
-        // Simple fixed-rate loop. For tighter timing, use esp_timer periodic callback.
-        vTaskDelay(pdMS_TO_TICKS(1000 / SAMPLE_RATE_HZ));
     }
 }
+#endif
+
+static void stream_sample(void *user, const bmi270_sample_t *s)
+{
+    udp_sender_t *udp = (udp_sender_t *)user;
+#if UDP_FRAME_BATCHING
+    udp_sender_batch_push(udp, s);
+#else
+    udp_sender_send_sample(udp, s);
+#endif
+}
+
+#if CONFIG_ACTION_MOTION_TRIGGER
+static void motion_trigger_setup(void)
+{
+    const motion_trigger_cfg_t cfg = {
+        .on_thresh = CONFIG_ACTION_MOTION_ON_THRESH,
+        .off_thresh = CONFIG_ACTION_MOTION_OFF_THRESH,
+        .on_hold = CONFIG_ACTION_MOTION_ON_HOLD,
+        .off_hold = CONFIG_ACTION_MOTION_OFF_HOLD,
+        .pre_samples = MOTION_PRE_SAMPLES,
+        .post_us = CONFIG_ACTION_MOTION_POST_MS * 1000LL,
+        .min_action_us = CONFIG_ACTION_MOTION_MIN_ACTION_MS * 1000LL,
+        .max_action_us = CONFIG_ACTION_MOTION_MAX_ACTION_MS * 1000LL,
+    };
+    bool ok = motion_trigger_init(&s_motion, &cfg, s_motion_pre);
+    if (!ok) {
+        ESP_LOGE(TAG, "motion trigger: on threshold below off threshold");
+    }
+    configASSERT(ok);
+}
+
+static void emit_segment_sample(void *user, const bmi270_sample_t *s)
+{
+    if (s_motion.segment_samples == 0) {
+        // First sample of a new segment: delimit it before any of its frames.
+        udp_sender_send_segment_start((udp_sender_t *)user, s_motion.segment_id,
+                                      s_motion.trigger_ts_us, s_motion.pre_len);
+#if CONFIG_ACTION_ONDEVICE_CLASSIFIER
+        // A segment that starts while the previous one is still being classified is skipped.
+        s_window_recording = s_model_ready && !s_window_busy;
+        s_window_len = 0;
+#endif
+    }
+#if CONFIG_ACTION_ONDEVICE_CLASSIFIER
+    if (s_window_recording && s_window_len < CLASSIFY_WINDOW_MAX) {
+        s_window[s_window_len++] = *s;
+    }
+#endif
+    stream_sample(user, s);
+}
+
+static void gate_sample(udp_sender_t *udp, const bmi270_sample_t *s)
+{
+    if (motion_trigger_push(&s_motion, s, emit_segment_sample, udp) != MOTION_TRIGGER_END) {
+        return;
+    }
+#if UDP_FRAME_BATCHING
+    udp_sender_batch_flush(udp);
+#endif
+    udp_sender_send_segment_end(udp, s_motion.segment_id, s->ts_us, s_motion.segment_samples,
+                                (uint16_t)s_motion.end_reason);
+    ESP_LOGI(TAG, "segment %u: %u samples", (unsigned)s_motion.segment_id,
+             (unsigned)s_motion.segment_samples);
+#if CONFIG_ACTION_ONDEVICE_CLASSIFIER
+    if (s_window_recording) {
+        if (s_motion.segment_samples > CLASSIFY_WINDOW_MAX) {
+            ESP_LOGW(TAG, "segment %u truncated to %u samples for classification",
+                     (unsigned)s_motion.segment_id, (unsigned)CLASSIFY_WINDOW_MAX);
+        }
+        s_window_recording = false;
+        s_window_busy = true;
+        xTaskNotifyGive(s_classify_task);
+    }
+#endif
+}
+#endif
 
 static void udp_task(void *arg)
 {
     udp_sender_t *udp = (udp_sender_t *)arg;
-    bmi270_sample_t s;
     TickType_t last_hb = 0;
+    uint32_t last_dropped = 0;
+#if CONFIG_ACTION_MOTION_TRIGGER
+    TickType_t last_idle = 0;
+#endif
     while (1) {
-        if (xQueueReceive(sample_q, &s, pdMS_TO_TICKS(200)) == pdTRUE) {
-            udp_sender_send_sample(udp, &s);
-        } else {
-            TickType_t now = xTaskGetTickCount();
-            if (now - last_hb >= pdMS_TO_TICKS(1000)) {
-                udp_sender_send_heartbeat(udp, esp_timer_get_time());
-                last_hb = now;
+        // Heartbeats go out while streaming too; they advertise the sample rate
+        // and the audio codecs audio_cmd_task accepts.
+        TickType_t now = xTaskGetTickCount();
+        if (now - last_hb >= pdMS_TO_TICKS(HEARTBEAT_PERIOD_MS)) {
+            udp_sender_send_heartbeat(udp, esp_timer_get_time(), IMU_ODR_HZ, UDP_HB_CAP_AUDIO_ADPCM);
+            last_hb = now;
+            imu_ring_stats_t st = {0};
+            imu_ring_get_stats(&s_sample_ring, &st);
+            if (st.dropped != last_dropped) {
+                ESP_LOGW(TAG, "sample ring overflow: dropped=%u high_watermark=%u lag=%u",
+                         (unsigned)st.dropped, (unsigned)st.high_watermark, (unsigned)st.lag);
+                last_dropped = st.dropped;
+            }
+        }
+#if CONFIG_ACTION_MOTION_TRIGGER
+        // While idle nothing but these summaries and the heartbeat is sent.
+        if (!s_motion.active && now - last_idle >= pdMS_TO_TICKS(MOTION_IDLE_SUMMARY_MS)) {
+            motion_trigger_idle_t idle;
+            motion_trigger_take_idle(&s_motion, &idle);
+            udp_sender_send_idle_summary(udp, esp_timer_get_time(), &idle);
+            last_idle = now;
+        }
+#endif
+
+        TickType_t wait = pdMS_TO_TICKS(200);
+#if UDP_FRAME_BATCHING
+        // Wait at most until the pending frame's time budget runs out.
+        if (udp->batch_count > 0) {
+            // Sample timestamps follow the sensor clock; deadlines stay on esp_timer.
+            int64_t due_us = udp->batch_open_us + UDP_BATCH_MAX_MS * 1000LL;
+            int64_t left_us = due_us - esp_timer_get_time();
+            wait = left_us > 0 ? pdMS_TO_TICKS((left_us + 999) / 1000) : 0;
+            if (left_us > 0 && wait == 0) {
+                wait = 1;
             }
         }
+#endif
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        // Serialize straight from the ring's contiguous spans.
+        const bmi270_sample_t *span = NULL;
+        size_t n = 0;
+        while ((n = imu_ring_peek(&s_sample_ring, &span)) > 0) {
+            for (size_t i = 0; i < n; ++i) {
+#if CONFIG_ACTION_MOTION_TRIGGER
+                gate_sample(udp, &span[i]);
+#else
+                stream_sample(udp, &span[i]);
+#endif
+            }
+            imu_ring_commit(&s_sample_ring, n);
+        }
+#if UDP_FRAME_BATCHING
+        if (udp->batch_count > 0 &&
+            esp_timer_get_time() - udp->batch_open_us >= UDP_BATCH_MAX_MS * 1000LL) {
+            udp_sender_batch_flush(udp);
+        }
+#endif
     }
 }
 
@@ -109,18 +337,6 @@ static inline uint32_t read_le32(const uint8_t *p)
            ((uint32_t)p[3] << 24);
 }
 
-static void speaker_write_silence_samples(uint32_t samples)
-{
-    static const int16_t zeros[256] = {0};
-    while (samples > 0) {
-        size_t n = samples > 256 ? 256 : samples;
-        if (speaker_audio_write_samples(zeros, n) != ESP_OK) {
-            break;
-        }
-        samples -= (uint32_t)n;
-    }
-}
-
 typedef struct {
     char label[LABEL_MAX_LEN + 1];
 } label_cmd_t;
@@ -139,7 +355,7 @@ static void play_local_label_audio(const char *label)
     }
     // Warm-up silence prevents PA ramp-up from eating the first syllable.
     speaker_audio_write_silence_ms(LABEL_PLAY_WARMUP_MS);
-    err = speaker_audio_write_samples(clip.samples, clip.sample_count);
+    err = speaker_audio_write_pregained(clip.samples, clip.sample_count);
     if (err != ESP_OK) {
         ESP_LOGW(TAG, "speaker write failed for label=%s err=%s", label, esp_err_to_name(err));
     }
@@ -159,6 +375,171 @@ static void label_play_task(void *arg)
     }
 }
 
+static void enqueue_label_cmd(const label_cmd_t *cmd)
+{
+    if (xQueueSend(label_cmd_q, cmd, 0) != pdTRUE) {
+        label_cmd_t dropped = {0};
+        if (xQueueReceive(label_cmd_q, &dropped, 0) == pdTRUE &&
+            xQueueSend(label_cmd_q, cmd, 0) == pdTRUE) {
+            ESP_LOGW(TAG, "label queue full, dropped oldest=%s", dropped.label);
+        } else {
+            ESP_LOGW(TAG, "label queue full, dropping current=%s", cmd->label);
+        }
+    }
+}
+
+#if CONFIG_ACTION_ONDEVICE_CLASSIFIER
+static void classify_task(void *arg)
+{
+    (void)arg;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t t0 = esp_timer_get_time();
+        size_t points = action_classifier_prep(&s_model, s_window, s_window_len, IMU_ODR_HZ,
+                                               &s_classify_work);
+        action_result_t res;
+        action_classifier_classify(&s_model, &s_classify_work, points, -1, &res);
+        size_t samples = s_window_len;
+        s_window_busy = false;
+
+        const char *label = action_model_label(&s_model, res.label);
+        ESP_LOGI(TAG, "on-device prediction=%s best=%s reject=%d samples=%u points=%u us=%u",
+                 label, action_model_label(&s_model, res.best_label), (int)res.reject,
+                 (unsigned)samples, (unsigned)points, (unsigned)(esp_timer_get_time() - t0));
+        if (res.label >= 0) {
+            label_cmd_t cmd = {0};
+            strlcpy(cmd.label, label, sizeof(cmd.label));
+            enqueue_label_cmd(&cmd);
+        }
+    }
+}
+#endif
+
+static void jitter_lock(void)
+{
+    xSemaphoreTake(s_jb_lock, portMAX_DELAY);
+}
+
+static void jitter_unlock(void)
+{
+    xSemaphoreGive(s_jb_lock);
+}
+
+static size_t playout_frame_len(uint32_t rate)
+{
+    size_t n = (size_t)((rate * AUDIO_PLAYOUT_FRAME_MS) / 1000);
+    if (n == 0) {
+        n = 1;
+    }
+    return n > AUDIO_PLAYOUT_FRAME_MAX ? AUDIO_PLAYOUT_FRAME_MAX : n;
+}
+
+// Feeds I2S from the jitter buffer at the stream rate. Only this task writes
+// stream audio, so a slow I2S write never holds up packet reception.
+static void audio_playout_task(void *arg)
+{
+    (void)arg;
+    static int16_t frame[AUDIO_PLAYOUT_FRAME_MAX];
+    bool speaker_on = false;
+    while (1) {
+        uint32_t events = 0;
+        // Keep PA/I2S alive between phrases; repeated start/stop causes pop.
+        TickType_t wait = speaker_on ? pdMS_TO_TICKS(AUDIO_IDLE_STOP_MS) : portMAX_DELAY;
+        if (xTaskNotifyWait(0, UINT32_MAX, &events, wait) != pdTRUE || (events & AUDIO_EVT_RELEASE)) {
+            if (speaker_on) {
+                stop_speaker_safely();
+                speaker_on = false;
+            }
+            if (!(events & AUDIO_EVT_START)) {
+                s_playout_busy = false;
+                continue;
+            }
+        }
+        s_playout_busy = true;
+
+        jitter_lock();
+        uint32_t rate = s_jb.sample_rate_hz;
+        jitter_unlock();
+        esp_err_t err = speaker_audio_start(rate);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "speaker start failed: %s", esp_err_to_name(err));
+            jitter_lock();
+            audio_jb_stop(&s_jb);
+            jitter_unlock();
+            speaker_on = false;
+            s_playout_busy = false;
+            continue;
+        }
+        if (!speaker_on) {
+            // Prime a short silence to reduce pop at stream start.
+            speaker_audio_write_silence_ms(8);
+            speaker_on = true;
+        }
+
+        size_t frame_len = playout_frame_len(rate);
+        uint32_t write_errors = 0;
+        while (1) {
+            jitter_lock();
+            audio_jb_pull_t st = audio_jb_pull(&s_jb, frame, frame_len);
+            uint32_t cur_rate = s_jb.sample_rate_hz;
+            jitter_unlock();
+            if (st == AUDIO_JB_PULL_DONE) {
+                break;
+            }
+            if (speaker_audio_write_samples(frame, frame_len) != ESP_OK) {
+                write_errors++;
+            }
+            if (cur_rate != rate) {
+                // A new AUDS restarted the buffer at another rate.
+                rate = cur_rate;
+                if (speaker_audio_start(rate) != ESP_OK) {
+                    write_errors++;
+                }
+                frame_len = playout_frame_len(rate);
+            }
+        }
+        speaker_audio_write_silence_ms(18);
+
+        audio_jb_stats_t st;
+        jitter_lock();
+        audio_jb_get_stats(&s_jb, &st);
+        jitter_unlock();
+        ESP_LOGI(
+            TAG,
+            "audio stream end: sr=%u pkts=%u played=%u concealed=%u underruns=%u overruns=%u "
+            "late=%u dup=%u resyncs=%u target_ms=%u max_depth_ms=%u write_err=%u max_rx_gap_ms=%.1f",
+            (unsigned)rate,
+            (unsigned)st.received,
+            (unsigned)st.played,
+            (unsigned)st.concealed,
+            (unsigned)st.underruns,
+            (unsigned)st.overruns,
+            (unsigned)st.late,
+            (unsigned)st.duplicates,
+            (unsigned)st.resyncs,
+            (unsigned)st.target_ms,
+            (unsigned)st.max_depth_ms,
+            (unsigned)write_errors,
+            s_audio_max_rx_gap_us / 1000.0f
+        );
+    }
+}
+
+// Stops stream playback and waits (bounded) for the playout task to let go
+// of the speaker, so local label clips do not fight over I2S.
+static void release_stream_playout(void)
+{
+    jitter_lock();
+    audio_jb_stop(&s_jb);
+    jitter_unlock();
+    xTaskNotify(s_playout_task, AUDIO_EVT_RELEASE, eSetBits);
+    for (int i = 0; i < AUDIO_RELEASE_WAIT_MS / 10 && s_playout_busy; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+// Network side of the speaker stream: slots AUDD payloads into the jitter
+// buffer and never touches I2S itself.
 static void audio_cmd_task(void *arg)
 {
     (void)arg;
@@ -189,21 +570,12 @@ static void audio_cmd_task(void *arg)
     setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
     ESP_LOGI(TAG, "audio cmd listen on UDP %d", AUDIO_CMD_PORT);
 
-    uint8_t buf[1200];
+    static uint8_t buf[8 + AUDIO_JB_SLOT_SAMPLES * sizeof(int16_t)];
+    static int16_t decoded[AUDIO_JB_SLOT_SAMPLES];
+    uint8_t stream_codec = AUDIO_CODEC_PCM16;
     bool audio_active = false;
-    bool have_expected_seq = false;
-    uint16_t expected_seq = 0;
-    uint16_t last_packet_samples = 0;
     int64_t last_audio_rx_us = 0;
-    uint32_t stream_rate = 0;
-    uint32_t data_packets = 0;
-    uint32_t data_samples = 0;
-    uint32_t gap_packets = 0;
-    uint32_t late_packets = 0;
-    uint32_t jump_events = 0;
-    uint32_t write_errors = 0;
     int64_t last_data_rx_us = 0;
-    int64_t max_data_rx_gap_us = 0;
     while (1) {
         struct sockaddr_in from = {0};
         socklen_t from_len = sizeof(from);
@@ -212,31 +584,10 @@ static void audio_cmd_task(void *arg)
             if ((errno == EAGAIN || errno == EWOULDBLOCK) && audio_active) {
                 int64_t now_us = esp_timer_get_time();
                 if ((now_us - last_audio_rx_us) >= (AUDIO_IDLE_STOP_MS * 1000LL)) {
-                    stop_speaker_safely();
-                    ESP_LOGI(
-                        TAG,
-                        "audio stream stop(idle): sr=%u pkts=%u samples=%u gap_pkts=%u late=%u jumps=%u write_err=%u max_rx_gap_ms=%.1f",
-                        stream_rate,
-                        data_packets,
-                        data_samples,
-                        gap_packets,
-                        late_packets,
-                        jump_events,
-                        write_errors,
-                        max_data_rx_gap_us / 1000.0f
-                    );
+                    // Stream went quiet without AUDE.
+                    ESP_LOGI(TAG, "audio stream stop(idle)");
+                    release_stream_playout();
                     audio_active = false;
-                    have_expected_seq = false;
-                    last_packet_samples = 0;
-                    stream_rate = 0;
-                    data_packets = 0;
-                    data_samples = 0;
-                    gap_packets = 0;
-                    late_packets = 0;
-                    jump_events = 0;
-                    write_errors = 0;
-                    last_data_rx_us = 0;
-                    max_data_rx_gap_us = 0;
                 }
             }
             continue;
@@ -251,121 +602,75 @@ static void audio_cmd_task(void *arg)
             memcpy(cmd.label, buf + 4, n);
             cmd.label[n] = '\0';
 
-            // If stream mode was previously active, reset it before local playback queue.
-            if (audio_active) {
-                stop_speaker_safely();
+            // Release the speaker from stream mode before local playback.
+            if (audio_active || s_playout_busy) {
+                release_stream_playout();
                 audio_active = false;
-                have_expected_seq = false;
-                last_packet_samples = 0;
-                stream_rate = 0;
-                data_packets = 0;
-                data_samples = 0;
-                gap_packets = 0;
-                late_packets = 0;
-                jump_events = 0;
-                write_errors = 0;
-                last_data_rx_us = 0;
-                max_data_rx_gap_us = 0;
-            }
-            if (xQueueSend(label_cmd_q, &cmd, 0) != pdTRUE) {
-                label_cmd_t dropped = {0};
-                if (xQueueReceive(label_cmd_q, &dropped, 0) == pdTRUE &&
-                    xQueueSend(label_cmd_q, &cmd, 0) == pdTRUE) {
-                    ESP_LOGW(TAG, "label queue full, dropped oldest=%s", dropped.label);
-                } else {
-                    ESP_LOGW(TAG, "label queue full, dropping current=%s", cmd.label);
-                }
             }
+            enqueue_label_cmd(&cmd);
             continue;
         }
         if (len >= 8 && memcmp(buf, PKT_MAGIC_START, 4) == 0) {
             uint32_t sample_rate = read_le32(buf + 4);
-            esp_err_t err = speaker_audio_start(sample_rate);
-            if (err != ESP_OK) {
-                ESP_LOGW(TAG, "speaker start failed: %s", esp_err_to_name(err));
-            } else {
-                audio_active = true;
-                have_expected_seq = false;
-                last_packet_samples = 0;
-                stream_rate = sample_rate;
-                data_packets = 0;
-                data_samples = 0;
-                gap_packets = 0;
-                late_packets = 0;
-                jump_events = 0;
-                write_errors = 0;
-                last_data_rx_us = 0;
-                max_data_rx_gap_us = 0;
-                // Prime a short silence to reduce pop at stream start.
-                speaker_audio_write_silence_ms(8);
+            if (sample_rate == 0) {
+                sample_rate = CONFIG_ACTION_LABEL_AUDIO_SAMPLE_RATE;
+            }
+            // Optional trailing codec byte; plain 8-byte AUDS means PCM16.
+            uint8_t codec = len >= 9 ? buf[8] : AUDIO_CODEC_PCM16;
+            if (codec != AUDIO_CODEC_PCM16 && codec != AUDIO_CODEC_IMA_ADPCM) {
+                ESP_LOGW(TAG, "audio stream codec %u not supported", (unsigned)codec);
+                continue;
             }
+            stream_codec = codec;
+            jitter_lock();
+            audio_jb_start(&s_jb, sample_rate);
+            jitter_unlock();
+            audio_active = true;
+            last_data_rx_us = 0;
+            s_audio_max_rx_gap_us = 0;
+            xTaskNotify(s_playout_task, AUDIO_EVT_START, eSetBits);
             continue;
         }
         if (len >= 8 && memcmp(buf, PKT_MAGIC_DATA, 4) == 0) {
             uint16_t seq = read_le16(buf + 4);
             uint16_t samples = read_le16(buf + 6);
-            size_t bytes = (size_t)samples * sizeof(int16_t);
-            if ((size_t)len < 8 + bytes) {
+            size_t bytes = stream_codec == AUDIO_CODEC_IMA_ADPCM ? AUDIO_ADPCM_BLOCK_BYTES((size_t)samples)
+                                                                 : (size_t)samples * sizeof(int16_t);
+            if ((size_t)len < 8 + bytes || samples > AUDIO_JB_SLOT_SAMPLES) {
                 continue;
             }
             if (!audio_active) {
                 continue;
             }
+            const int16_t *pcm = (const int16_t *)(buf + 8);
+            if (stream_codec == AUDIO_CODEC_IMA_ADPCM) {
+                if (audio_adpcm_decode_block(buf + 8, bytes, samples, decoded) != samples) {
+                    continue;
+                }
+                pcm = decoded;
+            }
             int64_t now_data_rx_us = esp_timer_get_time();
             if (last_data_rx_us > 0) {
                 int64_t dt_us = now_data_rx_us - last_data_rx_us;
-                if (dt_us > max_data_rx_gap_us) {
-                    max_data_rx_gap_us = dt_us;
+                if (dt_us > s_audio_max_rx_gap_us) {
+                    s_audio_max_rx_gap_us = dt_us;
                 }
             }
             last_data_rx_us = now_data_rx_us;
-            if (have_expected_seq) {
-                int16_t delta = (int16_t)(seq - expected_seq);
-                if (delta > 0 && delta <= AUDIO_MAX_GAP_PACKETS && last_packet_samples > 0) {
-                    // Fill small packet gaps with zeros to avoid sharp discontinuities.
-                    uint32_t missing_samples = (uint32_t)delta * (uint32_t)last_packet_samples;
-                    gap_packets += (uint32_t)delta;
-                    speaker_write_silence_samples(missing_samples);
-                } else if (delta < 0 && (-delta) <= AUDIO_MAX_GAP_PACKETS) {
-                    // Late or duplicate packet; drop it to keep timeline monotonic.
-                    late_packets += (uint32_t)(-delta);
-                    continue;
-                } else if (delta != 0) {
-                    // Large jump: re-sync on current sequence id.
-                    jump_events++;
-                    ESP_LOGD(TAG, "audio seq jump exp=%u got=%u", expected_seq, seq);
-                }
-            }
-            const int16_t *pcm = (const int16_t *)(buf + 8);
-            esp_err_t err = speaker_audio_write_samples(pcm, samples);
-            if (err != ESP_OK) {
-                write_errors++;
-                ESP_LOGD(TAG, "speaker write failed seq=%u err=%s", seq, esp_err_to_name(err));
+            jitter_lock();
+            audio_jb_put_t put = audio_jb_put(&s_jb, seq, pcm, samples);
+            jitter_unlock();
+            if (put == AUDIO_JB_PUT_INVALID) {
+                ESP_LOGD(TAG, "audio packet seq=%u samples=%u rejected", seq, samples);
             }
-            data_packets++;
-            data_samples += samples;
-            expected_seq = (uint16_t)(seq + 1);
-            have_expected_seq = true;
-            last_packet_samples = samples;
             continue;
         }
         if (len >= 6 && memcmp(buf, PKT_MAGIC_END, 4) == 0) {
-            // Keep PA/I2S alive briefly; repeated start/stop causes pop.
-            speaker_audio_write_silence_ms(18);
-            ESP_LOGI(
-                TAG,
-                "audio stream end: sr=%u pkts=%u samples=%u gap_pkts=%u late=%u jumps=%u write_err=%u max_rx_gap_ms=%.1f",
-                stream_rate,
-                data_packets,
-                data_samples,
-                gap_packets,
-                late_packets,
-                jump_events,
-                write_errors,
-                max_data_rx_gap_us / 1000.0f
-            );
-            have_expected_seq = false;
-            last_packet_samples = 0;
+            // Playout drains what is queued and logs the stream stats.
+            jitter_lock();
+            audio_jb_end(&s_jb);
+            jitter_unlock();
+            audio_active = false;
             continue;
         }
     }
@@ -384,8 +689,13 @@ void app_main(void)
 
     // TODO: implement Wi-Fi station connect in udp_sender_init (or separate wifi module)
 
-    ESP_ERROR_CHECK(bmi270_i2c_init(&s_bmi, I2C_PORT, I2C_SDA_PIN, I2C_SCL_PIN));
+    ESP_ERROR_CHECK(bmi270_i2c_init(&s_bmi, I2C_PORT, I2C_SDA_PIN, I2C_SCL_PIN, I2C_CLK_HZ));
     esp_err_t bmi_err = bmi270_config_default(&s_bmi);
+#if CONFIG_ACTION_IMU_ACQ_FIFO
+    if (bmi_err == ESP_OK) {
+        bmi_err = bmi270_fifo_enable(&s_bmi, IMU_FIFO_WATERMARK_FRAMES);
+    }
+#endif
     s_bmi_present = (bmi_err == ESP_OK);
     if (!s_bmi_present) {
         ESP_LOGW(TAG, "BMI270 not found on I2C (addr 0x%02x), disabling sampling task", s_bmi.addr);
@@ -394,15 +704,47 @@ void app_main(void)
     ESP_ERROR_CHECK(udp_sender_init(&s_udp));
     ESP_ERROR_CHECK(speaker_audio_init());
 
-    sample_q = xQueueCreate(256, sizeof(bmi270_sample_t));
-    configASSERT(sample_q);
+    bool ring_ok = imu_ring_init(&s_sample_ring, s_sample_storage, SAMPLE_RING_LEN);
+    configASSERT(ring_ok);
+#if CONFIG_ACTION_MOTION_TRIGGER
+    motion_trigger_setup();
+#endif
+#if CONFIG_ACTION_ONDEVICE_CLASSIFIER
+    size_t model_len = (size_t)(_binary_action_model_bin_end - _binary_action_model_bin_start);
+    s_model_ready = action_model_load(&s_model, _binary_action_model_bin_start, model_len);
+    if (s_model_ready) {
+        ESP_LOGI(TAG, "on-device model: labels=%u refs=%u max_points=%u",
+                 (unsigned)s_model.label_count, (unsigned)s_model.ref_count,
+                 (unsigned)s_model.max_points);
+    } else {
+        ESP_LOGW(TAG, "on-device model invalid (%u bytes), classifier disabled", (unsigned)model_len);
+    }
+#endif
     label_cmd_q = xQueueCreate(LABEL_CMD_QUEUE_LEN, sizeof(label_cmd_t));
     configASSERT(label_cmd_q);
+    const audio_jb_cfg_t jb_cfg = {
+        .min_depth_ms = CONFIG_ACTION_AUDIO_JITTER_MIN_MS,
+        .max_depth_ms = CONFIG_ACTION_AUDIO_JITTER_MAX_MS,
+    };
+    bool jb_ok = audio_jb_init(&s_jb, &jb_cfg, s_jb_pcm, AUDIO_JB_SLOTS, AUDIO_JB_SLOT_SAMPLES);
+    configASSERT(jb_ok);
+    s_jb_lock = xSemaphoreCreateMutex();
+    configASSERT(s_jb_lock);
 
+    // Consumers first: sampling_task notifies udp_task, udp_task notifies classify_task.
+#if CONFIG_ACTION_ONDEVICE_CLASSIFIER
+    if (s_model_ready) {
+        // Below the streaming tasks: a long DTW pass must not back up the sample ring.
+        xTaskCreatePinnedToCore(classify_task, "classify_task", 4096, NULL, 4, &s_classify_task,
+                                APP_TASK_CORE);
+    }
+#endif
+    xTaskCreatePinnedToCore(udp_task, "udp_task", 4096, &s_udp, 5, &s_udp_task, APP_TASK_CORE);
     if (s_bmi_present) {
         xTaskCreatePinnedToCore(sampling_task, "sampling_task", 4096, &s_bmi, 5, NULL, APP_TASK_CORE);
     }
-    xTaskCreatePinnedToCore(udp_task, "udp_task", 4096, &s_udp, 5, NULL, APP_TASK_CORE);
     xTaskCreatePinnedToCore(label_play_task, "label_play_task", 4096, NULL, 5, NULL, APP_TASK_CORE);
+    xTaskCreatePinnedToCore(audio_playout_task, "audio_playout_task", 4096, NULL, 5, &s_playout_task,
+                            APP_TASK_CORE);
     xTaskCreatePinnedToCore(audio_cmd_task, "audio_cmd_task", 4096, NULL, 5, NULL, APP_TASK_CORE);
 }
@@ -0,0 +1,104 @@
+#include "audio_adpcm.h"
+
+static const int16_t k_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+static const int8_t k_index_table[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+typedef struct {
+    int32_t predictor;
+    int32_t index;
+} adpcm_state_t;
+
+// Applies one code to the state; shared by the encoder and decoder so they
+// track the same predictor.
+static inline int16_t adpcm_step(adpcm_state_t *st, uint8_t code)
+{
+    int32_t step = k_step_table[st->index];
+    int32_t delta = step >> 3;
+    if (code & 4) delta += step;
+    if (code & 2) delta += step >> 1;
+    if (code & 1) delta += step >> 2;
+    st->predictor += (code & 8) ? -delta : delta;
+    if (st->predictor > 32767) st->predictor = 32767;
+    else if (st->predictor < -32768) st->predictor = -32768;
+    st->index += k_index_table[code & 7];
+    if (st->index < 0) st->index = 0;
+    else if (st->index > 88) st->index = 88;
+    return (int16_t)st->predictor;
+}
+
+static inline uint8_t adpcm_quantize(const adpcm_state_t *st, int32_t sample)
+{
+    int32_t diff = sample - st->predictor;
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    int32_t step = k_step_table[st->index];
+    if (diff >= step) {
+        code |= 4;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 2;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 1;
+    }
+    return code;
+}
+
+size_t audio_adpcm_encode_block(const int16_t *pcm, size_t n, uint8_t *step_index,
+                                uint8_t *out, size_t cap)
+{
+    if (!pcm || n == 0 || !step_index || !out) return 0;
+    size_t bytes = AUDIO_ADPCM_BLOCK_BYTES(n);
+    if (cap < bytes) return 0;
+    adpcm_state_t st = {
+        .predictor = pcm[0],
+        .index = *step_index > 88 ? 88 : *step_index,
+    };
+    out[0] = (uint8_t)((uint16_t)pcm[0] & 0xFF);
+    out[1] = (uint8_t)((uint16_t)pcm[0] >> 8);
+    out[2] = (uint8_t)st.index;
+    out[3] = 0;
+    uint8_t *p = out + AUDIO_ADPCM_HEADER_BYTES;
+    for (size_t i = 1; i < n; ++i) {
+        uint8_t code = adpcm_quantize(&st, pcm[i]);
+        adpcm_step(&st, code);
+        if ((i & 1) != 0) {
+            *p = code;
+        } else {
+            *p++ |= (uint8_t)(code << 4);
+        }
+    }
+    *step_index = (uint8_t)st.index;
+    return bytes;
+}
+
+size_t audio_adpcm_decode_block(const uint8_t *in, size_t len, size_t n, int16_t *out)
+{
+    if (!in || !out || n == 0 || len < AUDIO_ADPCM_BLOCK_BYTES(n) || in[2] > 88) return 0;
+    adpcm_state_t st = {
+        .predictor = (int16_t)((uint16_t)in[0] | ((uint16_t)in[1] << 8)),
+        .index = in[2],
+    };
+    out[0] = (int16_t)st.predictor;
+    const uint8_t *p = in + AUDIO_ADPCM_HEADER_BYTES;
+    for (size_t i = 1; i < n; ++i) {
+        uint8_t code = (i & 1) != 0 ? (*p & 0x0F) : (*p++ >> 4);
+        out[i] = adpcm_step(&st, code);
+    }
+    return n;
+}
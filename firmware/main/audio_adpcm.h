@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// IMA-ADPCM blocks for the AUDS/AUDD speaker stream (codec AUDIO_CODEC_IMA_ADPCM).
+// Each AUDD payload is one self-contained block, so a lost packet does not
+// corrupt the next one:
+//   int16 first sample, uint8 step index (0..88), uint8 reserved,
+//   then sample_count - 1 4-bit codes, low nibble first.
+// About 3.9x smaller than PCM16. Platform-independent; pc/audio_adpcm.py
+// builds this file on the host and `pc/bench.py adpcm` measures it.
+
+#define AUDIO_CODEC_PCM16 0
+#define AUDIO_CODEC_IMA_ADPCM 1
+
+#define AUDIO_ADPCM_HEADER_BYTES 4
+#define AUDIO_ADPCM_BLOCK_BYTES(n) (AUDIO_ADPCM_HEADER_BYTES + (n) / 2)
+
+// Encodes n >= 1 samples. *step_index carries the quantizer step between
+// blocks (start at 0). Returns bytes written, 0 if cap is too small.
+size_t audio_adpcm_encode_block(const int16_t *pcm, size_t n, uint8_t *step_index,
+                                uint8_t *out, size_t cap);
+
+// Decodes a block holding n samples. Returns n, or 0 if the block is short
+// or malformed.
+size_t audio_adpcm_decode_block(const uint8_t *in, size_t len, size_t n, int16_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,292 @@
+#include "audio_jitter.h"
+
+#include <string.h>
+
+#define AUDIO_JB_STEP_MS 20          // target increase per underrun
+#define AUDIO_JB_RELAX_MS 10         // target decrease per clean run
+#define AUDIO_JB_RELAX_AFTER_MS 5000 // clean playout needed before relaxing
+#define AUDIO_JB_FADE_PACKETS 2      // concealment fades out over this many packets
+
+static uint32_t ms_to_samples(const audio_jb_t *jb, uint32_t ms)
+{
+    return (uint32_t)(((uint64_t)jb->sample_rate_hz * ms) / 1000);
+}
+
+// Most audio the slot window holds, at the packet length seen so far (the
+// slot size before the first packet). A deeper target could never be met.
+static uint32_t window_ms(const audio_jb_t *jb)
+{
+    uint32_t len = jb->last_len ? jb->last_len : jb->slot_samples;
+    if (jb->sample_rate_hz == 0) return UINT32_MAX;
+    return (uint32_t)(((uint64_t)jb->slot_count * len * 1000) / jb->sample_rate_hz);
+}
+
+static void set_target_ms(audio_jb_t *jb, uint32_t ms)
+{
+    if (ms < jb->cfg.min_depth_ms) ms = jb->cfg.min_depth_ms;
+    if (ms > jb->cfg.max_depth_ms) ms = jb->cfg.max_depth_ms;
+    if (ms > window_ms(jb)) ms = window_ms(jb);
+    jb->stats.target_ms = ms;
+    jb->target_samples = ms_to_samples(jb, ms);
+}
+
+static audio_jb_slot_t *slot_for(audio_jb_t *jb, uint16_t seq)
+{
+    return &jb->slots[seq % jb->slot_count];
+}
+
+static int16_t *slot_pcm(audio_jb_t *jb, uint16_t seq)
+{
+    return jb->pcm + (size_t)(seq % jb->slot_count) * jb->slot_samples;
+}
+
+static int16_t *conceal_pcm(audio_jb_t *jb)
+{
+    return jb->pcm + (size_t)jb->slot_count * jb->slot_samples;
+}
+
+static bool slot_ready(const audio_jb_t *jb, uint16_t seq)
+{
+    const audio_jb_slot_t *s = &jb->slots[seq % jb->slot_count];
+    return s->len != 0 && s->seq == seq;
+}
+
+static void clear_queue(audio_jb_t *jb)
+{
+    memset(jb->slots, 0, sizeof(jb->slots));
+    jb->have_seq = false;
+    jb->play_seq = 0;
+    jb->end_seq = 0;
+    jb->play_off = 0;
+    jb->lost_left = 0;
+    jb->playing = false;
+}
+
+bool audio_jb_init(audio_jb_t *jb, const audio_jb_cfg_t *cfg, int16_t *pcm_storage,
+                   uint16_t slot_count, uint16_t slot_samples)
+{
+    if (!jb || !cfg || !pcm_storage) return false;
+    if (slot_count < 2 || slot_count > AUDIO_JB_MAX_SLOTS || slot_samples == 0) return false;
+    memset(jb, 0, sizeof(*jb));
+    jb->cfg = *cfg;
+    // Independent menuconfig values; a minimum above the maximum means the maximum.
+    if (jb->cfg.min_depth_ms > jb->cfg.max_depth_ms) jb->cfg.min_depth_ms = jb->cfg.max_depth_ms;
+    jb->pcm = pcm_storage;
+    jb->slot_count = slot_count;
+    jb->slot_samples = slot_samples;
+    jb->stats.target_ms = jb->cfg.min_depth_ms;
+    return true;
+}
+
+void audio_jb_start(audio_jb_t *jb, uint32_t sample_rate_hz)
+{
+    uint32_t target_ms = jb->stats.target_ms;
+    clear_queue(jb);
+    memset(&jb->stats, 0, sizeof(jb->stats));
+    jb->open = true;
+    jb->ending = false;
+    jb->sample_rate_hz = sample_rate_hz;
+    jb->last_len = 0;
+    jb->conceal_pos = 0;
+    jb->clean_samples = 0;
+    set_target_ms(jb, target_ms);
+}
+
+void audio_jb_end(audio_jb_t *jb)
+{
+    jb->ending = true;
+}
+
+void audio_jb_stop(audio_jb_t *jb)
+{
+    jb->open = false;
+    clear_queue(jb);
+}
+
+uint32_t audio_jb_depth(const audio_jb_t *jb)
+{
+    if (!jb->open || !jb->have_seq) return 0;
+    uint32_t depth = 0;
+    uint16_t span = (uint16_t)(jb->end_seq - jb->play_seq);
+    for (uint16_t i = 0; i < span && i < jb->slot_count; ++i) {
+        uint16_t seq = (uint16_t)(jb->play_seq + i);
+        if (slot_ready(jb, seq)) {
+            depth += jb->slots[seq % jb->slot_count].len;
+        }
+    }
+    return depth > jb->play_off ? depth - jb->play_off : 0;
+}
+
+static void track_depth(audio_jb_t *jb)
+{
+    if (jb->sample_rate_hz == 0) return;
+    uint32_t ms = (uint32_t)(((uint64_t)audio_jb_depth(jb) * 1000) / jb->sample_rate_hz);
+    if (ms > jb->stats.max_depth_ms) jb->stats.max_depth_ms = ms;
+}
+
+audio_jb_put_t audio_jb_put(audio_jb_t *jb, uint16_t seq, const int16_t *pcm, size_t n)
+{
+    if (!jb->open) return AUDIO_JB_PUT_IDLE;
+    if (!pcm || n == 0 || n > jb->slot_samples) return AUDIO_JB_PUT_INVALID;
+    if (!jb->have_seq) {
+        jb->have_seq = true;
+        jb->play_seq = seq;
+        jb->end_seq = seq;
+    }
+
+    int16_t ahead = (int16_t)(seq - jb->play_seq);
+    int32_t far = 2 * (int32_t)jb->slot_count;
+    if (ahead < -far || ahead >= far) {
+        // Sender restarted or we fell far behind: start over on this packet.
+        clear_queue(jb);
+        jb->have_seq = true;
+        jb->play_seq = seq;
+        jb->end_seq = seq;
+        jb->stats.resyncs++;
+        ahead = 0;
+    }
+    if (ahead < 0 || (ahead == 0 && (jb->play_off > 0 || jb->lost_left > 0))) {
+        jb->stats.late++;
+        return AUDIO_JB_PUT_LATE;
+    }
+    while ((int16_t)(seq - jb->play_seq) >= (int16_t)jb->slot_count) {
+        // No room in the window: drop the oldest packet to stay near real time.
+        audio_jb_slot_t *old = slot_for(jb, jb->play_seq);
+        if (old->len != 0 && old->seq == jb->play_seq) {
+            old->len = 0;
+            jb->stats.overruns++;
+        }
+        jb->play_seq++;
+        jb->play_off = 0;
+        jb->lost_left = 0;
+    }
+
+    audio_jb_slot_t *s = slot_for(jb, seq);
+    if (s->len != 0 && s->seq == seq) {
+        jb->stats.duplicates++;
+        return AUDIO_JB_PUT_DUPLICATE;
+    }
+    memcpy(slot_pcm(jb, seq), pcm, n * sizeof(int16_t));
+    s->seq = seq;
+    s->len = (uint16_t)n;
+    if ((int16_t)(seq + 1 - jb->end_seq) > 0) {
+        jb->end_seq = (uint16_t)(seq + 1);
+    }
+    jb->stats.received++;
+    track_depth(jb);
+    return AUDIO_JB_PUT_OK;
+}
+
+// Repeats the last played packet, fading linearly to silence.
+static void conceal_fill(audio_jb_t *jb, int16_t *out, size_t n)
+{
+    const int16_t *src = conceal_pcm(jb);
+    uint32_t fade_len = (uint32_t)jb->last_len * AUDIO_JB_FADE_PACKETS;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t pos = jb->conceal_pos + (uint32_t)i;
+        if (pos >= fade_len) {
+            out[i] = 0;
+        } else {
+            out[i] = (int16_t)(((int32_t)src[pos % jb->last_len] * (int32_t)(fade_len - pos)) /
+                               (int32_t)fade_len);
+        }
+    }
+    if (jb->conceal_pos < fade_len) {
+        jb->conceal_pos += (uint32_t)n;
+    }
+}
+
+// Length to conceal for a lost packet: the last packet's, else the next queued one's.
+static uint32_t lost_packet_len(audio_jb_t *jb)
+{
+    if (jb->last_len != 0) return jb->last_len;
+    for (uint16_t seq = jb->play_seq; seq != jb->end_seq; ++seq) {
+        if (slot_ready(jb, seq)) return jb->slots[seq % jb->slot_count].len;
+    }
+    return jb->slot_samples;
+}
+
+audio_jb_pull_t audio_jb_pull(audio_jb_t *jb, int16_t *out, size_t n)
+{
+    if (!jb->open) {
+        memset(out, 0, n * sizeof(int16_t));
+        return AUDIO_JB_PULL_DONE;
+    }
+    if (!jb->playing) {
+        // A full slot window starts playout too: the next packet would push
+        // queued audio out rather than add depth.
+        if (jb->ending ||
+            (jb->have_seq && (audio_jb_depth(jb) >= jb->target_samples ||
+                              (uint16_t)(jb->end_seq - jb->play_seq) >= jb->slot_count))) {
+            jb->playing = true;
+        } else {
+            conceal_fill(jb, out, n);
+            return AUDIO_JB_PULL_BUFFERING;
+        }
+    }
+
+    size_t done = 0;
+    while (done < n) {
+        if (jb->lost_left == 0 && slot_ready(jb, jb->play_seq)) {
+            audio_jb_slot_t *s = slot_for(jb, jb->play_seq);
+            const int16_t *src = slot_pcm(jb, jb->play_seq);
+            size_t k = (size_t)(s->len - jb->play_off);
+            if (k > n - done) k = n - done;
+            memcpy(out + done, src + jb->play_off, k * sizeof(int16_t));
+            done += k;
+            jb->play_off = (uint16_t)(jb->play_off + k);
+            jb->conceal_pos = 0;
+            jb->clean_samples += (uint32_t)k;
+            if (jb->play_off == s->len) {
+                memcpy(conceal_pcm(jb), src, (size_t)s->len * sizeof(int16_t));
+                jb->last_len = s->len;
+                s->len = 0;
+                jb->play_seq++;
+                jb->play_off = 0;
+                jb->stats.played++;
+            }
+            continue;
+        }
+        if (jb->lost_left == 0) {
+            if ((int16_t)(jb->end_seq - jb->play_seq) > 0) {
+                // Later packets are queued, so this one is lost rather than late.
+                jb->lost_left = lost_packet_len(jb);
+                jb->stats.concealed++;
+            } else if (jb->ending) {
+                memset(out + done, 0, (n - done) * sizeof(int16_t));
+                jb->open = false;
+                return done > 0 ? AUDIO_JB_PULL_PLAY : AUDIO_JB_PULL_DONE;
+            } else {
+                jb->stats.underruns++;
+                jb->playing = false;
+                jb->clean_samples = 0;
+                set_target_ms(jb, jb->stats.target_ms + AUDIO_JB_STEP_MS);
+                conceal_fill(jb, out + done, n - done);
+                return AUDIO_JB_PULL_BUFFERING;
+            }
+        }
+        size_t k = jb->lost_left;
+        if (k > n - done) k = n - done;
+        conceal_fill(jb, out + done, k);
+        done += k;
+        jb->lost_left -= (uint32_t)k;
+        if (jb->lost_left == 0) {
+            jb->play_seq++;
+            jb->play_off = 0;
+        }
+    }
+
+    if (jb->clean_samples >= ms_to_samples(jb, AUDIO_JB_RELAX_AFTER_MS)) {
+        jb->clean_samples = 0;
+        if (jb->stats.target_ms > jb->cfg.min_depth_ms) {
+            set_target_ms(jb, jb->stats.target_ms > AUDIO_JB_RELAX_MS
+                                  ? jb->stats.target_ms - AUDIO_JB_RELAX_MS : 0);
+        }
+    }
+    return AUDIO_JB_PULL_PLAY;
+}
+
+void audio_jb_get_stats(const audio_jb_t *jb, audio_jb_stats_t *out)
+{
+    *out = jb->stats;
+}
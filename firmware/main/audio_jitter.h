@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Jitter buffer for the AUDS/AUDD speaker stream. The network side puts
+// packets by sequence number into preallocated slots; the playout side pulls
+// fixed-size frames at the stream rate.
+//   - playout starts (and restarts after an underrun) once target_ms of
+//     audio is buffered or the slot window is full; every underrun raises
+//     the target by a step, long clean runs lower it again, within
+//     [min_depth_ms, max_depth_ms] and never past what the slots hold
+//   - a missing packet with later ones already queued is treated as lost and
+//     concealed by repeating the last packet with a fade to silence
+//   - late and duplicate packets are dropped; a packet too far ahead for
+//     the slot window pushes the oldest queued packets out (overrun)
+// No locking: the caller serializes put/pull. Platform-independent;
+// `pc/bench.py jitter` drives this file with synthetic loss/reorder traces.
+
+#define AUDIO_JB_MAX_SLOTS 32
+
+typedef struct {
+    uint16_t min_depth_ms;
+    uint16_t max_depth_ms;
+} audio_jb_cfg_t;
+
+typedef enum {
+    AUDIO_JB_PUT_OK = 0,
+    AUDIO_JB_PUT_IDLE,        // no stream open
+    AUDIO_JB_PUT_INVALID,     // empty or larger than a slot
+    AUDIO_JB_PUT_LATE,        // its playout time has passed
+    AUDIO_JB_PUT_DUPLICATE,
+} audio_jb_put_t;
+
+typedef enum {
+    AUDIO_JB_PULL_PLAY = 0,   // frame holds stream audio (possibly concealed)
+    AUDIO_JB_PULL_BUFFERING,  // frame holds silence/concealment while refilling
+    AUDIO_JB_PULL_DONE,       // stream ended and drained, or stopped; frame is silence
+} audio_jb_pull_t;
+
+typedef struct {
+    uint32_t received;        // packets accepted
+    uint32_t played;          // packets played out
+    uint32_t concealed;       // lost packets replaced by concealment
+    uint32_t underruns;       // buffer ran dry while playing
+    uint32_t overruns;        // queued packets pushed out by newer ones
+    uint32_t late;
+    uint32_t duplicates;
+    uint32_t resyncs;         // sequence jumps that restarted the buffer
+    uint32_t target_ms;       // current adaptive target depth
+    uint32_t max_depth_ms;    // deepest buffer seen
+} audio_jb_stats_t;
+
+typedef struct {
+    uint16_t seq;
+    uint16_t len;             // 0 = empty
+} audio_jb_slot_t;
+
+typedef struct {
+    audio_jb_cfg_t cfg;
+    int16_t *pcm;             // slot_count x slot_samples, then one concealment packet
+    uint16_t slot_count;
+    uint16_t slot_samples;
+    audio_jb_slot_t slots[AUDIO_JB_MAX_SLOTS];
+
+    bool open;
+    bool ending;              // AUDE seen: drain without waiting for depth
+    bool playing;
+    bool have_seq;
+    uint16_t play_seq;        // next packet to play
+    uint16_t end_seq;         // one past the newest packet received
+    uint16_t play_off;        // samples of play_seq already played
+    uint32_t sample_rate_hz;
+    uint32_t target_samples;
+
+    uint16_t last_len;        // concealment source length (0 = none yet)
+    uint32_t conceal_pos;     // samples concealed since the last real packet
+    uint32_t lost_left;       // samples still to conceal for a lost packet
+    uint32_t clean_samples;   // played since the last underrun or relax step
+
+    audio_jb_stats_t stats;
+} audio_jb_t;
+
+// pcm_storage holds (slot_count + 1) * slot_samples samples. A min_depth_ms
+// above max_depth_ms is lowered to it.
+bool audio_jb_init(audio_jb_t *jb, const audio_jb_cfg_t *cfg, int16_t *pcm_storage,
+                   uint16_t slot_count, uint16_t slot_samples);
+
+// Opens a new stream; drops queued audio and resets the stats. The adaptive
+// target carries over between streams.
+void audio_jb_start(audio_jb_t *jb, uint32_t sample_rate_hz);
+
+// Marks the end of the stream; pull drains what is queued, then reports DONE.
+void audio_jb_end(audio_jb_t *jb);
+
+// Closes the stream immediately.
+void audio_jb_stop(audio_jb_t *jb);
+
+audio_jb_put_t audio_jb_put(audio_jb_t *jb, uint16_t seq, const int16_t *pcm, size_t n);
+
+// Always fills all n samples of out.
+audio_jb_pull_t audio_jb_pull(audio_jb_t *jb, int16_t *out, size_t n);
+
+// Queued audio, in samples.
+uint32_t audio_jb_depth(const audio_jb_t *jb);
+
+void audio_jb_get_stats(const audio_jb_t *jb, audio_jb_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
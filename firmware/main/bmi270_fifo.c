@@ -0,0 +1,217 @@
+#include "bmi270_fifo.h"
+
+#include <string.h>
+
+// Header byte layout (header mode): fh_mode[7:6] fh_parm[5:2] fh_ext[1:0].
+#define FIFO_HEADER_MASK      0xFC
+#define FIFO_HEADER_ACC       0x84
+#define FIFO_HEADER_GYR       0x88
+#define FIFO_HEADER_GYR_ACC   0x8C
+#define FIFO_HEADER_AUX_BIT   0x10
+#define FIFO_HEADER_SKIP      0x40
+#define FIFO_HEADER_TIME      0x44
+#define FIFO_HEADER_CONFIG    0x48
+#define FIFO_HEADER_EMPTY     0x80
+
+#define FIFO_AXES_LEN   6
+#define FIFO_AUX_LEN    8
+#define FIFO_SKIP_LEN   1
+#define FIFO_TIME_LEN   3
+#define FIFO_CONFIG_LEN 4
+
+#define SENSORTIME_MASK 0xFFFFFF
+
+// Host clock tracking, a PI loop run once per burst on the host-vs-sensor
+// error: the rate term (sensor ticks -> us, in ppm, at most FIFO_MAX_PPM)
+// takes err / FIFO_FREQ_GAIN of it, the phase term err / FIFO_SLEW_GAIN, at
+// most 1/FIFO_SLEW_MAX of the time since the last burst. Errors beyond
+// FIFO_RESYNC_US (a stalled task, FIFO overflow) re-anchor outright.
+#define FIFO_SLEW_GAIN 16
+#define FIFO_FREQ_GAIN 512
+#define FIFO_SLEW_MAX  32
+#define FIFO_MAX_PPM   30000
+#define FIFO_RESYNC_US 250000
+
+static inline int16_t read_le16s(const uint8_t *p)
+{
+    return (int16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+}
+
+static inline int64_t ticks_to_us(int64_t ticks)
+{
+    // 1 tick = 1e6 / 25600 us = 625 / 16 us
+    return (ticks * 625) / 16;
+}
+
+// Sensor ticks to host us at the tracked rate. Spans are a burst or so, far
+// from overflowing.
+static inline int64_t ticks_to_host_us(const bmi270_fifo_parser_t *p, int64_t ticks)
+{
+    return (ticks * 625 * (1000000 + (int64_t)p->rate_ppm)) / (16 * 1000000LL);
+}
+
+void bmi270_fifo_parser_init(bmi270_fifo_parser_t *p, uint32_t odr_hz)
+{
+    if (!p) return;
+    memset(p, 0, sizeof(*p));
+    if (odr_hz == 0 || odr_hz > BMI270_SENSORTIME_HZ) {
+        odr_hz = 100;
+    }
+    p->frame_period_ticks = BMI270_SENSORTIME_HZ / odr_hz;
+}
+
+static void update_sensortime(bmi270_fifo_parser_t *p, uint32_t raw, int64_t host_now_us)
+{
+    raw &= SENSORTIME_MASK;
+    if (!p->have_time) {
+        p->have_time = true;
+        p->time_ticks = raw;
+        p->anchor_ticks = raw;
+        p->anchor_us = host_now_us;
+        p->last_sync_us = host_now_us;
+    } else {
+        uint32_t delta = (raw - p->last_raw_time) & SENSORTIME_MASK;
+        p->time_ticks += delta;
+    }
+    p->last_raw_time = raw;
+}
+
+// Pulls the tick->us mapping toward the host clock after a sensortime update.
+// host_now_us is taken right after the burst, so it trails the sensortime
+// frame by the read itself; that constant offset is absorbed like any other.
+// The anchor moves to the newest sensortime, so a rate change only applies
+// from here on.
+static void slew_to_host(bmi270_fifo_parser_t *p, int64_t host_now_us, size_t count)
+{
+    int64_t mapped_us = p->anchor_us + ticks_to_host_us(p, p->time_ticks - p->anchor_ticks);
+    int64_t err = host_now_us - mapped_us;
+    int64_t elapsed = host_now_us - p->last_sync_us;
+    p->clock_error_us = err;
+    if (elapsed <= 0) return;
+    p->last_sync_us = host_now_us;
+    p->anchor_ticks = p->time_ticks;
+    if (err > FIFO_RESYNC_US || err < -FIFO_RESYNC_US) {
+        // Never step back behind what was already emitted (count samples
+        // are backfilled from the new mapping).
+        int64_t floor_us = p->last_ts_us + ticks_to_host_us(p, (int64_t)(count ? count : 1) * p->frame_period_ticks);
+        p->anchor_us = host_now_us > floor_us ? host_now_us : floor_us;
+        return;
+    }
+    int64_t ppm = p->rate_ppm + err * 1000000 / elapsed / FIFO_FREQ_GAIN;
+    p->rate_ppm = (int32_t)(ppm > FIFO_MAX_PPM ? FIFO_MAX_PPM : (ppm < -FIFO_MAX_PPM ? -FIFO_MAX_PPM : ppm));
+    int64_t step = err / FIFO_SLEW_GAIN;
+    int64_t bound = elapsed / FIFO_SLEW_MAX;
+    // Backward by less than half a frame, so a burst's backfilled first
+    // sample still lands after the previous burst's last one.
+    int64_t back = ticks_to_us(p->frame_period_ticks) / 2;
+    if (step > bound) step = bound;
+    if (step < -bound) step = -bound;
+    if (step < -back) step = -back;
+    p->anchor_us = mapped_us + step;
+}
+
+size_t bmi270_fifo_parse(bmi270_fifo_parser_t *p,
+                         const uint8_t *buf, size_t len,
+                         int64_t host_now_us,
+                         bmi270_sample_t *out, size_t max_out)
+{
+    if (!p || !buf || !out || max_out == 0) return 0;
+
+    size_t count = 0;
+    size_t i = 0;
+    bool have_burst_time = false;
+    uint32_t burst_time = 0;
+
+    while (i < len) {
+        uint8_t header = buf[i] & FIFO_HEADER_MASK;
+        i++;
+        if (header == FIFO_HEADER_EMPTY) {
+            // Over-read past the last frame.
+            break;
+        }
+        if ((header & 0xC0) == 0x80) {
+            size_t need = 0;
+            bool has_aux = (header & FIFO_HEADER_AUX_BIT) != 0;
+            bool has_gyr = (header & 0x08) != 0;
+            bool has_acc = (header & 0x04) != 0;
+            need += has_aux ? FIFO_AUX_LEN : 0;
+            need += has_gyr ? FIFO_AXES_LEN : 0;
+            need += has_acc ? FIFO_AXES_LEN : 0;
+            if (i + need > len) {
+                p->truncated_bursts++;
+                break;
+            }
+            // Payload order within a frame is aux, gyro, accel.
+            const uint8_t *d = buf + i + (has_aux ? FIFO_AUX_LEN : 0);
+            if (has_gyr) {
+                p->last_gyr[0] = read_le16s(d);
+                p->last_gyr[1] = read_le16s(d + 2);
+                p->last_gyr[2] = read_le16s(d + 4);
+                d += FIFO_AXES_LEN;
+            }
+            if (has_acc) {
+                p->last_acc[0] = read_le16s(d);
+                p->last_acc[1] = read_le16s(d + 2);
+                p->last_acc[2] = read_le16s(d + 4);
+            }
+            i += need;
+            if ((has_gyr || has_acc) && count < max_out) {
+                bmi270_sample_t *s = &out[count++];
+                s->ts_us = 0;
+                s->ax = p->last_acc[0];
+                s->ay = p->last_acc[1];
+                s->az = p->last_acc[2];
+                s->gx = p->last_gyr[0];
+                s->gy = p->last_gyr[1];
+                s->gz = p->last_gyr[2];
+            }
+            continue;
+        }
+        if (header == FIFO_HEADER_SKIP) {
+            if (i + FIFO_SKIP_LEN > len) break;
+            p->skipped_frames += buf[i];
+            i += FIFO_SKIP_LEN;
+            continue;
+        }
+        if (header == FIFO_HEADER_TIME) {
+            if (i + FIFO_TIME_LEN > len) break;
+            burst_time = (uint32_t)buf[i] | ((uint32_t)buf[i + 1] << 8) | ((uint32_t)buf[i + 2] << 16);
+            have_burst_time = true;
+            i += FIFO_TIME_LEN;
+            continue;
+        }
+        if (header == FIFO_HEADER_CONFIG) {
+            if (i + FIFO_CONFIG_LEN > len) break;
+            i += FIFO_CONFIG_LEN;
+            continue;
+        }
+        // Unknown header: framing is lost for the rest of this burst.
+        p->truncated_bursts++;
+        break;
+    }
+
+    if (have_burst_time) {
+        update_sensortime(p, burst_time, host_now_us);
+        slew_to_host(p, host_now_us, count);
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // The sensortime frame is stamped with the most recent data frame; earlier
+    // frames are spaced by the ODR period.
+    int64_t last_us;
+    if (have_burst_time) {
+        last_us = p->anchor_us + ticks_to_host_us(p, p->time_ticks - p->anchor_ticks);
+    } else if (p->last_ts_us != 0) {
+        last_us = p->last_ts_us + ticks_to_host_us(p, (int64_t)count * p->frame_period_ticks);
+    } else {
+        last_us = host_now_us;
+    }
+    for (size_t k = 0; k < count; ++k) {
+        int64_t back = (int64_t)(count - 1 - k);
+        out[k].ts_us = last_us - ticks_to_host_us(p, back * p->frame_period_ticks);
+    }
+    p->last_ts_us = last_us;
+    return count;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "imu_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// BMI270 FIFO size; also the largest burst bmi270_fifo_parse() ever sees.
+#define BMI270_FIFO_SIZE_BYTES 2048
+// One header + gyro + accel frame.
+#define BMI270_FIFO_FRAME_BYTES 13
+// Sensortime counter: 24 bit, 25.6 kHz (39.0625 us per tick).
+#define BMI270_SENSORTIME_HZ 25600
+
+// Parser state kept across bursts. Platform-independent so it can be
+// exercised on the host against captured FIFO byte dumps.
+typedef struct {
+    uint32_t frame_period_ticks;  // sensortime ticks between regular frames
+    int16_t last_acc[3];          // carried forward into gyro-only frames
+    int16_t last_gyr[3];          // carried forward into accel-only frames
+    bool have_time;
+    uint32_t last_raw_time;       // last 24-bit sensortime seen
+    int64_t time_ticks;           // sensortime extended past 24-bit wraps
+    int64_t anchor_ticks;         // sensortime mapped to anchor_us
+    int64_t anchor_us;            // slewed toward host time on every burst
+    int32_t rate_ppm;             // tracked sensor clock error vs the host
+    int64_t last_sync_us;         // host time of the last slew
+    int64_t clock_error_us;       // host minus mapped sensor time before the last slew
+    int64_t last_ts_us;           // timestamp of the last emitted sample
+    uint32_t skipped_frames;      // frames the sensor dropped (FIFO overflow)
+    uint32_t truncated_bursts;    // bursts ending mid-frame or unknown header
+} bmi270_fifo_parser_t;
+
+void bmi270_fifo_parser_init(bmi270_fifo_parser_t *p, uint32_t odr_hz);
+
+// Decodes one header-mode FIFO burst into samples. Timestamps come from the
+// sensortime frame that follows the last data frame. The sensor's oscillator
+// is only good to about 1%, so host_now_us (read right after the burst, on
+// the host clock) anchors the sensor timebase on the first burst and steers
+// it on every later one, rate and phase, a bounded step per burst: sample
+// spacing stays smooth and monotonic while timestamps stay on the host
+// clock. It is also the fallback for a first burst without sensortime.
+// Returns the number of samples written.
+size_t bmi270_fifo_parse(bmi270_fifo_parser_t *p,
+                         const uint8_t *buf, size_t len,
+                         int64_t host_now_us,
+                         bmi270_sample_t *out, size_t max_out);
+
+#ifdef __cplusplus
+}
+#endif
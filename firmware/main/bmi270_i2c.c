@@ -1,16 +1,47 @@
 #include "bmi270_i2c.h"
 #include "bmi270_api.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <stdlib.h>
 
 #define BMI270_I2C_ADDR 0x68
 #define BMI270_I2C_ADDR_ALT 0x69
+// Extra bytes read past FIFO_LENGTH so the appended sensortime frame is included.
+#define BMI270_FIFO_READ_SLACK 4
 
 static const char *TAG = "bmi270";
 
 // Exported by the BMI270 component library but not declared in bmi270_api.h.
 extern int8_t bmi270_init(struct bmi2_dev *dev);
 
+static bool odr_to_bmi2(uint32_t odr_hz, uint8_t *acc_odr, uint8_t *gyr_odr)
+{
+    switch (odr_hz) {
+    case 25:
+        *acc_odr = BMI2_ACC_ODR_25HZ;
+        *gyr_odr = BMI2_GYR_ODR_25HZ;
+        return true;
+    case 50:
+        *acc_odr = BMI2_ACC_ODR_50HZ;
+        *gyr_odr = BMI2_GYR_ODR_50HZ;
+        return true;
+    case 100:
+        *acc_odr = BMI2_ACC_ODR_100HZ;
+        *gyr_odr = BMI2_GYR_ODR_100HZ;
+        return true;
+    case 200:
+        *acc_odr = BMI2_ACC_ODR_200HZ;
+        *gyr_odr = BMI2_GYR_ODR_200HZ;
+        return true;
+    case 400:
+        *acc_odr = BMI2_ACC_ODR_400HZ;
+        *gyr_odr = BMI2_GYR_ODR_400HZ;
+        return true;
+    default:
+        return false;
+    }
+}
+
 static bool i2c_probe_chip_id(i2c_port_t port, uint8_t addr, uint8_t *chip_id)
 {
     uint8_t reg = 0x00;
@@ -18,13 +49,14 @@ static bool i2c_probe_chip_id(i2c_port_t port, uint8_t addr, uint8_t *chip_id)
     return err == ESP_OK;
 }
 
-esp_err_t bmi270_i2c_init(bmi270_ctx_t *ctx, i2c_port_t port, int sda, int scl)
+esp_err_t bmi270_i2c_init(bmi270_ctx_t *ctx, i2c_port_t port, int sda, int scl, uint32_t clk_hz)
 {
     if (!ctx) return ESP_ERR_INVALID_ARG;
     ctx->port = port;
     ctx->addr = BMI270_I2C_ADDR;
     ctx->bus = NULL;
     ctx->bmi_handle = NULL;
+    ctx->fifo_buf = NULL;
 
     i2c_config_t conf = {
         .mode = I2C_MODE_MASTER,
@@ -32,7 +64,7 @@ esp_err_t bmi270_i2c_init(bmi270_ctx_t *ctx, i2c_port_t port, int sda, int scl)
         .scl_io_num = scl,
         .sda_pullup_en = GPIO_PULLUP_ENABLE,
         .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = 100000,
+        .master.clk_speed = clk_hz,
     };
     ctx->bus = i2c_bus_create(port, &conf);
     if (!ctx->bus) {
@@ -53,7 +85,7 @@ esp_err_t bmi270_i2c_init(bmi270_ctx_t *ctx, i2c_port_t port, int sda, int scl)
         ctx->addr = BMI270_I2C_ADDR;
     }
 
-    ESP_LOGI(TAG, "I2C bus created (addr=0x%02x)", ctx->addr);
+    ESP_LOGI(TAG, "I2C bus created (addr=0x%02x, clk=%u Hz)", ctx->addr, (unsigned)clk_hz);
     return ESP_OK;
 }
 
@@ -99,14 +131,21 @@ esp_err_t bmi270_config_default(bmi270_ctx_t *ctx)
     config[BMI2_ACCEL].type = BMI2_ACCEL;
     config[BMI2_GYRO].type = BMI2_GYRO;
 
+    uint8_t acc_odr = 0;
+    uint8_t gyr_odr = 0;
+    if (!odr_to_bmi2(BMI270_ODR_HZ, &acc_odr, &gyr_odr)) {
+        ESP_LOGE(TAG, "unsupported IMU ODR %d Hz", BMI270_ODR_HZ);
+        return ESP_ERR_INVALID_ARG;
+    }
+
     rslt = bmi2_get_sensor_config(config, 2, bmi2_dev);
     if (rslt == BMI2_OK) {
-        config[BMI2_ACCEL].cfg.acc.odr = BMI2_ACC_ODR_100HZ;
+        config[BMI2_ACCEL].cfg.acc.odr = acc_odr;
         config[BMI2_ACCEL].cfg.acc.range = BMI2_ACC_RANGE_4G;
         config[BMI2_ACCEL].cfg.acc.bwp = BMI2_ACC_NORMAL_AVG4;
         config[BMI2_ACCEL].cfg.acc.filter_perf = BMI2_PERF_OPT_MODE;
 
-        config[BMI2_GYRO].cfg.gyr.odr = BMI2_GYR_ODR_100HZ;
+        config[BMI2_GYRO].cfg.gyr.odr = gyr_odr;
         config[BMI2_GYRO].cfg.gyr.range = BMI2_GYR_RANGE_2000;
         config[BMI2_GYRO].cfg.gyr.bwp = BMI2_GYR_NORMAL_MODE;
         config[BMI2_GYRO].cfg.gyr.noise_perf = BMI2_POWER_OPT_MODE;
@@ -128,7 +167,7 @@ esp_err_t bmi270_config_default(bmi270_ctx_t *ctx)
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "BMI270 sensors enabled");
+    ESP_LOGI(TAG, "BMI270 sensors enabled (odr=%d Hz)", BMI270_ODR_HZ);
     return ESP_OK;
 }
 
@@ -138,8 +177,17 @@ int bmi270_read_sample(bmi270_ctx_t *ctx, bmi270_sample_t *out)
 
     if (!ctx || !ctx->bmi_handle) return -1;
 
+    struct bmi2_dev *dev = (struct bmi2_dev *)ctx->bmi_handle;
+    uint8_t status = 0;
+    int8_t rslt = bmi2_get_status(&status, dev);
+    if (rslt != BMI2_OK) return -1;
+    // Data-ready bits clear on read; without them the registers still hold
+    // the previous sample.
+    const uint8_t drdy = BMI2_DRDY_ACC | BMI2_DRDY_GYR;
+    if ((status & drdy) != drdy) return 1;
+
     struct bmi2_sens_data sensor_data = {0};
-    int8_t rslt = bmi2_get_sensor_data(&sensor_data, (struct bmi2_dev *)ctx->bmi_handle);
+    rslt = bmi2_get_sensor_data(&sensor_data, dev);
     if (rslt != BMI2_OK) return -1;
 
     out->ax = (int16_t)sensor_data.acc.x;
@@ -150,3 +198,61 @@ int bmi270_read_sample(bmi270_ctx_t *ctx, bmi270_sample_t *out)
     out->gz = (int16_t)sensor_data.gyr.z;
     return 0;
 }
+
+esp_err_t bmi270_fifo_enable(bmi270_ctx_t *ctx, uint16_t watermark_frames)
+{
+    if (!ctx || !ctx->bmi_handle) return ESP_ERR_INVALID_STATE;
+    struct bmi2_dev *dev = (struct bmi2_dev *)ctx->bmi_handle;
+
+    if (!ctx->fifo_buf) {
+        ctx->fifo_buf = malloc(BMI270_FIFO_SIZE_BYTES + BMI270_FIFO_READ_SLACK);
+        if (!ctx->fifo_buf) {
+            ESP_LOGE(TAG, "FIFO buffer allocation failed");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    // Let one burst read cover the whole FIFO.
+    dev->read_write_len = BMI270_FIFO_SIZE_BYTES + BMI270_FIFO_READ_SLACK;
+
+    int8_t rslt = bmi2_set_fifo_config(BMI2_FIFO_ALL_EN, BMI2_DISABLE, dev);
+    if (rslt == BMI2_OK) {
+        rslt = bmi2_set_fifo_config(BMI2_FIFO_ACC_EN | BMI2_FIFO_GYR_EN |
+                                    BMI2_FIFO_HEADER_EN | BMI2_FIFO_TIME_EN,
+                                    BMI2_ENABLE, dev);
+    }
+    if (rslt == BMI2_OK) {
+        rslt = bmi2_set_fifo_wm((uint16_t)(watermark_frames * BMI270_FIFO_FRAME_BYTES), dev);
+    }
+    if (rslt == BMI2_OK) {
+        rslt = bmi2_set_command_register(BMI2_FIFO_FLUSH_CMD, dev);
+    }
+    if (rslt != BMI2_OK) {
+        ESP_LOGE(TAG, "BMI270 FIFO config failed: %d", rslt);
+        return ESP_FAIL;
+    }
+
+    bmi270_fifo_parser_init(&ctx->fifo, BMI270_ODR_HZ);
+    ESP_LOGI(TAG, "BMI270 FIFO enabled (header+sensortime, wm=%u frames)", watermark_frames);
+    return ESP_OK;
+}
+
+int bmi270_fifo_read(bmi270_ctx_t *ctx, bmi270_sample_t *out, size_t max_out)
+{
+    if (!ctx || !ctx->bmi_handle || !ctx->fifo_buf || !out) return -1;
+    struct bmi2_dev *dev = (struct bmi2_dev *)ctx->bmi_handle;
+
+    uint16_t fifo_len = 0;
+    int8_t rslt = bmi2_get_fifo_length(&fifo_len, dev);
+    if (rslt != BMI2_OK) return -1;
+    if (fifo_len == 0) return 0;
+    if (fifo_len > BMI270_FIFO_SIZE_BYTES) {
+        fifo_len = BMI270_FIFO_SIZE_BYTES;
+    }
+
+    size_t read_len = (size_t)fifo_len + BMI270_FIFO_READ_SLACK;
+    rslt = bmi2_get_regs(BMI2_FIFO_DATA_ADDR, ctx->fifo_buf, (uint16_t)read_len, dev);
+    if (rslt != BMI2_OK) return -1;
+
+    int64_t now_us = esp_timer_get_time();
+    return (int)bmi270_fifo_parse(&ctx->fifo, ctx->fifo_buf, read_len, now_us, out, max_out);
+}
@@ -1,35 +1,39 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include "driver/i2c.h"
 #include "esp_err.h"
 #include "i2c_bus.h"
+#include "sdkconfig.h"
+#include "imu_sample.h"
+#include "bmi270_fifo.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Minimal sample payload for 6-axis IMU
-typedef struct {
-    int64_t ts_us;
-    int16_t ax;
-    int16_t ay;
-    int16_t az;
-    int16_t gx;
-    int16_t gy;
-    int16_t gz;
-} bmi270_sample_t;
+// Accel/gyro output data rate configured by bmi270_config_default().
+#define BMI270_ODR_HZ CONFIG_ACTION_IMU_ODR_HZ
 
 typedef struct {
     i2c_port_t port;
     uint8_t addr;
     i2c_bus_handle_t bus;
     void *bmi_handle;
+    uint8_t *fifo_buf;
+    bmi270_fifo_parser_t fifo;
 } bmi270_ctx_t;
 
-esp_err_t bmi270_i2c_init(bmi270_ctx_t *ctx, i2c_port_t port, int sda, int scl);
+esp_err_t bmi270_i2c_init(bmi270_ctx_t *ctx, i2c_port_t port, int sda, int scl, uint32_t clk_hz);
 esp_err_t bmi270_config_default(bmi270_ctx_t *ctx);
+// Returns 0 on a fresh sample, 1 if the sensor has no new data since the
+// last read (duplicate suppressed), -1 on error.
 int bmi270_read_sample(bmi270_ctx_t *ctx, bmi270_sample_t *out);
+// Enables the hardware FIFO (headers + sensortime) for accel/gyro.
+esp_err_t bmi270_fifo_enable(bmi270_ctx_t *ctx, uint16_t watermark_frames);
+// Drains the FIFO in one burst; returns samples written to out, or -1 on bus error.
+int bmi270_fifo_read(bmi270_ctx_t *ctx, bmi270_sample_t *out, size_t max_out);
 
 #ifdef __cplusplus
 }
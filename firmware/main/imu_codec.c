@@ -0,0 +1,141 @@
+#include "imu_codec.h"
+
+static inline uint64_t zigzag64(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag64(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline size_t put_varint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline bool get_varint(const uint8_t *p, size_t len, size_t *pos, uint64_t *v)
+{
+    uint64_t out = 0;
+    unsigned shift = 0;
+    while (*pos < len && shift < 64) {
+        uint8_t b = p[(*pos)++];
+        out |= (uint64_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            *v = out;
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+void imu_codec_enc_begin(imu_codec_enc_t *e, uint8_t *out, size_t cap)
+{
+    e->out = out;
+    e->cap = cap;
+    e->len = 0;
+    e->count = 0;
+    e->prev_dt_us = 0;
+}
+
+bool imu_codec_enc_push(imu_codec_enc_t *e, const bmi270_sample_t *s)
+{
+    uint8_t tmp[IMU_CODEC_MAX_SAMPLE_BYTES];
+    size_t n = 0;
+    int64_t dt_us = 0;
+    if (e->count == 0) {
+        n += put_varint(tmp + n, zigzag64(s->ts_us));
+        n += put_varint(tmp + n, zigzag64(s->ax));
+        n += put_varint(tmp + n, zigzag64(s->ay));
+        n += put_varint(tmp + n, zigzag64(s->az));
+        n += put_varint(tmp + n, zigzag64(s->gx));
+        n += put_varint(tmp + n, zigzag64(s->gy));
+        n += put_varint(tmp + n, zigzag64(s->gz));
+    } else {
+        dt_us = s->ts_us - e->prev.ts_us;
+        n += put_varint(tmp + n, zigzag64(dt_us - e->prev_dt_us));
+        n += put_varint(tmp + n, zigzag64((int64_t)s->ax - e->prev.ax));
+        n += put_varint(tmp + n, zigzag64((int64_t)s->ay - e->prev.ay));
+        n += put_varint(tmp + n, zigzag64((int64_t)s->az - e->prev.az));
+        n += put_varint(tmp + n, zigzag64((int64_t)s->gx - e->prev.gx));
+        n += put_varint(tmp + n, zigzag64((int64_t)s->gy - e->prev.gy));
+        n += put_varint(tmp + n, zigzag64((int64_t)s->gz - e->prev.gz));
+    }
+    if (e->len + n > e->cap) {
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        e->out[e->len + i] = tmp[i];
+    }
+    e->len += n;
+    e->count++;
+    e->prev = *s;
+    e->prev_dt_us = dt_us;
+    return true;
+}
+
+size_t imu_codec_encode_blocks(const bmi270_sample_t *in, size_t n, size_t block_len,
+                               uint8_t *out, size_t out_cap)
+{
+    if (!in || !out || block_len == 0) return 0;
+    imu_codec_enc_t e;
+    size_t total = 0;
+    for (size_t i = 0; i < n; i += block_len) {
+        imu_codec_enc_begin(&e, out + total, out_cap - total);
+        size_t end = i + block_len < n ? i + block_len : n;
+        for (size_t j = i; j < end; ++j) {
+            if (!imu_codec_enc_push(&e, &in[j])) {
+                return 0;
+            }
+        }
+        total += e.len;
+    }
+    return total;
+}
+
+size_t imu_codec_decode_block(const uint8_t *in, size_t len, size_t count,
+                              bmi270_sample_t *out, size_t max_out)
+{
+    if (!in || !out) return 0;
+    size_t pos = 0;
+    size_t decoded = 0;
+    int64_t prev_dt_us = 0;
+    uint64_t v[7];
+    while (decoded < count && decoded < max_out) {
+        for (int k = 0; k < 7; ++k) {
+            if (!get_varint(in, len, &pos, &v[k])) {
+                return decoded;
+            }
+        }
+        bmi270_sample_t *s = &out[decoded];
+        if (decoded == 0) {
+            s->ts_us = unzigzag64(v[0]);
+            s->ax = (int16_t)unzigzag64(v[1]);
+            s->ay = (int16_t)unzigzag64(v[2]);
+            s->az = (int16_t)unzigzag64(v[3]);
+            s->gx = (int16_t)unzigzag64(v[4]);
+            s->gy = (int16_t)unzigzag64(v[5]);
+            s->gz = (int16_t)unzigzag64(v[6]);
+        } else {
+            const bmi270_sample_t *p = &out[decoded - 1];
+            prev_dt_us += unzigzag64(v[0]);
+            s->ts_us = p->ts_us + prev_dt_us;
+            s->ax = (int16_t)(p->ax + unzigzag64(v[1]));
+            s->ay = (int16_t)(p->ay + unzigzag64(v[2]));
+            s->az = (int16_t)(p->az + unzigzag64(v[3]));
+            s->gx = (int16_t)(p->gx + unzigzag64(v[4]));
+            s->gy = (int16_t)(p->gy + unzigzag64(v[5]));
+            s->gz = (int16_t)(p->gz + unzigzag64(v[6]));
+        }
+        decoded++;
+    }
+    return decoded;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "imu_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lossless block codec for IMU samples. The first sample of a block is a
+// keyframe (zig-zag varint timestamp and axes); every later sample stores the
+// timestamp delta-of-delta and per-axis deltas against its predecessor as
+// zig-zag varints. Blocks are self-contained, so losing one datagram loses
+// only its block. Platform-independent; the host decoder builds this file too.
+
+// Worst case per sample: 10-byte timestamp varint + 6 x 3-byte axis varints.
+#define IMU_CODEC_MAX_SAMPLE_BYTES 28
+
+typedef struct {
+    uint8_t *out;
+    size_t cap;
+    size_t len;
+    size_t count;
+    bmi270_sample_t prev;
+    int64_t prev_dt_us;
+} imu_codec_enc_t;
+
+void imu_codec_enc_begin(imu_codec_enc_t *e, uint8_t *out, size_t cap);
+// Appends one sample to the block. Returns false (writing nothing) if it
+// would not fit in the remaining capacity.
+bool imu_codec_enc_push(imu_codec_enc_t *e, const bmi270_sample_t *s);
+
+// Encodes n samples as consecutive blocks of block_len samples each.
+// Returns bytes written, or 0 if out_cap is too small.
+size_t imu_codec_encode_blocks(const bmi270_sample_t *in, size_t n, size_t block_len,
+                               uint8_t *out, size_t out_cap);
+
+// Decodes one block holding count samples. Returns samples decoded; fewer
+// than count means the block was truncated or corrupt.
+size_t imu_codec_decode_block(const uint8_t *in, size_t len, size_t count,
+                              bmi270_sample_t *out, size_t max_out);
+
+#ifdef __cplusplus
+}
+#endif
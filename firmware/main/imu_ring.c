@@ -0,0 +1,75 @@
+#include "imu_ring.h"
+
+bool imu_ring_init(imu_ring_t *r, bmi270_sample_t *storage, uint32_t capacity)
+{
+    if (!r || !storage || capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->dropped, 0);
+    r->tail_cache = 0;
+    r->head_cache = 0;
+    r->pushed = 0;
+    r->high_watermark = 0;
+    r->buf = storage;
+    r->mask = capacity - 1;
+    return true;
+}
+
+bool imu_ring_push(imu_ring_t *r, const bmi270_sample_t *s)
+{
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t used = head - r->tail_cache;
+    if (used > r->mask) {
+        // Looks full with the cached tail; refresh it from the consumer.
+        r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+        used = head - r->tail_cache;
+        if (used > r->mask) {
+            atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+            return false;
+        }
+    }
+    r->buf[head & r->mask] = *s;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    r->pushed++;
+    if (used + 1 > r->high_watermark) {
+        r->high_watermark = used + 1;
+    }
+    return true;
+}
+
+size_t imu_ring_peek(imu_ring_t *r, const bmi270_sample_t **span)
+{
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    if (r->head_cache == tail) {
+        r->head_cache = atomic_load_explicit(&r->head, memory_order_acquire);
+    }
+    uint32_t avail = r->head_cache - tail;
+    if (avail == 0) {
+        return 0;
+    }
+    uint32_t start = tail & r->mask;
+    uint32_t to_end = r->mask + 1 - start;
+    if (span) {
+        *span = &r->buf[start];
+    }
+    return avail < to_end ? avail : to_end;
+}
+
+void imu_ring_commit(imu_ring_t *r, size_t n)
+{
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, tail + (uint32_t)n, memory_order_release);
+}
+
+void imu_ring_get_stats(imu_ring_t *r, imu_ring_stats_t *out)
+{
+    if (!r || !out) return;
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    out->pushed = r->pushed;
+    out->dropped = atomic_load_explicit(&r->dropped, memory_order_relaxed);
+    out->high_watermark = r->high_watermark;
+    out->lag = head - tail;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "imu_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMU_RING_CACHE_LINE 64
+
+typedef struct {
+    uint32_t pushed;          // samples accepted by the producer
+    uint32_t dropped;         // samples rejected because the ring was full
+    uint32_t high_watermark;  // max occupancy seen by the producer
+    uint32_t lag;             // samples waiting for the consumer right now
+} imu_ring_stats_t;
+
+// Single-producer/single-consumer ring of IMU samples. Lock-free: the
+// producer only writes head, the consumer only writes tail, each on its own
+// cache line. Indices run freely and are masked on access, so capacity must
+// be a power of two. Platform-independent (C11 atomics) for host builds.
+typedef struct {
+    _Alignas(IMU_RING_CACHE_LINE) atomic_uint head;
+    uint32_t tail_cache;      // producer's last view of tail
+    uint32_t pushed;
+    uint32_t high_watermark;
+    atomic_uint dropped;
+
+    _Alignas(IMU_RING_CACHE_LINE) atomic_uint tail;
+    uint32_t head_cache;      // consumer's last view of head
+
+    _Alignas(IMU_RING_CACHE_LINE) bmi270_sample_t *buf;
+    uint32_t mask;
+} imu_ring_t;
+
+bool imu_ring_init(imu_ring_t *r, bmi270_sample_t *storage, uint32_t capacity);
+
+// Producer side. Returns false (and counts a drop) when the ring is full.
+bool imu_ring_push(imu_ring_t *r, const bmi270_sample_t *s);
+
+// Consumer side. Exposes the longest contiguous run of readable samples
+// without copying; call imu_ring_commit() once they have been consumed.
+size_t imu_ring_peek(imu_ring_t *r, const bmi270_sample_t **span);
+void imu_ring_commit(imu_ring_t *r, size_t n);
+
+// Counters may be read from either side; values are a best-effort snapshot.
+void imu_ring_get_stats(imu_ring_t *r, imu_ring_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
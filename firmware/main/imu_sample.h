@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Minimal sample payload for 6-axis IMU
+typedef struct {
+    int64_t ts_us;
+    int16_t ax;
+    int16_t ay;
+    int16_t az;
+    int16_t gx;
+    int16_t gy;
+    int16_t gz;
+} bmi270_sample_t;
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,6 +8,9 @@
 extern "C" {
 #endif
 
+// Clips come from the generated label bank (label_bank.h): samples live in
+// flash with the speaker gain applied; play them with
+// speaker_audio_write_pregained().
 typedef struct {
     const int16_t *samples;
     size_t sample_count;
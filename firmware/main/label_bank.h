@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Clip bank generated at build time by firmware/tools/gen_label_bank.py from
+// main/audio_labels/*.pcm. Samples already carry the speaker gain and stay in
+// flash. k_label_bank_slots is a perfect hash table of size mask + 1 holding
+// clip index + 1 (0 = empty), keyed by label_bank_hash(label, seed) & mask.
+
+typedef struct {
+    const char *label;
+    const int16_t *samples;
+    uint32_t sample_count;
+} label_bank_clip_t;
+
+extern const uint32_t k_label_bank_count;
+extern const uint32_t k_label_bank_seed;
+extern const uint32_t k_label_bank_mask;
+extern const label_bank_clip_t k_label_bank_clips[];
+extern const uint8_t k_label_bank_slots[];
+
+#ifdef __cplusplus
+}
+#endif
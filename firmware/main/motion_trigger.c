@@ -0,0 +1,155 @@
+#include "motion_trigger.h"
+
+#include <string.h>
+
+static uint64_t gyro_norm_sq(const bmi270_sample_t *s)
+{
+    int32_t gx = s->gx;
+    int32_t gy = s->gy;
+    int32_t gz = s->gz;
+    return (uint64_t)(gx * gx) + (uint64_t)(gy * gy) + (uint64_t)(gz * gz);
+}
+
+static uint32_t isqrt64(uint64_t v)
+{
+    uint64_t r = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
+
+bool motion_trigger_init(motion_trigger_t *t, const motion_trigger_cfg_t *cfg,
+                         bmi270_sample_t *pre_storage)
+{
+    if (!t || !cfg || !pre_storage || cfg->pre_samples == 0) return false;
+    if (cfg->on_thresh < cfg->off_thresh) return false;
+    memset(t, 0, sizeof(*t));
+    t->cfg = *cfg;
+    if (t->cfg.on_hold == 0) t->cfg.on_hold = 1;
+    if (t->cfg.off_hold == 0) t->cfg.off_hold = 1;
+    t->on_sq = (uint64_t)cfg->on_thresh * cfg->on_thresh;
+    t->off_sq = (uint64_t)cfg->off_thresh * cfg->off_thresh;
+    t->pre = pre_storage;
+    return true;
+}
+
+void motion_trigger_reset(motion_trigger_t *t)
+{
+    t->pre_len = 0;
+    t->pre_head = 0;
+    t->have_last = false;
+    t->on_count = 0;
+    t->off_count = 0;
+    t->active = false;
+    t->in_post = false;
+}
+
+static void pre_push(motion_trigger_t *t, const bmi270_sample_t *s)
+{
+    t->pre[t->pre_head] = *s;
+    t->pre_head = (uint16_t)((t->pre_head + 1) % t->cfg.pre_samples);
+    if (t->pre_len < t->cfg.pre_samples) {
+        t->pre_len++;
+    }
+}
+
+static void idle_accumulate(motion_trigger_t *t, const bmi270_sample_t *s, uint64_t sq)
+{
+    t->idle_samples++;
+    if (sq > t->idle_peak_sq) {
+        t->idle_peak_sq = sq;
+    }
+    t->idle_sum[0] += s->ax;
+    t->idle_sum[1] += s->ay;
+    t->idle_sum[2] += s->az;
+}
+
+motion_trigger_event_t motion_trigger_push(motion_trigger_t *t, const bmi270_sample_t *s,
+                                           motion_trigger_emit_fn emit, void *user)
+{
+    if (t->have_last && s->ts_us < t->last_ts_us) {
+        return t->active ? MOTION_TRIGGER_ACTIVE : MOTION_TRIGGER_IDLE;
+    }
+    t->have_last = true;
+    t->last_ts_us = s->ts_us;
+    uint64_t sq = gyro_norm_sq(s);
+
+    if (!t->active) {
+        idle_accumulate(t, s, sq);
+        pre_push(t, s);
+        t->on_count = (sq >= t->on_sq) ? (uint16_t)(t->on_count + 1) : 0;
+        if (t->on_count < t->cfg.on_hold) {
+            return MOTION_TRIGGER_IDLE;
+        }
+
+        t->active = true;
+        t->in_post = false;
+        t->off_count = 0;
+        t->trigger_ts_us = s->ts_us;
+        t->segment_id++;
+        t->segment_samples = 0;
+        uint16_t start = (uint16_t)((t->pre_head + t->cfg.pre_samples - t->pre_len) %
+                                    t->cfg.pre_samples);
+        for (uint16_t i = 0; i < t->pre_len; ++i) {
+            if (emit) emit(user, &t->pre[(start + i) % t->cfg.pre_samples]);
+            t->segment_samples++;
+        }
+        return MOTION_TRIGGER_START;
+    }
+
+    if (emit) emit(user, s);
+    t->segment_samples++;
+    int64_t elapsed = s->ts_us - t->trigger_ts_us;
+    bool done = false;
+
+    if (t->in_post) {
+        done = s->ts_us >= t->post_until_us;
+        t->end_reason = MOTION_TRIGGER_END_QUIET;
+    } else if (elapsed >= t->cfg.max_action_us) {
+        done = true;
+        t->end_reason = MOTION_TRIGGER_END_MAX_LEN;
+    } else {
+        t->off_count = (sq <= t->off_sq) ? (uint16_t)(t->off_count + 1) : 0;
+        if (elapsed >= t->cfg.min_action_us && t->off_count >= t->cfg.off_hold) {
+            t->in_post = true;
+            t->post_until_us = s->ts_us + t->cfg.post_us;
+        }
+    }
+    if (!done) {
+        return MOTION_TRIGGER_ACTIVE;
+    }
+
+    // Next segment needs a fresh pre-roll and onset count.
+    t->active = false;
+    t->in_post = false;
+    t->pre_len = 0;
+    t->pre_head = 0;
+    t->on_count = 0;
+    return MOTION_TRIGGER_END;
+}
+
+void motion_trigger_take_idle(motion_trigger_t *t, motion_trigger_idle_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->samples = t->idle_samples;
+    out->peak_gyro_norm = isqrt64(t->idle_peak_sq);
+    if (t->idle_samples > 0) {
+        out->mean_ax = (int16_t)(t->idle_sum[0] / (int64_t)t->idle_samples);
+        out->mean_ay = (int16_t)(t->idle_sum[1] / (int64_t)t->idle_samples);
+        out->mean_az = (int16_t)(t->idle_sum[2] / (int64_t)t->idle_samples);
+    }
+    t->idle_samples = 0;
+    t->idle_peak_sq = 0;
+    t->idle_sum[0] = t->idle_sum[1] = t->idle_sum[2] = 0;
+}
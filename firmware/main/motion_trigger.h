@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "imu_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Gyro-norm hysteresis detector that cuts the sample stream into action
+// segments. Same rules as capture_triggered() in pc/live_classify.py:
+//   - start after on_hold consecutive samples with |gyro| >= on_thresh; the
+//     segment opens with the last pre_samples samples (trigger included)
+//   - once min_action_us has passed since the trigger, off_hold consecutive
+//     samples with |gyro| <= off_thresh begin a post_us tail
+//   - the segment ends when the tail is done or max_action_us is reached
+// Samples with a timestamp older than the previous one are ignored.
+// Platform-independent; pc/motion_trigger.py replays CSVs through this file.
+
+typedef struct {
+    uint32_t on_thresh;      // gyro norm, raw LSB
+    uint32_t off_thresh;
+    uint16_t on_hold;
+    uint16_t off_hold;
+    uint16_t pre_samples;    // pre-roll length, trigger sample included
+    int64_t post_us;
+    int64_t min_action_us;
+    int64_t max_action_us;
+} motion_trigger_cfg_t;
+
+typedef enum {
+    MOTION_TRIGGER_IDLE = 0,   // sample consumed, nothing emitted
+    MOTION_TRIGGER_START,      // segment opened; pre-roll emitted
+    MOTION_TRIGGER_ACTIVE,     // sample emitted inside the segment
+    MOTION_TRIGGER_END,        // sample emitted and segment closed
+} motion_trigger_event_t;
+
+typedef enum {
+    MOTION_TRIGGER_END_QUIET = 0,  // off hysteresis + post tail
+    MOTION_TRIGGER_END_MAX_LEN,    // max_action_us reached
+} motion_trigger_end_reason_t;
+
+// Idle-time statistics, gathered while no segment is open.
+typedef struct {
+    uint32_t samples;
+    uint32_t peak_gyro_norm;
+    int16_t mean_ax;
+    int16_t mean_ay;
+    int16_t mean_az;
+} motion_trigger_idle_t;
+
+typedef void (*motion_trigger_emit_fn)(void *user, const bmi270_sample_t *s);
+
+typedef struct {
+    motion_trigger_cfg_t cfg;
+    uint64_t on_sq;
+    uint64_t off_sq;
+
+    bmi270_sample_t *pre;      // pre-roll ring, cfg.pre_samples entries
+    uint16_t pre_len;
+    uint16_t pre_head;         // next write slot
+
+    bool have_last;
+    int64_t last_ts_us;
+    uint16_t on_count;
+    uint16_t off_count;
+
+    bool active;
+    bool in_post;
+    int64_t trigger_ts_us;
+    int64_t post_until_us;
+    uint32_t segment_id;       // id of the open (or last closed) segment
+    uint32_t segment_samples;  // samples emitted for that segment
+    motion_trigger_end_reason_t end_reason;
+
+    uint32_t idle_samples;
+    uint64_t idle_peak_sq;
+    int64_t idle_sum[3];
+} motion_trigger_t;
+
+// pre_storage must hold cfg->pre_samples samples (pre_samples >= 1).
+bool motion_trigger_init(motion_trigger_t *t, const motion_trigger_cfg_t *cfg,
+                         bmi270_sample_t *pre_storage);
+void motion_trigger_reset(motion_trigger_t *t);
+
+// Feeds one sample. Segment samples are passed to emit in order: on START the
+// whole pre-roll, afterwards one sample per call. Inside emit, segment_samples
+// is the number already emitted for the open segment (0 for its first one).
+motion_trigger_event_t motion_trigger_push(motion_trigger_t *t, const bmi270_sample_t *s,
+                                           motion_trigger_emit_fn emit, void *user);
+
+// Copies and clears the idle statistics gathered since the last call.
+void motion_trigger_take_idle(motion_trigger_t *t, motion_trigger_idle_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,6 +9,7 @@
 #include "esp_rom_gpio.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "sdkconfig.h"
 #include "soc/gpio_sig_map.h"
 
 // Reference: xiaozhi-esp32 board config for ESP-SensairShuttle.
@@ -17,7 +18,7 @@
 #define AUDIO_PA_CTL_GPIO      GPIO_NUM_1
 #define AUDIO_PDM_UPSAMPLE_FS  480
 #define AUDIO_DEFAULT_RATE_HZ  24000
-#define AUDIO_PCM_GAIN_NUM     30
+#define AUDIO_PCM_GAIN_NUM     CONFIG_ACTION_SPEAKER_GAIN_PCT
 #define AUDIO_PCM_GAIN_DEN     100
 #define AUDIO_SILENCE_CHUNK_SAMPLES 256
 #define AUDIO_WRITE_TIMEOUT_MS 1000
@@ -198,6 +199,18 @@ esp_err_t speaker_audio_write_samples(const int16_t *samples, size_t sample_coun
     return ESP_OK;
 }
 
+esp_err_t speaker_audio_write_pregained(const int16_t *samples, size_t sample_count)
+{
+    if (!samples || sample_count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // The I2S driver copies into its DMA buffers, so flash-resident clips can go straight in.
+    return speaker_audio_write_blocking(samples, sample_count);
+}
+
 esp_err_t speaker_audio_write_silence_ms(uint32_t ms)
 {
     if (!s_enabled || s_rate_hz == 0 || ms == 0) {
@@ -11,6 +11,9 @@ extern "C" {
 esp_err_t speaker_audio_init(void);
 esp_err_t speaker_audio_start(uint32_t sample_rate_hz);
 esp_err_t speaker_audio_write_samples(const int16_t *samples, size_t sample_count);
+// For samples that already carry CONFIG_ACTION_SPEAKER_GAIN_PCT (generated label
+// clips); written without the gain/copy pass.
+esp_err_t speaker_audio_write_pregained(const int16_t *samples, size_t sample_count);
 esp_err_t speaker_audio_write_silence_ms(uint32_t ms);
 void speaker_audio_stop(void);
 
@@ -8,6 +8,7 @@
 
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "nvs_flash.h"
@@ -169,6 +170,10 @@ esp_err_t udp_sender_init(udp_sender_t *udp)
     udp->dest_addr.sin_family = AF_INET;
     udp->dest_addr.sin_port = htons(udp_port);
     udp->dest_addr.sin_addr.s_addr = inet_addr(udp_ip);
+    udp->frame_seq = 0;
+    udp->batch_count = 0;
+    udp->batch_base_ts_us = 0;
+    udp->batch_open_us = 0;
 
     ESP_LOGI(TAG, "UDP sender ready: %s:%d", udp_ip, udp_port);
     return ESP_OK;
@@ -187,12 +192,158 @@ int udp_sender_send_sample(udp_sender_t *udp, const bmi270_sample_t *s)
     return err;
 }
 
-int udp_sender_send_heartbeat(udp_sender_t *udp, int64_t ts_us)
+#if CONFIG_ACTION_UDP_FRAME_COMPRESSED
+int udp_sender_batch_flush(udp_sender_t *udp)
 {
     if (!udp) return -1;
-    // Heartbeat frame: 4-byte magic + int64 timestamp (little endian)
-    uint8_t buf[12] = {'H', 'B', '0', '1'};
+    if (udp->batch_count == 0) return 0;
+
+    uint8_t *hdr = udp->batch_buf;
+    uint16_t flags = 0;
+    memcpy(hdr, "IMZ1", 4);
+    memcpy(hdr + 4, &udp->frame_seq, 4);
+    memcpy(hdr + 8, &udp->batch_count, 2);
+    memcpy(hdr + 10, &flags, 2);
+
+    size_t len = UDP_BATCH_HEADER_BYTES + udp->enc.len;
+    int err = sendto(udp->sock, udp->batch_buf, len, 0,
+                     (struct sockaddr *)&udp->dest_addr, sizeof(udp->dest_addr));
+    // Sequence advances even on send failure so the host sees the gap.
+    udp->frame_seq++;
+    udp->batch_count = 0;
+    return err;
+}
+
+int udp_sender_batch_push(udp_sender_t *udp, const bmi270_sample_t *s)
+{
+    if (!udp || !s) return -1;
+    int err = 0;
+    if (udp->batch_count == 0) {
+        // Every frame opens with a keyframe so a lost datagram loses one block.
+        imu_codec_enc_begin(&udp->enc, udp->batch_buf + UDP_BATCH_HEADER_BYTES,
+                            sizeof(udp->batch_buf) - UDP_BATCH_HEADER_BYTES);
+        udp->batch_base_ts_us = s->ts_us;
+        udp->batch_open_us = esp_timer_get_time();
+    }
+    // Buffer is sized for the worst case, so the push always fits.
+    imu_codec_enc_push(&udp->enc, s);
+    udp->batch_count++;
+
+    if (udp->batch_count >= UDP_BATCH_MAX_SAMPLES) {
+        err = udp_sender_batch_flush(udp);
+    }
+    return err;
+}
+#else
+int udp_sender_batch_flush(udp_sender_t *udp)
+{
+    if (!udp) return -1;
+    if (udp->batch_count == 0) return 0;
+
+    uint8_t *hdr = udp->batch_buf;
+    uint16_t flags = 0;
+    memcpy(hdr, "IMU2", 4);
+    memcpy(hdr + 4, &udp->frame_seq, 4);
+    memcpy(hdr + 8, &udp->batch_base_ts_us, 8);
+    memcpy(hdr + 16, &udp->batch_count, 2);
+    memcpy(hdr + 18, &flags, 2);
+
+    size_t len = UDP_BATCH_HEADER_BYTES + (size_t)udp->batch_count * UDP_BATCH_SAMPLE_BYTES;
+    int err = sendto(udp->sock, udp->batch_buf, len, 0,
+                     (struct sockaddr *)&udp->dest_addr, sizeof(udp->dest_addr));
+    // Sequence advances even on send failure so the host sees the gap.
+    udp->frame_seq++;
+    udp->batch_count = 0;
+    return err;
+}
+
+int udp_sender_batch_push(udp_sender_t *udp, const bmi270_sample_t *s)
+{
+    if (!udp || !s) return -1;
+    int err = 0;
+    if (udp->batch_count > 0) {
+        int64_t dt_us = s->ts_us - udp->batch_base_ts_us;
+        if (dt_us < 0 || dt_us > (int64_t)UINT32_MAX) {
+            // Delta does not fit the frame; start a new one from this sample.
+            err = udp_sender_batch_flush(udp);
+        }
+    }
+    if (udp->batch_count == 0) {
+        udp->batch_base_ts_us = s->ts_us;
+        udp->batch_open_us = esp_timer_get_time();
+    }
+
+    uint32_t dt_us = (uint32_t)(s->ts_us - udp->batch_base_ts_us);
+    uint8_t *p = udp->batch_buf + UDP_BATCH_HEADER_BYTES +
+                 (size_t)udp->batch_count * UDP_BATCH_SAMPLE_BYTES;
+    memcpy(p, &dt_us, 4);
+    memcpy(p + 4, &s->ax, 12);
+    udp->batch_count++;
+
+    if (udp->batch_count >= UDP_BATCH_MAX_SAMPLES) {
+        err = udp_sender_batch_flush(udp);
+    }
+    return err;
+}
+#endif
+
+int udp_sender_send_heartbeat(udp_sender_t *udp, int64_t ts_us, uint16_t sample_rate_hz,
+                              uint16_t caps)
+{
+    if (!udp) return -1;
+    // Heartbeat frame: 4-byte magic + int64 timestamp + uint16 IMU sample rate
+    // + uint16 capability flags (little endian)
+    uint8_t buf[16] = {'H', 'B', '0', '2'};
     memcpy(buf + 4, &ts_us, sizeof(ts_us));
+    memcpy(buf + 12, &sample_rate_hz, sizeof(sample_rate_hz));
+    memcpy(buf + 14, &caps, sizeof(caps));
+
+    int err = sendto(udp->sock, buf, sizeof(buf), 0,
+                     (struct sockaddr *)&udp->dest_addr, sizeof(udp->dest_addr));
+    return err;
+}
+
+int udp_sender_send_segment_start(udp_sender_t *udp, uint32_t segment_id, int64_t trigger_ts_us,
+                                  uint16_t pre_samples)
+{
+    if (!udp) return -1;
+    uint8_t buf[20] = {'S', 'E', 'G', 'S'};
+    memcpy(buf + 4, &segment_id, 4);
+    memcpy(buf + 8, &trigger_ts_us, 8);
+    memcpy(buf + 16, &pre_samples, 2);
+
+    int err = sendto(udp->sock, buf, sizeof(buf), 0,
+                     (struct sockaddr *)&udp->dest_addr, sizeof(udp->dest_addr));
+    return err;
+}
+
+int udp_sender_send_segment_end(udp_sender_t *udp, uint32_t segment_id, int64_t end_ts_us,
+                                uint32_t sample_count, uint16_t reason)
+{
+    if (!udp) return -1;
+    uint8_t buf[24] = {'S', 'E', 'G', 'E'};
+    memcpy(buf + 4, &segment_id, 4);
+    memcpy(buf + 8, &end_ts_us, 8);
+    memcpy(buf + 16, &sample_count, 4);
+    memcpy(buf + 20, &reason, 2);
+
+    int err = sendto(udp->sock, buf, sizeof(buf), 0,
+                     (struct sockaddr *)&udp->dest_addr, sizeof(udp->dest_addr));
+    return err;
+}
+
+int udp_sender_send_idle_summary(udp_sender_t *udp, int64_t ts_us,
+                                 const motion_trigger_idle_t *idle)
+{
+    if (!udp || !idle) return -1;
+    uint8_t buf[24] = {'I', 'D', 'L', '1'};
+    uint16_t peak = idle->peak_gyro_norm > UINT16_MAX ? UINT16_MAX : (uint16_t)idle->peak_gyro_norm;
+    memcpy(buf + 4, &ts_us, 8);
+    memcpy(buf + 12, &idle->samples, 4);
+    memcpy(buf + 16, &peak, 2);
+    memcpy(buf + 18, &idle->mean_ax, 2);
+    memcpy(buf + 20, &idle->mean_ay, 2);
+    memcpy(buf + 22, &idle->mean_az, 2);
 
     int err = sendto(udp->sock, buf, sizeof(buf), 0,
                      (struct sockaddr *)&udp->dest_addr, sizeof(udp->dest_addr));
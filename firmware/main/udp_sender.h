@@ -3,20 +3,75 @@
 #include "esp_err.h"
 #include <stdint.h>
 #include "lwip/sockets.h"
+#include "sdkconfig.h"
 #include "bmi270_i2c.h"
+#include "imu_codec.h"
+#include "motion_trigger.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#if CONFIG_ACTION_UDP_FRAME_BATCHED || CONFIG_ACTION_UDP_FRAME_COMPRESSED
+#define UDP_FRAME_BATCHING 1
+#define UDP_BATCH_MAX_SAMPLES CONFIG_ACTION_UDP_BATCH_MAX_SAMPLES
+#define UDP_BATCH_MAX_MS CONFIG_ACTION_UDP_BATCH_MAX_MS
+#else
+#define UDP_FRAME_BATCHING 0
+#define UDP_BATCH_MAX_SAMPLES 1
+#define UDP_BATCH_MAX_MS 0
+#endif
+
+#if CONFIG_ACTION_UDP_FRAME_COMPRESSED
+// Compressed IMZ1 frame (little endian):
+//   "IMZ1" + uint32 seq + uint16 sample_count + uint16 flags
+//   then one imu_codec block (keyframe + delta-coded samples)
+#define UDP_BATCH_HEADER_BYTES 12
+#define UDP_BATCH_SAMPLE_BYTES IMU_CODEC_MAX_SAMPLE_BYTES
+#else
+// Batched IMU2 frame (little endian):
+//   "IMU2" + uint32 seq + int64 base_ts_us + uint16 sample_count + uint16 flags
+//   then sample_count x (uint32 dt_us from base_ts_us + 6x int16)
+#define UDP_BATCH_HEADER_BYTES 20
+#define UDP_BATCH_SAMPLE_BYTES 16
+#endif
+
 typedef struct {
     int sock;
     struct sockaddr_in dest_addr;
+    uint32_t frame_seq;
+    uint16_t batch_count;
+    int64_t batch_base_ts_us;   // first sample's timestamp (sensor timebase)
+    int64_t batch_open_us;      // esp_timer time the pending frame was opened; flush deadlines use this
+#if CONFIG_ACTION_UDP_FRAME_COMPRESSED
+    imu_codec_enc_t enc;
+#endif
+    uint8_t batch_buf[UDP_BATCH_HEADER_BYTES + UDP_BATCH_MAX_SAMPLES * UDP_BATCH_SAMPLE_BYTES];
 } udp_sender_t;
 
 esp_err_t udp_sender_init(udp_sender_t *udp);
 int udp_sender_send_sample(udp_sender_t *udp, const bmi270_sample_t *s);
-int udp_sender_send_heartbeat(udp_sender_t *udp, int64_t ts_us);
+// Appends one sample to the pending IMU2/IMZ1 frame; sends it once it is full.
+int udp_sender_batch_push(udp_sender_t *udp, const bmi270_sample_t *s);
+// Sends the pending IMU2/IMZ1 frame (no-op when empty) and advances the sequence number.
+int udp_sender_batch_flush(udp_sender_t *udp);
+// Heartbeat capability flags (HB02 trailing uint16).
+#define UDP_HB_CAP_AUDIO_ADPCM (1u << 0)   // AUDS codec 1 (IMA-ADPCM) accepted
+
+int udp_sender_send_heartbeat(udp_sender_t *udp, int64_t ts_us, uint16_t sample_rate_hz,
+                              uint16_t caps);
+// Action segment delimiters (little endian):
+//   "SEGS" + uint32 segment_id + int64 trigger_ts_us + uint16 pre_samples + uint16 reserved
+//   "SEGE" + uint32 segment_id + int64 end_ts_us + uint32 sample_count + uint16 reason + uint16 reserved
+// Sample frames of a segment are sent between the two; SEGE follows the flush.
+int udp_sender_send_segment_start(udp_sender_t *udp, uint32_t segment_id, int64_t trigger_ts_us,
+                                  uint16_t pre_samples);
+int udp_sender_send_segment_end(udp_sender_t *udp, uint32_t segment_id, int64_t end_ts_us,
+                                uint32_t sample_count, uint16_t reason);
+// Idle summary (little endian):
+//   "IDL1" + int64 ts_us + uint32 sample_count + uint16 peak_gyro_norm + 3x int16 mean accel
+int udp_sender_send_idle_summary(udp_sender_t *udp, int64_t ts_us,
+                                 const motion_trigger_idle_t *idle);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+# Build step for board-local label clips: turns main/audio_labels/*.pcm into a
+# C clip bank with the speaker gain already applied and a perfect hash from
+# label (file stem) to clip. Run by main/CMakeLists.txt; lookup lives in
+# main/label_audio.c, which must use the same hash.
+import argparse
+import sys
+from pathlib import Path
+
+FNV_OFFSET = 0x811C9DC5
+FNV_PRIME = 0x01000193
+MAX_SEED_TRIES = 1 << 16
+
+
+def label_hash(label: bytes, seed: int) -> int:
+    # Seeded FNV-1a, same as label_bank_hash() in label_audio.c.
+    h = FNV_OFFSET ^ seed
+    for b in label:
+        h ^= b
+        h = (h * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+def find_seed(labels: list[bytes], mask: int) -> int:
+    for seed in range(MAX_SEED_TRIES):
+        slots = {label_hash(x, seed) & mask for x in labels}
+        if len(slots) == len(labels):
+            return seed
+    raise ValueError(f"no perfect hash seed for {len(labels)} labels in {MAX_SEED_TRIES} tries")
+
+
+def apply_gain(pcm: bytes, gain_pct: int) -> list[int]:
+    # Matches the integer math speaker_audio.c applies to streamed samples
+    # (C division truncates toward zero).
+    out = []
+    for i in range(0, len(pcm) - 1, 2):
+        v = int.from_bytes(pcm[i : i + 2], "little", signed=True) * gain_pct
+        q = abs(v) // 100
+        out.append(max(-32768, min(32767, q if v >= 0 else -q)))
+    return out
+
+
+def c_ident(label: str) -> str:
+    return "".join(c if c.isalnum() else "_" for c in label)
+
+
+def render(clips: list[tuple[str, list[int]]], seed: int, mask: int, slots: list[int]) -> str:
+    lines = [
+        "// Generated by firmware/tools/gen_label_bank.py. Do not edit.",
+        '#include "label_bank.h"',
+        "",
+    ]
+    for i, (label, samples) in enumerate(clips):
+        lines.append(f"// {label}: {len(samples)} samples")
+        lines.append(f"static const int16_t k_clip_{i}_{c_ident(label)}[{len(samples)}] = {{")
+        for j in range(0, len(samples), 16):
+            lines.append("    " + ", ".join(str(v) for v in samples[j : j + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+    lines.append(f"const uint32_t k_label_bank_count = {len(clips)};")
+    lines.append(f"const uint32_t k_label_bank_seed = {seed}u;")
+    lines.append(f"const uint32_t k_label_bank_mask = {mask}u;")
+    lines.append("")
+    lines.append(f"const label_bank_clip_t k_label_bank_clips[{max(1, len(clips))}] = {{")
+    for i, (label, samples) in enumerate(clips):
+        lines.append(f'    {{"{label}", k_clip_{i}_{c_ident(label)}, {len(samples)}}},')
+    if not clips:
+        lines.append("    {0},")
+    lines.append("};")
+    lines.append("")
+    lines.append(f"const uint8_t k_label_bank_slots[{mask + 1}] = {{")
+    lines.append("    " + ", ".join(str(v) for v in slots) + ",")
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Generate the board-local label clip bank.")
+    parser.add_argument("--out", type=Path, required=True, help="Generated C file")
+    parser.add_argument("--gain-pct", type=int, required=True, help="Speaker PCM gain in percent")
+    parser.add_argument("pcm", type=Path, nargs="*", help="Mono PCM16LE clips, label = file stem")
+    return parser.parse_args()
+
+
+def main() -> int:
+    args = parse_args()
+    clips = []
+    for path in sorted(args.pcm, key=lambda p: p.stem):
+        raw = path.read_bytes()
+        if len(raw) < 2 or len(raw) % 2 != 0:
+            print(f"{path}: not PCM16 (size {len(raw)})", file=sys.stderr)
+            return 1
+        label = path.stem
+        if not label or len(label.encode("utf-8")) > 63 or '"' in label or "\\" in label:
+            print(f"{path}: unusable label name", file=sys.stderr)
+            return 1
+        clips.append((label, apply_gain(raw, args.gain_pct)))
+    if len(clips) > 254:
+        print("at most 254 label clips", file=sys.stderr)
+        return 1
+
+    labels = [label.encode("utf-8") for label, _ in clips]
+    size = 1
+    while size < 2 * len(labels):
+        size *= 2
+    mask = size - 1
+    seed = find_seed(labels, mask) if labels else 0
+    slots = [0] * size
+    for i, label in enumerate(labels):
+        slots[label_hash(label, seed) & mask] = i + 1
+
+    args.out.parent.mkdir(parents=True, exist_ok=True)
+    args.out.write_text(render(clips, seed, mask, slots), encoding="utf-8")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,454 @@
+#!/usr/bin/env python3
+# Anytime (early-decision) classification of a triggered window for
+# live_classify.py --early-hold. While the window grows, every new point
+# extends one open-end DTW column per reference (dtw_open_end_push_f32() in
+# native/dtw_kernel.c, open_end_push_py() its twin): query and reference are
+# anchored at their starts, and the query so far may end anywhere in the
+# reference. A label's score is its best reference's open-end cost per query
+# point; predict_with_rejection() runs on those scores with per-point spot
+# thresholds and a margin. Once the same label has passed for `hold`
+# consecutive points, with its best reference matched at least `min_progress`
+# of the way through, the decision is committed: the full-window scoring,
+# which starts only after the trigger's quiet hold and post-roll, can still
+# run and confirm it.
+#
+# The stream is brought to the references' shape as in stream_spotter.py
+# (thinned to spot_step raw samples per point). For z-normalized models the
+# per-axis statistics are frozen from the prefix and re-estimated whenever it
+# doubles, rebuilding the columns, so the total work stays within twice one
+# full pass.
+#
+# Running this file replays manifest captures as triggered windows against a
+# model (leaving each capture's own reference out) and prints the accuracy vs
+# decision-latency curve over --holds.
+import argparse
+import ctypes
+import math
+import statistics
+import time
+from collections import defaultdict
+from dataclasses import dataclass, field
+from pathlib import Path
+
+from capture_file import manifest_capture_path
+from dtw_baseline import (
+    DTW_STRIDE,
+    LabeledSequence,
+    ScoringEngine,
+    point_cost,
+    predict_with_rejection,
+    prep_sequence,
+    read_manifest,
+    read_sequence,
+    resample_to_rate,
+)
+from model_file import load_model
+from stream_spotter import SpringBank, stream_step
+
+# Points before the first normalization and decision.
+ANYTIME_MIN_POINTS = 8
+# Defaults of the live flags.
+EARLY_MARGIN = 1.25
+EARLY_MIN_PROGRESS = 0.6
+
+
+def open_end_push_py(
+    refs: list[list[tuple[float, ...]]], d: list[float], x: tuple[float, ...], first: bool
+) -> tuple[list[float], list[int]]:
+    # Same as dtw_open_end_push_f32().
+    inf = math.inf
+    best: list[float] = []
+    best_j: list[int] = []
+    off = 0
+    for y in refs:
+        diag = 0.0 if first else inf
+        left = inf
+        lo = inf
+        lo_j = 0
+        for j, yj in enumerate(y):
+            up = inf if first else d[off + j]
+            left = point_cost(x, yj) + min(left, up, diag)
+            d[off + j] = left
+            if left < lo:
+                lo = left
+                lo_j = j
+            diag = up
+        best.append(lo)
+        best_j.append(lo_j)
+        off += len(y)
+    return best, best_j
+
+
+@dataclass
+class EarlyDecision:
+    label: str
+    score: float  # per-point open-end cost of the label's best reference
+    margin: float  # runner-up score / score
+    progress: float  # how far through its best reference the window got
+    points: int  # query points scored when it committed
+    samples: int  # raw samples pushed when it committed
+
+
+class AnytimeBank:
+    # The reference side, shared read-only by every AnytimeClassifier: the
+    # references' float32 points (a SpringBank) and, from the model's spot
+    # thresholds (full-window nearest-reference DTW), per-point thresholds
+    # for each label (divided by its median reference length).
+    def __init__(self, refs: list[LabeledSequence], params: dict, native: bool = True) -> None:
+        self.refs = refs
+        self.spring = SpringBank(refs, {}, native=native)
+        self.labels = sorted({x.label for x in refs})
+        self.label_idx = [self.labels.index(x.label) for x in refs]
+        lens: dict[str, list[int]] = defaultdict(list)
+        for item in refs:
+            lens[item.label].append(len(item.seq))
+        grace = max(1.0, float(params.get("reject_threshold_grace", 1.0)))
+        spot = params.get("spot_thresholds") or {}
+        self.thresholds = {
+            label: float(spot[label]) * grace / statistics.median(lens[label]) for label in self.labels if label in spot
+        }
+
+    @property
+    def native(self) -> bool:
+        return self.spring.lib is not None
+
+
+@dataclass
+class Verdict:
+    # One point's outcome: the label that passed (None: rejected, background
+    # or not far enough into its reference) and the raw samples so far.
+    label: str | None
+    samples: int
+    score: float = math.inf
+    margin: float = 0.0
+    progress: float = 0.0
+
+
+class AnytimeClassifier:
+    # One window's state over a shared AnytimeBank. push() takes raw samples
+    # (features) and returns the decision the sample committed, once.
+    def __init__(
+        self,
+        bank: AnytimeBank,
+        params: dict,
+        stream_hz: float,
+        hold: int,
+        margin: float = EARLY_MARGIN,
+        min_progress: float = EARLY_MIN_PROGRESS,
+        background: frozenset[str] = frozenset(),
+        keep_trace: bool = False,
+    ) -> None:
+        self.bank = bank
+        self.step = max(1.0, stream_step(params, stream_hz))
+        self.use_znorm = bool(params["use_znorm"])
+        self.hold = hold
+        self.margin = margin
+        self.min_progress = min_progress
+        self.background = background
+        self.unknown_label = str(params.get("unknown_label", "unknown"))
+        self.keep_trace = keep_trace
+        spring = bank.spring
+        count = len(bank.refs)
+        if bank.native:
+            self.d = (ctypes.c_double * max(1, spring.cells))()
+            self.best = (ctypes.c_double * max(1, count))()
+            self.best_j = (ctypes.c_size_t * max(1, count))()
+            self.point = (ctypes.c_float * DTW_STRIDE)()
+        else:
+            self.d = [math.inf] * spring.cells
+        self.reset()
+
+    def reset(self) -> None:
+        self.samples = 0
+        self.next_pick = 0.0
+        self.raw_points: list[tuple[float, ...]] = []
+        self.points = 0  # points in the current columns
+        self.rebase_at = ANYTIME_MIN_POINTS
+        self.mean: list[float] = []
+        self.std: list[float] = []
+        self.streak = 0
+        self.last: str | None = None
+        self.decision: EarlyDecision | None = None
+        self.trace: list[Verdict] = []
+
+    def push(self, feat: tuple[float, ...]) -> EarlyDecision | None:
+        self.samples += 1
+        if self.decision is not None or self.samples - 1 < self.next_pick:
+            return None
+        self.next_pick += self.step
+        self.raw_points.append(feat)
+        n = len(self.raw_points)
+        if n < ANYTIME_MIN_POINTS:
+            return None
+        if self.points == 0 or self.use_znorm and n >= self.rebase_at:
+            # (Re)normalize over the prefix and rebuild every column.
+            if self.use_znorm:
+                self._fit_stats()
+                self.rebase_at = 2 * n
+            self.points = 0
+            for p in self.raw_points:
+                best, best_j = self._column(p)
+        else:
+            best, best_j = self._column(feat)
+        return self._decide(best, best_j)
+
+    def _fit_stats(self) -> None:
+        cols = list(zip(*self.raw_points))
+        self.mean = [math.fsum(c) / len(c) for c in cols]
+        self.std = []
+        for c, mu in zip(cols, self.mean):
+            var = math.fsum((v - mu) * (v - mu) for v in c) / len(c)
+            sd = math.sqrt(var) if var > 0 else 1.0
+            self.std.append(sd if sd > 1e-12 else 1.0)
+
+    def _column(self, feat: tuple[float, ...]):
+        if self.use_znorm:
+            x = tuple((v - mu) / sd for v, mu, sd in zip(feat, self.mean, self.std))
+        else:
+            x = feat
+        first = self.points == 0
+        self.points += 1
+        spring = self.bank.spring
+        if spring.lib is not None:
+            pt = self.point
+            for i, v in enumerate(x):
+                pt[i] = v
+            spring.lib.dtw_open_end_push_f32(
+                spring.table, len(self.bank.refs), self.d, pt, int(first), self.best, self.best_j
+            )
+            return self.best, self.best_j
+        # Same float32 points the native kernel sees.
+        x = tuple(ctypes.c_float(v).value for v in x)
+        return open_end_push_py(spring.py_refs, self.d, x, first)
+
+    def _decide(self, best, best_j) -> EarlyDecision | None:
+        bank = self.bank
+        scores: dict[str, float] = {}
+        best_ref: dict[str, int] = {}
+        per_point = 1.0 / self.points
+        for r, label_i in enumerate(bank.label_idx):
+            label = bank.labels[label_i]
+            s = best[r] * per_point
+            if s < scores.get(label, math.inf):
+                scores[label] = s
+                best_ref[label] = r
+        pred, _reason = predict_with_rejection(
+            scores,
+            thresholds=bank.thresholds or None,
+            margin=self.margin,
+            threshold_grace=1.0,
+            unknown_label=self.unknown_label,
+        )
+        verdict = Verdict(None, self.samples)
+        if pred in scores and pred not in self.background:
+            ranked = sorted(scores.values())
+            r = best_ref[pred]
+            verdict = Verdict(
+                pred,
+                self.samples,
+                score=scores[pred],
+                margin=ranked[1] / max(ranked[0], 1e-12) if len(ranked) > 1 else math.inf,
+                progress=(best_j[r] + 1) / len(bank.refs[r].seq),
+            )
+            if verdict.progress < self.min_progress:
+                verdict.label = None
+        if self.keep_trace:
+            self.trace.append(verdict)
+        if verdict.label is None:
+            self.streak = 0
+            self.last = None
+            return None
+        self.streak = self.streak + 1 if verdict.label == self.last else 1
+        self.last = verdict.label
+        if self.hold <= 0 or self.streak < self.hold:
+            return None
+        self.decision = EarlyDecision(
+            label=verdict.label,
+            score=verdict.score,
+            margin=verdict.margin,
+            progress=verdict.progress,
+            points=self.points,
+            samples=self.samples,
+        )
+        return self.decision
+
+
+def first_commit(trace: list[Verdict], hold: int) -> Verdict | None:
+    # The verdict an AnytimeClassifier with this hold would have committed on.
+    streak = 0
+    last = None
+    for v in trace:
+        if v.label is None:
+            streak = 0
+            last = None
+            continue
+        streak = streak + 1 if v.label == last else 1
+        last = v.label
+        if streak >= hold:
+            return v
+    return None
+
+
+@dataclass
+class WindowReplay:
+    label: str
+    samples: int
+    full_pred: str
+    full_ms: float
+    trace: list[Verdict] = field(default_factory=list)
+
+
+def replay_windows(
+    refs: list[LabeledSequence],
+    params: dict,
+    thresholds: dict[str, float],
+    windows: list[tuple[str, Path, list[tuple[float, ...]]]],
+    rate_hz: float,
+    margin: float,
+    min_progress: float,
+    background: frozenset[str],
+    native: bool = True,
+    make_engine=None,
+) -> list[WindowReplay]:
+    # Each (label, path, raw samples) window through an AnytimeClassifier
+    # (verdict trace) and through the full-window scoring, leaving out
+    # references with the window's path.
+    out: list[WindowReplay] = []
+    engine = make_engine(refs) if make_engine is not None else None
+    try:
+        for label, path, raw in windows:
+            keep = [x for x in refs if x.path != path]
+            bank = AnytimeBank(keep, params, native=native)
+            clf = AnytimeClassifier(
+                bank, params, rate_hz, hold=0, margin=margin, min_progress=min_progress, background=background,
+                keep_trace=True,
+            )
+            for feat in raw:
+                clf.push(feat)
+            full_pred = ""
+            full_ms = 0.0
+            if engine is not None:
+                exclude = frozenset(i for i, x in enumerate(refs) if x.path == path)
+                model_hz = float(params.get("sample_rate_hz") or 0.0)
+                seq = resample_to_rate(raw, src_hz=rate_hz, dst_hz=model_hz) if model_hz > 0 else raw
+                query = prep_sequence(seq, max_points=int(params["max_points"]), use_znorm=bool(params["use_znorm"]))
+                t0 = time.perf_counter()
+                scores = engine.query_scores(
+                    query,
+                    per_label_k=int(params["per_label_k"]),
+                    score_mode=str(params["score_mode"]),
+                    hybrid_alpha=float(params["hybrid_alpha"]),
+                    exclude=exclude,
+                )[0]
+                full_pred, _reason = predict_with_rejection(
+                    scores,
+                    thresholds=thresholds,
+                    margin=float(params["reject_margin"]),
+                    threshold_grace=float(params["reject_threshold_grace"]),
+                    unknown_label=str(params["unknown_label"]),
+                )
+                full_ms = (time.perf_counter() - t0) * 1000
+            out.append(WindowReplay(label, len(raw), full_pred, full_ms, clf.trace))
+    finally:
+        if engine is not None:
+            engine.close()
+    return out
+
+
+def latency_curve(
+    replays: list[WindowReplay], holds: list[int], rate_hz: float, background: frozenset[str]
+) -> list[str]:
+    # One line per hold: how often it commits early, how often that is
+    # right, accuracy when the full-window result stands in for windows it
+    # does not commit on, and how far ahead of the window's end it decides.
+    scored = [r for r in replays if r.label not in background]
+    lines = []
+    if scored and any(r.full_pred for r in scored):
+        acc = sum(r.full_pred == r.label for r in scored) / len(scored)
+        ms = statistics.mean(r.full_ms for r in scored)
+        lines.append(f"full windows={len(scored)} accuracy={acc:.4f} decision_at=window_end+{ms:.1f}ms")
+    for hold in holds:
+        early = right = combined = 0
+        leads: list[float] = []
+        fracs: list[float] = []
+        for r in scored:
+            v = first_commit(r.trace, hold)
+            if v is None:
+                combined += r.full_pred == r.label
+                continue
+            early += 1
+            right += v.label == r.label
+            combined += v.label == r.label
+            leads.append((r.samples - v.samples) * 1000.0 / rate_hz)
+            fracs.append(v.samples / r.samples)
+        n = max(1, len(scored))
+        lines.append(
+            f"hold={hold} early={early / n:.4f} early_accuracy={right / max(1, early):.4f} "
+            f"accuracy={combined / n:.4f} lead_ms_median={statistics.median(leads) if leads else 0.0:.0f} "
+            f"decided_at_median={statistics.median(fracs) if fracs else 1.0:.2f} of window"
+        )
+    return lines
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Replay captures as triggered windows: early-decision accuracy vs latency."
+    )
+    parser.add_argument("--model", type=Path, required=True, help="Model from build_model.py (with spot params)")
+    parser.add_argument("--manifest", type=Path, required=True, help="Captures to replay")
+    parser.add_argument("--session", default="", help="Manifest session filter")
+    parser.add_argument("--labels", default="", help="Manifest label filter")
+    parser.add_argument("--background", default="idle", help="Comma-separated labels never decided early")
+    parser.add_argument("--holds", default="1,2,4,8,16", help="Comma-separated --early-hold values to compare")
+    parser.add_argument("--margin", type=float, default=EARLY_MARGIN, help="As --early-margin")
+    parser.add_argument("--min-progress", type=float, default=EARLY_MIN_PROGRESS, help="As --early-min-progress")
+    parser.add_argument("--limit", type=int, default=0, help="Replay at most this many captures (0 = all)")
+    parser.add_argument("--python", action="store_true", help="Also run the Python twin and compare verdicts")
+    parser.add_argument("--workers", type=int, default=1, help="Full-window ScoringEngine workers")
+    return parser.parse_args()
+
+
+def main() -> int:
+    args = parse_args()
+    refs, params, thresholds = load_model(args.model)
+    labels = {x.strip().lower() for x in args.labels.split(",") if x.strip()}
+    rows = read_manifest(args.manifest, session=args.session, labels=labels)
+    if args.limit > 0:
+        rows = rows[: args.limit]
+    rate_hz = float(params.get("sample_rate_hz") or 200.0)
+    background = frozenset(x.strip() for x in args.background.split(",") if x.strip())
+    windows = [(row["label"], Path(row["csv_path"]), read_sequence(manifest_capture_path(row))) for row in rows]
+    if not params.get("spot_thresholds"):
+        print(f"{args.model}: no spot params, so no threshold gate; rebuild it with build_model.py")
+
+    def make_engine(engine_refs: list[LabeledSequence]) -> ScoringEngine:
+        return ScoringEngine(
+            engine_refs,
+            query_len=int(params["max_points"]),
+            window_frac=float(params["window_frac"]),
+            xcorr_max_lag_frac=float(params["xcorr_max_lag_frac"]),
+            xcorr_min_overlap_frac=float(params["xcorr_min_overlap_frac"]),
+            workers=args.workers,
+        )
+
+    t0 = time.perf_counter()
+    replays = replay_windows(
+        refs, params, thresholds, windows, rate_hz, args.margin, args.min_progress, background, make_engine=make_engine
+    )
+    print(f"windows={len(replays)} refs={len(refs)} seconds={time.perf_counter() - t0:.1f}")
+    holds = [int(x) for x in args.holds.split(",") if x.strip()]
+    for line in latency_curve(replays, holds, rate_hz, background):
+        print(line)
+    if args.python:
+        twin = replay_windows(
+            refs, params, thresholds, windows, rate_hz, args.margin, args.min_progress, background, native=False
+        )
+        same = [[v.label for v in a.trace] for a in replays] == [[v.label for v in b.trace] for b in twin]
+        print(f"native_vs_python same_verdicts={same}")
+        if not same:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,125 @@
+# IMA-ADPCM for the PC-to-board speaker stream. Python twin of
+# firmware/main/audio_adpcm.c (same block layout, bit-exact); the C encoder
+# is used when it builds on the host.
+import array
+import ctypes
+import sys
+
+from native_lib import load_audio_adpcm
+
+CODEC_PCM16 = 0
+CODEC_IMA_ADPCM = 1
+HEADER_BYTES = 4
+
+STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+]
+INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8]
+
+
+def block_bytes(n: int) -> int:
+    return HEADER_BYTES + n // 2
+
+
+def _step(pred: int, index: int, code: int) -> tuple[int, int]:
+    step = STEP_TABLE[index]
+    delta = step >> 3
+    if code & 4:
+        delta += step
+    if code & 2:
+        delta += step >> 1
+    if code & 1:
+        delta += step >> 2
+    pred = pred - delta if code & 8 else pred + delta
+    pred = max(-32768, min(32767, pred))
+    index = max(0, min(88, index + INDEX_TABLE[code & 7]))
+    return pred, index
+
+
+def encode_block_py(pcm: list[int], step_index: int) -> tuple[bytes, int]:
+    # Returns (block, step index for the next block).
+    pred = pcm[0]
+    index = min(88, step_index)
+    out = bytearray(pred.to_bytes(2, "little", signed=True) + bytes([index, 0]))
+    for i in range(1, len(pcm)):
+        diff = pcm[i] - pred
+        code = 0
+        if diff < 0:
+            code = 8
+            diff = -diff
+        step = STEP_TABLE[index]
+        if diff >= step:
+            code |= 4
+            diff -= step
+        step >>= 1
+        if diff >= step:
+            code |= 2
+            diff -= step
+        step >>= 1
+        if diff >= step:
+            code |= 1
+        pred, index = _step(pred, index, code)
+        if i & 1:
+            out.append(code)
+        else:
+            out[-1] |= code << 4
+    return bytes(out), index
+
+
+def decode_block_py(block: bytes, n: int) -> list[int] | None:
+    if n < 1 or len(block) < block_bytes(n) or block[2] > 88:
+        return None
+    pred = int.from_bytes(block[0:2], "little", signed=True)
+    index = block[2]
+    out = [pred]
+    for i in range(1, n):
+        byte = block[HEADER_BYTES + (i - 1) // 2]
+        code = byte & 0x0F if i & 1 else byte >> 4
+        pred, index = _step(pred, index, code)
+        out.append(pred)
+    return out
+
+
+def encode_blocks(pcm: list[int], samples_per_block: int) -> list[tuple[int, bytes]]:
+    # Splits pcm into blocks of samples_per_block; returns (sample_count, block) pairs.
+    lib = load_audio_adpcm()
+    out = []
+    index = 0
+    if lib is not None:
+        arr = (ctypes.c_int16 * len(pcm))(*pcm)
+        buf = ctypes.create_string_buffer(block_bytes(samples_per_block))
+        step = ctypes.c_uint8(0)
+        for off in range(0, len(pcm), samples_per_block):
+            n = min(samples_per_block, len(pcm) - off)
+            src = ctypes.cast(ctypes.byref(arr, off * 2), ctypes.POINTER(ctypes.c_int16))
+            nbytes = lib.audio_adpcm_encode_block(src, n, ctypes.byref(step), buf, len(buf))
+            out.append((n, buf.raw[:nbytes]))
+        return out
+    for off in range(0, len(pcm), samples_per_block):
+        chunk = pcm[off : off + samples_per_block]
+        block, index = encode_block_py(chunk, index)
+        out.append((len(chunk), block))
+    return out
+
+
+def decode_block(block: bytes, n: int) -> list[int] | None:
+    lib = load_audio_adpcm()
+    if lib is None:
+        return decode_block_py(block, n)
+    out = (ctypes.c_int16 * n)()
+    if lib.audio_adpcm_decode_block(block, len(block), n, out) != n:
+        return None
+    return list(out)
+
+
+def pcm_bytes_to_samples(pcm_bytes: bytes) -> list[int]:
+    pcm = array.array("h")
+    pcm.frombytes(pcm_bytes[: len(pcm_bytes) - len(pcm_bytes) % 2])
+    if sys.byteorder != "little":
+        pcm.byteswap()
+    return pcm.tolist()
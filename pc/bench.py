@@ -0,0 +1,1790 @@
+#!/usr/bin/env python3
+import argparse
+import ctypes
+import gc
+import json
+import math
+import multiprocessing
+import os
+import random
+import socket
+import statistics
+import struct
+import sys
+import tempfile
+import time
+import tracemalloc
+from array import array
+from pathlib import Path
+
+from dtw_baseline import (
+    DTW_STRIDE,
+    LabeledSequence,
+    Q16Bank,
+    Q16Format,
+    ScoringEngine,
+    dtw_distance_py,
+    dtw_packed,
+    load_labeled_sequences,
+    max_normalized_xcorr,
+    max_normalized_xcorr_fft,
+    pack_sequence,
+    xcorr_fft_size,
+    xcorr_spectra,
+    xcorr_spectrum,
+    prep_points,
+    prep_sequence,
+    quantize_references,
+    read_sequence,
+    split_stratified,
+    znormalize,
+)
+from capture_file import CaptureFile, CaptureWriter, find_captures, read_samples
+from anytime import latency_curve, replay_windows
+from embedding_index import evaluate_prefilter, format_prefilter
+from prototypes import evaluate_split, format_split
+from device_fleet import DeviceSession, Fleet, FleetWindow
+from imu_frames import (
+    BATCH_HEADER_FMT,
+    BATCH_HEADER_SIZE,
+    BATCH_SAMPLE_FMT,
+    BATCH_SAMPLE_SIZE,
+    COMPRESSED_HEADER_SIZE,
+    LEGACY_FMT,
+    LEGACY_SIZE,
+    ImuStream,
+    Sample,
+    decode_codec_block,
+    encode_codec_blocks,
+    read_raw_csv,
+)
+from audio_adpcm import (
+    block_bytes,
+    decode_block,
+    decode_block_py,
+    encode_block_py,
+    encode_blocks,
+    pcm_bytes_to_samples,
+)
+from imu_ingest import ImuIngest, open_ingest
+from live_classify import WindowResult, score_window
+from model_file import load_model, write_model
+from motion_trigger import TriggerConfig
+from native_lib import (
+    load_audio_adpcm,
+    ImuSample,
+    load_audio_jitter,
+    load_bmi270_fifo,
+    load_dtw_kernel,
+    load_imu_ring,
+    load_q16_kernel,
+    load_udp_ingest,
+    load_xcorr_kernel,
+)
+
+LEGACY_STRUCT = struct.Struct(LEGACY_FMT)
+JB_MAX_SLOTS = 32
+JB_PULL_BUFFERING = 1
+JB_PULL_DONE = 2
+# name -> (loss probability, reorder probability, spike probability, spike max ms)
+JITTER_SCENARIOS = {
+    # loss, reorder, spike probability, spike ms, stall probability, stall ms
+    "clean": (0.0, 0.0, 0.0, 0.0, 0.0, 0.0),
+    "loss": (0.03, 0.0, 0.0, 0.0, 0.0, 0.0),
+    "reorder": (0.0, 0.08, 0.0, 0.0, 0.0, 0.0),
+    "spikes": (0.0, 0.0, 0.05, 150.0, 0.0, 0.0),
+    "wifi": (0.02, 0.05, 0.05, 250.0, 0.0, 0.0),
+    # Link stalls: everything sent during one arrives in a burst at its end.
+    "stalls": (0.0, 0.0, 0.0, 0.0, 0.01, 400.0),
+}
+
+
+def parse_args() -> argparse.Namespace:
+    default_base = Path(__file__).resolve().parents[1] / "data"
+
+    parser = argparse.ArgumentParser(description="Host-side benchmarks for action-detect modules.")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    codec = sub.add_parser("codec", help="IMU frame compression ratio and encode speed")
+    codec.add_argument("--base-dir", type=Path, default=default_base, help="Data root")
+    codec.add_argument("--block", type=int, default=16, help="Samples per IMZ1 frame")
+    codec.add_argument(
+        "--synthetic-sec",
+        type=float,
+        default=60.0,
+        help="Synthetic trace length used when no raw captures are found",
+    )
+    codec.add_argument("--rate-hz", type=int, default=200, help="Synthetic trace sample rate")
+
+    jitter = sub.add_parser("jitter", help="Speaker stream jitter buffer on synthetic loss/reorder traces")
+    jitter.add_argument(
+        "--scenario",
+        choices=sorted(JITTER_SCENARIOS),
+        action="append",
+        default=[],
+        help="Scenario to run (repeatable, default all)",
+    )
+    jitter.add_argument("--seconds", type=float, default=20.0, help="Stream length")
+    jitter.add_argument("--sample-rate", type=int, default=24000)
+    jitter.add_argument("--packet-ms", type=float, default=40.0, help="Matches --tts-packet-ms")
+    jitter.add_argument("--frame-ms", type=float, default=10.0, help="Playout frame length")
+    # Defaults match the firmware Kconfig defaults.
+    jitter.add_argument("--min-depth-ms", type=int, default=60)
+    jitter.add_argument("--max-depth-ms", type=int, default=300)
+    jitter.add_argument("--slots", type=int, default=16)
+    jitter.add_argument("--slot-samples", type=int, default=1024)
+    jitter.add_argument("--seed", type=int, default=1)
+
+    fifo = sub.add_parser("fifo", help="BMI270 FIFO parser on byte dumps: frames, sensortime wrap, clock slew")
+    fifo.add_argument("--odr-hz", type=int, default=200, help="Matches BMI270_ODR_HZ")
+    fifo.add_argument("--burst-frames", type=int, default=4, help="Frames per drain in the drift run")
+    fifo.add_argument("--drift", type=float, default=0.01, help="Sensor clock error in the drift run (0.01 = 1%% fast)")
+    fifo.add_argument("--hours", type=float, default=1.0, help="Simulated length of the drift run")
+    fifo.add_argument(
+        "--dump", type=Path, action="append", default=[], help="Also decode a raw FIFO burst file (repeatable)"
+    )
+
+    ring = sub.add_parser("ring", help="IMU sample ring: two-thread order/overflow check and ns/sample vs a queue")
+    ring.add_argument("--capacity", type=int, default=256, help="Matches SAMPLE_RING_LEN in app_main.c")
+    ring.add_argument("--samples", type=int, default=2_000_000, help="Samples per run (below 2^32)")
+    ring.add_argument("--overflow-samples", type=int, default=200_000, help="Samples in the overflow runs")
+    ring.add_argument("--stall-every", type=int, default=1024, help="Overflow run: consumer sleeps every N samples")
+    ring.add_argument("--stall-us", type=int, default=2000, help="Overflow run: length of each consumer sleep")
+    ring.add_argument("--repeat", type=int, default=3, help="Timed runs per structure (best kept)")
+
+    adpcm = sub.add_parser("adpcm", help="Speaker stream IMA-ADPCM quality, size and speed")
+    adpcm.add_argument(
+        "--pcm",
+        type=Path,
+        action="append",
+        default=[],
+        help="Mono PCM16LE file (repeatable, default firmware/main/audio_labels/*.pcm)",
+    )
+    adpcm.add_argument("--sample-rate", type=int, default=24000)
+    adpcm.add_argument("--packet-ms", type=float, default=40.0, help="Matches --tts-packet-ms")
+
+    dtw = sub.add_parser("dtw", help="Banded DTW ns/cell: native kernel vs pure Python")
+    dtw.add_argument("--max-points", type=int, action="append", default=[], help="Repeatable (default 60,120,180,256)")
+    dtw.add_argument(
+        "--window-frac", type=float, action="append", default=[], help="Repeatable (default 0.1,0.2,0.5)"
+    )
+    dtw.add_argument("--pairs", type=int, default=6, help="Sequence pairs per setting")
+
+    xcorr = sub.add_parser("xcorr", help="Normalized cross-correlation: FFT kernel vs Python lag loop")
+    xcorr.add_argument("--max-points", type=int, action="append", default=[], help="Repeatable (default 60,180,256)")
+    xcorr.add_argument("--max-lag-frac", type=float, default=0.15, help="Matches --xcorr-max-lag-frac")
+    xcorr.add_argument("--min-overlap-frac", type=float, default=0.50, help="Matches --xcorr-min-overlap-frac")
+    xcorr.add_argument("--refs", type=int, default=40, help="References per query")
+    xcorr.add_argument("--queries", type=int, default=3)
+
+    scale = sub.add_parser("scale", help="ScoringEngine latency across worker counts and reference set sizes")
+    scale.add_argument(
+        "--workers", type=int, action="append", default=[], help="Repeatable (default 1, 2, 4, ... up to the cores)"
+    )
+    scale.add_argument("--refs", type=int, action="append", default=[], help="Repeatable (default 60,240,960)")
+    scale.add_argument("--labels", type=int, default=6)
+    scale.add_argument("--max-points", type=int, default=180)
+    scale.add_argument("--window-frac", type=float, default=0.2)
+    scale.add_argument("--per-label-k", type=int, default=3)
+    scale.add_argument("--queries", type=int, default=8)
+
+    startup = sub.add_parser("startup", help="Live startup: JSON vs mapped binary model load and prepare")
+    startup.add_argument("--refs", type=int, action="append", default=[], help="Repeatable (default 100,1000)")
+    startup.add_argument("--labels", type=int, default=6)
+    startup.add_argument("--max-points", type=int, default=180)
+    startup.add_argument("--queries", type=int, default=4, help="Queries scored against both to compare")
+
+    spring = sub.add_parser("spring", help="Stream spotting: per-sample cost of SPRING subsequence DTW")
+    spring.add_argument("--refs", type=int, action="append", default=[], help="Repeatable (default 30,120,480)")
+    spring.add_argument("--labels", type=int, default=6)
+    spring.add_argument("--max-points", type=int, default=180)
+    spring.add_argument("--step", type=float, default=2.5, help="Raw samples per reference point")
+    spring.add_argument("--seconds", type=float, default=30.0, help="Stream length at 200 Hz")
+    spring.add_argument(
+        "--python", action="store_true", help="Also run the Python twin on the smallest set and compare"
+    )
+
+    ingest = sub.add_parser("ingest", help="UDP ingest: per-packet recvfrom vs batched ring receiver")
+    ingest.add_argument("--streams", type=int, default=16, help="Paced 200 Hz legacy streams")
+    ingest.add_argument("--seconds", type=float, default=5.0)
+    ingest.add_argument("--busy-ms", type=float, default=300.0, help="Consumer stall (scoring) once a second")
+    ingest.add_argument("--burst", type=int, default=100000, help="Datagrams in the unpaced burst")
+
+    capture = sub.add_parser("capture", help="Raw capture files: CSV vs columnar binary write/load/slice")
+    capture.add_argument("--seconds", type=float, default=600.0, help="Synthetic recording length at 200 Hz")
+    capture.add_argument("--repeat-sec", type=float, default=3.0, help="Length of each per-repeat file")
+    capture.add_argument("--slice-sec", type=float, default=1.0, help="Time slice read from the long recording")
+
+    seqcache = sub.add_parser("seqcache", help="Reference loading: re-prepare every capture vs the prepared-sequence cache")
+    seqcache.add_argument("--captures", type=int, default=1000, help="Synthetic per-repeat captures per format")
+    seqcache.add_argument("--repeat-sec", type=float, default=3.0)
+    seqcache.add_argument("--max-points", type=int, default=180)
+
+    condense = sub.add_parser("condense", help="Reference condensation: accuracy and query time vs reference count")
+    condense.add_argument("--labels", type=int, default=6)
+    condense.add_argument("--styles", type=int, default=3, help="Distinct ways each label is performed")
+    condense.add_argument("--refs-per-label", type=int, default=60, help="Captures per label (before the split)")
+    condense.add_argument("--prototypes", default="1,2,4,8", help="Prototypes per label to try")
+    condense.add_argument("--per-label-k", type=int, default=3)
+    condense.add_argument("--max-points", type=int, default=120)
+    condense.add_argument("--max-drop", type=float, default=0.02, help="Fail if the largest setting loses more accuracy")
+
+    fixedpoint = sub.add_parser("fixedpoint", help="int16 references and fixed-point scoring vs the float path")
+    fixedpoint.add_argument("--labels", type=int, default=6)
+    fixedpoint.add_argument("--styles", type=int, default=3, help="Distinct ways each label is performed")
+    fixedpoint.add_argument("--refs-per-label", type=int, default=60, help="Captures per label (before the split)")
+    fixedpoint.add_argument("--per-label-k", type=int, default=3)
+    fixedpoint.add_argument("--max-points", type=int, default=180)
+    fixedpoint.add_argument("--exact-queries", type=int, default=8, help="Queries whose per-reference metrics are compared")
+    fixedpoint.add_argument("--twin-refs", type=int, default=24, help="References in the native vs Python twin check")
+    fixedpoint.add_argument("--max-drop", type=float, default=0.01, help="Fail if fixed point loses more accuracy")
+
+    prefilter = sub.add_parser("prefilter", help="Embedding pre-filter: recall@k, agreement and query time vs shortlist")
+    prefilter.add_argument("--labels", type=int, default=6)
+    prefilter.add_argument("--styles", type=int, default=3, help="Distinct ways each label is performed")
+    prefilter.add_argument("--refs-per-label", type=int, default=160, help="Captures per label (before the split)")
+    prefilter.add_argument("--shortlists", default="4,8,16,32", help="Shortlist sizes per label to try")
+    prefilter.add_argument("--per-label-k", type=int, default=3)
+    prefilter.add_argument("--max-points", type=int, default=120)
+    prefilter.add_argument("--queries", type=int, default=60, help="Test queries scored (of the 30% split)")
+    prefilter.add_argument(
+        "--min-agreement", type=float, default=0.98, help="Fail if the largest shortlist agrees with exact less"
+    )
+
+    anytime = sub.add_parser("anytime", help="Early decisions in a triggered window: accuracy vs decision latency")
+    anytime.add_argument("--labels", type=int, default=6)
+    anytime.add_argument("--refs-per-label", type=int, default=40, help="Captures per label (before the split)")
+    anytime.add_argument("--max-points", type=int, default=90)
+    anytime.add_argument("--step", type=float, default=2.0, help="Raw samples per gesture point")
+    anytime.add_argument("--noise", type=float, default=0.3, help="Sensor noise on each performance")
+    anytime.add_argument(
+        "--shared-prefix", type=float, default=0.4, help="Fraction of every gesture that starts the same way"
+    )
+    anytime.add_argument("--holds", default="1,2,4,8,16", help="Comma-separated early holds to compare")
+    anytime.add_argument("--margin", type=float, default=1.25)
+    anytime.add_argument("--min-progress", type=float, default=0.6)
+    anytime.add_argument(
+        "--python", action="store_true", help="Also run the Python twin on a few windows and compare"
+    )
+
+    fleet = sub.add_parser("fleet", help="Multi-device load: simulated boards over loopback, one shared engine")
+    fleet.add_argument("--devices", type=int, default=32, help="Simulated boards (source IPs 127.0.0.2...)")
+    fleet.add_argument("--rate", type=int, default=200, help="IMU rate per board, Hz")
+    fleet.add_argument("--seconds", type=float, default=20.0)
+    fleet.add_argument("--gesture-every", type=float, default=2.0, help="Seconds between a board's gestures")
+    fleet.add_argument("--frame-samples", type=int, default=1, help="1 = legacy frames, more = IMU2 batches")
+    fleet.add_argument("--labels", type=int, default=4)
+    fleet.add_argument("--refs-per-label", type=int, default=10)
+    fleet.add_argument("--max-points", type=int, default=90)
+    fleet.add_argument(
+        "--workers", type=int, default=1, help="ScoringEngine workers (1 = in process; CPU excludes workers)"
+    )
+    return parser.parse_args()
+
+
+def synthetic_trace(seconds: float, rate_hz: int, seed: int = 1) -> list[Sample]:
+    # Random-walk axes with a little timestamp jitter, roughly like a handheld IMU.
+    rng = random.Random(seed)
+    period_us = 1_000_000 // rate_hz
+    ts = 0
+    axes = [0, 0, 4096, 0, 0, 0]
+    out: list[Sample] = []
+    for _ in range(int(seconds * rate_hz)):
+        ts += period_us + rng.randint(-4, 4)
+        axes = [max(-32768, min(32767, v + rng.randint(-200, 200))) for v in axes]
+        out.append((ts, *axes))
+    return out
+
+
+def load_traces(base_dir: Path, synthetic_sec: float, rate_hz: int) -> list[list[Sample]]:
+    traces = [t for t in (read_samples(p) for p in find_captures(base_dir)) if t]
+    if traces:
+        print(f"traces={len(traces)} source={base_dir / 'raw'}")
+        return traces
+    print(f"no raw captures under {base_dir / 'raw'}, using {synthetic_sec:.0f}s synthetic trace")
+    return [synthetic_trace(synthetic_sec, rate_hz)]
+
+
+def run_codec(args: argparse.Namespace) -> int:
+    if args.block < 1 or args.block > 64:
+        print("--block must be in 1..64", file=sys.stderr)
+        return 2
+    traces = load_traces(args.base_dir, args.synthetic_sec, args.rate_hz)
+    if encode_codec_blocks(traces[0][:1], 1) is None:
+        print("native imu_codec unavailable", file=sys.stderr)
+        return 1
+
+    samples = 0
+    frames = 0
+    payload = 0
+    encode_s = 0.0
+    for trace in traces:
+        for i in range(0, len(trace), args.block):
+            chunk = trace[i : i + args.block]
+            t0 = time.perf_counter()
+            block = encode_codec_blocks(chunk, args.block)
+            encode_s += time.perf_counter() - t0
+            if decode_codec_block(block, len(chunk)) != chunk:
+                print(f"round-trip mismatch in block at sample {i}", file=sys.stderr)
+                return 1
+            samples += len(chunk)
+            frames += 1
+            payload += COMPRESSED_HEADER_SIZE + len(block)
+
+    legacy = samples * LEGACY_SIZE
+    batched = frames * BATCH_HEADER_SIZE + samples * BATCH_SAMPLE_SIZE
+    print(f"samples={samples} frames={frames} block={args.block}")
+    print(f"legacy_bytes={legacy} ({LEGACY_SIZE:.2f} B/sample)")
+    print(f"imu2_bytes={batched} ({batched / samples:.2f} B/sample)")
+    print(f"imz1_bytes={payload} ({payload / samples:.2f} B/sample)")
+    print(f"ratio_vs_legacy={legacy / payload:.2f}x ratio_vs_imu2={batched / payload:.2f}x")
+    # Includes ctypes call overhead; the C encoder itself is much faster.
+    print(f"encode_ns_per_sample={encode_s * 1e9 / samples:.0f}")
+    return 0
+
+
+class _JbCfg(ctypes.Structure):
+    # Mirrors audio_jb_cfg_t.
+    _fields_ = [("min_depth_ms", ctypes.c_uint16), ("max_depth_ms", ctypes.c_uint16)]
+
+
+class _JbStats(ctypes.Structure):
+    # Mirrors audio_jb_stats_t.
+    _fields_ = [
+        (name, ctypes.c_uint32)
+        for name in (
+            "received",
+            "played",
+            "concealed",
+            "underruns",
+            "overruns",
+            "late",
+            "duplicates",
+            "resyncs",
+            "target_ms",
+            "max_depth_ms",
+        )
+    ]
+
+
+class _JbSlot(ctypes.Structure):
+    _fields_ = [("seq", ctypes.c_uint16), ("len", ctypes.c_uint16)]
+
+
+class _Jb(ctypes.Structure):
+    # Mirrors audio_jb_t.
+    _fields_ = [
+        ("cfg", _JbCfg),
+        ("pcm", ctypes.POINTER(ctypes.c_int16)),
+        ("slot_count", ctypes.c_uint16),
+        ("slot_samples", ctypes.c_uint16),
+        ("slots", _JbSlot * JB_MAX_SLOTS),
+        ("open", ctypes.c_bool),
+        ("ending", ctypes.c_bool),
+        ("playing", ctypes.c_bool),
+        ("have_seq", ctypes.c_bool),
+        ("play_seq", ctypes.c_uint16),
+        ("end_seq", ctypes.c_uint16),
+        ("play_off", ctypes.c_uint16),
+        ("sample_rate_hz", ctypes.c_uint32),
+        ("target_samples", ctypes.c_uint32),
+        ("last_len", ctypes.c_uint16),
+        ("conceal_pos", ctypes.c_uint32),
+        ("lost_left", ctypes.c_uint32),
+        ("clean_samples", ctypes.c_uint32),
+        ("stats", _JbStats),
+    ]
+
+
+def stream_arrivals(
+    packets: int, packet_ms: float, scenario: tuple, rng: random.Random
+) -> list[tuple[float, int]]:
+    # (arrival ms, seq) for a sender pacing packets in real time, like send_pcm_to_board_udp.
+    loss, reorder, spike_p, spike_ms, stall_p, stall_ms = scenario
+    out = []
+    held_until = 0.0
+    for seq in range(packets):
+        if rng.random() < loss:
+            continue
+        t = seq * packet_ms + 3.0 + abs(rng.gauss(0.0, 1.5))
+        if rng.random() < stall_p:
+            held_until = max(held_until, t + stall_ms)
+        t = max(t, held_until)
+        if rng.random() < reorder:
+            t += packet_ms * 1.5
+        if rng.random() < spike_p:
+            t += rng.uniform(0.0, spike_ms)
+        out.append((t, seq))
+    out.sort()
+    return out
+
+
+def run_jitter_scenario(lib: ctypes.CDLL, args: argparse.Namespace, name: str, packet_ms: float) -> bool:
+    rate = args.sample_rate
+    per_packet = int(rate * packet_ms / 1000.0)
+    frame_len = max(1, int(rate * args.frame_ms / 1000.0))
+    total = int(args.seconds * rate)
+    # Non-zero everywhere so leading buffer silence can be told apart.
+    source = [1000 + int(8000 * math.sin(2 * math.pi * 440 * i / rate)) for i in range(total)]
+    packets = (total + per_packet - 1) // per_packet
+
+    jb = _Jb()
+    storage = (ctypes.c_int16 * ((args.slots + 1) * args.slot_samples))()
+    cfg = _JbCfg(args.min_depth_ms, args.max_depth_ms)
+    if not lib.audio_jb_init(ctypes.byref(jb), ctypes.byref(cfg), storage, args.slots, args.slot_samples):
+        raise ValueError("audio_jb_init rejected the configuration")
+    lib.audio_jb_start(ctypes.byref(jb), rate)
+
+    rng = random.Random(f"{args.seed}:{name}")
+    arrivals = stream_arrivals(packets, packet_ms, JITTER_SCENARIOS[name], rng)
+    end_ms = (packets - 1) * packet_ms + 5.0
+    frame = (ctypes.c_int16 * frame_len)()
+    out: list[int] = []
+    i = 0
+    t = 0.0
+    ended = False
+    # Pulls still buffering with the slot window already full: playout can
+    # only wait for a depth the window cannot hold.
+    stuck = 0
+    while True:
+        while i < len(arrivals) and arrivals[i][0] <= t:
+            seq = arrivals[i][1]
+            chunk = source[seq * per_packet : (seq + 1) * per_packet]
+            lib.audio_jb_put(ctypes.byref(jb), seq & 0xFFFF, (ctypes.c_int16 * len(chunk))(*chunk), len(chunk))
+            i += 1
+        if not ended and t >= end_ms and i == len(arrivals):
+            lib.audio_jb_end(ctypes.byref(jb))
+            ended = True
+        full = jb.have_seq and (jb.end_seq - jb.play_seq) & 0xFFFF >= jb.slot_count
+        res = lib.audio_jb_pull(ctypes.byref(jb), frame, frame_len)
+        if res == JB_PULL_DONE:
+            break
+        if res == JB_PULL_BUFFERING and full:
+            stuck += 1
+        out.extend(frame)
+        t += frame_len * 1000.0 / rate
+
+    st = jb.stats
+    lead = next((k for k, v in enumerate(out) if v != 0), len(out))
+    extra_ms = (len(out) - lead - total) * 1000.0 / rate
+    window_ms = args.slots * packet_ms
+    ok = stuck == 0 and st.target_ms <= window_ms
+    if name == "clean":
+        ok = ok and out[lead : lead + total] == source and st.concealed == 0 and st.underruns == 0
+    print(
+        f"{name}@{packet_ms:g}ms: packets={packets} received={st.received} played={st.played} "
+        f"concealed={st.concealed} underruns={st.underruns} overruns={st.overruns} "
+        f"late={st.late} dup={st.duplicates} target_ms={st.target_ms} "
+        f"max_depth_ms={st.max_depth_ms} startup_ms={lead * 1000.0 / rate:.0f} "
+        f"stretch_ms={extra_ms:.0f} window_ms={window_ms:.0f} stuck_pulls={stuck}" + ("" if ok else " FAIL")
+    )
+    return ok
+
+
+def run_jitter(args: argparse.Namespace) -> int:
+    if not 2 <= args.slots <= JB_MAX_SLOTS:
+        print(f"--slots must be in 2..{JB_MAX_SLOTS}", file=sys.stderr)
+        return 2
+    if args.sample_rate * args.packet_ms / 1000.0 > args.slot_samples:
+        print("--packet-ms does not fit in --slot-samples", file=sys.stderr)
+        return 2
+    lib = load_audio_jitter()
+    if lib is None:
+        print("native audio_jitter unavailable", file=sys.stderr)
+        return 1
+    names = args.scenario or list(JITTER_SCENARIOS)
+    runs = [(name, args.packet_ms) for name in names]
+    if not args.scenario:
+        # Short packets make a short slot window (16 x 10 ms); stalls must
+        # not drive the target past it.
+        runs.append(("stalls", 10.0))
+    ok = all([run_jitter_scenario(lib, args, name, packet_ms) for name, packet_ms in runs])
+    return 0 if ok else 1
+
+
+class _FifoParser(ctypes.Structure):
+    # Mirrors bmi270_fifo_parser_t in firmware/main/bmi270_fifo.h.
+    _fields_ = [
+        ("frame_period_ticks", ctypes.c_uint32),
+        ("last_acc", ctypes.c_int16 * 3),
+        ("last_gyr", ctypes.c_int16 * 3),
+        ("have_time", ctypes.c_bool),
+        ("last_raw_time", ctypes.c_uint32),
+        ("time_ticks", ctypes.c_int64),
+        ("anchor_ticks", ctypes.c_int64),
+        ("anchor_us", ctypes.c_int64),
+        ("rate_ppm", ctypes.c_int32),
+        ("last_sync_us", ctypes.c_int64),
+        ("clock_error_us", ctypes.c_int64),
+        ("last_ts_us", ctypes.c_int64),
+        ("skipped_frames", ctypes.c_uint32),
+        ("truncated_bursts", ctypes.c_uint32),
+    ]
+
+
+# Header-mode FIFO frames as the BMI270 emits them (datasheet 5.5.9).
+FIFO_GYR_ACC = 0x8C
+FIFO_ACC = 0x84
+FIFO_GYR = 0x88
+FIFO_SKIP = 0x40
+FIFO_TIME = 0x44
+FIFO_CONFIG = 0x48
+FIFO_EMPTY = 0x80
+SENSORTIME_HZ = 25600
+
+
+def fifo_frame(gyr: tuple[int, int, int] | None, acc: tuple[int, int, int] | None) -> bytes:
+    header = FIFO_EMPTY | (0x08 if gyr else 0) | (0x04 if acc else 0)
+    return bytes([header]) + (struct.pack("<3h", *gyr) if gyr else b"") + (struct.pack("<3h", *acc) if acc else b"")
+
+
+def fifo_time(ticks: int) -> bytes:
+    return bytes([FIFO_TIME]) + (ticks & 0xFFFFFF).to_bytes(3, "little")
+
+
+def fifo_axes(i: int) -> tuple[tuple[int, int, int], tuple[int, int, int]]:
+    # Distinct gyro/accel values per frame index.
+    return (i, -i, 1000 + i), (4096 - i, 7 * i, -3 * i)
+
+
+class FifoHarness:
+    def __init__(self, lib: ctypes.CDLL, odr_hz: int) -> None:
+        self.lib = lib
+        self.p = _FifoParser()
+        lib.bmi270_fifo_parser_init(ctypes.byref(self.p), odr_hz)
+        self.out = (ImuSample * 512)()
+
+    def parse(self, burst: bytes, host_now_us: int) -> list[tuple[int, ...]]:
+        n = self.lib.bmi270_fifo_parse(ctypes.byref(self.p), burst, len(burst), host_now_us, self.out, len(self.out))
+        return [(x.ts_us, x.ax, x.ay, x.az, x.gx, x.gy, x.gz) for x in self.out[:n]]
+
+
+def fifo_cases(lib: ctypes.CDLL, odr_hz: int) -> list[tuple[str, bool, str]]:
+    # (case, passed, detail) for each hand-built dump.
+    period_ticks = SENSORTIME_HZ // odr_hz
+    period_us = period_ticks * 1_000_000 / SENSORTIME_HZ
+    results = []
+
+    def expect_samples(got, frames, last_us):
+        want = []
+        for k, (gyr, acc) in enumerate(frames):
+            ts = last_us - int((len(frames) - 1 - k) * period_us)
+            want.append((ts, *acc, *gyr))
+        return got == want, f"got {len(got)} samples, want {len(want)}"
+
+    # Header-mode gyro+accel frames, sensortime, then 0x80 over-read padding.
+    h = FifoHarness(lib, odr_hz)
+    frames = [fifo_axes(i) for i in range(6)]
+    burst = b"".join(fifo_frame(g, a) for g, a in frames) + fifo_time(5000) + bytes([FIFO_EMPTY]) * 25
+    ok, detail = expect_samples(h.parse(burst, 1_000_000), frames, 1_000_000)
+    results.append(("header frames + sensortime + 0x80 padding", ok and h.p.truncated_bursts == 0, detail))
+
+    # Padding with stray bytes after it: nothing past the first 0x80 is read.
+    h = FifoHarness(lib, odr_hz)
+    burst = fifo_frame(*frames[0]) + fifo_time(100) + bytes([FIFO_EMPTY, 0x8C, 0x01, 0x02])
+    got = h.parse(burst, 500_000)
+    results.append(("over-read stops at 0x80", len(got) == 1 and h.p.truncated_bursts == 0, f"samples={len(got)}"))
+
+    # Accel-only and gyro-only frames carry the other sensor's last values.
+    h = FifoHarness(lib, odr_hz)
+    (g0, a0), (g1, a1), (g2, a2) = frames[:3]
+    burst = fifo_frame(g0, a0) + fifo_frame(None, a1) + fifo_frame(g2, None) + fifo_time(9000)
+    got = h.parse(burst, 2_000_000)
+    ok = [x[1:] for x in got] == [(*a0, *g0), (*a1, *g0), (*a1, *g2)]
+    results.append(("accel-only / gyro-only frames", ok, f"samples={len(got)}"))
+
+    # Skip and config-change frames between data frames.
+    h = FifoHarness(lib, odr_hz)
+    burst = (
+        fifo_frame(*frames[0])
+        + bytes([FIFO_SKIP, 3])
+        + fifo_frame(*frames[1])
+        + bytes([FIFO_CONFIG, 0x01, 0x02, 0x03, 0x04])
+        + fifo_frame(*frames[2])
+        + fifo_time(777)
+    )
+    ok, detail = expect_samples(h.parse(burst, 3_000_000), frames[:3], 3_000_000)
+    results.append(("skip + config-change frames", ok and h.p.skipped_frames == 3, f"{detail}, skipped={h.p.skipped_frames}"))
+
+    # A frame cut off at the end of the burst: earlier frames still come out.
+    h = FifoHarness(lib, odr_hz)
+    burst = fifo_frame(*frames[0]) + fifo_frame(*frames[1]) + fifo_time(400) + fifo_frame(*frames[2])[:7]
+    got = h.parse(burst, 4_000_000)
+    ok = len(got) == 2 and h.p.truncated_bursts == 1 and got[-1][0] == 4_000_000
+    results.append(("frame truncated at burst end", ok, f"samples={len(got)} truncated={h.p.truncated_bursts}"))
+
+    # Sensortime wrapping past 24 bits: spacing stays one period across bursts.
+    h = FifoHarness(lib, odr_hz)
+    ticks = 0xFFFFFF - 5 * period_ticks
+    host = 10_000_000
+    stamps = []
+    for b in range(6):
+        burst = b""
+        for k in range(4):
+            burst += fifo_frame(*fifo_axes(b * 4 + k))
+        ticks += 4 * period_ticks
+        burst += fifo_time(ticks)
+        host_now = host + int(round((ticks - (0xFFFFFF - 5 * period_ticks) - 4 * period_ticks) * 1e6 / SENSORTIME_HZ))
+        stamps += [x[0] for x in h.parse(burst, host_now)]
+    steps = {b - a for a, b in zip(stamps, stamps[1:])}
+    ok = len(stamps) == 24 and steps <= {int(period_us), int(period_us) + 1} and ticks > 0xFFFFFF
+    results.append(("sensortime 24-bit wrap", ok, f"samples={len(stamps)} steps_us={sorted(steps)}"))
+    return results
+
+
+def fifo_drift(lib: ctypes.CDLL, args: argparse.Namespace) -> tuple[bool, str]:
+    # Bursts every --burst-frames frames with the sensor clock --drift fast
+    # and up to 2 ms of read-time jitter; the mapped timestamps must track the
+    # host clock and stay monotonic.
+    rng = random.Random(3)
+    h = FifoHarness(lib, args.odr_hz)
+    period_ticks = SENSORTIME_HZ // args.odr_hz
+    host_per_tick = 1e6 / SENSORTIME_HZ / (1.0 + args.drift)
+    bursts = int(args.hours * 3600 * args.odr_hz / args.burst_frames)
+    ticks = 123
+    last = None
+    worst_err = 0
+    worst_step = 0.0
+    nominal = period_ticks * 1e6 / SENSORTIME_HZ
+    backward = 0
+    for b in range(bursts):
+        burst = b"".join(fifo_frame(*fifo_axes(k)) for k in range(args.burst_frames))
+        ticks += args.burst_frames * period_ticks
+        burst += fifo_time(ticks)
+        host_now = 1_000_000 + int(ticks * host_per_tick) + rng.randint(0, 2000)
+        got = h.parse(burst, host_now)
+        for x in got:
+            if last is not None:
+                step = x[0] - last
+                backward += step <= 0
+                worst_step = max(worst_step, abs(step - nominal) / nominal)
+            last = x[0]
+        if b > bursts // 10:
+            worst_err = max(worst_err, abs(h.p.clock_error_us))
+    free_run = args.hours * 3600 * args.drift / (1.0 + args.drift)
+    ok = backward == 0 and worst_err < 10_000
+    detail = (
+        f"bursts={bursts} worst_clock_error_ms={worst_err / 1000:.2f} (unslewed: {free_run:.1f}s) "
+        f"worst_spacing_error={worst_step * 100:.1f}% backward_steps={backward}"
+    )
+    return ok, detail
+
+
+def run_fifo(args: argparse.Namespace) -> int:
+    lib = load_bmi270_fifo()
+    if lib is None:
+        print("native bmi270_fifo unavailable", file=sys.stderr)
+        return 1
+    ok = True
+    for name, passed, detail in fifo_cases(lib, args.odr_hz):
+        print(f"{name}: {'ok' if passed else 'FAIL'} {detail}")
+        ok = ok and passed
+    passed, detail = fifo_drift(lib, args)
+    print(f"drift {args.drift * 100:g}% over {args.hours:g}h: {'ok' if passed else 'FAIL'} {detail}")
+    ok = ok and passed
+    for path in args.dump:
+        h = FifoHarness(lib, args.odr_hz)
+        got = h.parse(path.read_bytes(), 0)
+        print(
+            f"{path}: samples={len(got)} skipped={h.p.skipped_frames} truncated={h.p.truncated_bursts} "
+            f"sensortime={h.p.last_raw_time if h.p.have_time else 'none'}"
+        )
+        for x in got:
+            print("  " + " ".join(str(v) for v in x))
+    return 0 if ok else 1
+
+
+class _RingStressResult(ctypes.Structure):
+    # Mirrors ring_stress_result_t in pc/native/ring_stress.c.
+    _fields_ = [
+        ("offered", ctypes.c_uint64),
+        ("pushed", ctypes.c_uint64),
+        ("dropped", ctypes.c_uint64),
+        ("consumed", ctypes.c_uint64),
+        ("skipped", ctypes.c_uint64),
+        ("order_errors", ctypes.c_uint64),
+        ("high_watermark", ctypes.c_uint32),
+        ("max_seen", ctypes.c_uint32),
+        ("max_lag", ctypes.c_uint32),
+        ("end_lag", ctypes.c_uint32),
+        ("elapsed_ns", ctypes.c_uint64),
+    ]
+
+
+def ring_problems(r: _RingStressResult, capacity: int, lossless: bool) -> list[str]:
+    # Invariants of one two-thread run; empty when it passed.
+    bad = []
+    if r.order_errors:
+        bad.append(f"order_errors={r.order_errors}")
+    if r.consumed != r.pushed or r.end_lag != 0:
+        bad.append(f"consumed={r.consumed} pushed={r.pushed} end_lag={r.end_lag}")
+    if lossless and (r.pushed != r.offered or r.skipped != 0):
+        bad.append(f"lossless run lost samples: offered={r.offered} pushed={r.pushed} skipped={r.skipped}")
+    if not lossless and (r.offered != r.pushed + r.dropped or r.skipped != r.dropped):
+        bad.append(f"offered={r.offered} != pushed+dropped={r.pushed + r.dropped} (skipped={r.skipped})")
+    if not 0 < r.high_watermark <= capacity or r.max_seen > r.high_watermark:
+        bad.append(f"high_watermark={r.high_watermark} max_seen={r.max_seen} capacity={capacity}")
+    if r.max_lag > capacity:
+        bad.append(f"max_lag={r.max_lag} > capacity={capacity}")
+    if not lossless and not r.dropped:
+        bad.append("nothing overflowed; raise --stall-us")
+    if not lossless and r.dropped and r.high_watermark != capacity:
+        bad.append(f"dropped={r.dropped} before high_watermark reached capacity ({r.high_watermark})")
+    return bad
+
+
+def run_ring(args: argparse.Namespace) -> int:
+    if args.capacity < 2 or args.capacity & (args.capacity - 1):
+        print("--capacity must be a power of two >= 2", file=sys.stderr)
+        return 2
+    if not 0 < args.samples < 1 << 32 or not 0 < args.overflow_samples < 1 << 32:
+        print("sample counts must be in 1..2^32-1 (the ring's counters are 32-bit)", file=sys.stderr)
+        return 2
+    lib = load_imu_ring()
+    if lib is None:
+        print("native imu_ring unavailable", file=sys.stderr)
+        return 1
+    ok = True
+    ns: dict[str, float] = {}
+    runs = [
+        ("ring", lib.ring_stress, True, args.samples, 0, 0),
+        ("queue", lib.queue_stress, True, args.samples, 0, 0),
+        ("ring", lib.ring_stress, False, args.overflow_samples, args.stall_every, args.stall_us),
+        ("queue", lib.queue_stress, False, args.overflow_samples, args.stall_every, args.stall_us),
+    ]
+    for name, fn, lossless, samples, stall_every, stall_us in runs:
+        best = None
+        for _ in range(max(1, args.repeat) if lossless else 1):
+            r = _RingStressResult()
+            if fn(args.capacity, samples, int(lossless), stall_every, stall_us, ctypes.byref(r)) != 0:
+                print(f"{name}: run failed to start", file=sys.stderr)
+                return 1
+            bad = ring_problems(r, args.capacity, lossless)
+            ok = ok and not bad
+            if best is None or r.elapsed_ns < best[0].elapsed_ns or bad:
+                best = (r, bad)
+            if bad:
+                break
+        r, bad = best
+        per = r.elapsed_ns / max(1, r.consumed)
+        if lossless:
+            ns[name] = per
+        # Lossless runs count full-ring retries as drops; only their time matters.
+        counts = f"full_waits={r.dropped} ns_per_sample={per:.1f}" if lossless else f"dropped={r.dropped}"
+        print(
+            f"{name} {'lossless' if lossless else 'overflow'}: samples={r.offered} consumed={r.consumed} "
+            f"{counts} high_watermark={r.high_watermark} max_lag={r.max_lag} "
+            f"{'ok' if not bad else 'FAIL ' + '; '.join(bad)}"
+        )
+    print(f"ring_vs_queue speedup={ns['queue'] / max(ns['ring'], 1e-9):.1f}x")
+    return 0 if ok else 1
+
+
+def snr_db(ref: list[int], got: list[int]) -> float:
+    sig = sum(v * v for v in ref)
+    noise = sum((a - b) * (a - b) for a, b in zip(ref, got))
+    if noise == 0:
+        return float("inf")
+    return 10.0 * math.log10(max(sig, 1) / noise)
+
+
+def run_adpcm(args: argparse.Namespace) -> int:
+    lib = load_audio_adpcm()
+    if lib is None:
+        print("native audio_adpcm unavailable", file=sys.stderr)
+        return 1
+    paths = args.pcm or sorted((Path(__file__).resolve().parents[1] / "firmware/main/audio_labels").glob("*.pcm"))
+    clips = [(p.name, pcm_bytes_to_samples(p.read_bytes())) for p in paths]
+    rng = random.Random(1)
+    # Two seconds of a chirp plus noise, in case no clips are available.
+    rate = args.sample_rate
+    chirp = [
+        int(9000 * math.sin(2 * math.pi * (200 + 1500 * i / (2 * rate)) * i / rate)) + rng.randint(-300, 300)
+        for i in range(2 * rate)
+    ]
+    clips.append(("synthetic_chirp", chirp))
+    per_packet = max(1, int(rate * args.packet_ms / 1000.0))
+
+    ok = True
+    for name, pcm in clips:
+        if not pcm:
+            continue
+        t0 = time.perf_counter()
+        blocks = encode_blocks(pcm, per_packet)
+        enc_s = time.perf_counter() - t0
+        decoded: list[int] = []
+        for n, block in blocks:
+            decoded.extend(decode_block(block, n) or [0] * n)
+        out = (ctypes.c_int16 * per_packet)()
+        t0 = time.perf_counter()
+        for n, block in blocks:
+            lib.audio_adpcm_decode_block(block, len(block), n, out)
+        dec_s = time.perf_counter() - t0
+
+        # Python twin must produce the same bitstream and samples.
+        index = 0
+        off = 0
+        for n, block in blocks:
+            py_block, index = encode_block_py(pcm[off : off + n], index)
+            if py_block != block or decode_block_py(block, n) != decoded[off : off + n]:
+                print(f"{name}: python/native mismatch in block at sample {off}", file=sys.stderr)
+                ok = False
+                break
+            off += n
+
+        pcm_bytes = sum(8 + 2 * n for n, _ in blocks)
+        adpcm_bytes = sum(8 + len(b) for _, b in blocks)
+        assert all(len(b) == block_bytes(n) for n, b in blocks)
+        # Times include one ctypes call per packet.
+        print(
+            f"{name}: samples={len(pcm)} packets={len(blocks)} snr_db={snr_db(pcm, decoded):.1f} "
+            f"pcm_bytes={pcm_bytes} adpcm_bytes={adpcm_bytes} ratio={pcm_bytes / adpcm_bytes:.2f}x "
+            f"encode_ns_per_sample={enc_s * 1e9 / len(pcm):.0f} decode_ns_per_sample={dec_s * 1e9 / len(pcm):.0f}"
+        )
+    return 0 if ok else 1
+
+
+def random_sequence(n: int, rng: random.Random) -> list[tuple[float, ...]]:
+    axes = [0.0] * 6
+    out = []
+    for _ in range(n):
+        axes = [v + rng.gauss(0.0, 1.0) for v in axes]
+        out.append(tuple(axes))
+    return znormalize(out)
+
+
+def band_cells(n: int, m: int, window: int) -> int:
+    if window <= 0:
+        window = max(n, m)
+    window = max(window, abs(n - m))
+    return sum(min(m, i + window) - max(1, i - window) + 1 for i in range(1, n + 1))
+
+
+def run_dtw(args: argparse.Namespace) -> int:
+    if load_dtw_kernel() is None:
+        print("native dtw_kernel unavailable", file=sys.stderr)
+        return 1
+    rng = random.Random(1)
+    worst_rel = 0.0
+    for max_points in args.max_points or [60, 120, 180, 256]:
+        # Queries and references differ a little in length, like real captures.
+        pairs = [
+            (random_sequence(max_points, rng), random_sequence(max(2, int(max_points * 0.85)), rng))
+            for _ in range(args.pairs)
+        ]
+        for window_frac in args.window_frac or [0.1, 0.2, 0.5]:
+            cells = 0
+            py_s = 0.0
+            native_s = 0.0
+            for a, b in pairs:
+                window = int(round(max(len(a), len(b)) * window_frac))
+                cells += band_cells(len(a), len(b), window)
+                t0 = time.perf_counter()
+                ref = dtw_distance_py(a, b, window)
+                py_s += time.perf_counter() - t0
+                pa = pack_sequence(a)
+                pb = pack_sequence(b)
+                t0 = time.perf_counter()
+                got = dtw_packed(a, pa, b, pb, window)
+                native_s += time.perf_counter() - t0
+                worst_rel = max(worst_rel, abs(got - ref) / max(abs(ref), 1e-12))
+            print(
+                f"max_points={max_points} window_frac={window_frac:.2f} band_cells={cells // len(pairs)} "
+                f"python_ns_per_cell={py_s * 1e9 / cells:.1f} native_ns_per_cell={native_s * 1e9 / cells:.2f} "
+                f"speedup={py_s / native_s:.0f}x"
+            )
+    print(f"max_relative_diff={worst_rel:.2e}")
+    return 0 if worst_rel < 1e-4 else 1
+
+
+def warped_copy(proto: list[tuple[float, ...]], n: int, noise: float, rng: random.Random) -> list[tuple[float, ...]]:
+    # Random monotone time warp of a prototype plus sensor noise, re-normalized.
+    speed = [rng.uniform(0.6, 1.4) for _ in range(n)]
+    pos = [0.0]
+    for v in speed[:-1]:
+        pos.append(pos[-1] + v)
+    scale = (len(proto) - 1) / pos[-1]
+    out = []
+    for p in pos:
+        base = proto[min(len(proto) - 1, int(round(p * scale)))]
+        out.append(tuple(x + rng.gauss(0.0, noise) for x in base))
+    return znormalize(out)
+
+
+def run_xcorr(args: argparse.Namespace) -> int:
+    if load_xcorr_kernel() is None:
+        print("native xcorr_kernel unavailable", file=sys.stderr)
+        return 1
+    rng = random.Random(4)
+    mismatches = 0
+    for max_points in args.max_points or [60, 180, 256]:
+        # Shifted, noisy copies so the best lag is somewhere inside the range.
+        base = random_sequence(max_points + max_points // 2, rng)
+        refs = []
+        for _ in range(args.refs):
+            off = rng.randrange(max_points // 2)
+            m = max(8, int(max_points * rng.uniform(0.85, 1.0)))
+            refs.append(znormalize([tuple(v + rng.gauss(0.0, 0.5) for v in p) for p in base[off : off + m]]))
+        queries = [random_sequence(max_points, rng) for _ in range(args.queries - 1)] + [
+            znormalize(base[max_points // 4 : max_points // 4 + max_points])
+        ]
+        sides = [xcorr_spectra(r) for r in refs]
+        py_s = 0.0
+        fft_s = 0.0
+        for q in queries:
+            params = []
+            for r, side in zip(refs, sides):
+                max_lag = int(round(max(len(q), len(r)) * args.max_lag_frac))
+                min_overlap = max(4, int(round(min(len(q), len(r)) * args.min_overlap_frac)))
+                xcorr_spectrum(side, xcorr_fft_size(len(q), len(r), max_lag))  # model load
+                params.append((max_lag, min_overlap))
+            t0 = time.perf_counter()
+            want = [max_normalized_xcorr(q, r, lag, ov) for r, (lag, ov) in zip(refs, params)]
+            py_s += time.perf_counter() - t0
+            t0 = time.perf_counter()
+            q_side = xcorr_spectra(q)
+            got = [
+                max_normalized_xcorr_fft(q, q_side, r, side, lag, ov)
+                for r, side, (lag, ov) in zip(refs, sides, params)
+            ]
+            fft_s += time.perf_counter() - t0
+            mismatches += sum(1 for x, y in zip(want, got) if x != y)
+        pairs = len(queries) * len(refs)
+        print(
+            f"max_points={max_points} lags=+-{int(round(max_points * args.max_lag_frac))} "
+            f"python_us_per_ref={py_s * 1e6 / pairs:.0f} fft_us_per_ref={fft_s * 1e6 / pairs:.1f} "
+            f"speedup={py_s / fft_s:.0f}x"
+        )
+    print(f"best_and_lag_mismatches={mismatches}")
+    return 0 if mismatches == 0 else 1
+
+
+def run_scale(args: argparse.Namespace) -> int:
+    cores = os.cpu_count() or 1
+    worker_counts = args.workers or sorted({1, 2, *[w for w in (4, 8, 16, 32) if w <= cores], cores})
+    rng = random.Random(5)
+    n = args.max_points
+    protos = [random_sequence(n, rng) for _ in range(args.labels)]
+    queries = [warped_copy(protos[rng.randrange(args.labels)], n, 0.3, rng) for _ in range(args.queries)]
+    print(f"cores={cores}")
+    same = True
+    for ref_count in args.refs or [60, 240, 960]:
+        refs = [
+            LabeledSequence(
+                label=f"l{i % args.labels}",
+                path=Path(f"r{i}"),
+                seq=warped_copy(protos[i % args.labels], n, rng.uniform(0.2, 0.9), rng),
+            )
+            for i in range(ref_count)
+        ]
+        base_ms = None
+        want = None
+        for workers in worker_counts:
+            t0 = time.perf_counter()
+            with ScoringEngine(refs, n, args.window_frac, 0.15, 0.5, workers=workers) as engine:
+                startup_s = time.perf_counter() - t0
+                engine.query_scores(queries[0], args.per_label_k, "hybrid", 0.35)  # warm-up
+                got = []
+                t0 = time.perf_counter()
+                for q in queries:
+                    got.append(engine.query_scores(q, args.per_label_k, "hybrid", 0.35))
+                ms = (time.perf_counter() - t0) * 1000 / len(queries)
+            if want is None:
+                want = got
+                base_ms = ms
+            same = same and got == want
+            print(
+                f"refs={ref_count} workers={workers} startup_ms={startup_s * 1000:.0f} "
+                f"ms_per_query={ms:.2f} speedup={base_ms / ms:.2f}x"
+            )
+    print(f"results_identical_across_workers={same}")
+    return 0 if same else 1
+
+
+def spring_stream(
+    protos: list[tuple[float, ...]], n: int, step: float, samples: int, rng: random.Random
+) -> tuple[list[tuple[float, ...]], list[tuple[int, int, str]]]:
+    # Raw stream at `step` samples per point: quiet noise with a warped copy
+    # of a random prototype every few seconds. Returns it and the gesture
+    # spans (first, last sample, label).
+    out: list[tuple[float, ...]] = []
+    spans: list[tuple[int, int, str]] = []
+    while len(out) < samples:
+        out.extend(tuple(rng.gauss(0.0, 0.3) for _ in range(6)) for _ in range(rng.randint(200, 500)))
+        li = rng.randrange(len(protos))
+        g = warped_copy(protos[li], n, 0.3, rng)
+        raw = [g[min(n - 1, int(i / step))] for i in range(int(n * step))]
+        spans.append((len(out), len(out) + len(raw) - 1, f"l{li}"))
+        out.extend(raw)
+    return out[:samples], [x for x in spans if x[1] < samples]
+
+
+def run_spring(args: argparse.Namespace) -> int:
+    from stream_spotter import SpringBank, StreamSpotter
+
+    if load_dtw_kernel() is None:
+        print("native dtw_kernel unavailable", file=sys.stderr)
+        return 1
+    rng = random.Random(7)
+    n = args.max_points
+    protos = [random_sequence(n, rng) for _ in range(args.labels)]
+    # Spot threshold per label: twice the DTW between two of its copies.
+    thresholds = {
+        f"l{i}": 2.0 * dtw_packed(a, pack_sequence(a), b, pack_sequence(b), 0)
+        for i, p in enumerate(protos)
+        for a, b in [(warped_copy(p, n, 0.3, rng), warped_copy(p, n, 0.3, rng))]
+    }
+    samples = int(args.seconds * 200)
+    stream, spans = spring_stream(protos, n, args.step, samples, rng)
+    ok = True
+    for ref_count in args.refs or [30, 120, 480]:
+        refs = [
+            LabeledSequence(
+                label=f"l{i % args.labels}",
+                path=Path(f"r{i}"),
+                seq=warped_copy(protos[i % args.labels], n, rng.uniform(0.2, 0.6), rng),
+            )
+            for i in range(ref_count)
+        ]
+        runs = [("native", True)]
+        if args.python and ref_count == min(args.refs or [30]):
+            runs.append(("python", False))
+        got = {}
+        for name, native in runs:
+            spotter = StreamSpotter(SpringBank(refs, thresholds, native=native), args.step, n, use_znorm=True)
+            # The Python twin gets a short stretch only.
+            feed = stream if native else stream[: min(samples, 4000)]
+            detections = []
+            t0 = time.perf_counter()
+            for i, feat in enumerate(feed):
+                detections.extend(spotter.push(i * 5000, feat))
+            elapsed = time.perf_counter() - t0
+            st = spotter.stats
+            hit = sum(
+                any(d.start_us <= b * 5000 and d.end_us >= a * 5000 and d.label == label for d in detections)
+                for a, b, label in spans
+                if b < len(feed)
+            )
+            print(
+                f"refs={ref_count} spotter={name} cells={spotter.bank.cells} sample_us_mean={st.mean_us():.2f} "
+                f"sample_us_p99={st.percentile_us(0.99):.2f} sample_us_max={st.max_ns / 1000:.0f} "
+                f"devices_at_200hz={len(feed) / elapsed / 200:.0f} "
+                f"gestures={sum(b < len(feed) for _a, b, _l in spans)} spotted={hit} detections={len(detections)}"
+            )
+            got[name] = [(d.ref, d.start_us, d.end_us) for d in detections]
+        if "python" in got:
+            # The Python run stops early, so its detections open the native list.
+            same = got["python"] == got["native"][: len(got["python"])]
+            print(f"refs={ref_count} native_vs_python same_detections={same} compared={len(got['python'])}")
+            ok = ok and same
+    return 0 if ok else 1
+
+
+def run_startup(args: argparse.Namespace) -> int:
+    rng = random.Random(6)
+    n = args.max_points
+    protos = [random_sequence(n, rng) for _ in range(args.labels)]
+    queries = [warped_copy(protos[rng.randrange(args.labels)], n, 0.3, rng) for _ in range(args.queries)]
+    params = {
+        "max_points": n,
+        "use_znorm": True,
+        "window_frac": 0.2,
+        "per_label_k": 3,
+        "score_mode": "hybrid",
+        "hybrid_alpha": 0.35,
+        "xcorr_max_lag_frac": 0.15,
+        "xcorr_min_overlap_frac": 0.5,
+    }
+    worst = 0.0
+    agree = True
+    for ref_count in args.refs or [100, 1000]:
+        refs = [
+            {
+                "label": f"l{i % args.labels}",
+                "path": f"r{i}.csv",
+                "seq": [list(p) for p in warped_copy(protos[i % args.labels], rng.randint(n * 3 // 4, n), 0.5, rng)],
+            }
+            for i in range(ref_count)
+        ]
+        model = {"version": 1, "params": params, "thresholds": {}, "labels": sorted({r["label"] for r in refs}), "references": refs}
+        with tempfile.TemporaryDirectory() as tmp:
+            json_path = Path(tmp) / "model.json"
+            with json_path.open("w", encoding="utf-8") as f:
+                json.dump(model, f)
+            variants = [("json", json_path)]
+            for name, quantize in (("binary", False), ("binary_int16", True)):
+                path = Path(tmp) / f"{name}.admodel"
+                write_model(path, model, quantize=quantize)
+                variants.append((name, path))
+            scores = {}
+            for name, path in variants:
+                gc.collect()
+                t0 = time.perf_counter()
+                loaded, _params, _thr = load_model(path)
+                t1 = time.perf_counter()
+                engine = ScoringEngine(loaded, n, 0.2, 0.15, 0.5, workers=1)
+                t2 = time.perf_counter()
+                scores[name] = [engine.query_scores(q, 3, "hybrid", 0.35)[0] for q in queries]
+                del loaded, engine
+                # Separate pass: tracing allocations slows loading down.
+                tracemalloc.start()
+                loaded, _params, _thr = load_model(path)
+                _cur, peak = tracemalloc.get_traced_memory()
+                tracemalloc.stop()
+                del loaded
+                print(
+                    f"refs={ref_count} model={name} bytes={path.stat().st_size} load_ms={(t1 - t0) * 1000:.1f} "
+                    f"prepare_ms={(t2 - t1) * 1000:.1f} startup_ms={(t2 - t0) * 1000:.1f} "
+                    f"load_py_heap_kb={peak // 1024}"
+                )
+        # float32 storage rounds the references the DTW kernel already
+        # rounds; the xcorr half moves by float32 rounding.
+        for want, got in zip(scores["json"], scores["binary"]):
+            agree = agree and min(want, key=want.get) == min(got, key=got.get)
+            for label, v in want.items():
+                worst = max(worst, abs(got[label] - v) / max(abs(v), 1e-9))
+    print(f"binary_vs_json max_relative_score_diff={worst:.2e} best_label_agree={agree}")
+    return 0 if agree and worst < 1e-4 else 1
+
+
+def ingest_sender(port: int, streams: int, seconds: float, burst: int) -> None:
+    # Child process: paced legacy frames, `streams` at 200 Hz; or, with
+    # burst > 0, that many frames as fast as the socket takes them.
+    tx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    dst = ("127.0.0.1", port)
+    if burst > 0:
+        for i in range(burst):
+            tx.sendto(LEGACY_STRUCT.pack(i, 1, 2, 3, 4, 5, 6), dst)
+        return
+    t0 = time.perf_counter()
+    for tick in range(int(seconds * 200)):
+        for s in range(streams):
+            tx.sendto(LEGACY_STRUCT.pack(tick * 5000 + s, s, 0, 4096, 0, 0, 0), dst)
+        delay = t0 + (tick + 1) / 200.0 - time.perf_counter()
+        if delay > 0:
+            time.sleep(delay)
+
+
+def ingest_receiver(name: str, port: int) -> tuple[object, callable]:
+    # (handle, recv_sample) for one receiver variant; the socket gets the same
+    # kernel buffer in every variant.
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+    sock.bind(("127.0.0.1", port))
+    if name == "recvfrom":
+        sock.settimeout(0.25)
+        stream = ImuStream(sock)
+        return stream, stream.recv_sample
+    ingest = ImuIngest(sock, ring_sec=60.0, native=name == "ring_native").start()
+    return ingest, ingest.reader().recv_sample
+
+
+def run_ingest(args: argparse.Namespace) -> int:
+    variants = ["recvfrom", "ring_python"]
+    if load_udp_ingest() is not None:
+        variants.append("ring_native")
+    port = 19500
+    ok = True
+    sent = int(args.seconds * 200) * args.streams
+    for name in variants:
+        # Paced streams; the consumer stalls once a second like a scoring call,
+        # then (recvfrom, as live_classify did) drains what piled up.
+        port += 1
+        handle, recv = ingest_receiver(name, port)
+        proc = multiprocessing.Process(target=ingest_sender, args=(port, args.streams, args.seconds, 0))
+        proc.start()
+        got = 0
+        stall_at = time.monotonic() + 1.0
+        while proc.is_alive():
+            if recv() is not None:
+                got += 1
+            if time.monotonic() >= stall_at:
+                time.sleep(args.busy_ms / 1000.0)
+                if name == "recvfrom":
+                    handle.drain(max_packets=1 << 30)
+                stall_at = time.monotonic() + 1.0
+        proc.join()
+        while recv() is not None:
+            got += 1
+        print(
+            f"ingest paced receiver={name} streams={args.streams} sent={sent} delivered={got} "
+            f"lost={sent - got} busy_ms_per_sec={args.busy_ms:.0f}"
+        )
+        if name != "recvfrom":
+            ok = ok and got == sent
+            handle.close()
+        handle.sock.close()
+
+    for name in variants:
+        # Unpaced burst: how many datagrams a receiver keeps up with, and its
+        # process CPU per datagram (sender runs in another process).
+        port += 1
+        handle, recv = ingest_receiver(name, port)
+        proc = multiprocessing.Process(target=ingest_sender, args=(port, 0, 0.0, args.burst))
+        cpu0 = time.process_time_ns()
+        t0 = time.perf_counter()
+        proc.start()
+        got = 0
+        last = time.perf_counter()
+        while proc.is_alive() or time.perf_counter() - last < 0.5:
+            if recv() is not None:
+                got += 1
+                last = time.perf_counter()
+        elapsed = last - t0
+        cpu_ns = time.process_time_ns() - cpu0
+        proc.join()
+        extra = ""
+        if name != "recvfrom":
+            st = handle.stats
+            extra = f" datagrams_per_batch={st.datagrams / max(1, st.batches):.1f}"
+            handle.close()
+        handle.sock.close()
+        print(
+            f"ingest burst receiver={name} sent={args.burst} received={got} lost={args.burst - got} "
+            f"received_per_sec={got / max(elapsed, 1e-9):.0f} cpu_ns_per_datagram={cpu_ns / max(1, got):.0f}{extra}"
+        )
+    return 0 if ok else 1
+
+
+def csv_write_loop(path: Path, samples: list[Sample]) -> None:
+    # What capture_labeled.py did per sample before capture files.
+    with path.open("w", encoding="utf-8") as f:
+        f.write("ts_us,ax,ay,az,gx,gy,gz\n")
+        for ts_us, ax, ay, az, gx, gy, gz in samples:
+            f.write(f"{ts_us},{ax},{ay},{az},{gx},{gy},{gz}\n")
+
+
+def capture_write_loop(path: Path, samples: list[Sample]) -> None:
+    with CaptureWriter(path) as w:
+        for s in samples:
+            w.append(s)
+
+
+def run_capture(args: argparse.Namespace) -> int:
+    # One long recording plus the same samples cut into per-repeat files (a
+    # session's manifest). Write: a sample at a time, as capture runs do.
+    # Load: every repeat file through read_sequence() (model build) and as raw
+    # samples. Slice: a window from the long recording by device time.
+    trace = synthetic_trace(args.seconds, 200)
+    per = max(1, int(args.repeat_sec * 200))
+    repeats = [trace[i : i + per] for i in range(0, len(trace), per)]
+    mid = trace[len(trace) // 2][0]
+    lo_us, hi_us = mid, mid + int(args.slice_sec * 1_000_000)
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        base = Path(tmp)
+        results = {}
+        for name, suffix, write in (("csv", ".csv", csv_write_loop), ("binary", ".adcap", capture_write_loop)):
+            long_path = base / f"long{suffix}"
+            t0 = time.perf_counter()
+            write(long_path, trace)
+            write_s = time.perf_counter() - t0
+            paths = [base / f"r{i:04d}{suffix}" for i in range(len(repeats))]
+            t0 = time.perf_counter()
+            for path, rep in zip(paths, repeats):
+                write(path, rep)
+            write_rep_s = time.perf_counter() - t0
+            t0 = time.perf_counter()
+            feats = [read_sequence(p) for p in paths]
+            load_s = time.perf_counter() - t0
+            t0 = time.perf_counter()
+            raw = read_samples(long_path)
+            raw_s = time.perf_counter() - t0
+            t0 = time.perf_counter()
+            if name == "csv":
+                window = [s for s in read_samples(long_path) if lo_us <= s[0] < hi_us]
+            else:
+                cap = CaptureFile(long_path)
+                window = cap.samples(lo_us, hi_us)
+                cap.close()
+            slice_s = time.perf_counter() - t0
+            results[name] = (feats, raw, window)
+            print(
+                f"capture format={name} samples={len(trace)} bytes_per_sample={long_path.stat().st_size / len(trace):.1f} "
+                f"write_samples_per_sec={len(trace) / write_s:.0f} "
+                f"write_repeats_per_sec={len(repeats) / write_rep_s:.0f} "
+                f"load_repeats_per_sec={len(repeats) / load_s:.0f} (read_sequence, {per} samples each) "
+                f"load_samples_per_sec={len(trace) / raw_s:.0f} "
+                f"slice_ms={slice_s * 1000:.2f} ({args.slice_sec:.1f}s of {args.seconds:.0f}s)"
+            )
+        same = results["csv"] == results["binary"] and results["binary"][1] == trace
+        ok = ok and same
+    print(f"round_trip_exact={same}")
+    return 0 if ok else 1
+
+
+def run_seqcache(args: argparse.Namespace) -> int:
+    # A manifest of --captures repeats per format, loaded the old way (read
+    # and prep_sequence() per capture), then through load_labeled_sequences()
+    # with a cold and a warm cache. Fails unless every path yields the same
+    # float32 points.
+    per = max(2, int(args.repeat_sec * 200))
+    trace = synthetic_trace(args.captures * args.repeat_sec, 200)
+    repeats = [trace[i : i + per] for i in range(0, len(trace) - per + 1, per)]
+    same = True
+    with tempfile.TemporaryDirectory() as tmp:
+        base = Path(tmp)
+        for name, suffix, write in (("csv", ".csv", csv_write_loop), ("binary", ".adcap", capture_write_loop)):
+            rows = []
+            for i, rep in enumerate(repeats):
+                path = base / f"{name}_r{i:05d}{suffix}"
+                write(path, rep)
+                rows.append({"label": f"l{i % 8}", "csv_path": str(path)})
+            t0 = time.perf_counter()
+            raws = [read_sequence(Path(r["csv_path"])) for r in rows]
+            read_s = time.perf_counter() - t0
+            t0 = time.perf_counter()
+            old = [prep_sequence(x, args.max_points, True) for x in raws]
+            prep_s = time.perf_counter() - t0
+            t0 = time.perf_counter()
+            for x in raws:
+                prep_points(x, args.max_points, True)
+            prep_vec_s = time.perf_counter() - t0
+            cache_path = base / f"{name}.seqcache.bin"
+            timings = []
+            loaded = []
+            for path in (None, cache_path, cache_path):
+                t0 = time.perf_counter()
+                loaded.append(load_labeled_sequences(rows, args.max_points, True, cache_path=path))
+                timings.append(time.perf_counter() - t0)
+            want = [[tuple(array("f", p)) for p in seq] for seq in old]
+            for items in loaded:
+                same = same and [[tuple(p) for p in x.seq] for x in items] == want
+            n = len(rows)
+            print(
+                f"seqcache format={name} captures={n} samples_each={per} max_points={args.max_points} "
+                f"read_ms={read_s * 1000:.0f} prep_tuples_ms={prep_s * 1000:.0f} prep_points_ms={prep_vec_s * 1000:.0f} "
+                f"old_load_ms={(read_s + prep_s) * 1000:.0f} load_no_cache_ms={timings[0] * 1000:.0f} "
+                f"load_cold_ms={timings[1] * 1000:.0f} load_warm_ms={timings[2] * 1000:.0f} "
+                f"warm_speedup={(read_s + prep_s) / timings[2]:.1f}x cache_bytes={cache_path.stat().st_size}"
+            )
+    print(f"sequences_match={same}")
+    return 0 if same else 1
+
+
+def run_condense(args: argparse.Namespace) -> int:
+    # Synthetic labels, each performed in --styles distinct ways with
+    # per-capture warp, length and noise; stratified split, then the full
+    # training set vs condensed ones (hybrid scoring, as live).
+    rng = random.Random(11)
+    n = args.max_points
+    items = []
+    for li in range(args.labels):
+        styles = [random_sequence(n, rng) for _ in range(args.styles)]
+        for r in range(args.refs_per_label):
+            m = max(8, int(n * rng.uniform(0.85, 1.0)))
+            seq = warped_copy(styles[r % args.styles], m, rng.uniform(0.3, 0.9), rng)
+            items.append(LabeledSequence(label=f"l{li}", path=Path(f"l{li}_{r}"), seq=seq, raw_len=m * 3))
+    train, test = split_stratified(items, test_ratio=0.3, seed=7)
+
+    def make_engine(refs: list[LabeledSequence]) -> ScoringEngine:
+        return ScoringEngine(refs, query_len=n, window_frac=0.2, xcorr_max_lag_frac=0.15, xcorr_min_overlap_frac=0.5, workers=1)
+
+    settings = [int(x) for x in args.prototypes.split(",") if x.strip()]
+    t0 = time.perf_counter()
+    results = evaluate_split(train, test, settings, args.per_label_k, 0.2, make_engine, "hybrid", 0.35)
+    print(f"condense labels={args.labels} styles={args.styles} train={len(train)} test={len(test)} seconds={time.perf_counter() - t0:.1f}")
+    for line in format_split(results):
+        print(line)
+    return 0 if results[0].accuracy - results[-1].accuracy <= args.max_drop else 1
+
+
+def sequence_bytes(seq: list[tuple[float, ...]]) -> int:
+    # Resident size of a sequence held as a list of float tuples.
+    return sys.getsizeof(seq) + sum(sys.getsizeof(p) + sum(sys.getsizeof(v) for v in p) for p in seq)
+
+
+def run_fixedpoint(args: argparse.Namespace) -> int:
+    # The condense data set scored as float (tuples here, float32 in the
+    # kernels) and as int16 references through the fixed-point kernel:
+    # reference memory, hybrid query time and accuracy, the gap between the
+    # two paths' per-reference metrics, and the kernel against its Python twin.
+    if load_q16_kernel() is None:
+        print("native q16_kernel unavailable", file=sys.stderr)
+        return 1
+    rng = random.Random(13)
+    n = args.max_points
+    items = []
+    for li in range(args.labels):
+        styles = [random_sequence(n, rng) for _ in range(args.styles)]
+        for r in range(args.refs_per_label):
+            m = max(8, int(n * rng.uniform(0.85, 1.0)))
+            seq = warped_copy(styles[r % args.styles], m, rng.uniform(0.3, 0.9), rng)
+            items.append(LabeledSequence(label=f"l{li}", path=Path(f"l{li}_{r}"), seq=seq))
+    train, test = split_stratified(items, test_ratio=0.3, seed=7)
+    fmt = Q16Format.for_references(train)
+    q16_refs = quantize_references(train, fmt)
+    points = sum(len(x.seq) for x in train)
+    print(
+        f"fixedpoint refs={len(train)} queries={len(test)} points={points} "
+        f"tuple_bytes={sum(sequence_bytes(x.seq) for x in train)} "
+        f"float32_bytes={points * DTW_STRIDE * 4} int16_bytes={points * DTW_STRIDE * 2}"
+    )
+
+    runs = {}
+    for name, refs, fixed in (("float", train, False), ("fixed", q16_refs, True)):
+        with ScoringEngine(refs, n, 0.2, 0.15, 0.5, workers=1, fixed_point=fixed) as engine:
+            engine.query_scores(test[0].seq, args.per_label_k, "hybrid", 0.35)  # warm-up
+            preds = []
+            t0 = time.perf_counter()
+            for item in test:
+                scores = engine.query_scores(item.seq, args.per_label_k, "hybrid", 0.35)[0]
+                preds.append(min(scores, key=scores.get))
+            ns = (time.perf_counter() - t0) * 1e9 / len(test)
+            exact = [list(engine.score_row(item.seq).values()) for item in test[: args.exact_queries]]
+        accuracy = sum(p == item.label for p, item in zip(preds, test)) / len(test)
+        runs[name] = (preds, exact, accuracy)
+        print(
+            f"fixedpoint path={name} ns_per_query={ns:.0f} ns_per_ref={ns / len(train):.0f} accuracy={accuracy:.4f}"
+        )
+    float_preds, float_exact, float_acc = runs["float"]
+    fixed_preds, fixed_exact, fixed_acc = runs["fixed"]
+    agree = sum(a == b for a, b in zip(float_preds, fixed_preds)) / len(test)
+    dtw_rel = 0.0
+    xcorr_abs = 0.0
+    lag_diff = 0
+    for row_f, row_q in zip(float_exact, fixed_exact):
+        for a, b in zip(row_f, row_q):
+            dtw_rel = max(dtw_rel, abs(a.dtw - b.dtw) / a.dtw if a.dtw > 0 else 0.0)
+            xcorr_abs = max(xcorr_abs, abs(a.xcorr - b.xcorr))
+            lag_diff += a.lag != b.lag
+    print(
+        f"fixedpoint agreement={agree:.4f} max_dtw_rel_err={dtw_rel:.2e} max_xcorr_abs_err={xcorr_abs:.2e} "
+        f"lag_mismatches={lag_diff}"
+    )
+
+    bank = Q16Bank(q16_refs[: args.twin_refs], fmt)
+    active = list(range(len(bank.refs)))
+    twin_same = True
+    for item in test[:2]:
+        want = bank.score(item.seq, active, 0.2, 0.15, 0.5)
+        got = bank.score(item.seq, active, 0.2, 0.15, 0.5, native=False)
+        twin_same = twin_same and [(m.dtw, m.xcorr, m.lag) for m in got] == [(m.dtw, m.xcorr, m.lag) for m in want]
+    print(f"python_twin_identical={twin_same}")
+    return 0 if twin_same and float_acc - fixed_acc <= args.max_drop else 1
+
+
+def run_prefilter(args: argparse.Namespace) -> int:
+    # The condense data set at a larger reference count: exact scoring vs
+    # the embedding pre-filter at each --shortlists size.
+    rng = random.Random(17)
+    n = args.max_points
+    items = []
+    for li in range(args.labels):
+        styles = [random_sequence(n, rng) for _ in range(args.styles)]
+        for r in range(args.refs_per_label):
+            m = max(8, int(n * rng.uniform(0.85, 1.0)))
+            seq = warped_copy(styles[r % args.styles], m, rng.uniform(0.3, 0.9), rng)
+            items.append(LabeledSequence(label=f"l{li}", path=Path(f"l{li}_{r}"), seq=seq))
+    train, test = split_stratified(items, test_ratio=0.3, seed=7)
+    test = test[:: max(1, len(test) // args.queries)][: args.queries]
+
+    def make_engine(refs: list[LabeledSequence]) -> ScoringEngine:
+        return ScoringEngine(refs, query_len=n, window_frac=0.2, xcorr_max_lag_frac=0.15, xcorr_min_overlap_frac=0.5, workers=1)
+
+    shortlists = [int(x) for x in args.shortlists.split(",") if x.strip()]
+    t0 = time.perf_counter()
+    results = evaluate_prefilter(train, test, shortlists, args.per_label_k, make_engine, "hybrid", 0.35)
+    print(f"prefilter labels={args.labels} train={len(train)} queries={len(test)} seconds={time.perf_counter() - t0:.1f}")
+    for line in format_prefilter(results, args.per_label_k):
+        print(line)
+    return 0 if results[-1].agreement >= args.min_agreement else 1
+
+
+def run_anytime(args: argparse.Namespace) -> int:
+    # Captures as the trigger cuts them (quiet pre-roll, gesture, quiet
+    # tail); references are the 70% split prepared as build_model.py does,
+    # the rest replayed sample by sample through AnytimeClassifier.
+    rng = random.Random(23)
+    n = args.max_points
+    raw_by_path: dict[Path, list[tuple[float, ...]]] = {}
+    items = []
+    shared = int(n * args.shared_prefix)
+    start = random_sequence(n, rng)[:shared]
+    for li in range(args.labels):
+        # Each label goes its own way after the common start.
+        tail = random_sequence(n - shared, rng)
+        join = [a - b for a, b in zip(start[-1], tail[0])] if start else [0.0] * 6
+        proto = znormalize(start + [tuple(v + d for v, d in zip(p, join)) for p in tail])
+        for r in range(args.refs_per_label):
+            g = warped_copy(proto, int(n * args.step * rng.uniform(0.85, 1.0)), args.noise, rng)
+            pre = [tuple(rng.gauss(0.0, 0.3) for _ in range(6)) for _ in range(rng.randint(30, 60))]
+            post = [tuple(rng.gauss(0.0, 0.3) for _ in range(6)) for _ in range(rng.randint(60, 100))]
+            path = Path(f"l{li}_{r}")
+            raw_by_path[path] = pre + g + post
+            items.append(LabeledSequence(label=f"l{li}", path=path, seq=prep_sequence(pre + g + post, n, True)))
+    train, test = split_stratified(items, test_ratio=0.3, seed=7)
+    # Spot threshold per label: twice the DTW between two of its references, as in spring.
+    spot = {}
+    for label in sorted({x.label for x in train}):
+        a, b = [x.seq for x in train if x.label == label][:2]
+        spot[label] = 2.0 * dtw_packed(a, pack_sequence(a), b, pack_sequence(b), 0)
+    params = {
+        "use_znorm": True,
+        "sample_rate_hz": 200.0,
+        "spot_step": statistics.median(len(raw_by_path[x.path]) for x in train) / n,
+        "spot_thresholds": spot,
+        "max_points": n,
+        "per_label_k": 3,
+        "score_mode": "hybrid",
+        "hybrid_alpha": 0.35,
+        "reject_margin": 1.0,
+        "reject_threshold_grace": 1.0,
+        "unknown_label": "unknown",
+    }
+    windows = [(x.label, x.path, raw_by_path[x.path]) for x in test]
+
+    def make_engine(refs: list[LabeledSequence]) -> ScoringEngine:
+        return ScoringEngine(refs, query_len=n, window_frac=0.2, xcorr_max_lag_frac=0.15, xcorr_min_overlap_frac=0.5, workers=1)
+
+    native = load_dtw_kernel() is not None
+    t0 = time.perf_counter()
+    replays = replay_windows(
+        train, params, {}, windows, 200.0, args.margin, args.min_progress, frozenset(), native=native,
+        make_engine=make_engine,
+    )
+    elapsed = time.perf_counter() - t0
+    samples = sum(len(w[2]) for w in windows)
+    print(
+        f"anytime labels={args.labels} refs={len(train)} windows={len(windows)} native={native} "
+        f"seconds={elapsed:.1f} sample_us_mean={elapsed / samples * 1e6:.1f} (incl. full-window scoring)"
+    )
+    holds = [int(x) for x in args.holds.split(",") if x.strip()]
+    for line in latency_curve(replays, holds, 200.0, frozenset()):
+        print(line)
+    if args.python and native:
+        few = windows[:: max(1, len(windows) // 4)][:4]
+        twin = replay_windows(train, params, {}, few, 200.0, args.margin, args.min_progress, frozenset(), native=False)
+        ours = [replays[windows.index(f)] for f in few]
+        same = [[v.label for v in a.trace] for a in ours] == [[v.label for v in b.trace] for b in twin]
+        worst = max(
+            (abs(u.score - v.score) / max(abs(v.score), 1e-12)
+             for a, b in zip(ours, twin) for u, v in zip(a.trace, b.trace) if v.label is not None),
+            default=0.0,
+        )
+        print(f"native_vs_python windows={len(few)} same_verdicts={same} max_relative_score_diff={worst:.2e}")
+        if not same or worst > 1e-6:
+            return 1
+    return 0
+
+
+def fleet_gesture(proto: list[tuple[float, ...]], n: int, rng: random.Random) -> list[tuple[int, ...]]:
+    # Raw int16 axes of one performance; gyro rides on an offset so the
+    # motion trigger holds for the whole gesture.
+    out = []
+    for p in warped_copy(proto, n, 0.2, rng):
+        acc = [int(v * 1500) for v in p[:3]]
+        gyro = [int(v * 1000) + (1500 if i == 0 else 0) for i, v in enumerate(p[3:])]
+        out.append(tuple(max(-32767, min(32767, v)) for v in acc + gyro))
+    return out
+
+
+def fleet_schedule(d: int, args: argparse.Namespace, gesture_len: int) -> list[tuple[int, int]]:
+    # (start tick, label) of each gesture board d performs.
+    every = int(args.gesture_every * args.rate)
+    ticks = int(args.seconds * args.rate)
+    first = args.rate + d * every // max(1, args.devices)
+    # Leave room for the trigger's quiet tail before the stream stops.
+    return [
+        (t, (d + k) % args.labels)
+        for k, t in enumerate(range(first, ticks - gesture_len - args.rate // 2, every))
+    ]
+
+
+def fleet_sender(port: int, args: argparse.Namespace, variants: list[list[list[tuple[int, ...]]]]) -> None:
+    # Child process: every board paced at args.rate from its own source IP.
+    rng = random.Random(7)
+    dst = ("127.0.0.1", port)
+    boards = []
+    for d in range(args.devices):
+        tx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        tx.bind((f"127.0.0.{2 + d}", 0))
+        schedule = fleet_schedule(d, args, len(variants[0][0]))
+        todo = {t: variants[label][rng.randrange(len(variants[label]))] for t, label in schedule}
+        boards.append((tx, todo, d * 1_000_003))
+    period_us = 1_000_000 // args.rate
+    batch = max(1, args.frame_samples)
+    pending: list[list[tuple[int, ...]]] = [[] for _ in boards]
+    active: list[tuple[list[tuple[int, ...]], int] | None] = [None] * len(boards)
+    seqs = [0] * len(boards)
+    t0 = time.perf_counter()
+    for tick in range(int(args.seconds * args.rate)):
+        for d, (tx, todo, base_us) in enumerate(boards):
+            if tick in todo:
+                active[d] = (todo[tick], tick)
+            cur = active[d]
+            if cur is not None and tick - cur[1] < len(cur[0]):
+                axes = cur[0][tick - cur[1]]
+            else:
+                axes = (rng.randint(-20, 20), rng.randint(-20, 20), 4096, rng.randint(-20, 20), 0, 0)
+            ts = base_us + tick * period_us
+            if batch == 1:
+                tx.sendto(LEGACY_STRUCT.pack(ts, *axes), dst)
+                continue
+            pending[d].append((ts, *axes))
+            if len(pending[d]) == batch:
+                rows = pending[d]
+                body = b"".join(struct.pack(BATCH_SAMPLE_FMT, x[0] - rows[0][0], *x[1:]) for x in rows)
+                tx.sendto(struct.pack(BATCH_HEADER_FMT, b"IMU2", seqs[d], rows[0][0], len(rows), 0) + body, dst)
+                seqs[d] += 1
+                pending[d] = []
+        delay = t0 + (tick + 1) / args.rate - time.perf_counter()
+        if delay > 0:
+            time.sleep(delay)
+
+
+def run_fleet(args: argparse.Namespace) -> int:
+    # Simulated boards stream idle noise with a gesture every few seconds;
+    # one consumer (live_classify --fleet's loop) segments and scores all of
+    # them through a single engine. Latency runs from the arrival of the
+    # sample that closed a gesture to its result; CPU is this process's
+    # (ingest thread, segmentation, scoring) over the run.
+    rng = random.Random(1)
+    n = args.max_points
+    gesture_len = int(0.6 * args.rate)
+    protos = [random_sequence(n, rng) for _ in range(args.labels)]
+    variants = [[fleet_gesture(p, gesture_len, rng) for _ in range(4)] for p in protos]
+    refs = [
+        LabeledSequence(
+            label=f"g{li}",
+            path=Path(f"g{li}_{i}"),
+            seq=prep_sequence([tuple(map(float, x)) for x in fleet_gesture(p, gesture_len, rng)], n, True),
+        )
+        for li, p in enumerate(protos)
+        for i in range(args.refs_per_label)
+    ]
+    params = {
+        "max_points": n,
+        "use_znorm": True,
+        "per_label_k": 3,
+        "score_mode": "dtw",
+        "hybrid_alpha": 0.35,
+        "reject_margin": 1.0,
+        "reject_threshold_grace": 1.0,
+        "unknown_label": "unknown",
+        "sample_rate_hz": float(args.rate),
+    }
+    engine = ScoringEngine(refs, query_len=n, window_frac=0.2, workers=args.workers)
+    truth = {
+        f"127.0.0.{2 + d}": [f"g{label}" for _t, label in fleet_schedule(d, args, gesture_len)]
+        for d in range(args.devices)
+    }
+    got: dict[str, list[str]] = {ip: [] for ip in truth}
+    score_ms: list[float] = []
+
+    def make_trigger(rate_hz: float) -> TriggerConfig:
+        return TriggerConfig.from_seconds(
+            on_thresh=800.0,
+            off_thresh=300.0,
+            on_hold=3,
+            off_hold=12,
+            pre_sec=0.1,
+            post_sec=0.1,
+            min_action_sec=0.15,
+            max_action_sec=2.5,
+            rate_hz=rate_hz,
+        )
+
+    def score(session: DeviceSession, win: FleetWindow) -> WindowResult:
+        return score_window(engine, params, {}, win.samples, session.rate_hz, 1)
+
+    def on_result(session: DeviceSession, _win: FleetWindow, result: WindowResult) -> None:
+        got.setdefault(session.ip, []).append(result.pred)
+        score_ms.append(result.score_ms)
+
+    port = 19600
+    ingest = open_ingest("127.0.0.1", port, ring_sec=30.0, expected_hz=args.rate, max_devices=args.devices)
+    fleet = Fleet(
+        ingest,
+        lambda reader: DeviceSession(reader, "trigger", float(args.rate), make_trigger=make_trigger),
+        score,
+        on_result,
+    )
+    proc = multiprocessing.Process(target=fleet_sender, args=(port, args, variants))
+    cpu0 = time.process_time_ns()
+    t0 = time.perf_counter()
+    proc.start()
+    idle_since = None
+    while True:
+        if fleet.step() > 0 or proc.is_alive():
+            idle_since = None
+        elif idle_since is None:
+            idle_since = time.perf_counter()
+        elif time.perf_counter() - idle_since > 0.5:
+            break
+    wall = time.perf_counter() - t0
+    cpu_ns = time.process_time_ns() - cpu0
+    proc.join()
+    ingest.close()
+    ingest.sock.close()
+    engine.close()
+
+    lat: list[float] = []
+    for session in fleet.sessions:
+        lat.extend(session.stats.latency_ms)
+    for line in fleet.report():
+        print(line)
+    lat.sort()
+    sent = sum(len(v) for v in truth.values())
+    found = sum(len(v) for v in got.values())
+    correct = sum(sum(a == b for a, b in zip(got[ip], want)) for ip, want in truth.items())
+    missed = sum(max(0, len(want) - len(got[ip])) for ip, want in truth.items())
+    samples = ingest.stats.samples
+    print(
+        f"fleet devices={len(fleet.sessions)}/{args.devices} rate_hz={args.rate} frame_samples={args.frame_samples} "
+        f"refs={len(refs)} workers={engine.workers} gestures={sent} results={found} correct={correct} "
+        f"missed={missed} samples={samples} datagrams={ingest.stats.datagrams}"
+    )
+    print(
+        f"fleet latency_ms_p50={lat[len(lat) // 2] if lat else 0.0:.1f} "
+        f"latency_ms_p99={lat[min(len(lat) - 1, int(0.99 * len(lat)))] if lat else 0.0:.1f} "
+        f"latency_ms_max={lat[-1] if lat else 0.0:.1f} score_ms_mean={sum(score_ms) / max(1, len(score_ms)):.1f} "
+        f"host_cpu={cpu_ns / 1e9 * 100 / wall:.1f}%_of_one_core cpu_us_per_sample={cpu_ns / 1000 / max(1, samples):.1f}"
+    )
+    # Every board's every gesture must come back, mostly right.
+    return 0 if len(fleet.sessions) == args.devices and missed == 0 and correct >= 0.9 * sent else 1
+
+
+def main() -> int:
+    args = parse_args()
+    if args.cmd == "codec":
+        return run_codec(args)
+    if args.cmd == "jitter":
+        return run_jitter(args)
+    if args.cmd == "adpcm":
+        return run_adpcm(args)
+    if args.cmd == "dtw":
+        return run_dtw(args)
+    if args.cmd == "xcorr":
+        return run_xcorr(args)
+    if args.cmd == "scale":
+        return run_scale(args)
+    if args.cmd == "startup":
+        return run_startup(args)
+    if args.cmd == "spring":
+        return run_spring(args)
+    if args.cmd == "ingest":
+        return run_ingest(args)
+    if args.cmd == "capture":
+        return run_capture(args)
+    if args.cmd == "seqcache":
+        return run_seqcache(args)
+    if args.cmd == "condense":
+        return run_condense(args)
+    if args.cmd == "fixedpoint":
+        return run_fixedpoint(args)
+    if args.cmd == "prefilter":
+        return run_prefilter(args)
+    if args.cmd == "anytime":
+        return run_anytime(args)
+    if args.cmd == "fifo":
+        return run_fifo(args)
+    if args.cmd == "ring":
+        return run_ring(args)
+    if args.cmd == "fleet":
+        return run_fleet(args)
+    return 2
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -6,10 +6,24 @@ import time
 from pathlib import Path
 
 from dtw_baseline import (
+    LabeledSequence,
+    ScoringEngine,
+    add_seq_cache_args,
+    build_pair_matrix,
     calibrate_label_thresholds,
     load_labeled_sequences,
+    load_pair_matrix,
+    manifest_sample_rate,
+    pair_params,
     read_manifest,
+    save_pair_matrix,
+    seq_cache_path,
 )
+from device_model import export_model_bin
+from embedding_index import EMBED_VERSION, embed_sequence
+from model_file import write_model
+from prototypes import HARD_PER_LABEL, condense_references
+from stream_spotter import spot_params
 
 
 def utc_now_iso() -> str:
@@ -35,8 +49,54 @@ def parse_args() -> argparse.Namespace:
     parser.add_argument(
         "--model-out",
         type=Path,
-        default=Path("data/model/action_model.json"),
-        help="Output model path",
+        default=Path("data/model/action_model.admodel"),
+        help="Output model path: mappable binary (model_file.py), or JSON if it ends in .json",
+    )
+    parser.add_argument(
+        "--json-out",
+        type=Path,
+        default=None,
+        help="Also write the model as JSON for inspection",
+    )
+    parser.add_argument(
+        "--model-dtype",
+        choices=("float32", "int16"),
+        default="float32",
+        help="Binary model reference storage (int16: per-axis scaled, about half the size)",
+    )
+    parser.add_argument(
+        "--no-embeddings",
+        action="store_true",
+        help="Do not store pre-filter embeddings (live_classify.py --prefilter-shortlist computes them at load)",
+    )
+    parser.add_argument(
+        "--bin-out",
+        type=Path,
+        default=None,
+        help="Also write the fixed-point device model (e.g. firmware/main/model/action_model.bin)",
+    )
+    parser.add_argument(
+        "--pairs-cache",
+        type=Path,
+        default=None,
+        help="Pairwise calibration matrix cache (default: <model-out>.pairs.bin)",
+    )
+    parser.add_argument(
+        "--no-pairs-cache",
+        action="store_true",
+        help="Score every reference pair from scratch and do not write the cache",
+    )
+    parser.add_argument(
+        "--condense",
+        type=int,
+        default=0,
+        help="Condense each label to this many DBA prototypes (at least --per-label-k; 0 = keep every capture)",
+    )
+    parser.add_argument(
+        "--condense-hard",
+        type=int,
+        default=HARD_PER_LABEL,
+        help="With --condense: captures the prototypes misclassify kept per label",
     )
     parser.add_argument("--max-points", type=int, default=180, help="Sequence resample points")
     parser.add_argument(
@@ -44,6 +104,7 @@ def parse_args() -> argparse.Namespace:
         action="store_true",
         help="Disable per-sequence z-normalization",
     )
+    add_seq_cache_args(parser)
     parser.add_argument(
         "--window-frac",
         type=float,
@@ -104,6 +165,12 @@ def parse_args() -> argparse.Namespace:
         default="unknown",
         help="Label emitted on rejection",
     )
+    parser.add_argument(
+        "--workers",
+        type=int,
+        default=0,
+        help="Calibration scoring worker processes (0 = auto)",
+    )
     return parser.parse_args()
 
 
@@ -117,21 +184,73 @@ def main() -> int:
     if not rows:
         raise ValueError("no samples selected from manifest")
 
-    refs = load_labeled_sequences(rows, max_points=args.max_points, use_znorm=use_znorm)
+    refs = load_labeled_sequences(
+        rows, max_points=args.max_points, use_znorm=use_znorm, cache_path=seq_cache_path(args)
+    )
     if not refs:
         raise ValueError("no references loaded")
+    # Calibration queries are the references themselves (mostly max_points
+    # long); the engine packs them and builds their spectra once up front.
+    def make_engine(engine_refs: list[LabeledSequence]) -> ScoringEngine:
+        return ScoringEngine(
+            engine_refs,
+            query_len=args.max_points,
+            window_frac=args.window_frac,
+            xcorr_max_lag_frac=args.xcorr_max_lag_frac,
+            xcorr_min_overlap_frac=args.xcorr_min_overlap_frac,
+            workers=args.workers,
+        )
 
-    thresholds = calibrate_label_thresholds(
-        refs,
-        window_frac=args.window_frac,
-        per_label_k=args.per_label_k,
-        q=args.reject_quantile,
-        scale=args.reject_scale,
-        score_mode=args.score_mode,
-        hybrid_alpha=args.hybrid_alpha,
-        xcorr_max_lag_frac=args.xcorr_max_lag_frac,
-        xcorr_min_overlap_frac=args.xcorr_min_overlap_frac,
-    )
+    captures = refs
+    condensed = None
+    with make_engine(refs) as engine:
+        # Leave-one-out calibration reads every pair from one matrix; pairs
+        # between references that were already there last build come from
+        # the cache, so a rebuild only scores the new captures' rows.
+        t_cal = time.perf_counter()
+        pairs_path = args.pairs_cache or args.model_out.with_suffix(".pairs.bin")
+        cached = None if args.no_pairs_cache else load_pair_matrix(pairs_path, pair_params(engine))
+        pairs = build_pair_matrix(engine, cached)
+        if not args.no_pairs_cache:
+            pairs_path.parent.mkdir(parents=True, exist_ok=True)
+            save_pair_matrix(pairs_path, pairs, pair_params(engine))
+        if args.condense <= 0:
+            thresholds = calibrate_label_thresholds(
+                engine,
+                per_label_k=args.per_label_k,
+                q=args.reject_quantile,
+                scale=args.reject_scale,
+                score_mode=args.score_mode,
+                hybrid_alpha=args.hybrid_alpha,
+                pairs=pairs,
+            )
+            spot = spot_params(engine, pairs, q=args.reject_quantile, scale=args.reject_scale)
+    if args.condense > 0:
+        # The model keeps the prototypes; thresholds come from scoring every
+        # capture against them.
+        refs, condensed = condense_references(
+            captures,
+            pairs,
+            args.condense,
+            args.per_label_k,
+            args.window_frac,
+            make_engine,
+            args.score_mode,
+            args.hybrid_alpha,
+            hard=args.condense_hard,
+        )
+        with make_engine(refs) as engine:
+            thresholds = calibrate_label_thresholds(
+                engine,
+                per_label_k=args.per_label_k,
+                q=args.reject_quantile,
+                scale=args.reject_scale,
+                score_mode=args.score_mode,
+                hybrid_alpha=args.hybrid_alpha,
+                queries=captures,
+            )
+            spot = spot_params(engine, None, q=args.reject_quantile, scale=args.reject_scale, queries=captures)
+    cal_s = time.perf_counter() - t_cal
     t1 = time.perf_counter()
 
     model = {
@@ -151,6 +270,11 @@ def main() -> int:
             "reject_margin": args.reject_margin,
             "reject_threshold_grace": args.reject_threshold_grace,
             "unknown_label": args.unknown_label,
+            "sample_rate_hz": manifest_sample_rate(rows),
+            "condense": args.condense,
+            "condensed_from": len(captures),
+            "embedding_version": 0 if args.no_embeddings else EMBED_VERSION,
+            **spot,
         },
         "thresholds": thresholds,
         "labels": sorted({x.label for x in refs}),
@@ -159,18 +283,43 @@ def main() -> int:
                 "label": x.label,
                 "path": str(x.path),
                 "seq": [list(p) for p in x.seq],
+                **({} if args.no_embeddings else {"embedding": list(embed_sequence(x.seq))}),
             }
             for x in refs
         ],
     }
 
     args.model_out.parent.mkdir(parents=True, exist_ok=True)
-    with args.model_out.open("w", encoding="utf-8") as f:
-        json.dump(model, f, ensure_ascii=True)
-
-    print(f"saved model: {args.model_out}")
-    print(f"labels={model['labels']} refs={len(refs)}")
+    json_outs = [p for p in (args.json_out,) if p is not None]
+    if args.model_out.suffix == ".json":
+        json_outs.append(args.model_out)
+    else:
+        size = write_model(args.model_out, model, quantize=args.model_dtype == "int16")
+        print(f"saved model: {args.model_out} ({size} bytes)")
+    for path in json_outs:
+        path.parent.mkdir(parents=True, exist_ok=True)
+        with path.open("w", encoding="utf-8") as f:
+            json.dump(model, f, ensure_ascii=True)
+        print(f"saved json model: {path}")
+    if args.bin_out is not None:
+        blob = export_model_bin(model)
+        args.bin_out.parent.mkdir(parents=True, exist_ok=True)
+        args.bin_out.write_bytes(blob)
+        print(f"saved device model: {args.bin_out} ({len(blob)} bytes)")
+    print(f"labels={model['labels']} refs={len(refs)} sample_rate_hz={model['params']['sample_rate_hz']}")
+    if condensed is not None:
+        print(
+            f"condensed captures={condensed.refs_in} prototypes={condensed.prototypes} hard={condensed.hard} "
+            f"refs={condensed.refs_out} condense_seconds={condensed.seconds:.3f}"
+        )
+        for label, (n_caps, n_protos, n_hard) in condensed.per_label.items():
+            print(f"condensed label={label} captures={n_caps} prototypes={n_protos} hard={n_hard}")
     print(f"thresholds={thresholds}")
+    print(f"spot_step={spot['spot_step']:.3f} spot_thresholds={spot['spot_thresholds']}")
+    print(
+        f"calibration_pairs scored={pairs.computed} cached={len(captures) * (len(captures) + 1) // 2 - pairs.computed} "
+        f"calibration_seconds={cal_s:.3f}"
+    )
     print(f"build_seconds={t1 - t0:.3f}")
     return 0
 
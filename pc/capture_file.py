@@ -0,0 +1,307 @@
+#!/usr/bin/env python3
+# Raw IMU capture files written by capture_labeled.py and udp_receiver.py.
+# Samples are stored in columns, chunk by chunk, so a recording is written
+# with one write per chunk and read back by mapping the file: each column is
+# a typed view of the mapping, and a time slice only touches the chunks the
+# footer index says overlap it. CSV captures from earlier sessions still
+# load; `capture_file.py convert` writes the binary twin of CSVs (or of every
+# CSV a manifest lists) and `capture_file.py export` writes CSV back out.
+#
+# Layout (little endian, chunks 8-byte aligned):
+#   header   HEADER_FMT: magic, version, axes, samples per full chunk
+#   chunks   CHUNK_FMT: magic, count, first/last ts_us; then count int64
+#            ts_us, then ax..gz as count int16 each, padded to 8 bytes
+#   index    chunk_count x INDEX_FMT: chunk offset, count, first/last ts_us
+#   footer   FOOTER_FMT: index offset, total samples, chunk count, magic
+# A file whose writer died before the footer is read by walking the chunks.
+import argparse
+import bisect
+import csv
+import json
+import mmap
+import struct
+import sys
+from array import array
+from pathlib import Path
+
+from imu_frames import Sample, read_raw_csv
+
+CAPTURE_MAGIC = b"ADCAPTUR"
+CAPTURE_VERSION = 1
+CAPTURE_SUFFIX = ".adcap"
+HEADER_FMT = "<8sHHI"
+HEADER_SIZE = struct.calcsize(HEADER_FMT)
+CHUNK_MAGIC = b"CHNK"
+CHUNK_FMT = "<4sIqq"
+CHUNK_SIZE = struct.calcsize(CHUNK_FMT)
+INDEX_FMT = "<QIIqq"
+INDEX_SIZE = struct.calcsize(INDEX_FMT)
+FOOTER_MAGIC = b"ADCAPEND"
+FOOTER_FMT = "<QQII8s"
+FOOTER_SIZE = struct.calcsize(FOOTER_FMT)
+AXES = 6
+CHUNK_SAMPLES = 1024
+CSV_HEADER = "ts_us,ax,ay,az,gx,gy,gz\n"
+
+
+def _pad8(n: int) -> int:
+    return (n + 7) // 8 * 8
+
+
+def _chunk_bytes(count: int) -> int:
+    return CHUNK_SIZE + _pad8(count * 8 + AXES * count * 2)
+
+
+def is_capture_file(path: Path) -> bool:
+    with path.open("rb") as f:
+        return f.read(len(CAPTURE_MAGIC)) == CAPTURE_MAGIC
+
+
+class CaptureWriter:
+    # Streams samples to path (through path.tmp, renamed on close()), one
+    # write per full chunk. A writer that dies leaves path.tmp, readable up to
+    # its last full chunk.
+    def __init__(self, path: Path, chunk_samples: int = CHUNK_SAMPLES) -> None:
+        if sys.byteorder != "little":
+            raise ValueError("capture files are written and mapped little endian only")
+        self.path = path
+        self.chunk_samples = max(1, chunk_samples)
+        self.tmp = path.with_name(path.name + ".tmp")
+        self.f = self.tmp.open("wb")
+        self.f.write(struct.pack(HEADER_FMT, CAPTURE_MAGIC, CAPTURE_VERSION, AXES, self.chunk_samples))
+        self.offset = HEADER_SIZE
+        self.index: list[tuple[int, int, int, int]] = []
+        self.count = 0
+        # Rows of the open chunk; split into columns when it is written.
+        self._rows: list[Sample] = []
+
+    def __enter__(self) -> "CaptureWriter":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+    def append(self, sample: Sample) -> None:
+        self._rows.append(sample)
+        if len(self._rows) >= self.chunk_samples:
+            self._flush_chunk()
+
+    def extend(self, samples: list[Sample]) -> None:
+        for s in samples:
+            self.append(s)
+
+    def _flush_chunk(self) -> None:
+        n = len(self._rows)
+        if n == 0:
+            return
+        ts, *cols = zip(*self._rows)
+        # Timestamps may step back (reordered frames); the index keeps the range.
+        first, last = min(ts), max(ts)
+        body = array("q", ts).tobytes() + b"".join(array("h", col).tobytes() for col in cols)
+        pad = bytes(_pad8(len(body)) - len(body))
+        self.f.write(struct.pack(CHUNK_FMT, CHUNK_MAGIC, n, first, last) + body + pad)
+        # Complete chunks reach the file even if the writer never closes.
+        self.f.flush()
+        self.index.append((self.offset, n, first, last))
+        self.offset += _chunk_bytes(n)
+        self.count += n
+        self._rows = []
+
+    def close(self) -> None:
+        if self.f.closed:
+            return
+        self._flush_chunk()
+        index = b"".join(struct.pack(INDEX_FMT, off, n, 0, first, last) for off, n, first, last in self.index)
+        self.f.write(index + struct.pack(FOOTER_FMT, self.offset, self.count, len(self.index), 0, FOOTER_MAGIC))
+        self.f.close()
+        self.tmp.replace(self.path)
+
+
+class CaptureFile:
+    # Read-only mapping of a capture. Columns are typed views of the mapping;
+    # samples()/features() take a device-time slice.
+    def __init__(self, path: Path) -> None:
+        self.path = path
+        with path.open("rb") as f:
+            self.mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version, axes, self.chunk_samples = struct.unpack_from(HEADER_FMT, self.mm)
+        if magic != CAPTURE_MAGIC or version != CAPTURE_VERSION or axes != AXES:
+            raise ValueError(f"{path}: not a version {CAPTURE_VERSION} capture file")
+        if sys.byteorder != "little":
+            raise ValueError(f"{path}: capture files are mapped little endian only")
+        self.index = self._read_index()
+        self.count = sum(n for _off, n, _first, _last in self.index)
+
+    def _read_index(self) -> list[tuple[int, int, int, int]]:
+        mm = self.mm
+        if len(mm) >= HEADER_SIZE + FOOTER_SIZE:
+            index_off, _total, chunks, _reserved, magic = struct.unpack_from(FOOTER_FMT, mm, len(mm) - FOOTER_SIZE)
+            if magic == FOOTER_MAGIC and index_off + chunks * INDEX_SIZE == len(mm) - FOOTER_SIZE:
+                return [
+                    (off, n, first, last)
+                    for off, n, _reserved, first, last in struct.iter_unpack(
+                        INDEX_FMT, mm[index_off : index_off + chunks * INDEX_SIZE]
+                    )
+                ]
+        # No footer: the writer stopped early. Keep every complete chunk.
+        index = []
+        off = HEADER_SIZE
+        while off + CHUNK_SIZE <= len(mm):
+            magic, n, first, last = struct.unpack_from(CHUNK_FMT, mm, off)
+            if magic != CHUNK_MAGIC or off + _chunk_bytes(n) > len(mm):
+                break
+            index.append((off, n, first, last))
+            off += _chunk_bytes(n)
+        return index
+
+    def __len__(self) -> int:
+        return self.count
+
+    def close(self) -> None:
+        self.mm.close()
+
+    def columns(self, chunk: int) -> tuple[memoryview, list[memoryview]]:
+        # (ts_us, [ax, ay, az, gx, gy, gz]) views of one chunk.
+        off, n, _first, _last = self.index[chunk]
+        body = memoryview(self.mm)[off + CHUNK_SIZE : off + _chunk_bytes(n)]
+        ts = body[: n * 8].cast("q")
+        axes = [body[n * 8 + a * n * 2 : n * 8 + (a + 1) * n * 2].cast("h") for a in range(AXES)]
+        return ts, axes
+
+    def _spans(self, start_us: int | None, end_us: int | None):
+        # (chunk, lo, hi) rows with start_us <= ts_us < end_us. Chunks are
+        # skipped by their index range; within a chunk the bounds are found by
+        # bisection, as timestamps only go forward apart from rare reordering.
+        for c, (_off, n, first, last) in enumerate(self.index):
+            if (end_us is not None and first >= end_us) or (start_us is not None and last < start_us):
+                continue
+            ts, _axes = self.columns(c)
+            lo = bisect.bisect_left(ts, start_us) if start_us is not None and first < start_us else 0
+            hi = bisect.bisect_left(ts, end_us) if end_us is not None and last >= end_us else n
+            if hi > lo:
+                yield c, lo, hi
+
+    def samples(self, start_us: int | None = None, end_us: int | None = None) -> list[Sample]:
+        out: list[Sample] = []
+        for c, lo, hi in self._spans(start_us, end_us):
+            ts, axes = self.columns(c)
+            out.extend(zip(ts[lo:hi], *(a[lo:hi] for a in axes)))
+        return out
+
+    def features(self, start_us: int | None = None, end_us: int | None = None) -> list[tuple[float, ...]]:
+        # The axes as float tuples (dtw_baseline.read_sequence()'s rows).
+        out: list[tuple[float, ...]] = []
+        for c, lo, hi in self._spans(start_us, end_us):
+            _ts, axes = self.columns(c)
+            out.extend(zip(*(array("d", a[lo:hi]) for a in axes)))
+        return out
+
+
+def read_samples(path: Path) -> list[Sample]:
+    # Raw samples of a capture, binary or CSV (by magic).
+    if is_capture_file(path):
+        cap = CaptureFile(path)
+        try:
+            return cap.samples()
+        finally:
+            cap.close()
+    return read_raw_csv(path)
+
+
+def find_captures(base_dir: Path) -> list[Path]:
+    # Recordings under base_dir/raw: the binary capture where a CSV has one.
+    found = sorted(base_dir.glob(f"raw/**/*{CAPTURE_SUFFIX}"))
+    have = {p.with_suffix("") for p in found}
+    return sorted(found + [p for p in base_dir.glob("raw/**/*.csv") if p.with_suffix("") not in have])
+
+
+def write_capture(path: Path, samples: list[Sample]) -> None:
+    with CaptureWriter(path) as w:
+        w.extend(samples)
+
+
+def write_csv(path: Path, samples: list[Sample]) -> None:
+    with path.open("w", encoding="utf-8", newline="") as f:
+        f.write(CSV_HEADER)
+        csv.writer(f, lineterminator="\n").writerows(samples)
+
+
+def manifest_capture_path(row: dict) -> Path:
+    # A manifest row's recording: the binary capture when it has one.
+    return Path(row.get("capture_path") or row["csv_path"])
+
+
+def convert_manifest(manifest: Path, overwrite: bool) -> int:
+    # Writes the binary twin of every CSV the manifest lists next to it and
+    # points the rows at it (capture_path; csv_path stays). Returns files written.
+    rows = [json.loads(line) for line in manifest.read_text(encoding="utf-8").splitlines() if line.strip()]
+    written = 0
+    for row in rows:
+        if row.get("capture_path") and not overwrite:
+            continue
+        src = Path(row["csv_path"])
+        if not src.exists():
+            print(f"skip (missing csv): {src}")
+            continue
+        dst = src.with_suffix(CAPTURE_SUFFIX)
+        write_capture(dst, read_raw_csv(src))
+        row["capture_path"] = str(dst)
+        written += 1
+    tmp = manifest.with_name(manifest.name + ".tmp")
+    tmp.write_text("".join(json.dumps(row, ensure_ascii=True) + "\n" for row in rows), encoding="utf-8")
+    tmp.replace(manifest)
+    return written
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Inspect, convert or export IMU capture files.")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    info = sub.add_parser("info", help="Print a capture's chunks and time range")
+    info.add_argument("path", type=Path)
+    convert = sub.add_parser("convert", help="CSV captures to binary (next to each CSV)")
+    convert.add_argument("csv", type=Path, nargs="*", help="CSV files")
+    convert.add_argument("--manifest", type=Path, default=None, help="Convert every CSV this manifest lists")
+    convert.add_argument("--overwrite", action="store_true", help="Rewrite captures converted before")
+    export = sub.add_parser("export", help="Binary capture to CSV")
+    export.add_argument("path", type=Path)
+    export.add_argument("--csv-out", type=Path, default=None, help="Default: next to the capture")
+    export.add_argument("--start-us", type=int, default=None, help="Only samples from this device time")
+    export.add_argument("--end-us", type=int, default=None, help="Only samples before this device time")
+    return parser.parse_args()
+
+
+def main() -> int:
+    args = parse_args()
+    if args.cmd == "info":
+        cap = CaptureFile(args.path)
+        first = min((x[2] for x in cap.index), default=0)
+        last = max((x[3] for x in cap.index), default=0)
+        print(
+            f"samples={len(cap)} chunks={len(cap.index)} chunk_samples={cap.chunk_samples} "
+            f"ts_us={first}..{last} bytes={args.path.stat().st_size}"
+        )
+        return 0
+    if args.cmd == "convert":
+        if args.manifest is None and not args.csv:
+            raise ValueError("give CSV files or --manifest")
+        for src in args.csv:
+            dst = src.with_suffix(CAPTURE_SUFFIX)
+            if dst.exists() and not args.overwrite:
+                print(f"skip (exists): {dst}")
+                continue
+            samples = read_raw_csv(src)
+            write_capture(dst, samples)
+            print(f"saved {len(samples)} samples: {dst}")
+        if args.manifest is not None:
+            print(f"converted {convert_manifest(args.manifest, args.overwrite)} captures in {args.manifest}")
+        return 0
+    cap = CaptureFile(args.path)
+    samples = cap.samples(args.start_us, args.end_us)
+    out = args.csv_out or args.path.with_suffix(".csv")
+    write_csv(out, samples)
+    print(f"saved {len(samples)} samples: {out}")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -2,13 +2,12 @@
 import argparse
 import datetime as dt
 import json
-import socket
-import struct
 import time
 from pathlib import Path
 
-FMT = "<q6h"
-SIZE = struct.calcsize(FMT)
+from capture_file import CAPTURE_SUFFIX, CaptureWriter, write_csv
+from imu_frames import Sample
+from imu_ingest import RING_SECONDS, RingReader, open_ingest
 
 
 def utc_now_iso() -> str:
@@ -23,7 +22,7 @@ def parse_args() -> argparse.Namespace:
     default_base = Path(__file__).resolve().parents[1] / "data"
 
     parser = argparse.ArgumentParser(
-        description="Capture labeled UDP IMU samples into per-repeat CSV files."
+        description="Capture labeled UDP IMU samples into per-repeat capture files."
     )
     parser.add_argument("--host", default="0.0.0.0", help="UDP bind host")
     parser.add_argument("--port", type=int, default=9000, help="UDP bind port")
@@ -41,19 +40,29 @@ def parse_args() -> argparse.Namespace:
     parser.add_argument(
         "--rest-sec", type=float, default=1.0, help="Rest time between repeats"
     )
+    parser.add_argument(
+        "--expected-hz", type=float, default=200.0, help="IMU rate used to size the ingest ring"
+    )
+    parser.add_argument(
+        "--ring-sec", type=float, default=RING_SECONDS, help="Seconds of samples the ingest ring keeps"
+    )
+    parser.add_argument(
+        "--device", default="", help="Record only this board's source IP (default: the first board heard)"
+    )
     parser.add_argument("--notes", default="", help="Optional notes written to manifest")
+    parser.add_argument(
+        "--csv",
+        action="store_true",
+        help="Also write each repeat as CSV (csv_path in the manifest) for older tools",
+    )
     parser.add_argument(
         "--overwrite",
         action="store_true",
-        help="Overwrite existing CSV file for same label/repeat",
+        help="Overwrite existing capture file for same label/repeat",
     )
     return parser.parse_args()
 
 
-def valid_sample_packet(data: bytes) -> bool:
-    return len(data) >= SIZE
-
-
 def normalize_label(label: str) -> str:
     return label.strip().lower().replace(" ", "_")
 
@@ -64,69 +73,45 @@ def append_manifest(path: Path, entry: dict) -> None:
         f.write(json.dumps(entry, ensure_ascii=True) + "\n")
 
 
-def drain_socket(sock: socket.socket, max_packets: int = 50000) -> int:
-    drained = 0
-    old_timeout = sock.gettimeout()
-    sock.setblocking(False)
-    try:
-        while drained < max_packets:
-            try:
-                sock.recvfrom(2048)
-                drained += 1
-            except BlockingIOError:
-                break
-    finally:
-        sock.setblocking(True)
-        sock.settimeout(old_timeout)
-    return drained
-
-
-def recv_sample(sock: socket.socket) -> tuple[int, int, int, int, int, int, int] | None:
-    try:
-        data, _addr = sock.recvfrom(1024)
-    except socket.timeout:
-        return None
-    if not valid_sample_packet(data):
-        return None
-    return struct.unpack(FMT, data[:SIZE])
-
-
 def capture_repeat(
-    sock: socket.socket, csv_path: Path, duration_sec: float, overwrite: bool
-) -> tuple[int, str, str]:
-    if csv_path.exists() and not overwrite:
-        raise FileExistsError(f"{csv_path} already exists (use --overwrite to replace)")
+    stream: RingReader, path: Path, duration_sec: float, overwrite: bool
+) -> tuple[list[Sample], str, str, int]:
+    # Records one repeat to path (capture_file.py format); returns its
+    # samples, start/end time and UDP frames lost meanwhile.
+    if path.exists() and not overwrite:
+        raise FileExistsError(f"{path} already exists (use --overwrite to replace)")
 
-    csv_path.parent.mkdir(parents=True, exist_ok=True)
-    drained = drain_socket(sock)
-    if drained > 0:
-        print(f"drained {drained} stale packets before capture")
+    path.parent.mkdir(parents=True, exist_ok=True)
+    # Samples from the rest period stay in the ring; the repeat starts now.
+    skipped = stream.drain()
+    if skipped > 0:
+        print(f"skipped {skipped} samples queued before capture")
 
     start_iso = utc_now_iso()
-    sample_count = 0
+    samples: list[Sample] = []
     duration_us = int(duration_sec * 1_000_000)
     start_ts_us: int | None = None
+    lost_before = stream.tracker.lost
 
-    with csv_path.open("w", encoding="utf-8") as f:
-        f.write("ts_us,ax,ay,az,gx,gy,gz\n")
+    with CaptureWriter(path) as writer:
         while True:
-            sample = recv_sample(sock)
+            sample = stream.recv_sample()
             if sample is None:
                 continue
-            ts_us, ax, ay, az, gx, gy, gz = sample
+            ts_us = sample[0]
 
             if start_ts_us is None:
                 start_ts_us = ts_us
             if ts_us < start_ts_us:
                 continue
 
-            f.write(f"{ts_us},{ax},{ay},{az},{gx},{gy},{gz}\n")
-            sample_count += 1
+            writer.append(sample)
+            samples.append(sample)
             if ts_us - start_ts_us >= duration_us:
                 break
 
     end_iso = utc_now_iso()
-    return sample_count, start_iso, end_iso
+    return samples, start_iso, end_iso, stream.tracker.lost - lost_before
 
 
 def main() -> None:
@@ -137,6 +122,8 @@ def main() -> None:
         raise ValueError("--duration-sec must be > 0")
     if args.rest_sec < 0:
         raise ValueError("--rest-sec must be >= 0")
+    if args.expected_hz <= 0 or args.ring_sec <= 0:
+        raise ValueError("--expected-hz and --ring-sec must be > 0")
 
     label = normalize_label(args.label)
     session_id = args.session
@@ -144,9 +131,8 @@ def main() -> None:
     raw_dir = base_dir / "raw" / session_id
     manifest_path = base_dir / "labels" / "manifest.jsonl"
 
-    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    sock.bind((args.host, args.port))
-    sock.settimeout(0.25)
+    ingest = open_ingest(args.host, args.port, ring_sec=args.ring_sec, expected_hz=args.expected_hz)
+    stream = ingest.reader(args.device or None)
     print(f"listening on {args.host}:{args.port}")
     print(f"session={session_id} label={label} repeats={args.repeats}")
     print(f"raw output: {raw_dir}")
@@ -157,21 +143,22 @@ def main() -> None:
             print(f"rest {args.rest_sec:.1f}s before repeat {i}...")
             time.sleep(args.rest_sec)
 
-        csv_name = f"{label}_r{i:02d}.csv"
-        csv_path = raw_dir / csv_name
-        print(f"capturing repeat {i}/{args.repeats}: {csv_name}")
-        sample_count, started, finished = capture_repeat(
-            sock=sock,
-            csv_path=csv_path,
+        name = f"{label}_r{i:02d}{CAPTURE_SUFFIX}"
+        path = raw_dir / name
+        print(f"capturing repeat {i}/{args.repeats}: {name}")
+        samples, started, finished, frames_lost = capture_repeat(
+            stream=stream,
+            path=path,
             duration_sec=args.duration_sec,
             overwrite=args.overwrite,
         )
+        sample_count = len(samples)
 
         entry = {
             "session_id": session_id,
             "label": label,
             "repeat_index": i,
-            "csv_path": str(csv_path),
+            "capture_path": str(path),
             "sample_count": sample_count,
             "capture_started_utc": started,
             "capture_finished_utc": finished,
@@ -179,11 +166,17 @@ def main() -> None:
             "target_duration_sec": args.duration_sec,
             "udp_host": args.host,
             "udp_port": args.port,
-            "frame_format": FMT,
+            "frame_format": stream.frame_format,
+            "sample_rate_hz": stream.rate_hz or round(sample_count / args.duration_sec, 1),
+            "udp_frames_lost": frames_lost,
             "notes": args.notes,
         }
+        if args.csv:
+            csv_path = path.with_suffix(".csv")
+            write_csv(csv_path, samples)
+            entry["csv_path"] = str(csv_path)
         append_manifest(manifest_path, entry)
-        print(f"saved {sample_count} samples")
+        print(f"saved {sample_count} samples (udp_frames_lost={frames_lost})")
 
     print("capture completed")
 
@@ -0,0 +1,249 @@
+#!/usr/bin/env python3
+# Serving several boards from one host. Each device heard by the ingest
+# (one source IP) gets a DeviceSession with its own reader cursor, timestamp
+# continuity check and segmentation state (host motion trigger, firmware
+# segments or stream spotter); all sessions share the caller's scoring
+# engine and references. Fleet runs them from one consumer loop, a slice of
+# samples per device per round, so a busy device cannot starve the others.
+import dataclasses
+import time
+from collections import deque
+from collections.abc import Callable
+from dataclasses import dataclass, field
+
+from imu_frames import Sample
+from imu_ingest import ImuIngest, RingReader, RingWindow
+from motion_trigger import EVENT_END, EVENT_START, MotionTrigger, TriggerConfig
+from stream_spotter import Detection, StreamSpotter
+
+# A device timestamp jump larger than this (either way) is a reboot or a
+# new stream: segmentation starts over instead of bridging the gap.
+RESTART_GAP_US = 1_000_000
+# Samples one device may consume per round before the next device runs.
+FLEET_SLICE = 64
+POLL_SEC = 0.1
+
+
+def sample_features(sample: Sample) -> tuple[float, ...]:
+    _ts_us, ax, ay, az, gx, gy, gz = sample
+    return (float(ax), float(ay), float(az), float(gx), float(gy), float(gz))
+
+
+def window_features(window: RingWindow) -> list[tuple[float, ...]]:
+    # MotionTrigger skips samples that step back in time; so does the segment.
+    seq: list[tuple[float, ...]] = []
+    last_ts_us: int | None = None
+    for x in window:
+        if last_ts_us is not None and x[0] < last_ts_us:
+            continue
+        last_ts_us = x[0]
+        seq.append(sample_features(x))
+    return seq
+
+
+class TriggerCapture:
+    # Host motion trigger (the firmware's, see motion_trigger.py) fed from a
+    # RingReader one sample at a time. Pre-trigger history is read back from
+    # the ring rather than buffered, so it is there even when the trigger
+    # fires right after the reader starts.
+    def __init__(self, stream: RingReader, cfg: TriggerConfig) -> None:
+        self.stream = stream
+        self.pre_samples = cfg.pre_samples
+        self.trig = MotionTrigger(dataclasses.replace(cfg, pre_samples=1))
+        self.start_pos = 0
+
+    @property
+    def active(self) -> bool:
+        return self.trig.active
+
+    def push(self, sample: Sample) -> RingWindow | None:
+        # sample: the one stream.recv_sample() returned last. Returns the
+        # ring window of a segment that ended with it.
+        stream = self.stream
+        event, _emitted = self.trig.push(sample)
+        if event == EVENT_START:
+            self.start_pos = max(stream.floor, stream.last_pos - self.pre_samples + 1)
+        elif event == EVENT_END:
+            stream.floor = stream.last_pos + 1
+            return stream.window_pos(self.start_pos, stream.floor)
+        return None
+
+
+@dataclass
+class FleetWindow:
+    # A segment ready for scoring.
+    samples: list[tuple[float, ...]]
+    closed_ns: int  # arrival (monotonic ns) of the sample that closed it
+    spotted: Detection | None = None
+
+
+@dataclass
+class DeviceStats:
+    samples: int = 0
+    windows: int = 0
+    results: int = 0
+    restarts: int = 0
+    reordered: int = 0  # samples that stepped back in time, skipped
+    overwritten: int = 0  # windows lost to the ring before they were read
+    # Close-to-result latency of recent results, ms.
+    latency_ms: deque = field(default_factory=lambda: deque(maxlen=4096), repr=False)
+
+    def percentile_ms(self, q: float) -> float:
+        if not self.latency_ms:
+            return 0.0
+        vals = sorted(self.latency_ms)
+        return vals[min(len(vals) - 1, int(q * len(vals)))]
+
+
+class DeviceSession:
+    # One board's state. mode: "trigger" (host motion trigger, make_trigger
+    # builds the config for a rate), "device" (segments cut by the firmware)
+    # or "stream" (make_spotter builds a StreamSpotter for a rate).
+    def __init__(
+        self,
+        stream: RingReader,
+        mode: str,
+        expected_hz: float,
+        make_trigger: Callable[[float], TriggerConfig] | None = None,
+        make_spotter: Callable[[float], StreamSpotter] | None = None,
+    ) -> None:
+        self.stream = stream
+        self.mode = mode
+        self.expected_hz = expected_hz
+        self.make_trigger = make_trigger
+        self.make_spotter = make_spotter
+        self.stats = DeviceStats()
+        self.last_ts_us: int | None = None
+        self.trigger: TriggerCapture | None = None
+        self.spotter: StreamSpotter | None = None
+
+    @property
+    def ip(self) -> str | None:
+        return self.stream.src_ip
+
+    @property
+    def rate_hz(self) -> float:
+        return self.stream.rate_hz or self.expected_hz
+
+    def _start(self) -> None:
+        # Segmentation state for the current rate, from the sample just read
+        # on; also how a restart resets it.
+        if self.mode == "trigger":
+            self.trigger = TriggerCapture(self.stream, self.make_trigger(self.rate_hz))
+            self.stream.floor = self.stream.last_pos
+        elif self.mode == "stream":
+            self.spotter = self.make_spotter(self.rate_hz)
+
+    def _continuous(self, ts_us: int) -> bool:
+        # False for a sample to skip (stepped back a little in time).
+        last = self.last_ts_us
+        if last is None or abs(ts_us - last) > RESTART_GAP_US:
+            if last is not None:
+                self.stats.restarts += 1
+            self._start()
+        elif ts_us < last:
+            self.stats.reordered += 1
+            return False
+        self.last_ts_us = ts_us
+        return True
+
+    def poll(self, limit: int) -> tuple[int, list[FleetWindow]]:
+        # Consumes at most limit received samples without blocking; returns
+        # (samples consumed, windows closed).
+        out: list[FleetWindow] = []
+        stream = self.stream
+        if self.mode == "device":
+            while (win := stream.poll_segment()) is not None:
+                self._close(win, out)
+            # Samples only matter between markers; skip the cursor past them.
+            used = stream.drain(markers=False)
+            self.stats.samples += used
+            return used, out
+        used = 0
+        while used < limit:
+            sample = stream.recv_sample(0)
+            if sample is None:
+                break
+            used += 1
+            self.stats.samples += 1
+            if not self._continuous(sample[0]):
+                continue
+            if self.trigger is not None:
+                win = self.trigger.push(sample)
+                if win is not None:
+                    self._close(win, out)
+            elif self.spotter is not None:
+                for det in self.spotter.push(sample[0], sample_features(sample)):
+                    self.stats.windows += 1
+                    out.append(FleetWindow(det.samples, stream.ring.arrival_ns(stream.last_pos), det))
+        return used, out
+
+    def _close(self, win: RingWindow, out: list[FleetWindow]) -> None:
+        if len(win) == 0:
+            return
+        seq = window_features(win)
+        closed_ns = win.arrival_ns(len(win) - 1)
+        if not win.intact():
+            self.stats.overwritten += 1
+            return
+        self.stats.windows += 1
+        out.append(FleetWindow(seq, closed_ns))
+
+
+class Fleet:
+    # score(session, window) runs the shared engine and returns the result
+    # handed to on_result(session, window, result); close-to-result latency
+    # is recorded per device.
+    def __init__(
+        self,
+        ingest: ImuIngest,
+        new_session: Callable[[RingReader], DeviceSession],
+        score: Callable[[DeviceSession, FleetWindow], object],
+        on_result: Callable[[DeviceSession, FleetWindow, object], None],
+        slice_samples: int = FLEET_SLICE,
+    ) -> None:
+        self.ingest = ingest
+        self.new_session = new_session
+        self.score = score
+        self.on_result = on_result
+        self.slice_samples = slice_samples
+        self.sessions: list[DeviceSession] = []
+
+    def _adopt(self) -> None:
+        order = self.ingest.order
+        while len(self.sessions) < len(order):
+            dev = order[len(self.sessions)]
+            self.sessions.append(self.new_session(self.ingest.reader(dev.ip)))
+            print(f"device joined ip={dev.ip} devices={len(self.sessions)}")
+
+    def step(self, timeout_sec: float = POLL_SEC) -> int:
+        # One round over every device; waits up to timeout_sec when nothing
+        # was pending. Returns samples consumed.
+        seen = self.ingest.published
+        self._adopt()
+        used = 0
+        for session in self.sessions:
+            n, windows = session.poll(self.slice_samples)
+            used += n
+            for win in windows:
+                result = self.score(session, win)
+                session.stats.results += 1
+                session.stats.latency_ms.append((time.monotonic_ns() - win.closed_ns) / 1e6)
+                self.on_result(session, win, result)
+        if used == 0:
+            self.ingest.wait(seen, timeout_sec)
+        return used
+
+    def report(self) -> list[str]:
+        # One line per device, then resets the latency window.
+        lines = []
+        for s in self.sessions:
+            st = s.stats
+            lines.append(
+                f"device ip={s.ip} samples={st.samples} windows={st.windows} results={st.results} "
+                f"latency_ms_p50={st.percentile_ms(0.5):.1f} latency_ms_p99={st.percentile_ms(0.99):.1f} "
+                f"restarts={st.restarts} reordered={st.reordered} overwritten={st.overwritten} "
+                f"udp_frames_lost={s.stream.tracker.lost} overruns={s.stream.overruns} rate_hz={s.rate_hz:.1f}"
+            )
+            st.latency_ms.clear()
+        return lines
@@ -0,0 +1,273 @@
+#!/usr/bin/env python3
+# Binary model export for the on-device classifier (firmware/main/action_classifier.c)
+# and a parity check of that C classifier against dtw_baseline.py.
+import argparse
+import ctypes
+import struct
+import sys
+import time
+from pathlib import Path
+
+from dtw_baseline import (
+    LabeledSequence,
+    compute_query_scores,
+    predict_with_rejection,
+)
+from capture_file import read_samples
+from model_file import model_dict
+from native_lib import ImuSample, load_action_classifier
+
+MODEL_MAGIC = b"ADM1"
+MODEL_VERSION = 1
+LABEL_LEN = 32
+MAX_LABELS = 16
+MAX_REFS = 128
+MAX_POINTS = 256
+MAX_K = 8
+DIMS = 6
+ZNORM_Q_SHIFT = 10
+SCORE_MODES = {"dtw": 0, "hybrid": 1, "xcorr": 2}
+HEADER_FMT = f"<4sHHHHBBBBIIIIIII{LABEL_LEN}s"
+LABEL_FMT = f"<{LABEL_LEN}sB7xQ"
+
+
+def _q16(v: float) -> int:
+    return max(0, min(0xFFFFFFFF, int(round(v * 65536))))
+
+
+def _label_bytes(name: str) -> bytes:
+    raw = name.encode("utf-8")
+    if len(raw) >= LABEL_LEN:
+        raise ValueError(f"label too long for device model (max {LABEL_LEN - 1} bytes): {name}")
+    return raw
+
+
+def export_model_bin(model: dict) -> bytes:
+    # model: the JSON object written by build_model.py.
+    params = model["params"]
+    refs = model["references"]
+    labels = sorted({x["label"] for x in refs})
+    max_points = int(params["max_points"])
+    per_label_k = int(params["per_label_k"])
+    if len(labels) > MAX_LABELS or len(refs) > MAX_REFS:
+        raise ValueError(f"device model supports <= {MAX_LABELS} labels and <= {MAX_REFS} references")
+    if not 0 < max_points <= MAX_POINTS:
+        raise ValueError(f"device model needs 0 < max_points <= {MAX_POINTS}")
+    if not 0 < per_label_k <= MAX_K:
+        raise ValueError(f"device model needs 0 < per_label_k <= {MAX_K}")
+
+    use_znorm = bool(params["use_znorm"])
+    q_shift = ZNORM_Q_SHIFT if use_znorm else 0
+    score_mode = str(params["score_mode"])
+    # DTW scores are squared point differences; hybrid/xcorr scores are ratios.
+    score_scale = float(1 << (2 * q_shift)) if score_mode == "dtw" else 65536.0
+    rate_hz = params.get("sample_rate_hz") or 0.0
+
+    out = bytearray(
+        struct.pack(
+            HEADER_FMT,
+            MODEL_MAGIC,
+            MODEL_VERSION,
+            len(labels),
+            len(refs),
+            max_points,
+            SCORE_MODES[score_mode],
+            1 if use_znorm else 0,
+            q_shift,
+            per_label_k,
+            int(round(float(rate_hz) * 100)),
+            _q16(float(params["window_frac"])),
+            _q16(float(params["xcorr_max_lag_frac"])),
+            _q16(float(params["xcorr_min_overlap_frac"])),
+            _q16(float(params["hybrid_alpha"])),
+            _q16(float(params["reject_margin"])),
+            _q16(float(params["reject_threshold_grace"])),
+            _label_bytes(str(params["unknown_label"])),
+        )
+    )
+    thresholds = model.get("thresholds", {})
+    for label in labels:
+        thr = thresholds.get(label)
+        scaled = min(0xFFFFFFFFFFFFFFFF, int(round(float(thr) * score_scale))) if thr is not None else 0
+        out += struct.pack(LABEL_FMT, _label_bytes(label), 1 if thr is not None else 0, scaled)
+
+    qscale = float(1 << q_shift)
+    for ref in refs:
+        seq = ref["seq"]
+        if not 0 < len(seq) <= MAX_POINTS:
+            raise ValueError(f"reference {ref['path']} has {len(seq)} points")
+        out += struct.pack("<HH", labels.index(ref["label"]), len(seq))
+        for p in seq:
+            vals = [max(-32768, min(32767, int(round(v * qscale)))) for v in p]
+            out += struct.pack("<6h", *vals)
+    return bytes(out)
+
+
+class _Ref(ctypes.Structure):
+    _fields_ = [
+        ("label", ctypes.c_uint16),
+        ("len", ctypes.c_uint16),
+        ("points", ctypes.c_void_p),
+    ]
+
+
+class _Model(ctypes.Structure):
+    # Mirrors action_model_t.
+    _fields_ = [
+        ("label_count", ctypes.c_uint16),
+        ("ref_count", ctypes.c_uint16),
+        ("max_points", ctypes.c_uint16),
+        ("score_mode", ctypes.c_uint8),
+        ("use_znorm", ctypes.c_bool),
+        ("q_shift", ctypes.c_uint8),
+        ("per_label_k", ctypes.c_uint8),
+        ("sample_rate_centihz", ctypes.c_uint32),
+        ("window_frac_q16", ctypes.c_uint32),
+        ("xcorr_max_lag_frac_q16", ctypes.c_uint32),
+        ("xcorr_min_overlap_frac_q16", ctypes.c_uint32),
+        ("hybrid_alpha_q16", ctypes.c_uint32),
+        ("reject_margin_q16", ctypes.c_uint32),
+        ("reject_grace_q16", ctypes.c_uint32),
+        ("unknown_label", ctypes.c_char * LABEL_LEN),
+        ("labels", (ctypes.c_char * LABEL_LEN) * MAX_LABELS),
+        ("has_threshold", ctypes.c_bool * MAX_LABELS),
+        ("thresholds", ctypes.c_uint64 * MAX_LABELS),
+        ("refs", _Ref * MAX_REFS),
+    ]
+
+
+class _Result(ctypes.Structure):
+    # Mirrors action_result_t.
+    _fields_ = [
+        ("label", ctypes.c_int),
+        ("best_label", ctypes.c_int),
+        ("reject", ctypes.c_int),
+        ("best_score", ctypes.c_uint64),
+        ("second_score", ctypes.c_uint64),
+        ("label_scores", ctypes.c_uint64 * MAX_LABELS),
+    ]
+
+
+class _Work(ctypes.Structure):
+    # Mirrors action_classifier_work_t.
+    _fields_ = [
+        ("query", ctypes.c_int16 * (MAX_POINTS * DIMS)),
+        ("row", (ctypes.c_uint64 * (MAX_POINTS + 1)) * 2),
+        ("ref_dtw", ctypes.c_uint64 * MAX_REFS),
+        ("ref_xcorr", ctypes.c_int32 * MAX_REFS),
+    ]
+
+
+class NativeClassifier:
+    def __init__(self, blob: bytes) -> None:
+        lib = load_action_classifier()
+        if lib is None:
+            raise RuntimeError("native action_classifier unavailable")
+        self.lib = lib
+        self.blob = blob  # the model points into it
+        self.model = _Model()
+        self.work = _Work()
+        if not lib.action_model_load(ctypes.byref(self.model), blob, len(blob)):
+            raise ValueError("action_model_load rejected the model blob")
+
+    def label_name(self, idx: int) -> str:
+        if idx < 0:
+            return self.model.unknown_label.decode("utf-8")
+        return self.model.labels[idx].value.decode("utf-8")
+
+    def classify(self, samples: list, src_rate_hz: int = 0, skip_ref: int = -1) -> tuple[str, str]:
+        # Returns (accepted label or unknown, best label before gating).
+        arr = (ImuSample * len(samples))(*samples)
+        n = self.lib.action_classifier_prep(
+            ctypes.byref(self.model), arr, len(samples), src_rate_hz, ctypes.byref(self.work)
+        )
+        res = _Result()
+        self.lib.action_classifier_classify(
+            ctypes.byref(self.model), ctypes.byref(self.work), n, skip_ref, ctypes.byref(res)
+        )
+        return self.label_name(res.label), self.label_name(res.best_label)
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Check the firmware fixed-point classifier against dtw_baseline.py "
+        "(leave-one-out over the model references)."
+    )
+    parser.add_argument(
+        "--model",
+        type=Path,
+        default=Path("data/model/action_model.admodel"),
+        help="Model from build_model.py (binary or JSON)",
+    )
+    parser.add_argument("--limit", type=int, default=0, help="Check at most this many references")
+    return parser.parse_args()
+
+
+def main() -> int:
+    args = parse_args()
+    model = model_dict(args.model)
+    params = model["params"]
+    thresholds = {k: float(v) for k, v in model.get("thresholds", {}).items()}
+    refs = [
+        LabeledSequence(
+            label=x["label"],
+            path=Path(x["path"]),
+            seq=[tuple(float(v) for v in p) for p in x["seq"]],
+        )
+        for x in model["references"]
+    ]
+    blob = export_model_bin(model)
+    clf = NativeClassifier(blob)
+    print(f"device_model_bytes={len(blob)} refs={len(refs)}")
+
+    checked = 0
+    agree = 0
+    agree_best = 0
+    native_s = 0.0
+    for i, item in enumerate(refs):
+        if args.limit and checked >= args.limit:
+            break
+        if not item.path.exists():
+            print(f"skip (missing capture): {item.path}")
+            continue
+        raw = read_samples(item.path)
+        pool = [x for j, x in enumerate(refs) if j != i]
+        label_scores, _dtw, _xcorr, _metrics = compute_query_scores(
+            item.seq,
+            pool,
+            window_frac=float(params["window_frac"]),
+            per_label_k=int(params["per_label_k"]),
+            score_mode=str(params["score_mode"]),
+            hybrid_alpha=float(params["hybrid_alpha"]),
+            xcorr_max_lag_frac=float(params["xcorr_max_lag_frac"]),
+            xcorr_min_overlap_frac=float(params["xcorr_min_overlap_frac"]),
+        )
+        py_pred, _reason = predict_with_rejection(
+            label_scores=label_scores,
+            thresholds=thresholds,
+            margin=float(params["reject_margin"]),
+            threshold_grace=float(params["reject_threshold_grace"]),
+            unknown_label=str(params["unknown_label"]),
+        )
+        py_best = min(label_scores.items(), key=lambda x: x[1])[0] if label_scores else None
+
+        t0 = time.perf_counter()
+        c_pred, c_best = clf.classify(raw, skip_ref=i)
+        native_s += time.perf_counter() - t0
+
+        checked += 1
+        agree += int(c_pred == py_pred)
+        agree_best += int(c_best == py_best)
+        if c_pred != py_pred:
+            print(f"mismatch {item.path}: python={py_pred} device={c_pred} (best {py_best}/{c_best})")
+
+    if checked == 0:
+        print("no reference CSVs available to check", file=sys.stderr)
+        return 2
+    print(f"checked={checked} prediction_agreement={agree / checked:.3f} best_label_agreement={agree_best / checked:.3f}")
+    print(f"native_ms_per_query={native_s * 1000 / checked:.2f}")
+    return 0 if agree == checked else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
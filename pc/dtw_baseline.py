@@ -1,16 +1,50 @@
 #!/usr/bin/env python3
 import argparse
 import csv
+import ctypes
+import hashlib
 import json
 import math
+import multiprocessing
+import operator
+import os
 import random
+import struct
+import sys
+from array import array
 from collections import Counter, defaultdict
-from dataclasses import dataclass
+from dataclasses import dataclass, field
 from pathlib import Path
 from typing import Iterable
 
+from capture_file import CaptureFile, is_capture_file, manifest_capture_path
+from native_lib import load_dtw_kernel, load_q16_kernel, load_xcorr_kernel
 
 FEATURES = ("ax", "ay", "az", "gx", "gy", "gz")
+# Floats per point in the native DTW layout (pc/native/dtw_kernel.c).
+DTW_STRIDE = 8
+# Auto worker count never gives a ScoringEngine worker fewer references.
+MIN_REFS_PER_WORKER = 32
+# Pairwise calibration matrix cache (save_pair_matrix()): header, JSON
+# params/keys, then the dtw and xcorr matrices as native float64.
+PAIRS_MAGIC = b"ADPAIRS\0"
+PAIRS_VERSION = 1
+PAIRS_HEADER_FMT = "<8sII"
+# Prepared-sequence cache (SequenceCache): header, JSON params/entries, then
+# every entry's points as float32 in the native DTW layout. Bump SEQ_PREP_VERSION
+# whenever prep_points() changes what it produces.
+SEQ_CACHE_MAGIC = b"ADSEQS\0\0"
+SEQ_CACHE_VERSION = 1
+SEQ_CACHE_HEADER_FMT = "<8sII"
+SEQ_PREP_VERSION = 1
+# Fixed-point scoring (Q16Format, pc/native/q16_kernel.c).
+Q16_MAX = 32767
+# int16 scales cover this multiple of the references' per-axis peak, so a
+# query reaching past every reference still quantizes without clipping.
+Q16_HEADROOM = 2.0
+# Fractional bits of the per-axis cost weights.
+Q16_WEIGHT_BITS = 16
+Q16_INF = (1 << 63) - 1
 
 
 @dataclass
@@ -18,6 +52,32 @@ class LabeledSequence:
     label: str
     path: Path
     seq: list[tuple[float, ...]]
+    # Points captured before prep_sequence() (0 = unknown).
+    raw_len: int = 0
+    # float32 copy of seq for the native DTW kernel, built on first use.
+    packed: object = field(default=None, repr=False, compare=False)
+    # Cross-correlation spectra for the native xcorr kernel, see xcorr_spectra().
+    xcorr: object = field(default=None, repr=False, compare=False)
+    # Pre-filter descriptor stored in the model (embedding_index.py).
+    embedding: object = field(default=None, repr=False, compare=False)
+
+
+class _Q16Ref(ctypes.Structure):
+    # Mirrors q16_ref_t in pc/native/q16_kernel.c.
+    _fields_ = [
+        ("seq", ctypes.c_void_p),
+        ("len", ctypes.c_size_t),
+    ]
+
+
+@dataclass
+class XcorrSpectra:
+    # One side of max_normalized_xcorr_fft(): the sequence as flat doubles and
+    # its per-axis half spectra by FFT size.
+    flat: ctypes.Array
+    length: int
+    dims: int
+    by_size: dict = field(default_factory=dict)
 
 
 @dataclass
@@ -63,7 +123,19 @@ def parse_args() -> argparse.Namespace:
         action="store_true",
         help="Disable per-sequence feature z-normalization",
     )
+    add_seq_cache_args(common)
     common.add_argument("--k", type=int, default=1, help="K in k-NN over DTW distances")
+    common.add_argument(
+        "--workers",
+        type=int,
+        default=0,
+        help="Scoring worker processes (0 = auto: one per core, at least 32 references each)",
+    )
+    common.add_argument(
+        "--fixed-point",
+        action="store_true",
+        help="Score int16 references with the fixed-point kernel (evaluate: also float, for parity)",
+    )
 
     ev = sub.add_parser(
         "evaluate", parents=[common], help="Stratified split evaluation on manifest data"
@@ -74,7 +146,7 @@ def parse_args() -> argparse.Namespace:
     clf = sub.add_parser(
         "classify", parents=[common], help="Classify one CSV using manifest as references"
     )
-    clf.add_argument("--csv", type=Path, required=True, help="CSV file to classify")
+    clf.add_argument("--csv", type=Path, required=True, help="Capture to classify (binary or CSV)")
     clf.add_argument(
         "--per-label-k",
         type=int,
@@ -161,14 +233,34 @@ def read_manifest(path: Path, session: str, labels: set[str]) -> list[dict]:
     return rows
 
 
-def read_sequence(csv_path: Path) -> list[tuple[float, ...]]:
-    seq: list[tuple[float, ...]] = []
-    with csv_path.open("r", encoding="utf-8") as f:
-        reader = csv.DictReader(f)
-        for row in reader:
-            seq.append(tuple(float(row[k]) for k in FEATURES))
+def manifest_sample_rate(rows: Iterable[dict]) -> float | None:
+    # Median capture rate: advertised sample_rate_hz, else sample_count / duration_sec.
+    rates: list[float] = []
+    for row in rows:
+        rate = row.get("sample_rate_hz")
+        if not rate and row.get("duration_sec"):
+            rate = float(row.get("sample_count", 0)) / float(row["duration_sec"])
+        if rate and float(rate) > 0:
+            rates.append(float(rate))
+    if not rates:
+        return None
+    rates.sort()
+    return rates[len(rates) // 2]
+
+
+def read_sequence(path: Path) -> list[tuple[float, ...]]:
+    # Binary capture (see capture_file.py) or CSV.
+    if is_capture_file(path):
+        cap = CaptureFile(path)
+        try:
+            seq = cap.features()
+        finally:
+            cap.close()
+    else:
+        with path.open("r", encoding="utf-8") as f:
+            seq = [tuple(float(row[k]) for k in FEATURES) for row in csv.DictReader(f)]
     if not seq:
-        raise ValueError(f"no samples in {csv_path}")
+        raise ValueError(f"no samples in {path}")
     return seq
 
 
@@ -179,31 +271,42 @@ def downsample(seq: list[tuple[float, ...]], max_points: int) -> list[tuple[floa
     if max_points == 1:
         return [seq[0]]
     step = (n - 1) / (max_points - 1)
-    idxs = [min(n - 1, round(i * step)) for i in range(max_points)]
-    return [seq[i] for i in idxs]
+    return list(operator.itemgetter(*[min(n - 1, round(i * step)) for i in range(max_points)])(seq))
 
 
-def znormalize(seq: list[tuple[float, ...]]) -> list[tuple[float, ...]]:
-    dims = len(seq[0])
-    means = [0.0] * dims
-    for p in seq:
-        for i, x in enumerate(p):
-            means[i] += x
-    inv_n = 1.0 / len(seq)
-    means = [m * inv_n for m in means]
+def resample_to_rate(
+    seq: list[tuple[float, ...]], src_hz: float, dst_hz: float, tolerance: float = 0.1
+) -> list[tuple[float, ...]]:
+    # Nearest-index resampling so sequences captured at different stream rates
+    # share the same point density before downsample()/DTW.
+    if src_hz <= 0 or dst_hz <= 0 or abs(src_hz - dst_hz) <= tolerance * dst_hz:
+        return seq
+    n = len(seq)
+    m = max(1, int(round(n * dst_hz / src_hz)))
+    if m == 1 or n == 1:
+        return [seq[0]] * m
+    step = (n - 1) / (m - 1)
+    return [seq[min(n - 1, round(i * step))] for i in range(m)]
+
+
+def znormalize_columns(cols: list[tuple[float, ...]]) -> list[list[float]]:
+    # Per-feature z-normalization over whole columns (one list pass each
+    # instead of a loop per point and feature).
+    inv_n = 1.0 / len(cols[0])
+    out: list[list[float]] = []
+    for col in cols:
+        mean = sum(col) * inv_n
+        d = [x - mean for x in col]
+        var = sum(map(operator.mul, d, d))
+        std = math.sqrt(var * inv_n) if var > 0 else 1.0
+        if std <= 1e-12:
+            std = 1.0
+        out.append([x / std for x in d])
+    return out
 
-    vars_ = [0.0] * dims
-    for p in seq:
-        for i, x in enumerate(p):
-            d = x - means[i]
-            vars_[i] += d * d
-    stds = [math.sqrt(v * inv_n) if v > 0 else 1.0 for v in vars_]
-    stds = [s if s > 1e-12 else 1.0 for s in stds]
 
-    out: list[tuple[float, ...]] = []
-    for p in seq:
-        out.append(tuple((x - means[i]) / stds[i] for i, x in enumerate(p)))
-    return out
+def znormalize(seq: list[tuple[float, ...]]) -> list[tuple[float, ...]]:
+    return list(zip(*znormalize_columns(list(zip(*seq)))))
 
 
 def prep_sequence(
@@ -215,15 +318,151 @@ def prep_sequence(
     return seq
 
 
+def prep_points(seq: list[tuple[float, ...]], max_points: int, use_znorm: bool) -> tuple[array, int]:
+    # prep_sequence() straight into float32 points in the native DTW layout;
+    # returns (points, dims).
+    cols: list = list(zip(*downsample(seq, max_points)))
+    dims = len(cols)
+    if dims > DTW_STRIDE:
+        raise ValueError(f"{dims} features do not fit the {DTW_STRIDE}-float point layout")
+    if use_znorm:
+        cols = znormalize_columns(cols)
+    # Each column lands in its strided slots; the padding stays zero.
+    points = array("f", bytes(4 * DTW_STRIDE * len(cols[0])))
+    for i, col in enumerate(cols):
+        points[i::DTW_STRIDE] = array("f", col)
+    return points, dims
+
+
+def points_sequence(points: array | bytes, dims: int) -> list[tuple[float, ...]]:
+    # float32 points (native DTW layout) as a reference sequence: packed for
+    # the kernel when it is there, per-point tuples for the Python paths.
+    raw = points if isinstance(points, (bytes, memoryview)) else points.tobytes()
+    if load_dtw_kernel() is not None:
+        return PackedSequence((ctypes.c_float * (len(raw) // 4)).from_buffer_copy(raw), dims)
+    vals = array("f")
+    vals.frombytes(raw)
+    return [tuple(vals[i : i + dims]) for i in range(0, len(vals), DTW_STRIDE)]
+
+
+class SequenceCache:
+    # On-disk prepared references keyed by capture content hash, max_points
+    # and z-normalization, so reloading unchanged captures skips decoding and
+    # preparation. Entries of other captures or settings are kept; deleting
+    # the file starts over.
+    def __init__(self, path: Path) -> None:
+        self.path = path
+        self.hits = 0
+        self.misses = 0
+        # key -> (raw_len, dims, float32 points bytes)
+        self.entries: dict[str, tuple[int, int, bytes]] = {}
+        self._dirty = False
+        self._load()
+
+    @staticmethod
+    def params() -> dict:
+        return {"prep": SEQ_PREP_VERSION, "stride": DTW_STRIDE, "byteorder": sys.byteorder}
+
+    @staticmethod
+    def key(digest: str, max_points: int, use_znorm: bool) -> str:
+        return f"{digest}:{max_points}:{int(use_znorm)}"
+
+    def _load(self) -> None:
+        # Missing, unreadable or foreign files just mean an empty cache.
+        try:
+            blob = self.path.read_bytes()
+            magic, version, header_len = struct.unpack_from(SEQ_CACHE_HEADER_FMT, blob)
+            if magic != SEQ_CACHE_MAGIC or version != SEQ_CACHE_VERSION:
+                return
+            start = struct.calcsize(SEQ_CACHE_HEADER_FMT)
+            header = json.loads(blob[start : start + header_len].decode("utf-8"))
+        except (OSError, ValueError, struct.error):
+            return
+        if header.get("params") != self.params():
+            return
+        body = memoryview(blob)[start + header_len :]
+        for key, raw_len, dims, offset, size in header.get("entries", []):
+            if offset + size <= len(body):
+                self.entries[key] = (raw_len, dims, body[offset : offset + size])
+
+    def get(self, key: str) -> tuple[int, int, bytes] | None:
+        hit = self.entries.get(key)
+        if hit is None:
+            self.misses += 1
+        else:
+            self.hits += 1
+        return hit
+
+    def put(self, key: str, raw_len: int, dims: int, points: array) -> None:
+        self.entries[key] = (raw_len, dims, points.tobytes())
+        self._dirty = True
+
+    def save(self) -> None:
+        # Rewrites the file only when something was added.
+        if not self._dirty:
+            return
+        entries = []
+        offset = 0
+        for key, (raw_len, dims, points) in self.entries.items():
+            entries.append([key, raw_len, dims, offset, len(points)])
+            offset += len(points)
+        header = json.dumps({"params": self.params(), "entries": entries}).encode("utf-8")
+        self.path.parent.mkdir(parents=True, exist_ok=True)
+        tmp = self.path.with_name(self.path.name + ".tmp")
+        with tmp.open("wb") as f:
+            f.write(struct.pack(SEQ_CACHE_HEADER_FMT, SEQ_CACHE_MAGIC, SEQ_CACHE_VERSION, len(header)))
+            f.write(header)
+            for _raw_len, _dims, points in self.entries.values():
+                f.write(points)
+        tmp.replace(self.path)
+        self._dirty = False
+
+
+def add_seq_cache_args(parser: argparse.ArgumentParser) -> None:
+    parser.add_argument(
+        "--seq-cache",
+        type=Path,
+        default=None,
+        help="Prepared-sequence cache (default: <manifest>.seqcache.bin)",
+    )
+    parser.add_argument(
+        "--no-seq-cache",
+        action="store_true",
+        help="Prepare every capture from scratch and do not write the cache",
+    )
+
+
+def seq_cache_path(args: argparse.Namespace) -> Path | None:
+    if args.no_seq_cache:
+        return None
+    return args.seq_cache or args.manifest.with_suffix(".seqcache.bin")
+
+
 def load_labeled_sequences(
-    manifest_rows: Iterable[dict], max_points: int, use_znorm: bool
+    manifest_rows: Iterable[dict], max_points: int, use_znorm: bool, cache_path: Path | None = None
 ) -> list[LabeledSequence]:
+    # References come out as float32 points whether or not they were cached,
+    # so scores do not depend on the cache.
+    cache = SequenceCache(cache_path) if cache_path is not None else None
     items: list[LabeledSequence] = []
     for row in manifest_rows:
-        path = Path(row["csv_path"])
-        seq = read_sequence(path)
-        seq = prep_sequence(seq, max_points=max_points, use_znorm=use_znorm)
-        items.append(LabeledSequence(label=row["label"], path=path, seq=seq))
+        path = manifest_capture_path(row)
+        hit = key = None
+        if cache is not None:
+            key = SequenceCache.key(hashlib.sha1(path.read_bytes()).hexdigest(), max_points, use_znorm)
+            hit = cache.get(key)
+        if hit is not None:
+            raw_len, dims, points = hit
+        else:
+            raw = read_sequence(path)
+            raw_len = len(raw)
+            points, dims = prep_points(raw, max_points, use_znorm)
+            if cache is not None:
+                cache.put(key, raw_len, dims, points)
+        items.append(LabeledSequence(label=row["label"], path=path, seq=points_sequence(points, dims), raw_len=raw_len))
+    if cache is not None:
+        cache.save()
+        print(f"seq_cache path={cache.path} hits={cache.hits} misses={cache.misses}")
     return items
 
 
@@ -231,12 +470,16 @@ def point_cost(a: tuple[float, ...], b: tuple[float, ...]) -> float:
     return sum((x - y) * (x - y) for x, y in zip(a, b))
 
 
-def dtw_distance(a: list[tuple[float, ...]], b: list[tuple[float, ...]], window: int) -> float:
-    n = len(a)
-    m = len(b)
+def effective_window(n: int, m: int, window: int) -> int:
     if window <= 0:
         window = max(n, m)
-    window = max(window, abs(n - m))
+    return max(window, abs(n - m))
+
+
+def dtw_distance_py(a: list[tuple[float, ...]], b: list[tuple[float, ...]], window: int) -> float:
+    n = len(a)
+    m = len(b)
+    window = effective_window(n, m, window)
     inf = float("inf")
 
     prev = [inf] * (m + 1)
@@ -244,19 +487,117 @@ def dtw_distance(a: list[tuple[float, ...]], b: list[tuple[float, ...]], window:
     prev[0] = 0.0
 
     for i in range(1, n + 1):
+        # Only the band is visited; the cells just outside it are reset so
+        # the next row reads them as unreachable.
         start = max(1, i - window)
         end = min(m, i + window)
-        curr[0] = inf
-        for j in range(1, m + 1):
-            if j < start or j > end:
-                curr[j] = inf
-                continue
-            c = point_cost(a[i - 1], b[j - 1])
+        curr[start - 1] = inf
+        ai = a[i - 1]
+        for j in range(start, end + 1):
+            c = point_cost(ai, b[j - 1])
             curr[j] = c + min(curr[j - 1], prev[j], prev[j - 1])
+        if end < m:
+            curr[end + 1] = inf
         prev, curr = curr, prev
     return prev[m]
 
 
+class PackedSequence:
+    # Read-only sequence of per-point tuples over float32 points already in
+    # the native DTW layout (DTW_STRIDE floats per point, the first `dims`
+    # used), e.g. a slice of a mapped host model (model_file.py). The DTW and
+    # xcorr kernels read `data` directly; only the Python paths build tuples.
+    __slots__ = ("data", "dims")
+
+    def __init__(self, data: ctypes.Array, dims: int) -> None:
+        self.data = data
+        self.dims = dims
+
+    def __len__(self) -> int:
+        return len(self.data) // DTW_STRIDE
+
+    def __getitem__(self, i):
+        if isinstance(i, slice):
+            return [self[j] for j in range(*i.indices(len(self)))]
+        n = len(self)
+        if i < 0:
+            i += n
+        if not 0 <= i < n:
+            raise IndexError("point index out of range")
+        base = i * DTW_STRIDE
+        return tuple(self.data[base : base + self.dims])
+
+    def __iter__(self):
+        data = self.data
+        dims = self.dims
+        for base in range(0, len(data), DTW_STRIDE):
+            yield tuple(data[base : base + dims])
+
+    def __reduce__(self):
+        # Pickles (e.g. to ScoringEngine workers) as a plain float32 copy.
+        return (_unpickle_packed, (bytes(self.data), self.dims))
+
+
+def _unpickle_packed(raw: bytes, dims: int) -> PackedSequence:
+    return PackedSequence((ctypes.c_float * (len(raw) // 4)).from_buffer_copy(raw), dims)
+
+
+def pack_sequence(seq: list[tuple[float, ...]]) -> ctypes.Array | None:
+    # Contiguous float32 points, zero-padded to DTW_STRIDE; None without the native kernel.
+    if load_dtw_kernel() is None or not seq:
+        return None
+    if isinstance(seq, PackedSequence):
+        return seq.data
+    if len(seq[0]) > DTW_STRIDE:
+        return None
+    pad = (0.0,) * (DTW_STRIDE - len(seq[0]))
+    flat: list[float] = []
+    for p in seq:
+        flat.extend(p)
+        flat.extend(pad)
+    return (ctypes.c_float * len(flat))(*flat)
+
+
+def packed_ref(item: LabeledSequence) -> ctypes.Array | None:
+    if item.packed is None:
+        item.packed = pack_sequence(item.seq)
+    return item.packed
+
+
+def dtw_packed(
+    a: list[tuple[float, ...]],
+    a_packed: ctypes.Array | None,
+    b: list[tuple[float, ...]],
+    b_packed: ctypes.Array | None,
+    window: int,
+) -> float:
+    if a_packed is None or b_packed is None:
+        return dtw_distance_py(a, b, window)
+    return load_dtw_kernel().dtw_band_f32(a_packed, len(a), b_packed, len(b), window)
+
+
+def prepare_references(
+    refs: list[LabeledSequence],
+    query_len: int,
+    xcorr_max_lag_frac: float | None = None,
+) -> None:
+    # Packs every reference for the native DTW kernel and (given the lag
+    # fraction) builds its cross-correlation spectrum for queries of query_len
+    # points (max_points for live queries) ahead of the first query.
+    for item in refs:
+        packed_ref(item)
+        side = reference_xcorr(item) if xcorr_max_lag_frac is not None else None
+        if side is not None:
+            max_lag = int(round(max(query_len, len(item.seq)) * xcorr_max_lag_frac))
+            xcorr_spectrum(side, xcorr_fft_size(query_len, len(item.seq), max_lag))
+
+
+def dtw_distance(a: list[tuple[float, ...]], b: list[tuple[float, ...]], window: int) -> float:
+    # Native float32 kernel when available (matches dtw_distance_py to float32
+    # rounding), pure Python otherwise.
+    return dtw_packed(a, pack_sequence(a), b, pack_sequence(b), window)
+
+
 def classify_knn(
     query: list[tuple[float, ...]],
     train: list[LabeledSequence],
@@ -264,11 +605,20 @@ def classify_knn(
     window_frac: float,
 ) -> tuple[str, list[tuple[float, str, Path]]]:
     dists: list[tuple[float, str, Path]] = []
+    query_packed = pack_sequence(query)
     for item in train:
         window = int(round(max(len(query), len(item.seq)) * window_frac))
-        d = dtw_distance(query, item.seq, window=window)
+        d = dtw_packed(query, query_packed, item.seq, packed_ref(item), window=window)
         dists.append((d, item.label, item.path))
     dists.sort(key=lambda x: x[0])
+    return knn_vote(dists, k)
+
+
+def knn_vote(
+    dists: list[tuple[float, str, Path]], k: int
+) -> tuple[str, list[tuple[float, str, Path]]]:
+    # Majority label of the k nearest (dists sorted ascending); ties go to the
+    # alphabetically first label.
     k = max(1, min(k, len(dists)))
     topk = dists[:k]
     votes = Counter(label for _, label, _ in topk)
@@ -321,24 +671,435 @@ def max_normalized_xcorr(
     return best, best_lag
 
 
-def compute_pair_metrics(
+_twiddles: dict[int, ctypes.Array] = {}
+
+
+def xcorr_fft_size(n: int, m: int, max_lag: int) -> int:
+    # Smallest power of two that keeps every lag in +-max_lag from wrapping.
+    size = 2
+    while size < max(n, m) + max(0, max_lag):
+        size *= 2
+    return size
+
+
+def xcorr_spectra(seq: list[tuple[float, ...]]) -> XcorrSpectra | None:
+    lib = load_xcorr_kernel()
+    if lib is None or not seq:
+        return None
+    if isinstance(seq, PackedSequence):
+        flat = (ctypes.c_double * (len(seq) * seq.dims))()
+        lib.xcorr_widen_f32(seq.data, len(seq), DTW_STRIDE, seq.dims, flat)
+        return XcorrSpectra(flat=flat, length=len(seq), dims=seq.dims)
+    flat = [v for p in seq for v in p]
+    return XcorrSpectra(flat=(ctypes.c_double * len(flat))(*flat), length=len(seq), dims=len(seq[0]))
+
+
+def xcorr_spectrum(side: XcorrSpectra, nfft: int) -> ctypes.Array:
+    spec = side.by_size.get(nfft)
+    if spec is None:
+        lib = load_xcorr_kernel()
+        tw = _twiddles.get(nfft)
+        if tw is None:
+            tw = (ctypes.c_double * nfft)()
+            lib.xcorr_twiddles(nfft, tw)
+            _twiddles[nfft] = tw
+        spec = (ctypes.c_double * (side.dims * (nfft + 2)))()
+        if lib.xcorr_spectrum(side.flat, side.length, side.dims, nfft, tw, spec) != 0:
+            raise MemoryError("xcorr_spectrum failed")
+        side.by_size[nfft] = spec
+    return spec
+
+
+def reference_xcorr(item: LabeledSequence) -> XcorrSpectra | None:
+    if item.xcorr is None:
+        item.xcorr = xcorr_spectra(item.seq)
+    return item.xcorr
+
+
+def max_normalized_xcorr_fft(
+    a: list[tuple[float, ...]],
+    a_side: XcorrSpectra | None,
+    b: list[tuple[float, ...]],
+    b_side: XcorrSpectra | None,
+    max_lag: int,
+    min_overlap: int,
+) -> tuple[float, int]:
+    # Same (best, best_lag) as max_normalized_xcorr(): the native kernel gets
+    # the lag curve from one FFT and re-scores the best lags exactly.
+    if a_side is None or b_side is None or a_side.dims != b_side.dims:
+        return max_normalized_xcorr(a, b, max_lag=max_lag, min_overlap=min_overlap)
+    max_lag = max(0, max_lag)
+    nfft = xcorr_fft_size(len(a), len(b), max_lag)
+    best = ctypes.c_double()
+    lag = ctypes.c_long()
+    rc = load_xcorr_kernel().xcorr_best_lag(
+        a_side.flat,
+        len(a),
+        xcorr_spectrum(a_side, nfft),
+        b_side.flat,
+        len(b),
+        xcorr_spectrum(b_side, nfft),
+        a_side.dims,
+        nfft,
+        _twiddles[nfft],
+        max_lag,
+        min_overlap,
+        ctypes.byref(best),
+        ctypes.byref(lag),
+    )
+    if rc != 0:
+        raise MemoryError("xcorr_best_lag failed")
+    return best.value, lag.value
+
+
+def compute_pair_dtw(
     query: list[tuple[float, ...]],
+    query_packed: ctypes.Array | None,
     refs: list[LabeledSequence],
     window_frac: float,
-    xcorr_max_lag_frac: float,
-    xcorr_min_overlap_frac: float,
+) -> list[float]:
+    # Exact DTW from query to every reference, in reference order.
+    out = []
+    for item in refs:
+        window = int(round(max(len(query), len(item.seq)) * window_frac))
+        out.append(dtw_packed(query, query_packed, item.seq, packed_ref(item), window=window))
+    return out
+
+
+def score_references(
+    query: list[tuple[float, ...]],
+    refs: list[LabeledSequence],
+    window_frac: float,
+    xcorr_max_lag_frac: float | None,
+    xcorr_min_overlap_frac: float | None,
+    with_xcorr: bool = True,
 ) -> list[PairMetric]:
+    # One PairMetric per reference, in reference order. Without with_xcorr
+    # the xcorr is nan (lag 0).
     out: list[PairMetric] = []
+    dtws = compute_pair_dtw(query, pack_sequence(query), refs, window_frac)
+    query_xcorr = xcorr_spectra(query) if with_xcorr else None
+    for item, dtw in zip(refs, dtws):
+        xcorr, lag = float("nan"), 0
+        if with_xcorr:
+            max_lag = int(round(max(len(query), len(item.seq)) * xcorr_max_lag_frac))
+            min_overlap = int(round(min(len(query), len(item.seq)) * xcorr_min_overlap_frac))
+            min_overlap = max(4, min_overlap)
+            xcorr, lag = max_normalized_xcorr_fft(
+                query, query_xcorr, item.seq, reference_xcorr(item), max_lag=max_lag, min_overlap=min_overlap
+            )
+        out.append(PairMetric(label=item.label, path=item.path, dtw=dtw, xcorr=xcorr, lag=lag))
+    return out
+
+
+@dataclass(frozen=True)
+class Q16Format:
+    # Per-axis int16 quantization: value = q * scales[axis]. The fixed-point
+    # kernels weigh axis d by weights[d] ~ (scales[d] / max scale)^2 scaled by
+    # 2^Q16_WEIGHT_BITS, so every cost and dot product is an exact integer
+    # that one multiply by unit brings back to float units.
+    scales: tuple[float, ...]
+
+    @property
+    def weights(self) -> tuple[int, ...]:
+        top = max(self.scales)
+        w = [round((s / top) ** 2 * (1 << Q16_WEIGHT_BITS)) for s in self.scales]
+        return tuple(w + [0] * (DTW_STRIDE - len(w)))
+
+    @property
+    def unit(self) -> float:
+        return max(self.scales) ** 2 / (1 << Q16_WEIGHT_BITS)
+
+    @classmethod
+    def for_references(cls, refs: list[LabeledSequence]) -> "Q16Format":
+        # The format int16 references already share (an int16 host model),
+        # else q16_scales() over them.
+        fmts = {item.seq.fmt if isinstance(item.seq, Q16Sequence) else None for item in refs}
+        if len(fmts) == 1 and None not in fmts:
+            return fmts.pop()
+        return cls(q16_scales([item.seq for item in refs]))
+
+
+def q16_scales(seqs: Iterable[list[tuple[float, ...]]], headroom: float = Q16_HEADROOM) -> tuple[float, ...]:
+    # Symmetric per-axis scale over every point, Q16_HEADROOM times the peak.
+    peak: list[float] = []
+    for seq in seqs:
+        for p in seq:
+            if len(peak) < len(p):
+                peak.extend([0.0] * (len(p) - len(peak)))
+            for d, v in enumerate(p):
+                peak[d] = max(peak[d], abs(v))
+    return tuple((x * headroom / Q16_MAX) if x > 0 else 1.0 for x in peak)
+
+
+def quantize_points(seq: list[tuple[float, ...]], fmt: Q16Format) -> array:
+    # int16 points in the DTW_STRIDE layout, rounded half to even and clipped.
+    if isinstance(seq, Q16Sequence) and seq.fmt == fmt:
+        return seq.data if isinstance(seq.data, array) else array("h", bytes(seq.data))
+    out = array("h", bytes(2 * DTW_STRIDE * len(seq)))
+    for d, col in enumerate(zip(*seq)):
+        s = fmt.scales[d]
+        out[d::DTW_STRIDE] = array("h", [max(-Q16_MAX, min(Q16_MAX, round(v / s))) for v in col])
+    return out
+
+
+class Q16Sequence:
+    # PackedSequence over int16 points in a Q16Format: the fixed-point kernel
+    # reads `data` (an array('h') or a ctypes view of a mapped int16 host
+    # model) in place; iterating dequantizes.
+    __slots__ = ("data", "dims", "fmt")
+
+    def __init__(self, data, dims: int, fmt: Q16Format) -> None:
+        self.data = data
+        self.dims = dims
+        self.fmt = fmt
+
+    def __len__(self) -> int:
+        return len(self.data) // DTW_STRIDE
+
+    def __getitem__(self, i):
+        if isinstance(i, slice):
+            return [self[j] for j in range(*i.indices(len(self)))]
+        n = len(self)
+        if i < 0:
+            i += n
+        if not 0 <= i < n:
+            raise IndexError("point index out of range")
+        base = i * DTW_STRIDE
+        return tuple(q * s for q, s in zip(self.data[base : base + self.dims], self.fmt.scales))
+
+    def __iter__(self):
+        data = self.data
+        dims = self.dims
+        scales = self.fmt.scales
+        for base in range(0, len(data), DTW_STRIDE):
+            yield tuple(q * s for q, s in zip(data[base : base + dims], scales))
+
+    def __reduce__(self):
+        # Pickles (e.g. to ScoringEngine workers) as a plain int16 copy.
+        return (Q16Sequence, (array("h", bytes(self.data)), self.dims, self.fmt))
+
+
+def quantize_references(refs: list[LabeledSequence], fmt: Q16Format) -> list[LabeledSequence]:
+    # The same references holding int16 points only; ones already in fmt are
+    # kept as they are.
+    out = []
     for item in refs:
-        window = int(round(max(len(query), len(item.seq)) * window_frac))
-        dtw = dtw_distance(query, item.seq, window=window)
-        max_lag = int(round(max(len(query), len(item.seq)) * xcorr_max_lag_frac))
-        min_overlap = int(round(min(len(query), len(item.seq)) * xcorr_min_overlap_frac))
-        min_overlap = max(4, min_overlap)
-        xcorr, lag = max_normalized_xcorr(
-            query, item.seq, max_lag=max_lag, min_overlap=min_overlap
+        if not (isinstance(item.seq, Q16Sequence) and item.seq.fmt == fmt):
+            dims = len(item.seq[0]) if len(item.seq) else 0
+            item = LabeledSequence(
+                label=item.label,
+                path=item.path,
+                seq=Q16Sequence(quantize_points(item.seq, fmt), dims, fmt),
+                raw_len=item.raw_len,
+            )
+        out.append(item)
+    return out
+
+
+def _q16_address(data) -> int:
+    if isinstance(data, array):
+        return data.buffer_info()[0]
+    return ctypes.addressof(data)
+
+
+def q16_dtw_py(a: list[tuple[int, ...]], b: list[tuple[int, ...]], window: int, w: tuple[int, ...]) -> int:
+    # Twin of dtw_band() in q16_kernel.c: banded integer DTW.
+    n = len(a)
+    m = len(b)
+    window = effective_window(n, m, window)
+    inf = Q16_INF
+    prev = [inf] * (m + 1)
+    curr = [inf] * (m + 1)
+    prev[0] = 0
+    for i in range(1, n + 1):
+        start = max(1, i - window)
+        end = min(m, i + window)
+        ai = a[i - 1]
+        curr[start - 1] = inf
+        left = inf
+        for j in range(start, end + 1):
+            best = min(left, prev[j], prev[j - 1])
+            if best != inf:
+                bj = b[j - 1]
+                best += sum(wd * (x - y) * (x - y) for wd, x, y in zip(w, ai, bj))
+            left = curr[j] = best
+        if end < m:
+            curr[end + 1] = inf
+        prev, curr = curr, prev
+    return prev[m]
+
+
+def q16_xcorr_py(
+    a: list[tuple[int, ...]],
+    b: list[tuple[int, ...]],
+    max_lag: int,
+    min_overlap: int,
+    w: tuple[int, ...],
+    unit: float,
+) -> tuple[float, int]:
+    # Twin of xcorr() in q16_kernel.c; max_normalized_xcorr() in integers.
+    n = len(a)
+    m = len(b)
+    dims = len(a[0])
+    best = -1.0
+    best_lag = 0
+    max_lag = max(0, max_lag)
+    min_overlap = max(1, min_overlap)
+    for lag in range(-max_lag, max_lag + 1):
+        if lag >= 0:
+            pa = a[lag : lag + min(n - lag, m)]
+            pb = b
+        else:
+            pa = a
+            pb = b[-lag : -lag + min(n, m + lag)]
+        overlap = min(len(pa), len(pb))
+        if overlap < min_overlap:
+            continue
+        dot = 0
+        for d in range(dims):
+            dot += w[d] * sum(x[d] * y[d] for x, y in zip(pa, pb))
+        corr = clamp(float(dot) * unit / (overlap * dims), -1.0, 1.0)
+        if corr > best:
+            best = corr
+            best_lag = lag
+    return best, best_lag
+
+
+def q16_points(data, dims: int) -> list[tuple[int, ...]]:
+    return [tuple(data[base : base + dims]) for base in range(0, len(data), DTW_STRIDE)]
+
+
+class Q16Bank:
+    # References quantized to one Q16Format, with the fixed-point kernel's
+    # reference table built once. Scoring follows score_references(): every
+    # DTW in full and xcorr for every reference. The Python twin does the same
+    # integer math, so both paths return identical metrics. int16 halves the
+    # reference memory of float32; it is not faster (bench.py fixedpoint).
+    def __init__(self, refs: list[LabeledSequence], fmt: Q16Format) -> None:
+        self.fmt = fmt
+        self.refs = quantize_references(refs, fmt)
+        self.weights = fmt.weights
+        self.unit = fmt.unit
+        self.dims = len(fmt.scales)
+        self._lib = load_q16_kernel()
+        self._points: list[list[tuple[int, ...]]] | None = None
+        self._w = (ctypes.c_int64 * DTW_STRIDE)(*self.weights)
+        self._table = self._ref_table(range(len(self.refs))) if self._lib is not None else None
+
+    def nbytes(self) -> int:
+        return sum(len(item.seq.data) * 2 for item in self.refs)
+
+    def _ref_table(self, indices) -> ctypes.Array:
+        indices = list(indices)
+        table = (_Q16Ref * max(1, len(indices)))()
+        for row, i in zip(table, indices):
+            seq = self.refs[i].seq
+            row.seq = _q16_address(seq.data)
+            row.len = len(seq)
+        return table
+
+    def score(
+        self,
+        query: list[tuple[float, ...]],
+        active: list[int],
+        window_frac: float,
+        xcorr_max_lag_frac: float | None,
+        xcorr_min_overlap_frac: float | None,
+        with_xcorr: bool = True,
+        native: bool = True,
+    ) -> list[PairMetric]:
+        # One PairMetric per reference index in active, in that order.
+        q = quantize_points(query, self.fmt)
+        if not active or not len(q):
+            return []
+        with_xcorr = with_xcorr and xcorr_max_lag_frac is not None
+        xmax = xcorr_max_lag_frac if with_xcorr else 0.0
+        xmin = xcorr_min_overlap_frac if with_xcorr and xcorr_min_overlap_frac is not None else 0.0
+        if native and self._lib is not None:
+            dtw, xc, lags = self._score_native(q, active, window_frac, with_xcorr, xmax, xmin)
+        else:
+            dtw, xc, lags = self._score_py(q, active, window_frac, with_xcorr, xmax, xmin)
+        unit = self.unit
+        out = []
+        for pos, i in enumerate(active):
+            item = self.refs[i]
+            d = float("inf") if dtw[pos] == Q16_INF else dtw[pos] * unit
+            xcorr, lag = (xc[pos], lags[pos]) if with_xcorr else (float("nan"), 0)
+            out.append(PairMetric(label=item.label, path=item.path, dtw=d, xcorr=xcorr, lag=lag))
+        return out
+
+    def _score_native(self, q, active, window_frac, with_xcorr, xmax, xmin):
+        count = len(active)
+        table = self._table if count == len(self.refs) else self._ref_table(active)
+        dtw = (ctypes.c_int64 * count)()
+        xc = (ctypes.c_double * count)()
+        lags = (ctypes.c_long * count)()
+        qbuf = (ctypes.c_int16 * len(q)).from_buffer(q)
+        rc = self._lib.q16_score(
+            qbuf,
+            len(q) // DTW_STRIDE,
+            table,
+            count,
+            self._w,
+            self.dims,
+            self.unit,
+            window_frac,
+            int(with_xcorr),
+            xmax,
+            xmin,
+            dtw,
+            xc,
+            lags,
         )
-        out.append(PairMetric(label=item.label, path=item.path, dtw=dtw, xcorr=xcorr, lag=lag))
+        if rc != 0:
+            raise MemoryError("q16_score failed")
+        return dtw[:], xc[:], lags[:]
+
+    def _score_py(self, q, active, window_frac, with_xcorr, xmax, xmin):
+        # Twin of q16_score().
+        if self._points is None:
+            self._points = [q16_points(item.seq.data, self.dims) for item in self.refs]
+        w = self.weights[: self.dims]
+        qp = q16_points(q, self.dims)
+        n = len(qp)
+        refs = [self._points[i] for i in active]
+        dtw = [q16_dtw_py(qp, b, int(round(max(n, len(b)) * window_frac)), w) for b in refs]
+        xc = [float("nan")] * len(refs)
+        lags = [0] * len(refs)
+        if with_xcorr:
+            for pos, b in enumerate(refs):
+                max_lag = int(round(max(n, len(b)) * xmax))
+                min_overlap = max(4, int(round(min(n, len(b)) * xmin)))
+                xc[pos], lags[pos] = q16_xcorr_py(qp, b, max_lag, min_overlap, w, self.unit)
+        return dtw, xc, lags
+
+
+def keep_label_topk(metrics: list[PairMetric], per_label_k: int) -> None:
+    # Only each label's k nearest enter the scores; the rest report dtw=inf.
+    # Ties keep the earlier reference.
+    inf = float("inf")
+    by_label: dict[str, list[PairMetric]] = defaultdict(list)
+    for m in metrics:
+        by_label[m.label].append(m)
+    for rows in by_label.values():
+        for m in sorted(rows, key=lambda x: x.dtw)[per_label_k:]:
+            m.dtw = inf
+
+
+def compute_pair_metrics(
+    query: list[tuple[float, ...]],
+    refs: list[LabeledSequence],
+    window_frac: float,
+    xcorr_max_lag_frac: float,
+    xcorr_min_overlap_frac: float,
+    per_label_k: int = 0,
+) -> list[PairMetric]:
+    # With per_label_k > 0, references outside their label's k nearest keep
+    # their xcorr but report dtw=inf and sort last.
+    out = score_references(query, refs, window_frac, xcorr_max_lag_frac, xcorr_min_overlap_frac)
+    if per_label_k > 0:
+        keep_label_topk(out, per_label_k)
     out.sort(key=lambda x: x.dtw)
     return out
 
@@ -349,9 +1110,10 @@ def compute_distances(
     window_frac: float,
 ) -> list[tuple[float, str, Path]]:
     out: list[tuple[float, str, Path]] = []
+    query_packed = pack_sequence(query)
     for item in refs:
         window = int(round(max(len(query), len(item.seq)) * window_frac))
-        d = dtw_distance(query, item.seq, window=window)
+        d = dtw_packed(query, query_packed, item.seq, packed_ref(item), window=window)
         out.append((d, item.label, item.path))
     out.sort(key=lambda x: x[0])
     return out
@@ -381,14 +1143,22 @@ def compute_query_scores(
     xcorr_max_lag_frac: float,
     xcorr_min_overlap_frac: float,
 ) -> tuple[dict[str, float], dict[str, float], dict[str, float], list[PairMetric]]:
+    # Only the per-label top-k DTW enters the scores.
     metrics = compute_pair_metrics(
         query,
         refs,
         window_frac=window_frac,
         xcorr_max_lag_frac=xcorr_max_lag_frac,
         xcorr_min_overlap_frac=xcorr_min_overlap_frac,
+        per_label_k=max(1, per_label_k),
     )
+    return (*scores_from_metrics(metrics, per_label_k, score_mode, hybrid_alpha), metrics)
+
 
+def scores_from_metrics(
+    metrics: list[PairMetric], per_label_k: int, score_mode: str, hybrid_alpha: float
+) -> tuple[dict[str, float], dict[str, float], dict[str, float]]:
+    # (final, dtw, xcorr) label scores; final is lower-is-better in every mode.
     by_label: dict[str, list[PairMetric]] = defaultdict(list)
     for m in metrics:
         by_label[m.label].append(m)
@@ -419,7 +1189,240 @@ def compute_query_scores(
             dtw_norm = dtw_scores[label] / best_dtw
             final_scores[label] = dtw_norm + hybrid_alpha * xcorr_penalty
 
-    return final_scores, dtw_scores, xcorr_scores, metrics
+    return final_scores, dtw_scores, xcorr_scores
+
+
+def resolve_workers(workers: int, ref_count: int) -> int:
+    # workers <= 0: one per core, but no fewer than MIN_REFS_PER_WORKER
+    # references each (below that the pipe round trip costs more than the
+    # scoring it spreads out).
+    if workers <= 0:
+        workers = min(os.cpu_count() or 1, ref_count // MIN_REFS_PER_WORKER)
+    return max(1, min(workers, ref_count))
+
+
+def _score_worker(
+    conn,
+    shard: list[tuple[int, str, Path, list[tuple[float, ...]]]],
+    query_len: int,
+    window_frac: float,
+    xcorr_max_lag_frac: float | None,
+    xcorr_min_overlap_frac: float | None,
+    q16_format: Q16Format | None = None,
+) -> None:
+    # ScoringEngine worker process: prepares its shard once, then answers
+    # (query, exclude) requests until it gets None.
+    index = [i for i, _label, _path, _seq in shard]
+    refs = [LabeledSequence(label=label, path=path, seq=seq) for _i, label, path, seq in shard]
+    bank = Q16Bank(refs, q16_format) if q16_format is not None else None
+    if bank is None:
+        prepare_references(refs, query_len, xcorr_max_lag_frac)
+    conn.send(None)
+    while True:
+        req = conn.recv()
+        if req is None:
+            break
+        query, exclude = req
+        try:
+            active = [pos for pos, i in enumerate(index) if i not in exclude]
+            if bank is not None:
+                metrics = bank.score(
+                    query,
+                    active,
+                    window_frac,
+                    xcorr_max_lag_frac,
+                    xcorr_min_overlap_frac,
+                )
+            else:
+                metrics = score_references(
+                    query,
+                    [refs[pos] for pos in active],
+                    window_frac,
+                    xcorr_max_lag_frac,
+                    xcorr_min_overlap_frac,
+                    with_xcorr=xcorr_max_lag_frac is not None,
+                )
+            rows = [(index[pos], m.dtw, m.xcorr, m.lag) for pos, m in zip(active, metrics)]
+            conn.send(rows)
+        except Exception as e:
+            conn.send(e)
+    conn.close()
+
+
+class ScoringEngine:
+    # Scores queries against a fixed reference set, shared by classify,
+    # evaluate, build_model.py and live_classify.py. With one worker it runs
+    # in-process; with more, references are dealt round-robin to persistent
+    # worker processes that prepare their shard once and score every query
+    # against it in parallel. Results are merged back in reference order, so
+    # they are the same for any worker count. Processes rather than threads:
+    # the per-reference glue around the native kernels (and the pure-Python
+    # fallback) holds the GIL. Without xcorr fractions it scores DTW only.
+    # With fixed_point, references and queries are quantized to int16
+    # (q16_format, by default Q16Format.for_references()) and scored by the
+    # fixed-point kernel (Q16Bank) instead. A prefilter (EmbeddingIndex)
+    # narrows query_scores() to its shortlist unless asked for exact scores.
+    def __init__(
+        self,
+        refs: list[LabeledSequence],
+        query_len: int,
+        window_frac: float,
+        xcorr_max_lag_frac: float | None = None,
+        xcorr_min_overlap_frac: float | None = None,
+        workers: int = 0,
+        fixed_point: bool = False,
+        q16_format: Q16Format | None = None,
+        prefilter=None,
+    ) -> None:
+        self.refs = refs
+        self.prefilter = prefilter
+        self.window_frac = window_frac
+        self.xcorr_max_lag_frac = xcorr_max_lag_frac
+        self.xcorr_min_overlap_frac = xcorr_min_overlap_frac
+        self.workers = resolve_workers(workers, len(refs))
+        self.q16_format = (q16_format or Q16Format.for_references(refs)) if fixed_point else None
+        self.q16: Q16Bank | None = None
+        self._conns: list = []
+        self._procs: list = []
+        if self.workers == 1:
+            if self.q16_format is not None:
+                self.q16 = Q16Bank(refs, self.q16_format)
+            else:
+                prepare_references(refs, query_len, xcorr_max_lag_frac)
+            return
+        # Build the kernels here so the workers only load them.
+        if self.q16_format is not None:
+            load_q16_kernel()
+        else:
+            load_dtw_kernel()
+            load_xcorr_kernel()
+        ctx = multiprocessing.get_context()
+        for w in range(self.workers):
+            shard = [(i, refs[i].label, refs[i].path, refs[i].seq) for i in range(w, len(refs), self.workers)]
+            conn, child = ctx.Pipe()
+            proc = ctx.Process(
+                target=_score_worker,
+                args=(
+                    child,
+                    shard,
+                    query_len,
+                    window_frac,
+                    xcorr_max_lag_frac,
+                    xcorr_min_overlap_frac,
+                    self.q16_format,
+                ),
+                daemon=True,
+            )
+            proc.start()
+            child.close()
+            self._conns.append(conn)
+            self._procs.append(proc)
+        try:
+            for conn in self._conns:
+                conn.recv()
+        except EOFError:
+            self.close()
+            raise RuntimeError("scoring worker failed to start") from None
+
+    def __enter__(self) -> "ScoringEngine":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+    def close(self) -> None:
+        for conn in self._conns:
+            try:
+                conn.send(None)
+                conn.close()
+            except OSError:
+                pass
+        for proc in self._procs:
+            proc.join(timeout=1.0)
+            if proc.is_alive():
+                proc.terminate()
+        self._conns = []
+        self._procs = []
+
+    def score_row(
+        self,
+        query: list[tuple[float, ...]],
+        exclude: frozenset[int] = frozenset(),
+    ) -> dict[int, PairMetric]:
+        # score_references() over every reference not in exclude, keyed by
+        # reference index in ascending order.
+        if self.q16 is not None:
+            active = [i for i in range(len(self.refs)) if i not in exclude]
+            metrics = self.q16.score(
+                query,
+                active,
+                self.window_frac,
+                self.xcorr_max_lag_frac,
+                self.xcorr_min_overlap_frac,
+            )
+            return dict(zip(active, metrics))
+        if not self._conns:
+            active = [i for i in range(len(self.refs)) if i not in exclude]
+            metrics = score_references(
+                query,
+                [self.refs[i] for i in active],
+                self.window_frac,
+                self.xcorr_max_lag_frac,
+                self.xcorr_min_overlap_frac,
+                with_xcorr=self.xcorr_max_lag_frac is not None,
+            )
+            return dict(zip(active, metrics))
+        for conn in self._conns:
+            conn.send((query, exclude))
+        by_index: dict[int, PairMetric] = {}
+        error: BaseException | None = None
+        for conn in self._conns:
+            try:
+                reply = conn.recv()
+            except EOFError:
+                raise RuntimeError("scoring worker exited") from None
+            if isinstance(reply, BaseException):
+                error = reply
+                continue
+            for i, dtw, xcorr, lag in reply:
+                item = self.refs[i]
+                by_index[i] = PairMetric(label=item.label, path=item.path, dtw=dtw, xcorr=xcorr, lag=lag)
+        if error is not None:
+            raise error
+        return {i: by_index[i] for i in sorted(by_index)}
+
+    def pair_metrics(
+        self,
+        query: list[tuple[float, ...]],
+        per_label_k: int = 0,
+        exclude: frozenset[int] = frozenset(),
+    ) -> list[PairMetric]:
+        # compute_pair_metrics() over every reference not in exclude.
+        metrics = list(self.score_row(query, exclude).values())
+        if per_label_k > 0:
+            keep_label_topk(metrics, per_label_k)
+        metrics.sort(key=lambda x: x.dtw)
+        return metrics
+
+    def query_scores(
+        self,
+        query: list[tuple[float, ...]],
+        per_label_k: int,
+        score_mode: str,
+        hybrid_alpha: float,
+        exclude: frozenset[int] = frozenset(),
+        neighbors: int = 0,
+        exact: bool = False,
+    ) -> tuple[dict[str, float], dict[str, float], dict[str, float], list[PairMetric]]:
+        # compute_query_scores() through the engine. The first `neighbors`
+        # metrics are exact too (each label keeps that many), for printing.
+        # Without exact, a prefilter leaves only its shortlist (at least that
+        # many per label).
+        keep = max(1, per_label_k, neighbors)
+        if self.prefilter is not None and not exact:
+            exclude = exclude | self.prefilter.exclude(query, keep, exclude)
+        metrics = self.pair_metrics(query, per_label_k=keep, exclude=exclude)
+        return (*scores_from_metrics(metrics, per_label_k, score_mode, hybrid_alpha), metrics)
 
 
 def quantile(vals: list[float], q: float) -> float:
@@ -431,40 +1434,149 @@ def quantile(vals: list[float], q: float) -> float:
     return s[idx]
 
 
+@dataclass
+class PairMatrix:
+    # DTW and xcorr between every pair of references (flat, row-major, row =
+    # query; both are symmetric), for leave-one-out calibration. keys[i] is
+    # reference_key() of reference i.
+    keys: list[str]
+    dtw: array
+    xcorr: array
+    computed: int = 0  # pairs scored rather than taken from a cache
+
+
+def reference_key(item: LabeledSequence) -> str:
+    # Content hash of the prepared sequence, so cached pairs survive renames,
+    # reordering and added captures.
+    flat = array("d", (v for p in item.seq for v in p))
+    dims = len(item.seq[0]) if item.seq else 0
+    return hashlib.sha1(f"{len(item.seq)}x{dims}:".encode() + flat.tobytes()).hexdigest()
+
+
+def pair_params(engine: ScoringEngine) -> dict:
+    # Everything besides the two sequences that a cached pair depends on.
+    return {
+        "window_frac": engine.window_frac,
+        "xcorr_max_lag_frac": engine.xcorr_max_lag_frac,
+        "xcorr_min_overlap_frac": engine.xcorr_min_overlap_frac,
+        "native_dtw": load_dtw_kernel() is not None,
+        "byteorder": sys.byteorder,
+    }
+
+
+def build_pair_matrix(engine: ScoringEngine, cached: PairMatrix | None = None) -> PairMatrix:
+    # Pairs between references already in `cached` are copied; only rows of
+    # new references are scored (against everything, which also fills their
+    # columns).
+    refs = engine.refs
+    n = len(refs)
+    keys = [reference_key(x) for x in refs]
+    dtw = array("d", [0.0]) * (n * n)
+    xcorr = array("d", [0.0]) * (n * n)
+    old: dict[str, int] = {}
+    if cached is not None:
+        old = {k: i for i, k in enumerate(cached.keys)}
+        c = len(cached.keys)
+        old_idx = [old.get(k) for k in keys]
+        for i, oi in enumerate(old_idx):
+            if oi is None:
+                continue
+            for j, oj in enumerate(old_idx):
+                if oj is not None:
+                    dtw[i * n + j] = cached.dtw[oi * c + oj]
+                    xcorr[i * n + j] = cached.xcorr[oi * c + oj]
+    done: set[int] = set()
+    computed = 0
+    for i in range(n):
+        if keys[i] in old:
+            continue
+        row = engine.score_row(refs[i].seq, exclude=frozenset(done))
+        for j, m in row.items():
+            dtw[i * n + j] = dtw[j * n + i] = m.dtw
+            xcorr[i * n + j] = xcorr[j * n + i] = m.xcorr
+        computed += len(row)
+        done.add(i)
+    return PairMatrix(keys=keys, dtw=dtw, xcorr=xcorr, computed=computed)
+
+
+def save_pair_matrix(path: Path, pairs: PairMatrix, params: dict) -> None:
+    header = json.dumps({"params": params, "keys": pairs.keys}).encode("utf-8")
+    tmp = path.with_name(path.name + ".tmp")
+    with tmp.open("wb") as f:
+        f.write(struct.pack(PAIRS_HEADER_FMT, PAIRS_MAGIC, PAIRS_VERSION, len(header)))
+        f.write(header)
+        f.write(pairs.dtw.tobytes())
+        f.write(pairs.xcorr.tobytes())
+    tmp.replace(path)
+
+
+def load_pair_matrix(path: Path, params: dict) -> PairMatrix | None:
+    # None when missing, unreadable or built with other params.
+    try:
+        blob = path.read_bytes()
+        magic, version, header_len = struct.unpack_from(PAIRS_HEADER_FMT, blob)
+        if magic != PAIRS_MAGIC or version != PAIRS_VERSION:
+            return None
+        start = struct.calcsize(PAIRS_HEADER_FMT)
+        header = json.loads(blob[start : start + header_len].decode("utf-8"))
+    except (OSError, ValueError, struct.error):
+        return None
+    if header.get("params") != params:
+        return None
+    keys = header["keys"]
+    body = start + header_len
+    size = len(keys) * len(keys) * 8
+    if len(blob) != body + 2 * size:
+        return None
+    dtw = array("d")
+    dtw.frombytes(blob[body : body + size])
+    xcorr = array("d")
+    xcorr.frombytes(blob[body + size :])
+    return PairMatrix(keys=keys, dtw=dtw, xcorr=xcorr)
+
+
 def calibrate_label_thresholds(
-    refs: list[LabeledSequence],
-    window_frac: float,
+    engine: ScoringEngine,
     per_label_k: int,
     q: float,
     scale: float,
     score_mode: str,
     hybrid_alpha: float,
-    xcorr_max_lag_frac: float,
-    xcorr_min_overlap_frac: float,
+    pairs: PairMatrix | None = None,
+    queries: list[LabeledSequence] | None = None,
 ) -> dict[str, float]:
-    by_label: dict[str, list[LabeledSequence]] = defaultdict(list)
-    for item in refs:
-        by_label[item.label].append(item)
+    # Leave-one-out: every reference is scored against all the others, read
+    # from the pairwise matrix (built here unless given). A condensed set
+    # (prototypes.py) is calibrated on the captures it was built from
+    # instead: each of `queries` against the references, minus itself.
+    refs = engine.refs
+    by_label: dict[str, list[float]] = defaultdict(list)
+    if queries is not None:
+        for item in queries:
+            exclude = frozenset(j for j, x in enumerate(refs) if x.path == item.path)
+            label_scores = engine.query_scores(item.seq, per_label_k, score_mode, hybrid_alpha, exclude=exclude)[0]
+            if item.label in label_scores:
+                by_label[item.label].append(label_scores[item.label])
+    else:
+        if pairs is None:
+            pairs = build_pair_matrix(engine)
+        n = len(refs)
+        for i, item in enumerate(refs):
+            path = item.path
+            row = [
+                PairMetric(label=x.label, path=x.path, dtw=pairs.dtw[i * n + j], xcorr=pairs.xcorr[i * n + j], lag=0)
+                for j, x in enumerate(refs)
+                if x.path != path
+            ]
+            row.sort(key=lambda x: x.dtw)
+            label_scores, _dtw_scores, _xcorr_scores = scores_from_metrics(
+                row, per_label_k, score_mode, hybrid_alpha
+            )
+            if item.label in label_scores:
+                by_label[item.label].append(label_scores[item.label])
 
     thresholds: dict[str, float] = {}
-    for label, items in by_label.items():
-        scores: list[float] = []
-        for item in items:
-            pool = [x for x in refs if x.path != item.path]
-            label_scores, _dtw_scores, _xcorr_scores, _metrics = compute_query_scores(
-                item.seq,
-                pool,
-                window_frac=window_frac,
-                per_label_k=per_label_k,
-                score_mode=score_mode,
-                hybrid_alpha=hybrid_alpha,
-                xcorr_max_lag_frac=xcorr_max_lag_frac,
-                xcorr_min_overlap_frac=xcorr_min_overlap_frac,
-            )
-            if label in label_scores:
-                scores.append(label_scores[label])
-        if not scores:
-            continue
+    for label, scores in by_label.items():
         thresholds[label] = quantile(scores, q) * scale
     return thresholds
 
@@ -564,7 +1676,7 @@ def run_evaluate(args: argparse.Namespace) -> int:
         raise ValueError("no samples selected from manifest")
 
     items = load_labeled_sequences(
-        rows, max_points=args.max_points, use_znorm=not args.no_znorm
+        rows, max_points=args.max_points, use_znorm=not args.no_znorm, cache_path=seq_cache_path(args)
     )
     label_set = sorted({x.label for x in items})
     print(f"loaded {len(items)} samples, labels={label_set}")
@@ -574,12 +1686,31 @@ def run_evaluate(args: argparse.Namespace) -> int:
     train, test = split_stratified(items, test_ratio=args.test_ratio, seed=args.seed)
     print(f"train={len(train)} test={len(test)} k={args.k}")
 
-    y_true: list[str] = []
-    y_pred: list[str] = []
-    for item in test:
-        pred, _topk = classify_knn(item.seq, train, k=args.k, window_frac=args.window_frac)
-        y_true.append(item.label)
-        y_pred.append(pred)
+    y_true = [item.label for item in test]
+
+    def predict(fixed_point: bool) -> list[str]:
+        # k-NN needs every distance, so no per-label pruning; DTW only.
+        y_pred: list[str] = []
+        with ScoringEngine(
+            train,
+            query_len=args.max_points,
+            window_frac=args.window_frac,
+            workers=args.workers,
+            fixed_point=fixed_point,
+        ) as engine:
+            for item in test:
+                pairs = engine.pair_metrics(item.seq)
+                pred, _topk = knn_vote([(p.dtw, p.label, p.path) for p in pairs], k=args.k)
+                y_pred.append(pred)
+        return y_pred
+
+    y_pred = predict(args.fixed_point)
+    if args.fixed_point:
+        # Parity: the float path on the same split.
+        y_float = predict(False)
+        agree = sum(a == b for a, b in zip(y_pred, y_float)) / len(test) if test else 1.0
+        print(f"float_accuracy={metrics(y_true, y_float)['accuracy']:.4f}")
+        print(f"fixed_point_agreement={agree:.4f}")
 
     m = metrics(y_true, y_pred)
     print(f"accuracy={m['accuracy']:.4f}")
@@ -596,40 +1727,43 @@ def run_classify(args: argparse.Namespace) -> int:
         raise ValueError("no reference samples selected from manifest")
 
     references = load_labeled_sequences(
-        rows, max_points=args.max_points, use_znorm=not args.no_znorm
+        rows, max_points=args.max_points, use_znorm=not args.no_znorm, cache_path=seq_cache_path(args)
     )
-    thresholds = None
-    if not args.disable_reject:
-        thresholds = calibrate_label_thresholds(
-            references,
-            window_frac=args.window_frac,
-            per_label_k=args.per_label_k,
-            q=args.reject_quantile,
-            scale=args.reject_scale,
-            score_mode=args.score_mode,
-            hybrid_alpha=args.hybrid_alpha,
-            xcorr_max_lag_frac=args.xcorr_max_lag_frac,
-            xcorr_min_overlap_frac=args.xcorr_min_overlap_frac,
-        )
-
     query_path = args.csv.resolve()
-    train = [x for x in references if x.path.resolve() != query_path]
-    if not train:
+    exclude = frozenset(i for i, x in enumerate(references) if x.path.resolve() == query_path)
+    if len(exclude) == len(references):
         raise ValueError("no reference samples left after excluding query file")
 
     query_seq = prep_sequence(
         read_sequence(args.csv), max_points=args.max_points, use_znorm=not args.no_znorm
     )
-    label_scores, dtw_scores, xcorr_scores, pair_metrics = compute_query_scores(
-        query_seq,
-        train,
+    with ScoringEngine(
+        references,
+        query_len=args.max_points,
         window_frac=args.window_frac,
-        per_label_k=args.per_label_k,
-        score_mode=args.score_mode,
-        hybrid_alpha=args.hybrid_alpha,
         xcorr_max_lag_frac=args.xcorr_max_lag_frac,
         xcorr_min_overlap_frac=args.xcorr_min_overlap_frac,
-    )
+        workers=args.workers,
+        fixed_point=args.fixed_point,
+    ) as engine:
+        thresholds = None
+        if not args.disable_reject:
+            thresholds = calibrate_label_thresholds(
+                engine,
+                per_label_k=args.per_label_k,
+                q=args.reject_quantile,
+                scale=args.reject_scale,
+                score_mode=args.score_mode,
+                hybrid_alpha=args.hybrid_alpha,
+            )
+        label_scores, dtw_scores, xcorr_scores, pair_metrics = engine.query_scores(
+            query_seq,
+            per_label_k=args.per_label_k,
+            score_mode=args.score_mode,
+            hybrid_alpha=args.hybrid_alpha,
+            exclude=exclude,
+            neighbors=args.k,
+        )
     pred, reject_reason = predict_with_rejection(
         label_scores,
         thresholds=thresholds,
@@ -662,6 +1796,8 @@ def main() -> int:
         raise ValueError("--k must be > 0")
     if args.window_frac < 0:
         raise ValueError("--window-frac must be >= 0")
+    if args.workers < 0:
+        raise ValueError("--workers must be >= 0")
     if getattr(args, "per_label_k", 1) <= 0:
         raise ValueError("--per-label-k must be > 0")
     if getattr(args, "reject_margin", 0.0) < 0:
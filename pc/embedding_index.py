@@ -0,0 +1,344 @@
+#!/usr/bin/env python3
+# Embedding pre-filter in front of DTW (live_classify.py --prefilter-shortlist).
+# Every reference gets a fixed-length descriptor of its prepared
+# (downsampled, z-normalized) points: per-axis statistics, a PAA'd energy
+# envelope, coarse spectral bands (Haar octave energies) and per-axis PAA.
+# build_model.py stores them in the model. Each label's descriptors go in a
+# KD-tree, and a query is scored by DTW/xcorr only against the `shortlist`
+# nearest references of every label, so label scores still average
+# per_label_k neighbours from each label.
+import argparse
+import heapq
+import math
+import time
+from collections import defaultdict
+from collections.abc import Callable
+from dataclasses import dataclass
+from pathlib import Path
+
+from dtw_baseline import (
+    LabeledSequence,
+    ScoringEngine,
+    add_seq_cache_args,
+    load_labeled_sequences,
+    metrics,
+    read_manifest,
+    seq_cache_path,
+    split_stratified,
+)
+
+# Bump when embed_sequence() changes; models with another version are re-embedded at load.
+EMBED_VERSION = 1
+EMBED_SEGMENTS = 8
+EMBED_BANDS = 4
+# Per-group weights, applied after scaling each group to unit norm per
+# point: PAA tracks DTW most closely, so it counts double.
+EMBED_WEIGHTS = {"stats": 1.0, "envelope": 1.0, "bands": 1.0, "paa": 2.0}
+KD_LEAF_SIZE = 8
+
+
+def paa(values: list[float], segments: int) -> list[float]:
+    # Piecewise aggregate approximation: segment means (a short input
+    # repeats points).
+    n = len(values)
+    out = []
+    for s in range(segments):
+        lo = min(n - 1, s * n // segments)
+        hi = max(lo + 1, (s + 1) * n // segments)
+        out.append(math.fsum(values[lo:hi]) / (hi - lo))
+    return out
+
+
+def haar_bands(values: list[float], bands: int) -> list[float]:
+    # sqrt of each octave's share of the energy, highest octave first, from
+    # the detail coefficients of a Haar decomposition.
+    total = math.fsum(v * v for v in values)
+    out = []
+    x = values
+    for _ in range(bands):
+        if len(x) < 2 or total <= 0.0:
+            out.append(0.0)
+            continue
+        detail = math.fsum((x[i] - x[i + 1]) ** 2 for i in range(0, len(x) - 1, 2)) / 2.0
+        out.append(math.sqrt(detail / total))
+        x = [(x[i] + x[i + 1]) / math.sqrt(2.0) for i in range(0, len(x) - 1, 2)]
+    return out
+
+
+def embed_sequence(seq: list[tuple[float, ...]]) -> tuple[float, ...]:
+    # Fixed-length descriptor of prepared points: (4 + EMBED_BANDS +
+    # EMBED_SEGMENTS) x dims + EMBED_SEGMENTS values.
+    cols = [list(c) for c in zip(*seq)]
+    dims = len(cols)
+    stats: list[float] = []
+    bands: list[float] = []
+    shape: list[float] = []
+    for col in cols:
+        mean = math.fsum(col) / len(col)
+        std = math.sqrt(max(0.0, math.fsum(v * v for v in col) / len(col) - mean * mean))
+        stats.extend((mean, std, min(col), max(col)))
+        bands.extend(haar_bands(col, EMBED_BANDS))
+        shape.extend(paa(col, EMBED_SEGMENTS))
+    energy = [math.sqrt(math.fsum(v * v for v in p) / dims) for p in seq]
+    envelope = paa(energy, EMBED_SEGMENTS)
+    out: list[float] = []
+    for name, group, per in (
+        ("stats", stats, 4 * dims),
+        ("envelope", envelope, EMBED_SEGMENTS),
+        ("bands", bands, EMBED_BANDS * dims),
+        ("paa", shape, EMBED_SEGMENTS * dims),
+    ):
+        w = EMBED_WEIGHTS[name] / math.sqrt(per)
+        out.extend(v * w for v in group)
+    return tuple(out)
+
+
+class KDTree:
+    # Static KD-tree over points (equal-length tuples) tagged with ids;
+    # splits at the median of the widest axis. Leaves are scanned with
+    # math.dist.
+    def __init__(self, points: list[tuple[float, ...]], ids: list[int]) -> None:
+        self.points = points
+        self.ids = ids
+        # node: (axis, split, left, right) or (-1, leaf row indices)
+        self.nodes: list[tuple] = []
+        if points:
+            self._build(list(range(len(points))))
+
+    def _build(self, rows: list[int]) -> int:
+        node = len(self.nodes)
+        if len(rows) <= KD_LEAF_SIZE:
+            self.nodes.append((-1, rows))
+            return node
+        pts = self.points
+        dims = len(pts[rows[0]])
+        axis = max(range(dims), key=lambda d: max(pts[r][d] for r in rows) - min(pts[r][d] for r in rows))
+        rows.sort(key=lambda r: pts[r][axis])
+        mid = len(rows) // 2
+        self.nodes.append(None)
+        left = self._build(rows[:mid])
+        right = self._build(rows[mid:])
+        self.nodes[node] = (axis, pts[rows[mid]][axis], left, right)
+        return node
+
+    def nearest(self, q: tuple[float, ...], k: int, skip: frozenset[int] = frozenset()) -> list[tuple[float, int]]:
+        # The k nearest (distance, id) not in skip, nearest first.
+        if not self.nodes or k <= 0:
+            return []
+        heap: list[tuple[float, int]] = []  # (-distance, -id): worst on top
+        stack = [(0, 0.0)]
+        while stack:
+            node, bound = stack.pop()
+            if len(heap) == k and bound > -heap[0][0]:
+                continue
+            entry = self.nodes[node]
+            if entry[0] < 0:
+                for r in entry[1]:
+                    i = self.ids[r]
+                    if i in skip:
+                        continue
+                    item = (-math.dist(q, self.points[r]), -i)
+                    if len(heap) < k:
+                        heapq.heappush(heap, item)
+                    elif item > heap[0]:
+                        heapq.heapreplace(heap, item)
+                continue
+            axis, split, left, right = entry
+            diff = q[axis] - split
+            near, far = (left, right) if diff < 0 else (right, left)
+            # Far side last in, so the near side is searched first.
+            stack.append((far, max(bound, abs(diff))))
+            stack.append((near, bound))
+        return sorted((-d, -i) for d, i in heap)
+
+
+class EmbeddingIndex:
+    # Per-label KD-trees over reference embeddings. Stored embeddings
+    # (LabeledSequence.embedding, from the model) are used when `stored`
+    # says they match EMBED_VERSION; the rest are computed here.
+    def __init__(
+        self, refs: list[LabeledSequence], shortlist: int, exact_fallback: bool = False, stored: bool = True
+    ) -> None:
+        self.shortlist = shortlist
+        self.exact_fallback = exact_fallback
+        self.size = len(refs)
+        self.embedded = 0
+        by_label: dict[str, tuple[list, list]] = defaultdict(lambda: ([], []))
+        for i, item in enumerate(refs):
+            emb = item.embedding if stored else None
+            if emb is None:
+                emb = embed_sequence(item.seq)
+                self.embedded += 1
+            points, ids = by_label[item.label]
+            points.append(tuple(emb))
+            ids.append(i)
+        self.dims = len(next(iter(by_label.values()))[0][0]) if by_label else 0
+        self.trees = {label: KDTree(points, ids) for label, (points, ids) in by_label.items()}
+
+    def candidates(
+        self, query: list[tuple[float, ...]], per_label: int = 0, exclude: frozenset[int] = frozenset()
+    ) -> set[int]:
+        # Reference indices of every label's max(shortlist, per_label) nearest.
+        q = embed_sequence(query)
+        k = max(self.shortlist, per_label)
+        out: set[int] = set()
+        for tree in self.trees.values():
+            out.update(i for _d, i in tree.nearest(q, k, exclude))
+        return out
+
+    def exclude(
+        self, query: list[tuple[float, ...]], per_label: int = 0, exclude: frozenset[int] = frozenset()
+    ) -> frozenset[int]:
+        # ScoringEngine exclude set: everything outside the shortlist.
+        keep = self.candidates(query, per_label, exclude)
+        return frozenset(i for i in range(self.size) if i not in keep)
+
+
+@dataclass
+class PrefilterResult:
+    shortlist: int  # 0 = exact
+    refs_scored: float  # mean references scored per query
+    recall_k: float  # per-label true DTW top-k found in the shortlist
+    recall_1: float  # overall nearest reference found in the shortlist
+    agreement: float  # same best label as exact scoring
+    accuracy: float
+    query_ms: float
+
+
+def evaluate_prefilter(
+    train: list[LabeledSequence],
+    test: list[LabeledSequence],
+    shortlists: list[int],
+    per_label_k: int,
+    make_engine: Callable[[list[LabeledSequence]], ScoringEngine],
+    score_mode: str,
+    hybrid_alpha: float,
+) -> list[PrefilterResult]:
+    # Exact scoring of every test query against train, then through the
+    # pre-filter at each shortlist size: recall@k of the shortlist against
+    # full (unpruned) DTW, agreement, accuracy (best label, no reject gate)
+    # and mean query time.
+    truth_k: list[set[int]] = []
+    truth_1: list[int] = []
+    exact_pred: list[str] = []
+    results: list[PrefilterResult] = []
+    y_true = [x.label for x in test]
+    with make_engine(train) as engine:
+        for item in test:
+            row = engine.score_row(item.seq)
+            by_label: dict[str, list[tuple[float, int]]] = defaultdict(list)
+            for i, m in row.items():
+                by_label[m.label].append((m.dtw, i))
+            truth_k.append({i for rows in by_label.values() for _d, i in sorted(rows)[:per_label_k]})
+            truth_1.append(min((m.dtw, i) for i, m in row.items())[1])
+        t0 = time.perf_counter()
+        for item in test:
+            scores = engine.query_scores(item.seq, per_label_k, score_mode, hybrid_alpha)[0]
+            exact_pred.append(min(scores, key=scores.get))
+        exact_ms = (time.perf_counter() - t0) * 1000 / max(1, len(test))
+        results.append(
+            PrefilterResult(0, len(train), 1.0, 1.0, 1.0, metrics(y_true, exact_pred)["accuracy"], exact_ms)
+        )
+        index = EmbeddingIndex(train, 0)
+        engine.prefilter = index
+        for size in shortlists:
+            index.shortlist = size
+            hit_k = hit_1 = agree = scored = 0
+            y_pred = []
+            t0 = time.perf_counter()
+            for item, want in zip(test, exact_pred):
+                scores = engine.query_scores(item.seq, per_label_k, score_mode, hybrid_alpha)[0]
+                y_pred.append(min(scores, key=scores.get))
+                agree += y_pred[-1] == want
+            elapsed = time.perf_counter() - t0
+            for item, tk, t1 in zip(test, truth_k, truth_1):
+                cand = index.candidates(item.seq, per_label_k)
+                scored += len(cand)
+                hit_k += len(tk & cand)
+                hit_1 += t1 in cand
+            results.append(
+                PrefilterResult(
+                    size,
+                    scored / max(1, len(test)),
+                    hit_k / max(1, sum(len(x) for x in truth_k)),
+                    hit_1 / max(1, len(test)),
+                    agree / max(1, len(test)),
+                    metrics(y_true, y_pred)["accuracy"],
+                    elapsed * 1000 / max(1, len(test)),
+                )
+            )
+    return results
+
+
+def format_prefilter(results: list[PrefilterResult], per_label_k: int) -> list[str]:
+    exact = results[0]
+    lines = [f"exact refs={exact.refs_scored:.0f} accuracy={exact.accuracy:.4f} query_ms={exact.query_ms:.2f}"]
+    for r in results[1:]:
+        lines.append(
+            f"shortlist={r.shortlist} refs_scored={r.refs_scored:.1f} recall@{per_label_k}={r.recall_k:.4f} "
+            f"recall@1={r.recall_1:.4f} agreement={r.agreement:.4f} accuracy={r.accuracy:.4f} "
+            f"query_ms={r.query_ms:.2f} speedup={exact.query_ms / max(r.query_ms, 1e-9):.1f}x"
+        )
+    return lines
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Recall@k and speed of the embedding pre-filter against full DTW on a stratified split."
+    )
+    parser.add_argument("--manifest", type=Path, default=Path("data/labels/manifest.jsonl"))
+    parser.add_argument("--session", default="", help="Optional session_id filter")
+    parser.add_argument("--labels", default="", help="Optional comma-separated label filter")
+    parser.add_argument(
+        "--shortlists",
+        default="2,4,8,16",
+        help="Comma-separated shortlist sizes per label to try (raised to --per-label-k)",
+    )
+    parser.add_argument("--test-ratio", type=float, default=0.3)
+    parser.add_argument("--seed", type=int, default=7)
+    parser.add_argument("--max-points", type=int, default=180)
+    parser.add_argument("--no-znorm", action="store_true")
+    add_seq_cache_args(parser)
+    parser.add_argument("--window-frac", type=float, default=0.2)
+    parser.add_argument("--per-label-k", type=int, default=3)
+    parser.add_argument("--score-mode", choices=("dtw", "hybrid", "xcorr"), default="hybrid")
+    parser.add_argument("--hybrid-alpha", type=float, default=0.35)
+    parser.add_argument("--xcorr-max-lag-frac", type=float, default=0.15)
+    parser.add_argument("--xcorr-min-overlap-frac", type=float, default=0.50)
+    parser.add_argument("--workers", type=int, default=0)
+    return parser.parse_args()
+
+
+def main() -> int:
+    args = parse_args()
+    labels = {x.strip().lower() for x in args.labels.split(",") if x.strip()}
+    rows = read_manifest(args.manifest, session=args.session, labels=labels)
+    if not rows:
+        raise ValueError("no samples selected from manifest")
+    items = load_labeled_sequences(
+        rows, max_points=args.max_points, use_znorm=not args.no_znorm, cache_path=seq_cache_path(args)
+    )
+    train, test = split_stratified(items, test_ratio=args.test_ratio, seed=args.seed)
+    print(f"train={len(train)} test={len(test)} labels={sorted({x.label for x in items})}")
+
+    def make_engine(refs: list[LabeledSequence]) -> ScoringEngine:
+        return ScoringEngine(
+            refs,
+            query_len=args.max_points,
+            window_frac=args.window_frac,
+            xcorr_max_lag_frac=args.xcorr_max_lag_frac,
+            xcorr_min_overlap_frac=args.xcorr_min_overlap_frac,
+            workers=args.workers,
+        )
+
+    shortlists = [int(x) for x in args.shortlists.split(",") if x.strip()]
+    results = evaluate_prefilter(
+        train, test, shortlists, args.per_label_k, make_engine, args.score_mode, args.hybrid_alpha
+    )
+    for line in format_prefilter(results, args.per_label_k):
+        print(line)
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
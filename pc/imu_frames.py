@@ -0,0 +1,345 @@
+#!/usr/bin/env python3
+# Decoders for firmware IMU UDP frames (legacy <q6h>, batched IMU2 and compressed IMZ1).
+import csv
+import ctypes
+import socket
+import struct
+import time
+from collections import deque
+from pathlib import Path
+
+from native_lib import ImuSample, load_imu_codec
+
+# Legacy frame: <q6h (little endian) -> ts_us, ax, ay, az, gx, gy, gz
+LEGACY_FMT = "<q6h"
+LEGACY_SIZE = struct.calcsize(LEGACY_FMT)
+
+# Batched frame: "IMU2" + uint32 seq + int64 base_ts_us + uint16 count + uint16 flags,
+# then count x (uint32 dt_us + 6x int16).
+BATCH_MAGIC = b"IMU2"
+BATCH_HEADER_FMT = "<4sIqHH"
+BATCH_HEADER_SIZE = struct.calcsize(BATCH_HEADER_FMT)
+BATCH_SAMPLE_FMT = "<I6h"
+BATCH_SAMPLE_SIZE = struct.calcsize(BATCH_SAMPLE_FMT)
+
+# Compressed frame: "IMZ1" + uint32 seq + uint16 count + uint16 flags, then one
+# imu_codec block (firmware/main/imu_codec.c).
+COMPRESSED_MAGIC = b"IMZ1"
+COMPRESSED_HEADER_FMT = "<4sIHH"
+COMPRESSED_HEADER_SIZE = struct.calcsize(COMPRESSED_HEADER_FMT)
+
+# Heartbeat: "HB01" + int64 ts_us, or "HB02" + int64 ts_us + uint16 sample_rate_hz + uint16 caps.
+HEARTBEAT_V1_MAGIC = b"HB01"
+HEARTBEAT_V2_MAGIC = b"HB02"
+HEARTBEAT_V2_FMT = "<4sqHH"
+HEARTBEAT_V2_SIZE = struct.calcsize(HEARTBEAT_V2_FMT)
+HEARTBEAT_CAP_AUDIO_ADPCM = 1 << 0
+
+# Motion-triggered streaming (CONFIG_ACTION_MOTION_TRIGGER):
+#   "SEGS" + uint32 segment_id + int64 trigger_ts_us + uint16 pre_samples + uint16 reserved
+#   "SEGE" + uint32 segment_id + int64 end_ts_us + uint32 sample_count + uint16 reason + uint16 reserved
+#   "IDL1" + int64 ts_us + uint32 sample_count + uint16 peak_gyro_norm + 3x int16 mean accel
+SEGMENT_START_FMT = "<4sIqHH"
+SEGMENT_START_SIZE = struct.calcsize(SEGMENT_START_FMT)
+SEGMENT_END_FMT = "<4sIqIHH"
+SEGMENT_END_SIZE = struct.calcsize(SEGMENT_END_FMT)
+IDLE_SUMMARY_FMT = "<4sqIH3h"
+IDLE_SUMMARY_SIZE = struct.calcsize(IDLE_SUMMARY_FMT)
+SEGMENT_END_REASONS = {0: "quiet", 1: "max_len"}
+
+Sample = tuple[int, int, int, int, int, int, int]
+
+
+def _read_varint(buf: bytes, pos: int) -> tuple[int, int]:
+    out = 0
+    shift = 0
+    while True:
+        b = buf[pos]
+        pos += 1
+        out |= (b & 0x7F) << shift
+        if b < 0x80:
+            return out, pos
+        shift += 7
+
+
+def _unzigzag(v: int) -> int:
+    return (v >> 1) ^ -(v & 1)
+
+
+def _wrap16(v: int) -> int:
+    return ((v + 0x8000) & 0xFFFF) - 0x8000
+
+
+def decode_codec_block_py(block: bytes, count: int) -> list[Sample]:
+    out: list[Sample] = []
+    pos = 0
+    prev_dt = 0
+    try:
+        for i in range(count):
+            vals = []
+            for _ in range(7):
+                v, pos = _read_varint(block, pos)
+                vals.append(_unzigzag(v))
+            if i == 0:
+                out.append(tuple(vals))
+                continue
+            p = out[-1]
+            prev_dt += vals[0]
+            out.append(
+                (p[0] + prev_dt,)
+                + tuple(_wrap16(p[k] + vals[k]) for k in range(1, 7))
+            )
+    except IndexError:
+        pass
+    return out
+
+
+def decode_codec_block(block: bytes, count: int) -> list[Sample]:
+    lib = load_imu_codec()
+    if lib is None:
+        return decode_codec_block_py(block, count)
+    out = (ImuSample * count)()
+    n = lib.imu_codec_decode_block(block, len(block), count, out, count)
+    return [(s.ts_us, s.ax, s.ay, s.az, s.gx, s.gy, s.gz) for s in out[:n]]
+
+
+def encode_codec_blocks(samples: list[Sample], block_len: int) -> bytes | None:
+    # Host-side encoder (native only), used for benchmarks and tooling.
+    lib = load_imu_codec()
+    if lib is None:
+        return None
+    arr = (ImuSample * len(samples))(*samples)
+    cap = len(samples) * 28 + 16
+    out = ctypes.create_string_buffer(cap)
+    n = lib.imu_codec_encode_blocks(arr, len(samples), block_len, out, cap)
+    return out.raw[:n]
+
+
+def decode_packet(data: bytes) -> tuple[int | None, list[Sample]]:
+    # Returns (frame_seq, samples); frame_seq is None for legacy frames.
+    if len(data) > COMPRESSED_HEADER_SIZE and data[:4] == COMPRESSED_MAGIC:
+        _magic, seq, count, _flags = struct.unpack_from(COMPRESSED_HEADER_FMT, data, 0)
+        samples = decode_codec_block(data[COMPRESSED_HEADER_SIZE:], count)
+        if len(samples) != count:
+            return None, []
+        return seq, samples
+    if len(data) >= BATCH_HEADER_SIZE and data[:4] == BATCH_MAGIC:
+        _magic, seq, base_ts_us, count, _flags = struct.unpack_from(BATCH_HEADER_FMT, data, 0)
+        if len(data) != BATCH_HEADER_SIZE + count * BATCH_SAMPLE_SIZE:
+            return None, []
+        samples: list[Sample] = []
+        for dt_us, ax, ay, az, gx, gy, gz in struct.iter_unpack(
+            BATCH_SAMPLE_FMT, data[BATCH_HEADER_SIZE:]
+        ):
+            samples.append((base_ts_us + dt_us, ax, ay, az, gx, gy, gz))
+        return seq, samples
+    if len(data) == LEGACY_SIZE:
+        return None, [struct.unpack(LEGACY_FMT, data)]
+    return None, []
+
+
+def read_raw_csv(path: Path) -> list[Sample]:
+    # Reads a capture_labeled.py / udp_receiver.py CSV back as raw samples.
+    out: list[Sample] = []
+    with path.open("r", encoding="utf-8") as f:
+        for row in csv.DictReader(f):
+            out.append(
+                (
+                    int(row["ts_us"]),
+                    int(row["ax"]),
+                    int(row["ay"]),
+                    int(row["az"]),
+                    int(row["gx"]),
+                    int(row["gy"]),
+                    int(row["gz"]),
+                )
+            )
+    return out
+
+
+def decode_heartbeat(data: bytes) -> tuple[int, int | None, int] | None:
+    # Returns (ts_us, sample_rate_hz, caps) or None if data is not a heartbeat.
+    if len(data) == HEARTBEAT_V2_SIZE and data[:4] == HEARTBEAT_V2_MAGIC:
+        _magic, ts_us, rate_hz, caps = struct.unpack(HEARTBEAT_V2_FMT, data)
+        return ts_us, (rate_hz if rate_hz > 0 else None), caps
+    if len(data) == 12 and data[:4] == HEARTBEAT_V1_MAGIC:
+        (ts_us,) = struct.unpack_from("<q", data, 4)
+        return ts_us, None, 0
+    return None
+
+
+def decode_segment_marker(data: bytes) -> tuple[str, int, int, int] | None:
+    # Returns ("start", segment_id, trigger_ts_us, pre_samples) or
+    # ("end", segment_id, end_ts_us, sample_count); None if not a marker.
+    if len(data) == SEGMENT_START_SIZE and data[:4] == b"SEGS":
+        _magic, seg_id, ts_us, pre, _reserved = struct.unpack(SEGMENT_START_FMT, data)
+        return "start", seg_id, ts_us, pre
+    if len(data) == SEGMENT_END_SIZE and data[:4] == b"SEGE":
+        _magic, seg_id, ts_us, count, _reason, _reserved = struct.unpack(SEGMENT_END_FMT, data)
+        return "end", seg_id, ts_us, count
+    return None
+
+
+def decode_idle_summary(data: bytes) -> tuple[int, int, int, tuple[int, int, int]] | None:
+    # Returns (ts_us, sample_count, peak_gyro_norm, mean_accel).
+    if len(data) == IDLE_SUMMARY_SIZE and data[:4] == b"IDL1":
+        _magic, ts_us, count, peak, ax, ay, az = struct.unpack(IDLE_SUMMARY_FMT, data)
+        return ts_us, count, peak, (ax, ay, az)
+    return None
+
+
+# Counts lost/reordered IMU2 frames from uint32 sequence gaps.
+class SequenceTracker:
+    def __init__(self) -> None:
+        self.expected: int | None = None
+        self.frames = 0
+        self.lost = 0
+        self.late = 0
+
+    def update(self, seq: int) -> int:
+        # Returns the number of frames lost just before this one.
+        self.frames += 1
+        if self.expected is None:
+            self.expected = (seq + 1) & 0xFFFFFFFF
+            return 0
+        delta = (seq - self.expected) & 0xFFFFFFFF
+        if delta >= 0x80000000:
+            # Older than expected: duplicate or reordered frame.
+            self.late += 1
+            return 0
+        self.lost += delta
+        self.expected = (seq + 1) & 0xFFFFFFFF
+        return delta
+
+    def reset(self) -> None:
+        self.expected = None
+
+
+# Sample-at-a-time reader over a UDP socket carrying either frame format.
+class ImuStream:
+    def __init__(self, sock: socket.socket) -> None:
+        self.sock = sock
+        self.pending: deque[Sample] = deque()
+        self.tracker = SequenceTracker()
+        self.src_ip: str | None = None
+        self.frame_format: str | None = None
+        self.advertised_hz: int | None = None
+        self.device_caps = 0
+        self.recent_ts: deque[int] = deque(maxlen=256)
+        self.measured_hz: float | None = None
+        self.last_marker: tuple[str, int, int, int] | None = None
+        self.last_idle: tuple[int, int, int, tuple[int, int, int]] | None = None
+
+    def _recv_datagram(self) -> bool:
+        # Returns False on socket timeout.
+        try:
+            data, addr = self.sock.recvfrom(2048)
+        except socket.timeout:
+            return False
+        self.handle_datagram(data, addr)
+        return True
+
+    def handle_datagram(self, data: bytes, addr: tuple[str, int]) -> None:
+        # Handles one datagram: samples go to pending, a segment marker to last_marker.
+        hb = decode_heartbeat(data)
+        if hb is not None:
+            if hb[1] is not None:
+                self.advertised_hz = hb[1]
+            self.device_caps = hb[2]
+            return
+        marker = decode_segment_marker(data)
+        if marker is not None:
+            self.src_ip = addr[0]
+            self.last_marker = marker
+            return
+        idle = decode_idle_summary(data)
+        if idle is not None:
+            self.src_ip = addr[0]
+            self.last_idle = idle
+            return
+        seq, samples = decode_packet(data)
+        if not samples:
+            return
+        self.note_frame(addr[0], LEGACY_FMT if seq is None else data[:4].decode("ascii"), seq)
+        self.pending.extend(samples)
+        self.recent_ts.extend(x[0] for x in samples)
+
+    def note_frame(self, src_ip: str, frame_format: str, seq: int | None) -> None:
+        # Bookkeeping for one decoded sample frame; imu_ingest.py calls this for
+        # frames its native receiver decoded.
+        self.src_ip = src_ip
+        self.frame_format = frame_format
+        if seq is not None:
+            lost = self.tracker.update(seq)
+            if lost > 0:
+                print(f"udp_frames_lost={lost} total_lost={self.tracker.lost}")
+
+    def recv_sample(self) -> Sample | None:
+        while not self.pending:
+            if not self._recv_datagram():
+                return None
+        return self.pending.popleft()
+
+    def recv_segment(self, max_wait_sec: float) -> list[Sample] | None:
+        # Collects one firmware-delimited action segment (SEGS ... SEGE).
+        # Returns None if none completes within max_wait_sec (0 = wait forever).
+        deadline = time.monotonic() + max_wait_sec if max_wait_sec > 0 else float("inf")
+        seg_id: int | None = None
+        samples: list[Sample] = []
+        while time.monotonic() < deadline:
+            self.last_marker = None
+            if not self._recv_datagram():
+                continue
+            marker = self.last_marker
+            if marker is None:
+                if seg_id is not None:
+                    samples.extend(self.pending)
+                self.pending.clear()
+                continue
+            kind, marker_id, _ts_us, count = marker
+            if kind == "start":
+                seg_id = marker_id
+                samples = []
+                self.pending.clear()
+            elif seg_id == marker_id:
+                if len(samples) != count:
+                    print(f"segment {marker_id}: received {len(samples)}/{count} samples")
+                return samples
+        return None
+
+    def update_measured_rate(self) -> None:
+        if len(self.recent_ts) < 16:
+            return
+        span_us = self.recent_ts[-1] - self.recent_ts[0]
+        if span_us > 0:
+            self.measured_hz = (len(self.recent_ts) - 1) * 1_000_000 / span_us
+
+    @property
+    def rate_hz(self) -> float | None:
+        # Device-advertised rate when known, otherwise measured from timestamps.
+        if self.advertised_hz:
+            return float(self.advertised_hz)
+        self.update_measured_rate()
+        return self.measured_hz
+
+    def drain(self, max_packets: int) -> int:
+        drained = len(self.pending)
+        self.pending.clear()
+        # Keep the last estimate; the drained gap would skew the timestamp window.
+        self.update_measured_rate()
+        self.recent_ts.clear()
+        old_timeout = self.sock.gettimeout()
+        self.sock.setblocking(False)
+        try:
+            while drained < max_packets:
+                try:
+                    self.sock.recvfrom(2048)
+                    drained += 1
+                except BlockingIOError:
+                    break
+        finally:
+            self.sock.setblocking(True)
+            self.sock.settimeout(old_timeout)
+        # Drained frames are intentional gaps, not loss.
+        self.tracker.reset()
+        return drained
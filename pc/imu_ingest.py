@@ -0,0 +1,579 @@
+#!/usr/bin/env python3
+# Background UDP ingest shared by live_classify.py and capture_labeled.py.
+# A receiver thread takes datagrams in batches (udp_ingest_recv() in
+# native/udp_ingest.c: recvmmsg plus decode; without the native helper, a
+# non-blocking recvfrom loop through ImuStream). Every source IP is one
+# device (DeviceFeed) with its own frame state and a preallocated SampleRing
+# of its samples, stamped with their arrival time. Consumers hold their own
+# RingReader cursor on a device, so nothing is lost while they are busy
+# scoring, and read windows of the ring in place: by position (trigger
+# pre-history, device segments) or by device timestamp.
+#
+# A ring keeps ring_sec of samples at the expected rate. A reader that falls
+# further behind than that skips ahead to the oldest sample still held and
+# counts the skipped samples in overruns.
+import bisect
+import ctypes
+import os
+import select
+import socket
+import struct
+import sys
+import threading
+import time
+from collections import deque
+from dataclasses import dataclass
+
+from imu_frames import LEGACY_FMT, ImuStream, Sample, SequenceTracker
+from native_lib import load_udp_ingest
+
+RING_SECONDS = 120.0
+BATCH_MSGS = 64
+SLOT_BYTES = 2048
+POLL_SEC = 0.1
+# Kernel buffer asked for without the native helper, whose per-datagram cost
+# is several times higher (capped by net.core.rmem_max).
+PY_RCVBUF = 4 << 20
+# Most samples one datagram can carry: IMZ1 spends at least 7 bytes on each.
+MAX_DATAGRAM_SAMPLES = (SLOT_BYTES - 12) // 7 + 1
+RATE_WINDOW = 256
+MAX_DEVICES = 64
+
+# Datagram kinds reported by udp_ingest_recv().
+KIND_CONTROL = 0
+KIND_BAD = 4
+KIND_OVERFLOW = 5
+KIND_FORMATS = {1: LEGACY_FMT, 2: "IMU2", 3: "IMZ1"}
+
+
+class _IngestSample(ctypes.Structure):
+    # Mirrors ingest_sample_t in native/udp_ingest.c.
+    _fields_ = [
+        ("ts_us", ctypes.c_int64),
+        ("axes", ctypes.c_int16 * 6),
+        ("reserved", ctypes.c_int16 * 2),
+        ("arrival_ns", ctypes.c_int64),
+    ]
+
+
+class _IngestMsg(ctypes.Structure):
+    # Mirrors ingest_msg_t in native/udp_ingest.c.
+    _fields_ = [
+        ("len", ctypes.c_uint32),
+        ("addr", ctypes.c_uint32),
+        ("port", ctypes.c_uint16),
+        ("kind", ctypes.c_uint16),
+        ("seq", ctypes.c_uint32),
+        ("samples", ctypes.c_uint32),
+        ("reserved", ctypes.c_uint32),
+        ("ring_pos", ctypes.c_uint64),
+    ]
+
+
+# ingest_msg_t as bytes.
+_MSG = struct.Struct("<IIHHIIIQ")
+
+
+def _bytes(arr: ctypes.Array) -> memoryview:
+    # Byte view of a ctypes buffer: rows and payloads are copied by slicing,
+    # without a foreign call (and GIL hand-off) per datagram.
+    return memoryview((ctypes.c_ubyte * ctypes.sizeof(arr)).from_buffer(arr)).cast("B")
+
+# Byte views of one ring slot.
+_ROW = struct.Struct("<q6h4xq")
+_SAMPLE = struct.Struct("<q6h")
+_TS = struct.Struct("<q")
+_ARRIVAL_OFF = 24
+ROW_BYTES = ctypes.sizeof(_IngestSample)
+
+
+class SampleRing:
+    # Samples ever written are numbered from 0 (positions); slot = pos & mask.
+    # One writer; head is published after the samples below it are in place.
+    # The guard slots past the oldest readable position are what one append
+    # may overwrite before head moves, so readers never see a half write.
+    def __init__(self, capacity: int, guard: int) -> None:
+        size = 1
+        while size < capacity + guard:
+            size *= 2
+        self.size = size
+        self.mask = size - 1
+        self.guard = guard
+        self.buf = (_IngestSample * size)()
+        self.bytes = _bytes(self.buf)
+        self.head = 0
+
+    def oldest(self) -> int:
+        return max(0, self.head - (self.size - self.guard))
+
+    def sample(self, pos: int) -> Sample:
+        return _SAMPLE.unpack_from(self.buf, (pos & self.mask) * ROW_BYTES)
+
+    def ts_us(self, pos: int) -> int:
+        return _TS.unpack_from(self.buf, (pos & self.mask) * ROW_BYTES)[0]
+
+    def arrival_ns(self, pos: int) -> int:
+        return _TS.unpack_from(self.buf, (pos & self.mask) * ROW_BYTES + _ARRIVAL_OFF)[0]
+
+    def write(self, samples: list[Sample], arrival_ns: int) -> None:
+        # Python writer: appends at head, then publishes.
+        pos = self.head
+        for i, s in enumerate(samples):
+            _ROW.pack_into(self.buf, ((pos + i) & self.mask) * ROW_BYTES, *s, arrival_ns)
+        self.head = pos + len(samples)
+
+    def copy_rows(self, src: memoryview, first: int, count: int) -> None:
+        # Appends src rows [first, first + count) (a native receive's
+        # staging rows, as bytes), then publishes.
+        pos = self.head
+        done = 0
+        while done < count:
+            slot = (pos + done) & self.mask
+            n = min(count - done, self.size - slot)
+            at = (first + done) * ROW_BYTES
+            self.bytes[slot * ROW_BYTES : (slot + n) * ROW_BYTES] = src[at : at + n * ROW_BYTES]
+            done += n
+        self.head = pos + count
+
+    def find_ts(self, ts_us: int, lo: int, hi: int) -> int:
+        # First position in [lo, hi) with ts >= ts_us; device timestamps of
+        # one stream only go forward, apart from rare reordered frames.
+        return bisect.bisect_left(range(lo, hi), ts_us, key=self.ts_us) + lo
+
+    def measured_hz(self) -> float | None:
+        hi = self.head
+        lo = max(self.oldest(), hi - RATE_WINDOW)
+        if hi - lo < 16:
+            return None
+        span_us = self.ts_us(hi - 1) - self.ts_us(lo)
+        return (hi - 1 - lo) * 1_000_000 / span_us if span_us > 0 else None
+
+
+class RingWindow:
+    # Positions [lo, hi) of a ring, read in place. Valid while intact(): a
+    # window older than the ring's capacity has been overwritten.
+    def __init__(self, ring: SampleRing, lo: int, hi: int) -> None:
+        self.ring = ring
+        self.lo = lo
+        self.hi = max(lo, hi)
+
+    def __len__(self) -> int:
+        return self.hi - self.lo
+
+    def __getitem__(self, i: int) -> Sample:
+        if i < 0:
+            i += len(self)
+        if not 0 <= i < len(self):
+            raise IndexError("ring window index out of range")
+        return self.ring.sample(self.lo + i)
+
+    def __iter__(self):
+        sample = self.ring.sample
+        for pos in range(self.lo, self.hi):
+            yield sample(pos)
+
+    def intact(self) -> bool:
+        return self.lo >= self.ring.oldest()
+
+    def arrival_ns(self, i: int) -> int:
+        return self.ring.arrival_ns(self.lo + i)
+
+
+@dataclass
+class IngestStats:
+    datagrams: int = 0
+    batches: int = 0
+    samples: int = 0
+    bad: int = 0
+    overflow: int = 0
+    ignored: int = 0  # datagrams from sources past max_devices
+
+
+class DeviceFeed:
+    # One board, keyed by source IP. Frame bookkeeping (format, heartbeat
+    # rate/caps, IMU2 sequence gaps, idle summaries) lives in an ImuStream
+    # that only ever handles datagrams.
+    def __init__(self, ip: str, sock: socket.socket, capacity: int) -> None:
+        self.ip = ip
+        self.frames = ImuStream(sock)
+        self.ring = SampleRing(capacity, MAX_DATAGRAM_SAMPLES)
+        # (kind, segment_id, ts_us, count, ring position) of segment markers;
+        # marker_count numbers them like ring positions.
+        self.markers: deque[tuple[str, int, int, int, int]] = deque(maxlen=1024)
+        self.marker_count = 0
+        self.datagrams = 0
+
+    def add_marker(self) -> None:
+        # Records frames.last_marker at the current ring position.
+        if self.frames.last_marker is not None:
+            kind, seg_id, ts_us, count = self.frames.last_marker
+            self.markers.append((kind, seg_id, ts_us, count, self.ring.head))
+            self.marker_count += 1
+            self.frames.last_marker = None
+
+
+class ImuIngest:
+    # Owns the socket's receive side; start() launches the receiver thread.
+    # Devices appear in `order` as they are first heard from.
+    def __init__(
+        self,
+        sock: socket.socket,
+        ring_sec: float = RING_SECONDS,
+        expected_hz: float = 200.0,
+        native: bool = True,
+        max_devices: int = MAX_DEVICES,
+    ) -> None:
+        self.sock = sock
+        self.capacity = int(ring_sec * expected_hz)
+        self.max_devices = max_devices
+        self.devices: dict[str, DeviceFeed] = {}
+        self.order: list[DeviceFeed] = []
+        self.lib = load_udp_ingest() if native else None
+        self.cond = threading.Condition()
+        # Bumped once per receive that delivered anything.
+        self.published = 0
+        self.stats = IngestStats()
+        self.error: BaseException | None = None
+        self._stop = threading.Event()
+        # Native receives: device by source address (network byte order).
+        self._feeds: dict[int, DeviceFeed] = {}
+        if self.lib is not None:
+            # Native receives decode here, then rows are copied to their device.
+            staging = 1
+            while staging < BATCH_MSGS * MAX_DATAGRAM_SAMPLES:
+                staging *= 2
+            self._staging = (_IngestSample * staging)()
+            self._bufs = ctypes.create_string_buffer(BATCH_MSGS * SLOT_BYTES)
+            self._msgs = (_IngestMsg * BATCH_MSGS)()
+            self._staging_bytes = _bytes(self._staging)
+            self._bufs_bytes = _bytes(self._bufs)
+            self._msgs_bytes = _bytes(self._msgs)
+        else:
+            if sock.getsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF) < PY_RCVBUF:
+                sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, PY_RCVBUF)
+            sock.setblocking(False)
+        self._thread = threading.Thread(target=self._run, name="imu-ingest", daemon=True)
+
+    def start(self) -> "ImuIngest":
+        self._thread.start()
+        return self
+
+    def close(self) -> None:
+        self._stop.set()
+        self._thread.join(timeout=2 * POLL_SEC + 1.0)
+
+    def reader(self, ip: str | None = None) -> "RingReader":
+        return RingReader(self, ip)
+
+    @property
+    def native(self) -> bool:
+        return self.lib is not None
+
+    def wait(self, seen: int, timeout_sec: float) -> int:
+        # Blocks until something newer than `seen` (a published count) arrives.
+        with self.cond:
+            self.cond.wait_for(lambda: self.published != seen or self.error is not None, timeout_sec)
+        if self.error is not None:
+            raise RuntimeError("imu ingest thread failed") from self.error
+        return self.published
+
+    def _device(self, ip: str) -> DeviceFeed | None:
+        dev = self.devices.get(ip)
+        if dev is None:
+            if len(self.devices) >= self.max_devices:
+                self.stats.ignored += 1
+                return None
+            dev = DeviceFeed(ip, self.sock, self.capacity)
+            self.devices[ip] = dev
+            self.order.append(dev)
+        return dev
+
+    def _run(self) -> None:
+        try:
+            recv = self._recv_native if self.lib is not None else self._recv_py
+            while not self._stop.is_set():
+                if recv():
+                    with self.cond:
+                        self.published += 1
+                        self.cond.notify_all()
+        except BaseException as e:
+            self.error = e
+            with self.cond:
+                self.cond.notify_all()
+
+    def _recv_native(self) -> bool:
+        n = self.lib.udp_ingest_recv(
+            self.sock.fileno(),
+            int(POLL_SEC * 1000),
+            self._bufs,
+            SLOT_BYTES,
+            BATCH_MSGS,
+            self._msgs,
+            self._staging,
+            len(self._staging),
+            0,
+            len(self._staging),
+        )
+        if n < 0:
+            raise OSError(-n, os.strerror(-n))
+        if n == 0:
+            return False
+        # Rows of consecutive frames from one device are contiguous in the
+        # staging ring: copy each run at once, at most one guard's worth.
+        run: DeviceFeed | None = None
+        run_first = run_count = 0
+        stats = self.stats
+        staging = self._staging_bytes
+        msgs = _MSG.iter_unpack(self._msgs_bytes[: n * _MSG.size])
+        for i, (length, addr, port, kind, seq, count, _reserved, first) in enumerate(msgs):
+            dev = self._feeds.get(addr)
+            if dev is None:
+                dev = self._device(socket.inet_ntoa(addr.to_bytes(4, sys.byteorder)))
+                if dev is None:
+                    continue
+                self._feeds[addr] = dev
+            dev.datagrams += 1
+            if kind in KIND_FORMATS:
+                frames = dev.frames
+                # Legacy frames carry no sequence: only a format change to note.
+                if kind != 1 or frames.frame_format != LEGACY_FMT:
+                    frames.note_frame(dev.ip, KIND_FORMATS[kind], None if kind == 1 else seq)
+                stats.samples += count
+                if dev is run and run_count + count <= dev.ring.guard:
+                    run_count += count
+                    continue
+                if run is not None:
+                    run.ring.copy_rows(staging, run_first, run_count)
+                run, run_first, run_count = dev, first, count
+                continue
+            if run is not None:
+                # Markers take the ring position after every sample before them.
+                run.ring.copy_rows(staging, run_first, run_count)
+                run = None
+            if kind == KIND_CONTROL:
+                data = bytes(self._bufs_bytes[i * SLOT_BYTES : i * SLOT_BYTES + length])
+                dev.frames.handle_datagram(data, (dev.ip, port))
+                dev.add_marker()
+            elif kind == KIND_OVERFLOW:
+                stats.overflow += 1
+            else:
+                stats.bad += 1
+        if run is not None:
+            run.ring.copy_rows(staging, run_first, run_count)
+        stats.datagrams += n
+        stats.batches += 1
+        return True
+
+    def _recv_py(self) -> bool:
+        # One wait, then up to BATCH_MSGS datagrams without blocking: a burst
+        # costs one wakeup and one publish instead of one per datagram.
+        if not select.select((self.sock,), (), (), POLL_SEC)[0]:
+            return False
+        arrival_ns = time.monotonic_ns()
+        stats = self.stats
+        got = 0
+        for _ in range(BATCH_MSGS):
+            try:
+                data, addr = self.sock.recvfrom(SLOT_BYTES)
+            except BlockingIOError:
+                break
+            stats.datagrams += 1
+            dev = self._device(addr[0])
+            if dev is None:
+                continue
+            got += 1
+            dev.datagrams += 1
+            frames = dev.frames
+            frames.handle_datagram(data, addr)
+            dev.add_marker()
+            if frames.pending:
+                dev.ring.write(list(frames.pending), arrival_ns)
+                stats.samples += len(frames.pending)
+                frames.pending.clear()
+        stats.batches += 1
+        return got > 0
+
+
+class RingReader:
+    # One consumer's cursor into a device's ring. Offers the ImuStream calls
+    # the capture loops use (recv_sample, recv_segment, drain, rate_hz, ...),
+    # but samples stay in the ring and windows are views of it. Without an
+    # ip, the reader follows the first device heard from.
+    def __init__(self, ingest: ImuIngest, ip: str | None = None) -> None:
+        self.ingest = ingest
+        self.ip = ip
+        self.dev: DeviceFeed | None = None
+        self.ring: SampleRing | None = None
+        self.pos = 0
+        self.marker_pos = 0
+        self.overruns = 0
+        # End of the last segment handed out; pre-history never reaches below it.
+        self.floor = 0
+        # Segment start marker seen by recv_segment(), awaiting its end.
+        self.seg_start: tuple[str, int, int, int, int] | None = None
+        self._bind()
+
+    def _bind(self) -> bool:
+        if self.dev is not None:
+            return True
+        ingest = self.ingest
+        dev = ingest.devices.get(self.ip) if self.ip else (ingest.order[0] if ingest.order else None)
+        if dev is None:
+            return False
+        # Bound late: everything the device sent so far is unread.
+        self.dev = dev
+        self.ring = dev.ring
+        self.pos = dev.ring.oldest()
+        self.floor = self.pos
+        self.marker_pos = dev.marker_count - len(dev.markers)
+        return True
+
+    @property
+    def src_ip(self) -> str | None:
+        return self.dev.ip if self.dev is not None else None
+
+    @property
+    def frame_format(self) -> str | None:
+        return self.dev.frames.frame_format if self.dev is not None else None
+
+    @property
+    def device_caps(self) -> int:
+        return self.dev.frames.device_caps if self.dev is not None else 0
+
+    @property
+    def tracker(self) -> SequenceTracker:
+        return self.dev.frames.tracker if self.dev is not None else SequenceTracker()
+
+    @property
+    def last_idle(self):
+        return self.dev.frames.last_idle if self.dev is not None else None
+
+    @property
+    def rate_hz(self) -> float | None:
+        # Device-advertised rate when known, otherwise measured from the ring.
+        if self.dev is None:
+            return None
+        if self.dev.frames.advertised_hz:
+            return float(self.dev.frames.advertised_hz)
+        return self.ring.measured_hz()
+
+    @property
+    def last_pos(self) -> int:
+        # Ring position of the sample recv_sample() returned last.
+        return self.pos - 1
+
+    def pending(self) -> int:
+        # Samples received but not read yet.
+        return self.ring.head - self.pos if self._bind() else 0
+
+    def _wait(self, ready, timeout_sec: float) -> bool:
+        def ok() -> bool:
+            return self._bind() and ready()
+
+        if ok():
+            return True
+        if timeout_sec <= 0:
+            return False
+        ingest = self.ingest
+        with ingest.cond:
+            ingest.cond.wait_for(lambda: ok() or ingest.error is not None, timeout_sec)
+        if ingest.error is not None:
+            raise RuntimeError("imu ingest thread failed") from ingest.error
+        return ok()
+
+    def _catch_up(self) -> None:
+        oldest = self.ring.oldest()
+        if self.pos < oldest:
+            self.overruns += oldest - self.pos
+            self.pos = oldest
+
+    def recv_sample(self, timeout_sec: float = 0.25) -> Sample | None:
+        # timeout_sec 0 polls.
+        if not self._wait(lambda: self.ring.head > self.pos, timeout_sec):
+            return None
+        while True:
+            self._catch_up()
+            sample = self.ring.sample(self.pos)
+            # Re-check: the writer may have lapped the slot while we read it.
+            if self.pos >= self.ring.oldest():
+                self.pos += 1
+                return sample
+
+    def drain(self, markers: bool = True) -> int:
+        # Moves the cursor to the newest sample (and, with markers, past the
+        # segment markers received); returns samples skipped. The skipped
+        # samples stay in the ring for window() / pre-history.
+        if not self._bind():
+            return 0
+        skipped = self.ring.head - self.pos
+        self.pos = self.ring.head
+        if markers:
+            self.marker_pos = self.dev.marker_count
+            self.seg_start = None
+        return skipped
+
+    def window_pos(self, lo: int, hi: int) -> RingWindow:
+        return RingWindow(self.ring, max(lo, self.ring.oldest()), min(hi, self.ring.head))
+
+    def window(self, start_us: int, end_us: int) -> RingWindow:
+        # Samples with start_us <= ts_us < end_us still held by the ring.
+        lo, hi = self.ring.oldest(), self.ring.head
+        return RingWindow(self.ring, self.ring.find_ts(start_us, lo, hi), self.ring.find_ts(end_us, lo, hi))
+
+    def poll_segment(self) -> RingWindow | None:
+        # Consumes the markers received so far; returns the first segment
+        # (SEGS ... SEGE) they complete, as a window of the samples received
+        # between its markers.
+        if not self._bind():
+            return None
+        dev = self.dev
+        while self.marker_pos < dev.marker_count:
+            # Markers older than the deque are gone; skip to the oldest held.
+            first = dev.marker_count - len(dev.markers)
+            self.marker_pos = max(self.marker_pos, first)
+            marker = dev.markers[self.marker_pos - first]
+            self.marker_pos += 1
+            kind, seg_id, _ts_us, count, pos = marker
+            if kind == "start":
+                self.seg_start = marker
+            elif self.seg_start is not None and self.seg_start[1] == seg_id:
+                start = self.seg_start
+                self.seg_start = None
+                self.pos = max(self.pos, pos)
+                self.floor = pos
+                win = self.window_pos(start[4], pos)
+                if len(win) != count:
+                    print(f"segment {seg_id}: received {len(win)}/{count} samples")
+                return win
+        return None
+
+    def recv_segment(self, max_wait_sec: float) -> RingWindow | None:
+        # Waits for poll_segment(); None if no segment completes within
+        # max_wait_sec (0 = wait forever).
+        deadline = time.monotonic() + max_wait_sec if max_wait_sec > 0 else float("inf")
+        while True:
+            win = self.poll_segment()
+            if win is not None:
+                return win
+            left = deadline - time.monotonic()
+            if left <= 0:
+                return None
+            self._wait(lambda: self.marker_pos < self.dev.marker_count, min(left, 1.0))
+
+
+def open_ingest(
+    host: str,
+    port: int,
+    ring_sec: float = RING_SECONDS,
+    expected_hz: float = 200.0,
+    native: bool = True,
+    max_devices: int = MAX_DEVICES,
+) -> ImuIngest:
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    # Bursts land in the rings within a batch; the kernel buffer only has to
+    # cover one scheduling hiccup of the receiver thread.
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+    sock.bind((host, port))
+    return ImuIngest(
+        sock, ring_sec=ring_sec, expected_hz=expected_hz, native=native, max_devices=max_devices
+    ).start()
@@ -1,7 +1,6 @@
 #!/usr/bin/env python3
 import argparse
 import array
-import json
 import math
 import os
 import socket
@@ -9,24 +8,43 @@ import struct
 import subprocess
 import tempfile
 import time
-from collections import deque
+from concurrent.futures import Future, ThreadPoolExecutor
 from pathlib import Path
 import shutil
 import sys
 import wave
+from dataclasses import dataclass
 
 from dtw_baseline import (
     LabeledSequence,
+    PairMetric,
+    Q16Format,
+    ScoringEngine,
+    add_seq_cache_args,
+    build_pair_matrix,
     calibrate_label_thresholds,
-    compute_query_scores,
     load_labeled_sequences,
     predict_with_rejection,
     prep_sequence,
+    manifest_sample_rate,
+    quantize_references,
     read_manifest,
+    resample_to_rate,
+    seq_cache_path,
 )
+from anytime import EARLY_MARGIN, EARLY_MIN_PROGRESS, AnytimeBank, AnytimeClassifier, EarlyDecision
+from audio_adpcm import CODEC_IMA_ADPCM, pcm_bytes_to_samples
+from audio_adpcm import encode_blocks as encode_adpcm_blocks
+from device_fleet import DeviceSession, Fleet, FleetWindow, TriggerCapture, sample_features, window_features
+from embedding_index import EMBED_VERSION, EmbeddingIndex
+from imu_frames import HEARTBEAT_CAP_AUDIO_ADPCM
+from imu_ingest import MAX_DEVICES, RING_SECONDS, ImuIngest, RingReader, open_ingest
+from model_file import load_model
+from motion_trigger import TriggerConfig
+from stream_spotter import SpotStats, SpringBank, StreamSpotter, spot_params, spotter_for_model, stream_step
 
-FMT = "<q6h"
-SIZE = struct.calcsize(FMT)
+# Matches AUDIO_JB_SLOT_SAMPLES in firmware/main/app_main.c.
+BOARD_MAX_PACKET_SAMPLES = 1024
 
 
 def parse_args() -> argparse.Namespace:
@@ -38,8 +56,8 @@ def parse_args() -> argparse.Namespace:
     parser.add_argument(
         "--model",
         type=Path,
-        default=Path("data/model/action_model.json"),
-        help="Offline model artifact generated by build_model.py",
+        default=Path("data/model/action_model.admodel"),
+        help="Offline model artifact generated by build_model.py (binary or JSON)",
     )
     parser.add_argument(
         "--build-on-start",
@@ -54,7 +72,13 @@ def parse_args() -> argparse.Namespace:
     )
     parser.add_argument("--session", default="", help="Manifest session filter")
     parser.add_argument("--labels", default="", help="Manifest label filter")
-    parser.add_argument("--mode", choices=("trigger", "fixed"), default="trigger")
+    parser.add_argument(
+        "--mode",
+        choices=("trigger", "fixed", "device", "stream"),
+        default="trigger",
+        help="trigger: detect on host; device: use segments cut by the firmware motion trigger; "
+        "stream: always-on spotting (subsequence DTW), no keypress",
+    )
     parser.add_argument(
         "--duration-sec",
         type=float,
@@ -116,12 +140,110 @@ def parse_args() -> argparse.Namespace:
         help="Maximum wait for trigger in trigger mode",
     )
     parser.add_argument(
-        "--drain-max-packets",
-        type=int,
-        default=50000,
-        help="Maximum packets to drain before each capture",
+        "--expected-hz",
+        type=float,
+        default=200.0,
+        help="IMU rate assumed until the device advertises one (heartbeat) or it is measured",
+    )
+    parser.add_argument(
+        "--ring-sec",
+        type=float,
+        default=RING_SECONDS,
+        help="Seconds of samples the ingest ring keeps at --expected-hz",
     )
     parser.add_argument("--k", type=int, default=5, help="Top-k neighbors to print")
+    parser.add_argument(
+        "--workers",
+        type=int,
+        default=0,
+        help="Reference scoring worker processes (0 = auto: one per core, at least 32 references each)",
+    )
+    parser.add_argument(
+        "--fixed-point",
+        action="store_true",
+        help="Keep references as int16 and score with the fixed-point kernel (int16 models map in place)",
+    )
+    parser.add_argument(
+        "--prefilter-shortlist",
+        type=int,
+        default=0,
+        help="Score only each label's N nearest references by embedding (0 = score all; at least --per-label-k)",
+    )
+    parser.add_argument(
+        "--prefilter-exact-fallback",
+        action="store_true",
+        help="Re-score a window against every reference when its shortlisted prediction is rejected",
+    )
+    parser.add_argument(
+        "--early-hold",
+        type=int,
+        default=0,
+        help="Trigger mode: decide during the gesture once a label has held for N points (0 = at window end only)",
+    )
+    parser.add_argument(
+        "--early-margin",
+        type=float,
+        default=EARLY_MARGIN,
+        help="Trigger mode: runner-up / best prefix score a label needs to count toward --early-hold",
+    )
+    parser.add_argument(
+        "--early-min-progress",
+        type=float,
+        default=EARLY_MIN_PROGRESS,
+        help="Trigger mode: fraction of its best reference the gesture must have covered to decide early",
+    )
+    parser.add_argument(
+        "--early-background",
+        default="idle",
+        help="Trigger mode: comma-separated labels never decided early",
+    )
+    parser.add_argument(
+        "--stream-background",
+        default="idle",
+        help="Stream mode: comma-separated labels that are never spotted (the stream between gestures)",
+    )
+    parser.add_argument(
+        "--spot-step",
+        type=float,
+        default=0.0,
+        help="Stream mode: raw samples per spotting point (0 = from the model and stream rate)",
+    )
+    parser.add_argument(
+        "--spot-norm-frac",
+        type=float,
+        default=1.0,
+        help="Stream mode: z-norm window as a fraction of the median reference length "
+        "(points wait half of it before matching)",
+    )
+    parser.add_argument(
+        "--stream-report-sec",
+        type=float,
+        default=10.0,
+        help="Stream mode: print per-sample spotting cost this often (0 = never)",
+    )
+    parser.add_argument(
+        "--fleet",
+        action="store_true",
+        help="Serve every board sending to --port (trigger, device or stream mode, no keypress): "
+        "each gets its own segmentation state and announce cooldown, replies go back to it",
+    )
+    parser.add_argument(
+        "--max-devices",
+        type=int,
+        default=MAX_DEVICES,
+        help="Boards (source IPs) the ingest keeps state for; datagrams from further sources are dropped",
+    )
+    parser.add_argument(
+        "--device",
+        default="",
+        help="Single-board modes: only use this source IP (default: the first board heard)",
+    )
+    parser.add_argument(
+        "--fleet-report-sec",
+        type=float,
+        default=10.0,
+        help="Fleet mode: print per-device counters and latency this often (0 = never)",
+    )
     parser.add_argument(
         "--once",
         action="store_true",
@@ -203,6 +325,12 @@ def parse_args() -> argparse.Namespace:
         default=0.0,
         help="Initial buffered audio sent without pacing to absorb Wi-Fi jitter",
     )
+    parser.add_argument(
+        "--tts-codec",
+        choices=["auto", "pcm", "adpcm"],
+        default="auto",
+        help="TTS stream encoding; auto uses IMA-ADPCM when the board heartbeat advertises it",
+    )
     parser.add_argument(
         "--tts-debug-metrics",
         action="store_true",
@@ -218,6 +346,7 @@ def parse_args() -> argparse.Namespace:
     # Fallback model-build knobs (used only when --build-on-start).
     parser.add_argument("--max-points", type=int, default=180)
     parser.add_argument("--no-znorm", action="store_true")
+    add_seq_cache_args(parser)
     parser.add_argument("--window-frac", type=float, default=0.2)
     parser.add_argument("--per-label-k", type=int, default=3)
     parser.add_argument("--score-mode", choices=("dtw", "hybrid", "xcorr"), default="hybrid")
@@ -232,38 +361,16 @@ def parse_args() -> argparse.Namespace:
     return parser.parse_args()
 
 
-def drain_socket(sock: socket.socket, max_packets: int) -> int:
-    drained = 0
-    old_timeout = sock.gettimeout()
-    sock.setblocking(False)
-    try:
-        while drained < max_packets:
-            try:
-                sock.recvfrom(2048)
-                drained += 1
-            except BlockingIOError:
-                break
-    finally:
-        sock.setblocking(True)
-        sock.settimeout(old_timeout)
-    return drained
-
-
-def recv_sample(sock: socket.socket) -> tuple[int, tuple[float, ...], float, str] | None:
-    try:
-        data, addr = sock.recvfrom(2048)
-    except socket.timeout:
+def recv_sample(stream: RingReader) -> tuple[int, tuple[float, ...], float, str] | None:
+    sample = stream.recv_sample()
+    if sample is None:
         return None
-    if len(data) < SIZE:
-        return None
-    ts_us, ax, ay, az, gx, gy, gz = struct.unpack(FMT, data[:SIZE])
-    feat = (float(ax), float(ay), float(az), float(gx), float(gy), float(gz))
+    ts_us, _ax, _ay, _az, gx, gy, gz = sample
     gyro_norm = math.sqrt(gx * gx + gy * gy + gz * gz)
-    src_ip = addr[0]
-    return ts_us, feat, gyro_norm, src_ip
+    return ts_us, sample_features(sample), gyro_norm, stream.src_ip
 
 
-def capture_fixed_by_ts(sock: socket.socket, duration_sec: float) -> tuple[list[tuple[float, ...]], str | None]:
+def capture_fixed_by_ts(stream: RingReader, duration_sec: float) -> tuple[list[tuple[float, ...]], str | None]:
     duration_us = int(duration_sec * 1_000_000)
     seq: list[tuple[float, ...]] = []
     start_ts_us: int | None = None
@@ -271,7 +378,7 @@ def capture_fixed_by_ts(sock: socket.socket, duration_sec: float) -> tuple[list[
     src_ip: str | None = None
 
     while True:
-        sample = recv_sample(sock)
+        sample = recv_sample(stream)
         if sample is None:
             continue
         ts_us, feat, _energy, ip = sample
@@ -290,7 +397,7 @@ def capture_fixed_by_ts(sock: socket.socket, duration_sec: float) -> tuple[list[
 
 
 def capture_triggered(
-    sock: socket.socket,
+    stream: RingReader,
     trigger_on: float,
     trigger_off: float,
     trigger_on_hold: int,
@@ -301,87 +408,77 @@ def capture_triggered(
     max_action_sec: float,
     max_wait_sec: float,
     expected_hz: float,
+    early: AnytimeClassifier | None = None,
+    on_early=None,
 ) -> tuple[list[tuple[float, ...]], str | None]:
-    pre_len = max(1, int(round(pre_sec * expected_hz)))
-    pre_buf: deque[tuple[int, tuple[float, ...], float, str]] = deque(maxlen=pre_len)
-    on_count = 0
+    # Same detector the firmware runs with CONFIG_ACTION_MOTION_TRIGGER (see
+    # device_fleet.TriggerCapture), with pre-trigger history from the ring.
+    # early: fed the window as it grows (from its pre-trigger history on);
+    # on_early(decision) is called the first time it commits, and the window
+    # is still read to its end.
+    cfg = TriggerConfig.from_seconds(
+        on_thresh=trigger_on,
+        off_thresh=trigger_off,
+        on_hold=trigger_on_hold,
+        off_hold=trigger_off_hold,
+        pre_sec=pre_sec,
+        post_sec=post_sec,
+        min_action_sec=min_action_sec,
+        max_action_sec=max_action_sec,
+        rate_hz=expected_hz,
+    )
+    capture = TriggerCapture(stream, cfg)
     wait_deadline = time.monotonic() + max_wait_sec if max_wait_sec > 0 else float("inf")
-    last_ts_us: int | None = None
-    src_ip: str | None = None
-
-    # Wait for onset.
-    while time.monotonic() < wait_deadline:
-        sample = recv_sample(sock)
-        if sample is None:
-            continue
-        ts_us, feat, energy, ip = sample
-        src_ip = ip
-        if last_ts_us is not None and ts_us < last_ts_us:
-            continue
-        last_ts_us = ts_us
-        pre_buf.append(sample)
-        if energy >= trigger_on:
-            on_count += 1
-        else:
-            on_count = 0
-        if on_count >= max(1, trigger_on_hold):
-            break
-    else:
-        return [], src_ip
-
-    # Start capture from pre-trigger buffer.
-    seq_samples = list(pre_buf)
-    trigger_ts_us = seq_samples[-1][0]
-    off_count = 0
-    min_action_us = int(min_action_sec * 1_000_000)
-    max_action_us = int(max_action_sec * 1_000_000)
-    post_us = int(post_sec * 1_000_000)
-    post_until_us: int | None = None
+    if early is not None:
+        early.reset()
+    fed_ts_us: int | None = None  # newest sample early has seen
 
     while True:
-        sample = recv_sample(sock)
+        # The wait limit applies to onset only; an open action runs to its end.
+        if not capture.active and time.monotonic() >= wait_deadline:
+            return [], stream.src_ip
+        sample = stream.recv_sample()
         if sample is None:
             continue
-        ts_us, feat, energy, ip = sample
-        src_ip = ip
-        if ts_us < seq_samples[-1][0]:
+        window = capture.push(sample)
+        if window is not None:
+            break
+        if early is None or not capture.active or early.decision is not None:
             continue
-        seq_samples.append((ts_us, feat, energy, ip))
-        elapsed = ts_us - trigger_ts_us
-
-        if post_until_us is not None:
-            if ts_us >= post_until_us:
+        if fed_ts_us is None:
+            # Just triggered: catch up on the window so far.
+            pending = window_features(stream.window_pos(capture.start_pos, stream.last_pos + 1))
+        else:
+            # Samples stepping back in time are not in the window either.
+            pending = [sample_features(sample)] if sample[0] >= fed_ts_us else []
+        fed_ts_us = max(fed_ts_us or 0, sample[0])
+        for feat in pending:
+            decision = early.push(feat)
+            if decision is not None and on_early is not None:
+                on_early(decision)
                 break
-            continue
-
-        if elapsed >= max_action_us:
-            break
 
-        if energy <= trigger_off:
-            off_count += 1
-        else:
-            off_count = 0
+    seq = window_features(window)
+    if not window.intact():
+        print("trigger window overwritten before it was read; raise --ring-sec")
+        return [], stream.src_ip
+    return seq, stream.src_ip
 
-        if elapsed >= min_action_us and off_count >= max(1, trigger_off_hold):
-            post_until_us = ts_us + post_us
 
-    return [x[1] for x in seq_samples], src_ip
+def capture_device_segment(
+    stream: RingReader, max_wait_sec: float
+) -> tuple[list[tuple[float, ...]], str | None]:
+    # Firmware already cut the action (CONFIG_ACTION_MOTION_TRIGGER); just collect it.
+    samples = stream.recv_segment(max_wait_sec)
+    if not samples:
+        return [], stream.src_ip
+    return [sample_features(x) for x in samples], stream.src_ip
 
 
-def load_model(model_path: Path) -> tuple[list[LabeledSequence], dict, dict[str, float]]:
-    with model_path.open("r", encoding="utf-8") as f:
-        obj = json.load(f)
-    refs = [
-        LabeledSequence(
-            label=x["label"],
-            path=Path(x["path"]),
-            seq=[tuple(float(v) for v in p) for p in x["seq"]],
-        )
-        for x in obj["references"]
-    ]
-    params = obj["params"]
-    thresholds = {k: float(v) for k, v in obj.get("thresholds", {}).items()}
-    return refs, params, thresholds
+@dataclass
+class AnnounceGate:
+    last_label: str | None = None
+    last_ts: float = 0.0
 
 
 def build_runtime_from_manifest(args: argparse.Namespace) -> tuple[list[LabeledSequence], dict, dict]:
@@ -391,7 +488,9 @@ def build_runtime_from_manifest(args: argparse.Namespace) -> tuple[list[LabeledS
         raise ValueError("no reference samples selected from manifest")
 
     use_znorm = not args.no_znorm
-    refs = load_labeled_sequences(rows, max_points=args.max_points, use_znorm=use_znorm)
+    refs = load_labeled_sequences(
+        rows, max_points=args.max_points, use_znorm=use_znorm, cache_path=seq_cache_path(args)
+    )
     params = {
         "max_points": args.max_points,
         "use_znorm": use_znorm,
@@ -404,18 +503,27 @@ def build_runtime_from_manifest(args: argparse.Namespace) -> tuple[list[LabeledS
         "reject_margin": args.reject_margin,
         "reject_threshold_grace": args.reject_threshold_grace,
         "unknown_label": args.unknown_label,
+        "sample_rate_hz": manifest_sample_rate(rows),
     }
-    thresholds = calibrate_label_thresholds(
+    with ScoringEngine(
         refs,
+        query_len=args.max_points,
         window_frac=args.window_frac,
-        per_label_k=args.per_label_k,
-        q=args.reject_quantile,
-        scale=args.reject_scale,
-        score_mode=args.score_mode,
-        hybrid_alpha=args.hybrid_alpha,
         xcorr_max_lag_frac=args.xcorr_max_lag_frac,
         xcorr_min_overlap_frac=args.xcorr_min_overlap_frac,
-    )
+        workers=args.workers,
+    ) as engine:
+        pairs = build_pair_matrix(engine)
+        thresholds = calibrate_label_thresholds(
+            engine,
+            per_label_k=args.per_label_k,
+            q=args.reject_quantile,
+            scale=args.reject_scale,
+            score_mode=args.score_mode,
+            hybrid_alpha=args.hybrid_alpha,
+            pairs=pairs,
+        )
+        params.update(spot_params(engine, pairs, q=args.reject_quantile, scale=args.reject_scale))
     return refs, params, thresholds
 
 
@@ -490,6 +598,7 @@ def send_pcm_to_board_udp(
     dest_port: int,
     packet_ms: float,
     send_ahead_ms: float,
+    codec: str = "pcm",
 ) -> None:
     if not pcm_bytes:
         return
@@ -498,19 +607,27 @@ def send_pcm_to_board_udp(
     if not pcm_bytes:
         return
 
-    samples_per_packet = max(1, int(sample_rate * (packet_ms / 1000.0)))
+    # The board's jitter buffer slots hold at most BOARD_MAX_PACKET_SAMPLES.
+    samples_per_packet = min(BOARD_MAX_PACKET_SAMPLES, max(1, int(sample_rate * (packet_ms / 1000.0))))
     bytes_per_packet = samples_per_packet * 2
+    if codec == "adpcm":
+        payloads = encode_adpcm_blocks(pcm_bytes_to_samples(pcm_bytes), samples_per_packet)
+        start = b"AUDS" + struct.pack("<IB", sample_rate, CODEC_IMA_ADPCM)
+    else:
+        payloads = [
+            (len(chunk) // 2, chunk)
+            for chunk in (pcm_bytes[o: o + bytes_per_packet] for o in range(0, len(pcm_bytes), bytes_per_packet))
+        ]
+        start = b"AUDS" + struct.pack("<I", sample_rate)
     seq = 0
     addr = (dest_ip, dest_port)
     sent_samples = 0
     ahead_samples = max(0, int(sample_rate * (send_ahead_ms / 1000.0)))
 
     with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
-        sock.sendto(b"AUDS" + struct.pack("<I", sample_rate), addr)
-        for offset in range(0, len(pcm_bytes), bytes_per_packet):
-            chunk = pcm_bytes[offset: offset + bytes_per_packet]
-            sample_count = len(chunk) // 2
-            pkt = b"AUDD" + struct.pack("<HH", seq, sample_count) + chunk
+        sock.sendto(start, addr)
+        for sample_count, payload in payloads:
+            pkt = b"AUDD" + struct.pack("<HH", seq, sample_count) + payload
             sock.sendto(pkt, addr)
             seq = (seq + 1) & 0xFFFF
             sent_samples += sample_count
@@ -634,12 +751,473 @@ def save_pcm_wav(path: Path, pcm_bytes: bytes, sample_rate: int) -> None:
         wf.writeframes(pcm_bytes)
 
 
+def announce(
+    args: argparse.Namespace, pred: str, src_ip: str | None, stream: RingReader, gate: AnnounceGate
+) -> None:
+    # Speaks pred through the board (board-local label or streamed TTS),
+    # subject to the cooldown / repeat gate.
+    now = time.monotonic()
+    changed = (pred != gate.last_label)
+    cooldown_ok = (now - gate.last_ts) >= args.tts_cooldown_sec
+    repeat_same_label = args.tts_repeat or (args.tts_output_mode == "board-local")
+    if (repeat_same_label or changed) and cooldown_ok:
+        dest_ip = src_ip if args.tts_dest_ip == "auto" else args.tts_dest_ip
+        if dest_ip:
+            try:
+                if args.tts_output_mode == "board-local":
+                    send_label_to_board_udp(
+                        label=pred,
+                        dest_ip=dest_ip,
+                        dest_port=args.tts_port,
+                    )
+                    gate.last_label = pred
+                    gate.last_ts = now
+                    print(f"tts_label_sent label={pred} to {dest_ip}:{args.tts_port}")
+                else:
+                    text = label_to_tts_text(pred, args.tts_language)
+                    pcm, pcm_rate = synthesize_tts_pcm_with_say(
+                        text=text,
+                        voice=args.tts_voice,
+                        rate_wpm=args.tts_rate,
+                        target_sample_rate=args.tts_sample_rate,
+                    )
+                    raw_pcm = pcm
+                    raw_metrics = None
+                    if args.tts_debug_metrics:
+                        raw_metrics = pcm_metrics(raw_pcm)
+                    pcm = shape_tts_pcm_for_speaker(
+                        pcm_bytes=raw_pcm,
+                        sample_rate=pcm_rate,
+                        gain=args.tts_gain,
+                        target_peak=args.tts_target_peak,
+                        fade_ms=args.tts_fade_ms,
+                    )
+                    shaped_metrics = None
+                    if args.tts_debug_metrics:
+                        shaped_metrics = pcm_metrics(pcm)
+                        print(
+                            "tts_pcm_metrics "
+                            f"raw(samples={int(raw_metrics['samples'])} peak={raw_metrics['peak']:.0f} "
+                            f"rms={raw_metrics['rms']:.1f} dc={raw_metrics['dc']:.1f} "
+                            f"clip={raw_metrics['clip_ratio']*100:.3f}%) "
+                            f"shaped(samples={int(shaped_metrics['samples'])} peak={shaped_metrics['peak']:.0f} "
+                            f"rms={shaped_metrics['rms']:.1f} dc={shaped_metrics['dc']:.1f} "
+                            f"clip={shaped_metrics['clip_ratio']*100:.3f}%)"
+                        )
+                    if args.tts_debug_save_dir:
+                        ts = int(time.time() * 1000)
+                        base = f"{ts}_{pred}"
+                        raw_path = args.tts_debug_save_dir / f"{base}_raw.wav"
+                        shaped_path = args.tts_debug_save_dir / f"{base}_shaped.wav"
+                        save_pcm_wav(raw_path, raw_pcm, pcm_rate)
+                        save_pcm_wav(shaped_path, pcm, pcm_rate)
+                        print(f"tts_wav_saved raw={raw_path} shaped={shaped_path}")
+                    codec = args.tts_codec
+                    if codec == "auto":
+                        codec = "adpcm" if stream.device_caps & HEARTBEAT_CAP_AUDIO_ADPCM else "pcm"
+                    send_pcm_to_board_udp(
+                        pcm_bytes=pcm,
+                        sample_rate=pcm_rate,
+                        dest_ip=dest_ip,
+                        dest_port=args.tts_port,
+                        packet_ms=args.tts_packet_ms,
+                        send_ahead_ms=args.tts_send_ahead_ms,
+                        codec=codec,
+                    )
+                    gate.last_label = pred
+                    gate.last_ts = now
+                    print(f"tts_sent label={pred} codec={codec} to {dest_ip}:{args.tts_port}")
+            except Exception as e:
+                print(f"tts_error: {e}")
+        else:
+            print("tts_skip: destination ip unavailable")
+    else:
+        if not cooldown_ok:
+            elapsed = now - gate.last_ts
+            print(f"tts_skip: cooldown({elapsed:.2f}s<{args.tts_cooldown_sec:.2f}s)")
+        elif not changed:
+            print("tts_skip: same_label (enable --tts-repeat for stream mode)")
+
+
+@dataclass
+class WindowResult:
+    pred: str
+    reject_reason: str | None
+    label_scores: dict[str, float]
+    dtw_scores: dict[str, float]
+    xcorr_scores: dict[str, float]
+    pair_metrics: list[PairMetric]
+    score_ms: float
+    # Rejected through the pre-filter shortlist, then re-scored exactly.
+    exact_fallback: bool = False
+
+
+def score_window(
+    engine: ScoringEngine,
+    params: dict,
+    thresholds: dict[str, float],
+    raw_seq: list[tuple[float, ...]],
+    stream_hz: float,
+    k: int,
+) -> WindowResult:
+    # One captured (or spotted) window through the offline pipeline and the
+    # reject gate.
+    model_hz = float(params.get("sample_rate_hz") or 0.0)
+    if model_hz > 0:
+        # Match the reference point density before downsampling to max_points.
+        raw_seq = resample_to_rate(raw_seq, src_hz=stream_hz, dst_hz=model_hz)
+    query = prep_sequence(
+        raw_seq,
+        max_points=int(params["max_points"]),
+        use_znorm=bool(params["use_znorm"]),
+    )
+    t_score = time.perf_counter()
+
+    def decide(exact: bool):
+        scores = engine.query_scores(
+            query,
+            per_label_k=int(params["per_label_k"]),
+            score_mode=str(params["score_mode"]),
+            hybrid_alpha=float(params["hybrid_alpha"]),
+            neighbors=k,
+            exact=exact,
+        )
+        verdict = predict_with_rejection(
+            label_scores=scores[0],
+            thresholds=thresholds,
+            margin=float(params["reject_margin"]),
+            threshold_grace=float(params["reject_threshold_grace"]),
+            unknown_label=str(params["unknown_label"]),
+        )
+        return scores, verdict
+
+    (label_scores, dtw_scores, xcorr_scores, pair_metrics), (pred, reject_reason) = decide(False)
+    fallback = bool(reject_reason) and engine.prefilter is not None and engine.prefilter.exact_fallback
+    if fallback:
+        (label_scores, dtw_scores, xcorr_scores, pair_metrics), (pred, reject_reason) = decide(True)
+    score_ms = (time.perf_counter() - t_score) * 1000
+    return WindowResult(
+        pred=pred,
+        reject_reason=reject_reason,
+        label_scores=label_scores,
+        dtw_scores=dtw_scores,
+        xcorr_scores=xcorr_scores,
+        pair_metrics=pair_metrics,
+        score_ms=score_ms,
+        exact_fallback=fallback,
+    )
+
+
+def run_stream(
+    args: argparse.Namespace,
+    stream: RingReader,
+    engine: ScoringEngine,
+    refs: list[LabeledSequence],
+    params: dict,
+    thresholds: dict[str, float],
+    gate: AnnounceGate,
+) -> int:
+    # Always-on: every sample goes through the SPRING spotter; each spotted
+    # segment is re-scored like a captured window, so the reject thresholds
+    # decide what is announced.
+    if not params.get("spot_thresholds"):
+        raise ValueError(f"{args.model} has no spot params; rebuild it with pc/build_model.py")
+    background = frozenset(x.strip() for x in args.stream_background.split(",") if x.strip())
+    stream_hz = stream.rate_hz or args.expected_hz
+    spotter = spotter_for_model(
+        refs, params, stream_hz, step=args.spot_step, norm_frac=args.spot_norm_frac, background=background
+    )
+    latency_ms = spotter.latency_points() * spotter.step * 1000.0 / stream_hz
+    print(
+        f"streaming: spotted_labels={sorted({x.label for x in refs} - background)} "
+        f"step={spotter.step:.2f} norm_latency_ms={latency_ms:.0f} native={spotter.bank.lib is not None}"
+    )
+    unknown = str(params["unknown_label"])
+    report_at = time.monotonic() + args.stream_report_sec
+    report_from = time.perf_counter_ns()
+    while True:
+        sample = stream.recv_sample()
+        if sample is not None:
+            for det in spotter.push(sample[0], sample_features(sample)):
+                result = score_window(engine, params, thresholds, det.samples, stream_hz, args.k)
+                print(
+                    f"detection prediction={result.pred} spotted={det.label} "
+                    f"spot_dist={det.dist:.1f}/{det.threshold:.1f} start_us={det.start_us} end_us={det.end_us} "
+                    f"samples={len(det.samples)} close_lag_ms={(spotter.last_ts_us - det.end_us) / 1000:.0f} "
+                    f"score_ms={result.score_ms:.1f}"
+                    + (f" reject_reason={result.reject_reason}" if result.reject_reason else "")
+                )
+                if result.pred != unknown:
+                    if args.tts_enable:
+                        announce(args, result.pred, stream.src_ip, stream, gate)
+                    if args.once:
+                        return 0
+        if args.stream_report_sec > 0 and time.monotonic() >= report_at:
+            st = spotter.stats
+            wall_ns = max(1, time.perf_counter_ns() - report_from)
+            mean_us = st.mean_us()
+            print(
+                f"stream_stats samples={st.samples} points={st.points} detections={st.detections} "
+                f"sample_us_mean={mean_us:.1f} sample_us_p99={st.percentile_us(0.99):.1f} "
+                f"sample_us_max={st.max_ns / 1000:.1f} load={st.busy_ns * 100.0 / wall_ns:.2f}% "
+                f"devices_at_200hz={(1e6 / (mean_us * 200.0)) if mean_us > 0 else float('inf'):.0f}"
+            )
+            spotter.stats = SpotStats()
+            report_at = time.monotonic() + args.stream_report_sec
+            report_from = time.perf_counter_ns()
+            # Follow the device rate once it is advertised or measured.
+            rate = stream.rate_hz or args.expected_hz
+            if abs(rate - stream_hz) > 0.01 * stream_hz:
+                stream_hz = rate
+                spotter.set_step(stream_step(params, stream_hz, args.spot_step))
+
+
+def run_fleet(
+    args: argparse.Namespace,
+    ingest: ImuIngest,
+    engine: ScoringEngine,
+    refs: list[LabeledSequence],
+    params: dict,
+    thresholds: dict[str, float],
+) -> int:
+    # Every board on the port through one engine (see device_fleet.py).
+    # Announcements go back to the board that made the gesture, each with its
+    # own cooldown gate; they run on a small pool so synthesizing one does not
+    # stall the other boards, and a board still announcing skips the next.
+    mode = args.mode
+    background = frozenset(x.strip() for x in args.stream_background.split(",") if x.strip())
+    if mode == "stream" and not params.get("spot_thresholds"):
+        raise ValueError(f"{args.model} has no spot params; rebuild it with pc/build_model.py")
+    bank: SpringBank | None = None
+
+    def make_spotter(rate_hz: float) -> StreamSpotter:
+        nonlocal bank
+        spotter = spotter_for_model(
+            refs,
+            params,
+            rate_hz,
+            step=args.spot_step,
+            norm_frac=args.spot_norm_frac,
+            background=background,
+            bank=bank,
+        )
+        bank = spotter.bank
+        return spotter
+
+    def make_trigger(rate_hz: float) -> TriggerConfig:
+        return TriggerConfig.from_seconds(
+            on_thresh=args.trigger_on,
+            off_thresh=args.trigger_off,
+            on_hold=args.trigger_on_hold,
+            off_hold=args.trigger_off_hold,
+            pre_sec=args.pre_sec,
+            post_sec=args.post_sec,
+            min_action_sec=args.min_action_sec,
+            max_action_sec=args.max_action_sec,
+            rate_hz=rate_hz,
+        )
+
+    unknown = str(params["unknown_label"])
+    gates: dict[str, AnnounceGate] = {}
+    speaking: dict[str, Future] = {}
+    tts = ThreadPoolExecutor(max_workers=8, thread_name_prefix="tts")
+    done = False
+
+    def new_session(reader: RingReader) -> DeviceSession:
+        return DeviceSession(reader, mode, args.expected_hz, make_trigger=make_trigger, make_spotter=make_spotter)
+
+    def score(session: DeviceSession, win: FleetWindow) -> WindowResult:
+        return score_window(engine, params, thresholds, win.samples, session.rate_hz, args.k)
+
+    def on_result(session: DeviceSession, win: FleetWindow, result: WindowResult) -> None:
+        nonlocal done
+        ip = session.ip
+        print(
+            f"device={ip} prediction={result.pred} samples={len(win.samples)} score_ms={result.score_ms:.1f} "
+            f"latency_ms={(time.monotonic_ns() - win.closed_ns) / 1e6:.1f}"
+            + (f" spotted={win.spotted.label}" if win.spotted else "")
+            + (f" reject_reason={result.reject_reason}" if result.reject_reason else "")
+        )
+        if result.pred == unknown:
+            return
+        if args.tts_enable:
+            busy = speaking.get(ip)
+            if busy is not None and not busy.done():
+                print(f"tts_skip: device={ip} still announcing")
+            else:
+                gate = gates.setdefault(ip, AnnounceGate())
+                speaking[ip] = tts.submit(announce, args, result.pred, ip, session.stream, gate)
+        if args.once:
+            done = True
+
+    fleet = Fleet(ingest, new_session, score, on_result)
+    print(f"fleet: mode={mode} max_devices={args.max_devices} slice_samples={fleet.slice_samples}")
+    report_at = time.monotonic() + args.fleet_report_sec
+    try:
+        while not done:
+            fleet.step()
+            if args.fleet_report_sec > 0 and time.monotonic() >= report_at:
+                for line in fleet.report():
+                    print(line)
+                st = ingest.stats
+                print(
+                    f"fleet_stats devices={len(fleet.sessions)} datagrams={st.datagrams} samples={st.samples} "
+                    f"bad={st.bad} ignored={st.ignored}"
+                )
+                report_at = time.monotonic() + args.fleet_report_sec
+    finally:
+        tts.shutdown(wait=True)
+    return 0
+
+
+def capture_loop(
+    args: argparse.Namespace,
+    stream: RingReader,
+    engine: ScoringEngine,
+    params: dict,
+    thresholds: dict[str, float],
+    gate: AnnounceGate,
+    early_bank: AnytimeBank | None,
+    tts: ThreadPoolExecutor | None,
+) -> int:
+    # Interactive fixed / device / trigger captures, one prediction each.
+    while True:
+        if not args.once:
+            cmd = input("Press Enter to capture or type q to quit: ").strip().lower()
+            if cmd in {"q", "quit", "exit"}:
+                break
+
+        # Start from now; what arrived meanwhile stays in the ring as pre-history.
+        skipped = stream.drain()
+        if skipped > 0:
+            print(f"skipped {skipped} queued samples")
+
+        early_at: list[tuple[EarlyDecision, float]] = []
+        if args.mode == "fixed":
+            print(f"capturing fixed window {args.duration_sec:.2f}s by device timestamp...")
+            raw_seq, src_ip = capture_fixed_by_ts(stream, duration_sec=args.duration_sec)
+        elif args.mode == "device":
+            print(f"waiting device segment (max_wait={args.max_wait_sec:.1f}s)...")
+            raw_seq, src_ip = capture_device_segment(stream, max_wait_sec=args.max_wait_sec)
+        else:
+            print(
+                "waiting trigger "
+                f"(on={args.trigger_on:.1f}, off={args.trigger_off:.1f}, "
+                f"max_wait={args.max_wait_sec:.1f}s)..."
+            )
+            early = None
+            if early_bank is not None:
+                early = AnytimeClassifier(
+                    early_bank,
+                    params,
+                    stream.rate_hz or args.expected_hz,
+                    hold=args.early_hold,
+                    margin=args.early_margin,
+                    min_progress=args.early_min_progress,
+                    background=frozenset(x.strip() for x in args.early_background.split(",") if x.strip()),
+                )
+
+            def on_early(decision: EarlyDecision) -> None:
+                early_at.append((decision, time.monotonic()))
+                print(
+                    f"early_prediction={decision.label} score={decision.score:.4f} margin={decision.margin:.2f} "
+                    f"progress={decision.progress:.2f} samples={decision.samples}"
+                )
+                if tts is not None:
+                    tts.submit(announce, args, decision.label, stream.src_ip, stream, gate)
+
+            raw_seq, src_ip = capture_triggered(
+                stream=stream,
+                trigger_on=args.trigger_on,
+                trigger_off=args.trigger_off,
+                trigger_on_hold=args.trigger_on_hold,
+                trigger_off_hold=args.trigger_off_hold,
+                pre_sec=args.pre_sec,
+                post_sec=args.post_sec,
+                min_action_sec=args.min_action_sec,
+                max_action_sec=args.max_action_sec,
+                max_wait_sec=args.max_wait_sec,
+                expected_hz=stream.rate_hz or args.expected_hz,
+                early=early,
+                on_early=on_early,
+            )
+            if early_at and raw_seq:
+                decision, at = early_at[0]
+                print(
+                    f"early_lead_ms={(time.monotonic() - at) * 1000:.0f} "
+                    f"early_samples={decision.samples}/{len(raw_seq)}"
+                )
+
+        if not raw_seq:
+            print("no actionable window captured")
+            if args.once:
+                return 1
+            continue
+
+        stream_hz = stream.rate_hz or args.expected_hz
+        result = score_window(engine, params, thresholds, raw_seq, stream_hz, args.k)
+        pred = result.pred
+        print(f"prediction={pred} samples={len(raw_seq)} stream_hz={stream_hz:.1f}")
+        if result.reject_reason:
+            print(f"reject_reason={result.reject_reason}")
+        print(
+            f"score_mode={params['score_mode']} score_ms={result.score_ms:.1f} "
+            f"refs_scored={len(result.pair_metrics)}{' exact_fallback=1' if result.exact_fallback else ''}"
+        )
+        print("label_scores (final | dtw | xcorr):")
+        for label, score in sorted(result.label_scores.items(), key=lambda x: x[1]):
+            print(
+                f"- {label}: {score:.4f} | "
+                f"{result.dtw_scores.get(label, float('nan')):.4f} | "
+                f"{result.xcorr_scores.get(label, float('nan')):.4f}"
+            )
+        k = max(1, min(args.k, len(result.pair_metrics)))
+        for rank, m in enumerate(result.pair_metrics[:k], start=1):
+            print(
+                f"{rank}. label={m.label} dist={m.dtw:.4f} xcorr={m.xcorr:.4f} "
+                f"lag={m.lag} ref={m.path}"
+            )
+
+        early_label = early_at[0][0].label if early_at else None
+        if early_at:
+            print(f"early_agreed={int(early_label == pred)}")
+        # An early decision was already spoken; only a different one is.
+        if tts is not None and pred != str(params["unknown_label"]) and pred != early_label:
+            tts.submit(announce, args, pred, src_ip, stream, gate)
+
+        if args.once:
+            return 0
+    return 0
+
+
 def main() -> int:
     args = parse_args()
     if args.k <= 0:
         raise ValueError("--k must be > 0")
+    if args.workers < 0:
+        raise ValueError("--workers must be >= 0")
     if args.duration_sec <= 0:
         raise ValueError("--duration-sec must be > 0")
+    if args.expected_hz <= 0:
+        raise ValueError("--expected-hz must be > 0")
+    if args.ring_sec <= 0:
+        raise ValueError("--ring-sec must be > 0")
+    if args.max_devices <= 0:
+        raise ValueError("--max-devices must be > 0")
+    if args.fleet and args.mode == "fixed":
+        raise ValueError("--fleet supports trigger, device and stream modes")
+    if args.spot_step < 0:
+        raise ValueError("--spot-step must be >= 0")
+    if args.early_hold < 0:
+        raise ValueError("--early-hold must be >= 0")
+    if args.early_hold and (args.mode != "trigger" or args.fleet):
+        raise ValueError("--early-hold needs --mode trigger without --fleet")
+    if args.early_margin < 1:
+        raise ValueError("--early-margin must be >= 1")
+    if not 0 <= args.early_min_progress <= 1:
+        raise ValueError("--early-min-progress must be in [0, 1]")
+    if args.spot_norm_frac <= 0:
+        raise ValueError("--spot-norm-frac must be > 0")
     if args.trigger_on < 0 or args.trigger_off < 0:
         raise ValueError("trigger thresholds must be >= 0")
     if args.trigger_on < args.trigger_off:
@@ -663,7 +1241,7 @@ def main() -> int:
 
     t0 = time.perf_counter()
     if args.model.exists():
-        refs, params, thresholds = load_model(args.model)
+        refs, params, thresholds = load_model(args.model, fixed_point=args.fixed_point)
         source = f"model:{args.model}"
     elif args.build_on_start:
         print("model missing; building from manifest (slow)...")
@@ -673,21 +1251,52 @@ def main() -> int:
         raise FileNotFoundError(
             f"model not found: {args.model}. Run pc/build_model.py first or use --build-on-start."
         )
+    q16_format = None
+    if args.fixed_point:
+        # Drop float copies; only the int16 points stay resident.
+        q16_format = Q16Format.for_references(refs)
+        refs = quantize_references(refs, q16_format)
+    # Workers are daemon processes and go away with this one.
+    engine = ScoringEngine(
+        refs,
+        query_len=int(params["max_points"]),
+        window_frac=float(params["window_frac"]),
+        xcorr_max_lag_frac=float(params["xcorr_max_lag_frac"]),
+        xcorr_min_overlap_frac=float(params["xcorr_min_overlap_frac"]),
+        workers=args.workers,
+        fixed_point=args.fixed_point,
+        q16_format=q16_format,
+    )
+    if args.prefilter_shortlist > 0:
+        engine.prefilter = EmbeddingIndex(
+            refs,
+            args.prefilter_shortlist,
+            exact_fallback=args.prefilter_exact_fallback,
+            stored=params.get("embedding_version") == EMBED_VERSION,
+        )
     t1 = time.perf_counter()
 
     print(f"loaded references={len(refs)} labels={sorted({x.label for x in refs})}")
     print(f"source={source}")
-    print(f"startup_sec={t1 - t0:.3f}")
+    print(f"startup_sec={t1 - t0:.3f} scoring_workers={engine.workers}")
     print(
         "runtime_config: "
         f"mode={args.mode} score_mode={params['score_mode']} "
-        f"max_points={params['max_points']} use_znorm={params['use_znorm']}"
+        f"max_points={params['max_points']} use_znorm={params['use_znorm']} fixed_point={args.fixed_point}"
     )
+    if engine.prefilter is not None:
+        print(
+            f"prefilter: shortlist={engine.prefilter.shortlist} per label, embedding_dims={engine.prefilter.dims} "
+            f"embedded_at_load={engine.prefilter.embedded} exact_fallback={engine.prefilter.exact_fallback}"
+        )
 
-    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    sock.bind((args.host, args.port))
-    sock.settimeout(0.25)
-    print(f"listening on {args.host}:{args.port}")
+    ingest = open_ingest(
+        args.host, args.port, ring_sec=args.ring_sec, expected_hz=args.expected_hz, max_devices=args.max_devices
+    )
+    print(
+        f"listening on {args.host}:{args.port} ring_samples_per_device={ingest.capacity} "
+        f"batched_recv={ingest.native}"
+    )
     if args.tts_enable:
         print(
             "tts enabled: "
@@ -695,171 +1304,33 @@ def main() -> int:
             f"lang={args.tts_language} mode={args.tts_output_mode}"
         )
 
-    last_announce_label: str | None = None
-    last_announce_ts = 0.0
-
-    while True:
-        if not args.once:
-            cmd = input("Press Enter to capture or type q to quit: ").strip().lower()
-            if cmd in {"q", "quit", "exit"}:
-                break
-
-        drained = drain_socket(sock, max_packets=args.drain_max_packets)
-        if drained > 0:
-            print(f"drained {drained} stale packets")
-
-        if args.mode == "fixed":
-            print(f"capturing fixed window {args.duration_sec:.2f}s by device timestamp...")
-            raw_seq, src_ip = capture_fixed_by_ts(sock, duration_sec=args.duration_sec)
-        else:
-            print(
-                "waiting trigger "
-                f"(on={args.trigger_on:.1f}, off={args.trigger_off:.1f}, "
-                f"max_wait={args.max_wait_sec:.1f}s)..."
-            )
-            raw_seq, src_ip = capture_triggered(
-                sock=sock,
-                trigger_on=args.trigger_on,
-                trigger_off=args.trigger_off,
-                trigger_on_hold=args.trigger_on_hold,
-                trigger_off_hold=args.trigger_off_hold,
-                pre_sec=args.pre_sec,
-                post_sec=args.post_sec,
-                min_action_sec=args.min_action_sec,
-                max_action_sec=args.max_action_sec,
-                max_wait_sec=args.max_wait_sec,
-                expected_hz=316.0,
-            )
-
-        if not raw_seq:
-            print("no actionable window captured")
-            if args.once:
-                return 1
-            continue
+    if args.fleet:
+        return run_fleet(args, ingest, engine, refs, params, thresholds)
 
-        query = prep_sequence(
-            raw_seq,
-            max_points=int(params["max_points"]),
-            use_znorm=bool(params["use_znorm"]),
-        )
-        label_scores, dtw_scores, xcorr_scores, pair_metrics = compute_query_scores(
-            query,
-            refs,
-            window_frac=float(params["window_frac"]),
-            per_label_k=int(params["per_label_k"]),
-            score_mode=str(params["score_mode"]),
-            hybrid_alpha=float(params["hybrid_alpha"]),
-            xcorr_max_lag_frac=float(params["xcorr_max_lag_frac"]),
-            xcorr_min_overlap_frac=float(params["xcorr_min_overlap_frac"]),
-        )
-        pred, reject_reason = predict_with_rejection(
-            label_scores=label_scores,
-            thresholds=thresholds,
-            margin=float(params["reject_margin"]),
-            threshold_grace=float(params["reject_threshold_grace"]),
-            unknown_label=str(params["unknown_label"]),
+    stream = ingest.reader(args.device or None)
+    gate = AnnounceGate()
+    early_bank = None
+    if args.early_hold > 0:
+        early_bank = AnytimeBank(refs, params)
+        if not early_bank.thresholds:
+            print(f"{args.model} has no spot params, so early decisions have no threshold gate")
+        print(
+            f"early decisions: hold={args.early_hold} margin={args.early_margin} "
+            f"min_progress={args.early_min_progress} native={early_bank.native}"
         )
 
-        print(f"prediction={pred} samples={len(raw_seq)}")
-        if reject_reason:
-            print(f"reject_reason={reject_reason}")
-        print(f"score_mode={params['score_mode']}")
-        print("label_scores (final | dtw | xcorr):")
-        for label, score in sorted(label_scores.items(), key=lambda x: x[1]):
-            print(
-                f"- {label}: {score:.4f} | "
-                f"{dtw_scores.get(label, float('nan')):.4f} | "
-                f"{xcorr_scores.get(label, float('nan')):.4f}"
-            )
-        k = max(1, min(args.k, len(pair_metrics)))
-        for rank, m in enumerate(pair_metrics[:k], start=1):
-            print(
-                f"{rank}. label={m.label} dist={m.dtw:.4f} xcorr={m.xcorr:.4f} "
-                f"lag={m.lag} ref={m.path}"
-            )
+    if args.mode == "stream":
+        return run_stream(args, stream, engine, refs, params, thresholds, gate)
 
-        if args.tts_enable and pred != str(params["unknown_label"]):
-            now = time.monotonic()
-            changed = (pred != last_announce_label)
-            cooldown_ok = (now - last_announce_ts) >= args.tts_cooldown_sec
-            repeat_same_label = args.tts_repeat or (args.tts_output_mode == "board-local")
-            if (repeat_same_label or changed) and cooldown_ok:
-                dest_ip = src_ip if args.tts_dest_ip == "auto" else args.tts_dest_ip
-                if dest_ip:
-                    try:
-                        if args.tts_output_mode == "board-local":
-                            send_label_to_board_udp(
-                                label=pred,
-                                dest_ip=dest_ip,
-                                dest_port=args.tts_port,
-                            )
-                            last_announce_label = pred
-                            last_announce_ts = now
-                            print(f"tts_label_sent label={pred} to {dest_ip}:{args.tts_port}")
-                        else:
-                            text = label_to_tts_text(pred, args.tts_language)
-                            pcm, pcm_rate = synthesize_tts_pcm_with_say(
-                                text=text,
-                                voice=args.tts_voice,
-                                rate_wpm=args.tts_rate,
-                                target_sample_rate=args.tts_sample_rate,
-                            )
-                            raw_pcm = pcm
-                            raw_metrics = None
-                            if args.tts_debug_metrics:
-                                raw_metrics = pcm_metrics(raw_pcm)
-                            pcm = shape_tts_pcm_for_speaker(
-                                pcm_bytes=raw_pcm,
-                                sample_rate=pcm_rate,
-                                gain=args.tts_gain,
-                                target_peak=args.tts_target_peak,
-                                fade_ms=args.tts_fade_ms,
-                            )
-                            shaped_metrics = None
-                            if args.tts_debug_metrics:
-                                shaped_metrics = pcm_metrics(pcm)
-                                print(
-                                    "tts_pcm_metrics "
-                                    f"raw(samples={int(raw_metrics['samples'])} peak={raw_metrics['peak']:.0f} "
-                                    f"rms={raw_metrics['rms']:.1f} dc={raw_metrics['dc']:.1f} "
-                                    f"clip={raw_metrics['clip_ratio']*100:.3f}%) "
-                                    f"shaped(samples={int(shaped_metrics['samples'])} peak={shaped_metrics['peak']:.0f} "
-                                    f"rms={shaped_metrics['rms']:.1f} dc={shaped_metrics['dc']:.1f} "
-                                    f"clip={shaped_metrics['clip_ratio']*100:.3f}%)"
-                                )
-                            if args.tts_debug_save_dir:
-                                ts = int(time.time() * 1000)
-                                base = f"{ts}_{pred}"
-                                raw_path = args.tts_debug_save_dir / f"{base}_raw.wav"
-                                shaped_path = args.tts_debug_save_dir / f"{base}_shaped.wav"
-                                save_pcm_wav(raw_path, raw_pcm, pcm_rate)
-                                save_pcm_wav(shaped_path, pcm, pcm_rate)
-                                print(f"tts_wav_saved raw={raw_path} shaped={shaped_path}")
-                            send_pcm_to_board_udp(
-                                pcm_bytes=pcm,
-                                sample_rate=pcm_rate,
-                                dest_ip=dest_ip,
-                                dest_port=args.tts_port,
-                                packet_ms=args.tts_packet_ms,
-                                send_ahead_ms=args.tts_send_ahead_ms,
-                            )
-                            last_announce_label = pred
-                            last_announce_ts = now
-                            print(f"tts_sent label={pred} to {dest_ip}:{args.tts_port}")
-                    except Exception as e:
-                        print(f"tts_error: {e}")
-                else:
-                    print("tts_skip: destination ip unavailable")
-            else:
-                if not cooldown_ok:
-                    elapsed = now - last_announce_ts
-                    print(f"tts_skip: cooldown({elapsed:.2f}s<{args.tts_cooldown_sec:.2f}s)")
-                elif not changed:
-                    print("tts_skip: same_label (enable --tts-repeat for stream mode)")
-
-        if args.once:
-            return 0
-    return 0
+    # Announcements run on one worker thread, as in run_fleet: an early
+    # decision is spoken while the capture keeps draining the ring, and the
+    # final one queues behind it (same gate, in order).
+    tts = ThreadPoolExecutor(max_workers=1, thread_name_prefix="tts") if args.tts_enable else None
+    try:
+        return capture_loop(args, stream, engine, params, thresholds, gate, early_bank, tts)
+    finally:
+        if tts is not None:
+            tts.shutdown(wait=True)
 
 
 if __name__ == "__main__":
@@ -0,0 +1,309 @@
+#!/usr/bin/env python3
+# Host model artifact written by build_model.py and loaded by live_classify.py.
+# The binary format is mapped, not parsed: references stay one float32 array
+# in the native DTW layout that the kernels read in place. JSON models from
+# earlier builds still load; `model_file.py MODEL --json-out` exports for inspection.
+#
+# Layout (little endian, sections 64-byte aligned):
+#   header   HEADER_FMT: magic, version, flags, dims, stride, label/ref
+#            counts, then offsets of the sections below
+#   meta     JSON: params, thresholds, reference paths, int16 scales, ...
+#   labels   label_count x LABEL_FMT (NUL-padded UTF-8)
+#   refs     ref_count x REF_FMT: label index, points, DTW window for a
+#            max_points query, first point
+#   data     total points x stride, float32 (or int16 with FLAG_INT16)
+#   env      FLAG_ENVELOPES: LB_Keogh envelopes from earlier builds, skipped
+#   emb      optional (FLAG_EMBEDDINGS): ref_count x embedding_dims float32
+#            pre-filter embeddings (embedding_index.py), ending the file
+import argparse
+import ctypes
+import json
+import mmap
+import struct
+import sys
+from array import array
+from pathlib import Path
+
+from dtw_baseline import (
+    DTW_STRIDE,
+    LabeledSequence,
+    PackedSequence,
+    Q16Format,
+    Q16Sequence,
+    q16_scales,
+)
+from native_lib import load_dtw_kernel
+
+MODEL_MAGIC = b"ADHMODEL"
+MODEL_VERSION = 1
+HEADER_FMT = "<8sHHHHIIQQQQQQ"
+HEADER_SIZE = struct.calcsize(HEADER_FMT)
+LABEL_LEN = 64
+LABEL_FMT = f"<{LABEL_LEN}s"
+REF_FMT = "<IIIIQ"
+ALIGN = 64
+FLAG_INT16 = 1 << 0
+FLAG_ENVELOPES = 1 << 1  # no longer written
+FLAG_EMBEDDINGS = 1 << 2
+
+
+def _align(n: int) -> int:
+    return (n + ALIGN - 1) // ALIGN * ALIGN
+
+
+def is_binary_model(path: Path) -> bool:
+    with path.open("rb") as f:
+        return f.read(len(MODEL_MAGIC)) == MODEL_MAGIC
+
+
+def write_model(path: Path, model: dict, quantize: bool = False) -> int:
+    # model: the JSON object build_model.py assembles. Returns bytes written.
+    if sys.byteorder != "little":
+        raise ValueError("host models are written and mapped little endian only")
+    params = model["params"]
+    refs = model["references"]
+    labels = list(model["labels"])
+    dims = len(refs[0]["seq"][0]) if refs and refs[0]["seq"] else 0
+    if dims > DTW_STRIDE:
+        raise ValueError(f"host model supports at most {DTW_STRIDE} features per point")
+    for label in labels:
+        if len(label.encode("utf-8")) >= LABEL_LEN:
+            raise ValueError(f"label too long for host model (max {LABEL_LEN - 1} bytes): {label}")
+
+    scales = [1.0] * dims
+    if quantize:
+        # Per-axis symmetric int16 scale over every reference point, with the
+        # fixed-point scorer's headroom so it can use the points as stored.
+        scales = list(q16_scales(ref["seq"] for ref in refs))
+
+    max_points = int(params["max_points"])
+    window_frac = float(params["window_frac"])
+    table = bytearray()
+    data = array("h") if quantize else array("f")
+    pad = [0] * (DTW_STRIDE - dims)
+    label_ids = {label: i for i, label in enumerate(labels)}
+    for ref in refs:
+        seq = [tuple(p) for p in ref["seq"]]
+        m = len(seq)
+        window = int(round(max(max_points, m) * window_frac))
+        table += struct.pack(REF_FMT, label_ids[ref["label"]], m, window, 0, len(data) // DTW_STRIDE)
+        for p in seq:
+            if quantize:
+                data.extend(max(-32767, min(32767, int(round(v / s)))) for v, s in zip(p, scales))
+            else:
+                data.extend(p)
+            data.extend(pad)
+    with_emb = bool(refs) and all(ref.get("embedding") for ref in refs)
+    emb = array("f")
+    if with_emb:
+        for ref in refs:
+            emb.extend(ref["embedding"])
+
+    meta = {
+        "version": model.get("version", 1),
+        "built_utc": model.get("built_utc"),
+        "params": params,
+        "thresholds": model.get("thresholds", {}),
+        "paths": [str(ref["path"]) for ref in refs],
+        "scales": scales if quantize else None,
+        "embedding_dims": len(refs[0]["embedding"]) if with_emb else 0,
+    }
+    meta_raw = json.dumps(meta, ensure_ascii=True).encode("utf-8")
+    labels_raw = b"".join(struct.pack(LABEL_FMT, label.encode("utf-8")) for label in labels)
+
+    meta_off = _align(HEADER_SIZE)
+    labels_off = _align(meta_off + len(meta_raw))
+    refs_off = _align(labels_off + len(labels_raw))
+    data_off = _align(refs_off + len(table))
+    data_raw = data.tobytes()
+
+    flags = (
+        (FLAG_INT16 if quantize else 0)
+        | (FLAG_EMBEDDINGS if with_emb else 0)
+    )
+    out = bytearray(
+        struct.pack(
+            HEADER_FMT,
+            MODEL_MAGIC,
+            MODEL_VERSION,
+            flags,
+            dims,
+            DTW_STRIDE,
+            len(labels),
+            len(refs),
+            meta_off,
+            len(meta_raw),
+            labels_off,
+            refs_off,
+            data_off,
+            0,
+        )
+    )
+    for off, raw in ((meta_off, meta_raw), (labels_off, labels_raw), (refs_off, table), (data_off, data_raw)):
+        out += bytes(off - len(out)) + raw
+    if with_emb:
+        # Last, so the loader finds it from the file size.
+        out += bytes(_align(len(out)) - len(out)) + emb.tobytes()
+    tmp = path.with_name(path.name + ".tmp")
+    tmp.write_bytes(out)
+    tmp.replace(path)
+    return len(out)
+
+
+def load_binary_model(
+    path: Path, fixed_point: bool = False
+) -> tuple[list[LabeledSequence], dict, dict[str, float]]:
+    # Maps the file copy-on-write so ctypes can view it in place; every
+    # reference's points point into the mapping, which the
+    # views keep alive. With fixed_point, int16 references come back as
+    # Q16Sequence views of the mapping for ScoringEngine(fixed_point=True).
+    with path.open("rb") as f:
+        mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_COPY)
+    (
+        magic,
+        version,
+        flags,
+        dims,
+        stride,
+        label_count,
+        ref_count,
+        meta_off,
+        meta_len,
+        labels_off,
+        refs_off,
+        data_off,
+        _env_off,
+    ) = struct.unpack_from(HEADER_FMT, mm)
+    if magic != MODEL_MAGIC or version != MODEL_VERSION:
+        raise ValueError(f"{path}: not a version {MODEL_VERSION} host model")
+    if stride != DTW_STRIDE or sys.byteorder != "little":
+        raise ValueError(f"{path}: stride {stride} / byte order not supported on this host")
+    meta = json.loads(mm[meta_off : meta_off + meta_len].decode("utf-8"))
+    labels = [
+        struct.unpack_from(LABEL_FMT, mm, labels_off + i * LABEL_LEN)[0].rstrip(b"\0").decode("utf-8")
+        for i in range(label_count)
+    ]
+    paths = meta["paths"]
+    native = load_dtw_kernel() is not None
+    int16 = bool(flags & FLAG_INT16)
+    scales = meta.get("scales") or []
+    ref_size = struct.calcsize(REF_FMT)
+    emb_dims = int(meta.get("embedding_dims") or 0) if flags & FLAG_EMBEDDINGS else 0
+    emb_off = len(mm) - ref_count * emb_dims * 4
+
+    refs: list[LabeledSequence] = []
+    fmt = Q16Format(tuple(scales)) if int16 and fixed_point else None
+    for i in range(ref_count):
+        label_idx, m, _window, _reserved, first = struct.unpack_from(REF_FMT, mm, refs_off + i * ref_size)
+        embedding = None
+        if emb_dims:
+            embedding = (ctypes.c_float * emb_dims).from_buffer(mm, emb_off + i * emb_dims * 4)
+        if fmt is not None:
+            points = (ctypes.c_int16 * (m * stride)).from_buffer(mm, data_off + first * stride * 2)
+            seq = Q16Sequence(points, dims, fmt)
+            refs.append(LabeledSequence(label=labels[label_idx], path=Path(paths[i]), seq=seq, embedding=embedding))
+            continue
+        if int16:
+            # Not zero-copy: int16 only saves space on disk until scoring reads it.
+            raw = array("h")
+            start = data_off + first * stride * 2
+            raw.frombytes(mm[start : start + m * stride * 2])
+            vals = [v * scales[j % stride] if j % stride < dims else 0.0 for j, v in enumerate(raw)]
+            points = (ctypes.c_float * len(vals))(*vals)
+        else:
+            points = (ctypes.c_float * (m * stride)).from_buffer(mm, data_off + first * stride * 4)
+        item = LabeledSequence(
+            label=labels[label_idx], path=Path(paths[i]), seq=PackedSequence(points, dims), embedding=embedding
+        )
+        if native:
+            item.packed = points
+        refs.append(item)
+    thresholds = {k: float(v) for k, v in meta.get("thresholds", {}).items()}
+    return refs, meta["params"], thresholds
+
+
+def load_json_model(path: Path) -> tuple[list[LabeledSequence], dict, dict[str, float]]:
+    with path.open("r", encoding="utf-8") as f:
+        obj = json.load(f)
+    refs = [
+        LabeledSequence(
+            label=x["label"],
+            path=Path(x["path"]),
+            seq=[tuple(float(v) for v in p) for p in x["seq"]],
+            embedding=x.get("embedding"),
+        )
+        for x in obj["references"]
+    ]
+    params = obj["params"]
+    thresholds = {k: float(v) for k, v in obj.get("thresholds", {}).items()}
+    return refs, params, thresholds
+
+
+def load_model(path: Path, fixed_point: bool = False) -> tuple[list[LabeledSequence], dict, dict[str, float]]:
+    # Binary or JSON, by magic.
+    if is_binary_model(path):
+        return load_binary_model(path, fixed_point=fixed_point)
+    return load_json_model(path)
+
+
+def model_dict(path: Path) -> dict:
+    # The build_model.py JSON object for either format.
+    if not is_binary_model(path):
+        with path.open("r", encoding="utf-8") as f:
+            return json.load(f)
+    refs, params, thresholds = load_binary_model(path)
+    with path.open("rb") as f:
+        head = f.read(HEADER_SIZE)
+        meta_off, meta_len = struct.unpack(HEADER_FMT, head)[7:9]
+        f.seek(meta_off)
+        meta = json.loads(f.read(meta_len).decode("utf-8"))
+    return {
+        "version": meta.get("version", 1),
+        "built_utc": meta.get("built_utc"),
+        "params": params,
+        "thresholds": thresholds,
+        "labels": sorted({x.label for x in refs}),
+        "references": [
+            {
+                "label": x.label,
+                "path": str(x.path),
+                "seq": [list(p) for p in x.seq],
+                **({"embedding": list(x.embedding)} if x.embedding is not None else {}),
+            }
+            for x in refs
+        ],
+    }
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Inspect or export a host model.")
+    parser.add_argument("model", type=Path, help="Binary or JSON model from build_model.py")
+    parser.add_argument("--json-out", type=Path, default=None, help="Write the model as JSON")
+    return parser.parse_args()
+
+
+def main() -> int:
+    args = parse_args()
+    if is_binary_model(args.model):
+        with args.model.open("rb") as f:
+            fields = struct.unpack(HEADER_FMT, f.read(HEADER_SIZE))
+        flags = fields[2]
+        print(
+            f"binary v{fields[1]} dims={fields[3]} labels={fields[5]} refs={fields[6]} "
+            f"data={'int16' if flags & FLAG_INT16 else 'float32'} "
+            f"embeddings={'yes' if flags & FLAG_EMBEDDINGS else 'no'} bytes={args.model.stat().st_size}"
+        )
+    model = model_dict(args.model)
+    print(f"labels={model['labels']} refs={len(model['references'])}")
+    print(f"params={model['params']}")
+    print(f"thresholds={model['thresholds']}")
+    if args.json_out is not None:
+        args.json_out.parent.mkdir(parents=True, exist_ok=True)
+        with args.json_out.open("w", encoding="utf-8") as f:
+            json.dump(model, f, ensure_ascii=True)
+        print(f"saved json: {args.json_out}")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,286 @@
+#!/usr/bin/env python3
+# Motion-trigger segmentation shared by the host and the firmware.
+# MotionTrigger is the Python twin of firmware/main/motion_trigger.c; running this
+# file replays CSV captures through both and checks that they cut the same segments.
+import argparse
+import ctypes
+import sys
+from dataclasses import dataclass
+from pathlib import Path
+
+from capture_file import find_captures, read_samples
+from imu_frames import Sample
+from native_lib import ImuSample, MotionEmitFn, load_motion_trigger
+
+EVENT_IDLE = 0
+EVENT_START = 1
+EVENT_ACTIVE = 2
+EVENT_END = 3
+
+END_QUIET = 0
+END_MAX_LEN = 1
+
+
+@dataclass
+class TriggerConfig:
+    on_thresh: float
+    off_thresh: float
+    on_hold: int
+    off_hold: int
+    pre_samples: int
+    post_us: int
+    min_action_us: int
+    max_action_us: int
+
+    @classmethod
+    def from_seconds(
+        cls,
+        on_thresh: float,
+        off_thresh: float,
+        on_hold: int,
+        off_hold: int,
+        pre_sec: float,
+        post_sec: float,
+        min_action_sec: float,
+        max_action_sec: float,
+        rate_hz: float,
+    ) -> "TriggerConfig":
+        return cls(
+            on_thresh=on_thresh,
+            off_thresh=off_thresh,
+            on_hold=max(1, on_hold),
+            off_hold=max(1, off_hold),
+            pre_samples=max(1, int(round(pre_sec * rate_hz))),
+            post_us=int(post_sec * 1_000_000),
+            min_action_us=int(min_action_sec * 1_000_000),
+            max_action_us=int(max_action_sec * 1_000_000),
+        )
+
+
+class MotionTrigger:
+    def __init__(self, cfg: TriggerConfig) -> None:
+        self.cfg = cfg
+        self.on_sq = cfg.on_thresh * cfg.on_thresh
+        self.off_sq = cfg.off_thresh * cfg.off_thresh
+        self.segment_id = 0
+        self.end_reason = END_QUIET
+        self.reset()
+
+    def reset(self) -> None:
+        self.pre: list[Sample] = []
+        self.last_ts_us: int | None = None
+        self.on_count = 0
+        self.off_count = 0
+        self.active = False
+        self.post_until_us: int | None = None
+        self.trigger_ts_us = 0
+
+    def push(self, sample: Sample) -> tuple[int, list[Sample]]:
+        # Returns (event, samples emitted for the open segment).
+        ts_us = sample[0]
+        if self.last_ts_us is not None and ts_us < self.last_ts_us:
+            return (EVENT_ACTIVE if self.active else EVENT_IDLE), []
+        self.last_ts_us = ts_us
+        gx, gy, gz = sample[4], sample[5], sample[6]
+        sq = gx * gx + gy * gy + gz * gz
+
+        if not self.active:
+            self.pre.append(sample)
+            if len(self.pre) > self.cfg.pre_samples:
+                del self.pre[0]
+            self.on_count = self.on_count + 1 if sq >= self.on_sq else 0
+            if self.on_count < self.cfg.on_hold:
+                return EVENT_IDLE, []
+            self.active = True
+            self.post_until_us = None
+            self.off_count = 0
+            self.trigger_ts_us = ts_us
+            self.segment_id += 1
+            emitted = self.pre
+            self.pre = []
+            return EVENT_START, emitted
+
+        elapsed = ts_us - self.trigger_ts_us
+        done = False
+        if self.post_until_us is not None:
+            done = ts_us >= self.post_until_us
+            self.end_reason = END_QUIET
+        elif elapsed >= self.cfg.max_action_us:
+            done = True
+            self.end_reason = END_MAX_LEN
+        else:
+            self.off_count = self.off_count + 1 if sq <= self.off_sq else 0
+            if elapsed >= self.cfg.min_action_us and self.off_count >= self.cfg.off_hold:
+                self.post_until_us = ts_us + self.cfg.post_us
+        if not done:
+            return EVENT_ACTIVE, [sample]
+        self.active = False
+        self.post_until_us = None
+        self.pre = []
+        self.on_count = 0
+        return EVENT_END, [sample]
+
+
+# A closed segment: (samples, end_reason). Segments still open at the end are dropped.
+Segment = tuple[list[Sample], int]
+
+
+def segments_py(samples: list[Sample], cfg: TriggerConfig) -> list[Segment]:
+    trig = MotionTrigger(cfg)
+    out: list[Segment] = []
+    cur: list[Sample] = []
+    for s in samples:
+        event, emitted = trig.push(s)
+        cur.extend(emitted)
+        if event == EVENT_END:
+            out.append((cur, trig.end_reason))
+            cur = []
+    return out
+
+
+class _NativeCfg(ctypes.Structure):
+    # Mirrors motion_trigger_cfg_t.
+    _fields_ = [
+        ("on_thresh", ctypes.c_uint32),
+        ("off_thresh", ctypes.c_uint32),
+        ("on_hold", ctypes.c_uint16),
+        ("off_hold", ctypes.c_uint16),
+        ("pre_samples", ctypes.c_uint16),
+        ("post_us", ctypes.c_int64),
+        ("min_action_us", ctypes.c_int64),
+        ("max_action_us", ctypes.c_int64),
+    ]
+
+
+class _NativeTrigger(ctypes.Structure):
+    # Mirrors motion_trigger_t.
+    _fields_ = [
+        ("cfg", _NativeCfg),
+        ("on_sq", ctypes.c_uint64),
+        ("off_sq", ctypes.c_uint64),
+        ("pre", ctypes.POINTER(ImuSample)),
+        ("pre_len", ctypes.c_uint16),
+        ("pre_head", ctypes.c_uint16),
+        ("have_last", ctypes.c_bool),
+        ("last_ts_us", ctypes.c_int64),
+        ("on_count", ctypes.c_uint16),
+        ("off_count", ctypes.c_uint16),
+        ("active", ctypes.c_bool),
+        ("in_post", ctypes.c_bool),
+        ("trigger_ts_us", ctypes.c_int64),
+        ("post_until_us", ctypes.c_int64),
+        ("segment_id", ctypes.c_uint32),
+        ("segment_samples", ctypes.c_uint32),
+        ("end_reason", ctypes.c_int),
+        ("idle_samples", ctypes.c_uint32),
+        ("idle_peak_sq", ctypes.c_uint64),
+        ("idle_sum", ctypes.c_int64 * 3),
+    ]
+
+
+def segments_native(samples: list[Sample], cfg: TriggerConfig) -> list[Segment] | None:
+    lib = load_motion_trigger()
+    if lib is None:
+        return None
+    ncfg = _NativeCfg(
+        on_thresh=int(cfg.on_thresh),
+        off_thresh=int(cfg.off_thresh),
+        on_hold=cfg.on_hold,
+        off_hold=cfg.off_hold,
+        pre_samples=cfg.pre_samples,
+        post_us=cfg.post_us,
+        min_action_us=cfg.min_action_us,
+        max_action_us=cfg.max_action_us,
+    )
+    trig = _NativeTrigger()
+    pre = (ImuSample * cfg.pre_samples)()
+    if not lib.motion_trigger_init(ctypes.byref(trig), ctypes.byref(ncfg), pre):
+        raise ValueError("motion_trigger_init rejected the configuration")
+
+    cur: list[Sample] = []
+
+    def on_emit(_user, p) -> None:
+        s = p.contents
+        cur.append((s.ts_us, s.ax, s.ay, s.az, s.gx, s.gy, s.gz))
+
+    emit = MotionEmitFn(on_emit)
+    out: list[Segment] = []
+    one = ImuSample()
+    for s in samples:
+        (one.ts_us, one.ax, one.ay, one.az, one.gx, one.gy, one.gz) = s
+        if lib.motion_trigger_push(ctypes.byref(trig), ctypes.byref(one), emit, None) == EVENT_END:
+            out.append((cur[:], trig.end_reason))
+            cur.clear()
+    return out
+
+
+def parse_args() -> argparse.Namespace:
+    default_base = Path(__file__).resolve().parents[1] / "data"
+
+    parser = argparse.ArgumentParser(
+        description="Replay raw CSV captures through the firmware motion trigger and its Python twin."
+    )
+    parser.add_argument(
+        "--csv", type=Path, action="append", default=[], help="Capture file, binary or CSV (repeatable)"
+    )
+    parser.add_argument("--base-dir", type=Path, default=default_base, help="Data root for raw/**/ captures")
+    # Defaults match the firmware Kconfig defaults.
+    parser.add_argument("--trigger-on", type=int, default=800)
+    parser.add_argument("--trigger-off", type=int, default=300)
+    parser.add_argument("--trigger-on-hold", type=int, default=3)
+    parser.add_argument("--trigger-off-hold", type=int, default=20)
+    parser.add_argument("--pre-sec", type=float, default=0.25)
+    parser.add_argument("--post-sec", type=float, default=0.25)
+    parser.add_argument("--min-action-sec", type=float, default=0.15)
+    parser.add_argument("--max-action-sec", type=float, default=2.5)
+    parser.add_argument("--rate-hz", type=float, default=200.0, help="Sample rate for --pre-sec")
+    return parser.parse_args()
+
+
+def main() -> int:
+    args = parse_args()
+    if args.trigger_on < args.trigger_off:
+        raise ValueError("--trigger-on must be >= --trigger-off")
+    paths = args.csv or find_captures(args.base_dir)
+    if not paths:
+        print(f"no CSV files given and none under {args.base_dir / 'raw'}", file=sys.stderr)
+        return 2
+    cfg = TriggerConfig.from_seconds(
+        on_thresh=args.trigger_on,
+        off_thresh=args.trigger_off,
+        on_hold=args.trigger_on_hold,
+        off_hold=args.trigger_off_hold,
+        pre_sec=args.pre_sec,
+        post_sec=args.post_sec,
+        min_action_sec=args.min_action_sec,
+        max_action_sec=args.max_action_sec,
+        rate_hz=args.rate_hz,
+    )
+
+    total = 0
+    streamed = 0
+    mismatches = 0
+    for path in paths:
+        samples = read_samples(path)
+        ref = segments_py(samples, cfg)
+        native = segments_native(samples, cfg)
+        total += len(samples)
+        streamed += sum(len(seg) for seg, _reason in ref)
+        status = "native=unavailable"
+        if native is not None:
+            same = native == ref
+            mismatches += 0 if same else 1
+            status = "parity=ok" if same else "parity=MISMATCH"
+        print(f"{path}: samples={len(samples)} segments={len(ref)} {status}")
+        for i, (seg, reason) in enumerate(ref, start=1):
+            dur_ms = (seg[-1][0] - seg[0][0]) / 1000.0
+            why = "max_len" if reason == END_MAX_LEN else "quiet"
+            print(f"  {i}: samples={len(seg)} duration_ms={dur_ms:.0f} end={why}")
+
+    if total > 0:
+        print(f"streamed_fraction={streamed / total:.3f} ({streamed}/{total} samples)")
+    return 1 if mismatches else 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,247 @@
+// Banded DTW for pc/dtw_baseline.py, loaded through native_lib.load_dtw_kernel().
+// Sequences are contiguous float32 with DTW_STRIDE floats per point (features
+// zero-padded), so a point cost is one 8-lane vector subtract/multiply and the
+// padding lanes add nothing. Only cells inside the Sakoe-Chiba band are
+// visited; the cumulative cost is kept in double like the Python reference.
+// spring_push_f32() is the streaming side: subsequence DTW over a live stream.
+// dtw_dba_accumulate_f32() aligns captures to a prototype for model condensation.
+// dtw_open_end_push_f32() scores a growing query prefix for early decisions.
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DTW_STRIDE 8
+
+typedef float v8f __attribute__((vector_size(DTW_STRIDE * sizeof(float))));
+
+static inline double point_cost(const float *a, const float *b)
+{
+    v8f va;
+    v8f vb;
+    memcpy(&va, a, sizeof(va));
+    memcpy(&vb, b, sizeof(vb));
+    v8f d = va - vb;
+    d *= d;
+    return (double)(((d[0] + d[1]) + (d[2] + d[3])) + ((d[4] + d[5]) + (d[6] + d[7])));
+}
+
+static inline double min3(double x, double y, double z)
+{
+    double m = x < y ? x : y;
+    return m < z ? m : z;
+}
+
+// Same window rules as dtw_distance(): window <= 0 means unconstrained, and
+// the band always covers |n - m|. Returns INFINITY for an empty side.
+double dtw_band_f32(const float *a, size_t n, const float *b, size_t m, long window)
+{
+    if (window <= 0) window = (long)(n > m ? n : m);
+    long diff = (long)n - (long)m;
+    if (diff < 0) diff = -diff;
+    if (window < diff) window = diff;
+    if (n == 0 || m == 0) return (n == m) ? 0.0 : INFINITY;
+
+    double stack_rows[2 * 257];
+    double *rows = stack_rows;
+    if (m + 1 > 257) {
+        rows = malloc(2 * (m + 1) * sizeof(double));
+        if (!rows) return NAN;
+    }
+    double *prev = rows;
+    double *curr = rows + m + 1;
+    for (size_t j = 0; j <= m; ++j) prev[j] = INFINITY;
+    prev[0] = 0.0;
+
+    for (size_t i = 1; i <= n; ++i) {
+        size_t start = (long)i - window > 1 ? (size_t)((long)i - window) : 1;
+        size_t end = i + (size_t)window < m ? i + (size_t)window : m;
+        const float *ai = a + (i - 1) * DTW_STRIDE;
+        // Cells just outside the band must read as unreachable for the next row.
+        curr[start - 1] = INFINITY;
+        double left = INFINITY;
+        for (size_t j = start; j <= end; ++j) {
+            double c = point_cost(ai, b + (j - 1) * DTW_STRIDE);
+            left = c + min3(left, prev[j], prev[j - 1]);
+            curr[j] = left;
+        }
+        if (end < m) curr[end + 1] = INFINITY;
+        double *t = prev;
+        prev = curr;
+        curr = t;
+    }
+    double out = prev[m];
+    if (rows != stack_rows) free(rows);
+    return out;
+}
+
+// One DBA step (Petitjean et al., "A global averaging method for dynamic time
+// warping", 2011): aligns b to the centre a under the same band and adds
+// every b point to sum (n * DTW_STRIDE, per centre point) and count (n) of
+// the centre points it is matched with. Keeps the whole cost matrix to walk
+// the path back; on ties the diagonal wins, then the step in a, as in
+// dtw_align_py(). Returns the distance (NAN when out of memory).
+double dtw_dba_accumulate_f32(const float *a, size_t n, const float *b, size_t m, long window, double *sum,
+                              unsigned *count)
+{
+    if (window <= 0) window = (long)(n > m ? n : m);
+    long diff = (long)n - (long)m;
+    if (diff < 0) diff = -diff;
+    if (window < diff) window = diff;
+    if (n == 0 || m == 0) return (n == m) ? 0.0 : INFINITY;
+
+    size_t w = m + 1;
+    double *cost = malloc((n + 1) * w * sizeof(double));
+    if (!cost) return NAN;
+    for (size_t k = 0; k < (n + 1) * w; ++k) cost[k] = INFINITY;
+    cost[0] = 0.0;
+    for (size_t i = 1; i <= n; ++i) {
+        size_t start = (long)i - window > 1 ? (size_t)((long)i - window) : 1;
+        size_t end = i + (size_t)window < m ? i + (size_t)window : m;
+        const float *ai = a + (i - 1) * DTW_STRIDE;
+        double *prev = cost + (i - 1) * w;
+        double *curr = cost + i * w;
+        for (size_t j = start; j <= end; ++j) {
+            curr[j] = point_cost(ai, b + (j - 1) * DTW_STRIDE) + min3(curr[j - 1], prev[j], prev[j - 1]);
+        }
+    }
+    double out = cost[n * w + m];
+
+    size_t i = n;
+    size_t j = m;
+    while (i > 0 && j > 0) {
+        const float *bj = b + (j - 1) * DTW_STRIDE;
+        double *s = sum + (i - 1) * DTW_STRIDE;
+        for (int k = 0; k < DTW_STRIDE; ++k) s[k] += bj[k];
+        count[i - 1] += 1;
+        double d = cost[(i - 1) * w + j - 1];
+        double up = cost[(i - 1) * w + j];
+        double left = cost[i * w + j - 1];
+        if (d <= up && d <= left) {
+            --i;
+            --j;
+        } else if (up <= left) {
+            --i;
+        } else {
+            --j;
+        }
+    }
+    free(cost);
+    return out;
+}
+
+// Mirrored by _SpringRef / _SpringMatch in stream_spotter.py.
+typedef struct {
+    const float *seq;
+    size_t len;
+    double threshold;     // matches must end at or below this distance
+} spring_ref_t;
+
+typedef struct {
+    double dist;          // INFINITY = none
+    long long start;      // first and last stream point
+    long long end;
+    size_t ref;
+} spring_match_t;
+
+// One stream point x (index t) through SPRING (Sakurai et al., "Stream
+// Monitoring under the Time Warping Distance", 2007) for every reference: per
+// reference one new DTW column over its points, where a path may start at any
+// stream point. d / s hold each reference's column back to back (len cells:
+// cumulative cost and the stream point the path started at; start with
+// INFINITY / 0) and cand[r] its best match not yet reported (start with dist
+// INFINITY, ref r). A candidate is reported to out (room for count) once no
+// path still overlapping it can beat it; paths sharing its points are then
+// dropped. Returns the number reported; *open_start is the earliest start of
+// a candidate still held back (LLONG_MAX if none). O(total points) per call,
+// no allocation.
+size_t spring_push_f32(const spring_ref_t *refs, size_t count, double *d, long long *s,
+                       spring_match_t *cand, const float *x, long long t, spring_match_t *out,
+                       long long *open_start)
+{
+    size_t found = 0;
+    long long open = LLONG_MAX;
+    for (size_t r = 0; r < count; ++r) {
+        const float *y = refs[r].seq;
+        size_t m = refs[r].len;
+        spring_match_t *c = &cand[r];
+        // d(t, 0) = 0 starting at t; on ties the path starting latest wins.
+        double left = 0.0;
+        long long left_s = t;
+        double diag = 0.0;
+        long long diag_s = t;
+        int blocked = 0;
+        for (size_t j = 0; j < m; ++j) {
+            double up = d[j];
+            long long up_s = s[j];
+            double best = left;
+            long long best_s = left_s;
+            if (up < best) {
+                best = up;
+                best_s = up_s;
+            }
+            if (diag < best) {
+                best = diag;
+                best_s = diag_s;
+            }
+            left = point_cost(x, y + j * DTW_STRIDE) + best;
+            left_s = best_s;
+            d[j] = left;
+            s[j] = left_s;
+            blocked |= left < c->dist && left_s <= c->end;
+            diag = up;
+            diag_s = up_s;
+        }
+        if (c->dist <= refs[r].threshold && !blocked) {
+            out[found++] = *c;
+            for (size_t j = 0; j < m; ++j) {
+                if (s[j] <= c->end) d[j] = INFINITY;
+            }
+            c->dist = INFINITY;
+        }
+        if (d[m - 1] <= refs[r].threshold && d[m - 1] < c->dist) {
+            c->dist = d[m - 1];
+            c->start = s[m - 1];
+            c->end = t;
+        }
+        if (c->dist < INFINITY && c->start < open) open = c->start;
+        d += m;
+        s += m;
+    }
+    *open_start = open;
+    return found;
+}
+
+// One query point x through open-end DTW (anytime.py) for every reference:
+// query and reference are both anchored at their first points, the query
+// prefix so far may end at any reference point. d holds each reference's
+// current column back to back (len cells, D(i, j)); `first` starts a new
+// query. best[r] gets min_j D(i, j) and best_j[r] the first j reaching it.
+// O(total points) per call, no allocation.
+void dtw_open_end_push_f32(const spring_ref_t *refs, size_t count, double *d, const float *x, int first,
+                           double *best, size_t *best_j)
+{
+    for (size_t r = 0; r < count; ++r) {
+        const float *y = refs[r].seq;
+        size_t m = refs[r].len;
+        // D(-1, -1) = 0: only the first query point may start a path.
+        double diag = first ? 0.0 : INFINITY;
+        double left = INFINITY;
+        double lo = INFINITY;
+        size_t lo_j = 0;
+        for (size_t j = 0; j < m; ++j) {
+            double up = first ? INFINITY : d[j];
+            left = point_cost(x, y + j * DTW_STRIDE) + min3(left, up, diag);
+            d[j] = left;
+            if (left < lo) {
+                lo = left;
+                lo_j = j;
+            }
+            diag = up;
+        }
+        best[r] = lo;
+        best_j[r] = lo_j;
+        d += m;
+    }
+}
@@ -0,0 +1,142 @@
+// Fixed-point reference scoring for pc/dtw_baseline.py (ScoringEngine with
+// fixed_point=True), loaded through native_lib.load_q16_kernel(). Points are
+// int16 in the DTW_STRIDE layout, per-axis scaled (Q16Format). A point cost is
+// sum_d w[d] * (a_d - b_d)^2 and DTW sums it in int64; xcorr takes int64 dot
+// products per axis, weighted the same way. Everything up to the final
+// multiply by the format's unit is exact integer math, so the Python twin
+// (Q16Bank._score_py) gets the same results bit for bit.
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define Q16_STRIDE 8
+#define Q16_INF INT64_MAX
+
+// Mirrored by _Q16Ref in dtw_baseline.py.
+typedef struct {
+    const int16_t *seq;
+    size_t len;
+} q16_ref_t;
+
+static inline int64_t point_cost(const int16_t *a, const int16_t *b, const int64_t *w)
+{
+    int64_t s = 0;
+    for (int k = 0; k < Q16_STRIDE; ++k) {
+        int64_t d = (int64_t)a[k] - b[k];
+        s += w[k] * (d * d);
+    }
+    return s;
+}
+
+static inline int64_t min3(int64_t x, int64_t y, int64_t z)
+{
+    int64_t m = x < y ? x : y;
+    return m < z ? m : z;
+}
+
+// Python's round(): half to even, which nearbyint() does in the default mode.
+static long round_frac(size_t len, double frac) { return (long)nearbyint((double)len * frac); }
+
+// Banded DTW over rows (2 * (m + 1) cells of scratch).
+static int64_t dtw_band(const int16_t *a, size_t n, const int16_t *b, size_t m, long window, const int64_t *w,
+                        int64_t *rows)
+{
+    if (window <= 0) window = (long)(n > m ? n : m);
+    long diff = (long)n - (long)m;
+    if (diff < 0) diff = -diff;
+    if (window < diff) window = diff;
+    int64_t *prev = rows;
+    int64_t *curr = rows + m + 1;
+    for (size_t j = 0; j <= m; ++j) prev[j] = Q16_INF;
+    prev[0] = 0;
+    for (size_t i = 1; i <= n; ++i) {
+        size_t start = (long)i - window > 1 ? (size_t)((long)i - window) : 1;
+        size_t end = i + (size_t)window < m ? i + (size_t)window : m;
+        const int16_t *ai = a + (i - 1) * Q16_STRIDE;
+        curr[start - 1] = Q16_INF;
+        int64_t left = Q16_INF;
+        for (size_t j = start; j <= end; ++j) {
+            int64_t best = min3(left, prev[j], prev[j - 1]);
+            left = best == Q16_INF ? Q16_INF : best + point_cost(ai, b + (j - 1) * Q16_STRIDE, w);
+            curr[j] = left;
+        }
+        if (end < m) curr[end + 1] = Q16_INF;
+        int64_t *t = prev;
+        prev = curr;
+        curr = t;
+    }
+    return prev[m];
+}
+
+// Best normalized cross-correlation over lags -max_lag..max_lag with at
+// least min_overlap points, as max_normalized_xcorr(); the first lag wins ties.
+static double xcorr(const int16_t *a, size_t n, const int16_t *b, size_t m, long max_lag, long min_overlap,
+                    const int64_t *w, size_t dims, double unit, long *best_lag)
+{
+    double best = -1.0;
+    *best_lag = 0;
+    if (max_lag < 0) max_lag = 0;
+    if (min_overlap < 1) min_overlap = 1;
+    for (long lag = -max_lag; lag <= max_lag; ++lag) {
+        size_t a0 = lag >= 0 ? (size_t)lag : 0;
+        size_t b0 = lag >= 0 ? 0 : (size_t)(-lag);
+        long na = lag >= 0 ? (long)n - lag : (long)n;
+        long nb = lag >= 0 ? (long)m : (long)m + lag;
+        long overlap = na < nb ? na : nb;
+        if (overlap < min_overlap) continue;
+        int64_t acc[Q16_STRIDE] = {0};
+        const int16_t *pa = a + a0 * Q16_STRIDE;
+        const int16_t *pb = b + b0 * Q16_STRIDE;
+        for (long i = 0; i < overlap; ++i) {
+            for (int k = 0; k < Q16_STRIDE; ++k) acc[k] += (int32_t)pa[k] * pb[k];
+            pa += Q16_STRIDE;
+            pb += Q16_STRIDE;
+        }
+        int64_t dot = 0;
+        for (int k = 0; k < Q16_STRIDE; ++k) dot += w[k] * acc[k];
+        double corr = (double)dot * unit / (double)((size_t)overlap * dims);
+        corr = corr < -1.0 ? -1.0 : (corr > 1.0 ? 1.0 : corr);
+        if (corr > best) {
+            best = corr;
+            *best_lag = lag;
+        }
+    }
+    return best;
+}
+
+// Scores query q (n points) against count references: dtw[i] is the integer
+// DTW to refs[i], and with with_xcorr xcorr[i] / lag[i] are filled too.
+// Windows, lags and overlaps come from the fractions with
+// score_references()'s rounding. Returns 0, or -1 on bad input / no memory.
+int q16_score(const int16_t *q, size_t n, const q16_ref_t *refs, size_t count, const int64_t *w, size_t dims,
+              double unit, double window_frac, int with_xcorr, double max_lag_frac, double min_overlap_frac,
+              int64_t *dtw, double *xc, long *lag)
+{
+    if (n == 0) return -1;
+    size_t max_m = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (refs[i].len == 0) return -1;
+        if (refs[i].len > max_m) max_m = refs[i].len;
+    }
+    int64_t *rows = malloc(2 * (max_m + 1) * sizeof(int64_t));
+    if (!rows) return -1;
+
+    for (size_t i = 0; i < count; ++i) {
+        const q16_ref_t *r = &refs[i];
+        long window = round_frac(n > r->len ? n : r->len, window_frac);
+        dtw[i] = dtw_band(q, n, r->seq, r->len, window, w, rows);
+    }
+    free(rows);
+
+    if (with_xcorr) {
+        for (size_t i = 0; i < count; ++i) {
+            const q16_ref_t *r = &refs[i];
+            long max_lag = round_frac(n > r->len ? n : r->len, max_lag_frac);
+            long min_overlap = round_frac(n < r->len ? n : r->len, min_overlap_frac);
+            if (min_overlap < 4) min_overlap = 4;
+            xc[i] = xcorr(q, n, r->seq, r->len, max_lag, min_overlap, w, dims, unit, &lag[i]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,313 @@
+// Two-thread host check of firmware/main/imu_ring.c for `bench.py ring`,
+// loaded through native_lib.load_imu_ring(). A producer thread pushes
+// numbered samples (ts_us = sequence, axes derived from it so torn copies
+// show) and a consumer thread drains them with imu_ring_peek()/commit(),
+// as udp_task does. queue_stress() runs the same traffic through a model of
+// the FreeRTOS queue the ring replaced: a mutex + condvar bounded queue that
+// copies each sample in on send and out on receive.
+//
+// lossless: the producer retries a full ring (yielding) so every sample
+// gets through, for ns/sample; otherwise each sample is offered once and a
+// full ring drops it, like xQueueSend(..., 0) did. stall_every/stall_us put
+// the consumer to sleep every so many samples (udp_task blocked in sendto()); there
+// the producer hands samples over in FIFO-sized bursts with a short pause
+// between them, so the ring mostly overflows while the consumer sleeps.
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "imu_ring.h"
+
+#define STRESS_BURST 16       // samples per producer burst in the overflow run
+#define STRESS_BURST_GAP_US 20
+
+// Mirrored by _RingStressResult in bench.py.
+typedef struct {
+    uint64_t offered;       // samples the producer tried to hand over
+    uint64_t pushed;        // accepted (ring counter, widened)
+    uint64_t dropped;       // rejected on a full ring/queue (each retry counts)
+    uint64_t consumed;      // samples the consumer saw
+    uint64_t skipped;       // sequence gaps the consumer saw (lost samples)
+    uint64_t order_errors;  // duplicates, reordering or torn samples
+    uint32_t high_watermark;
+    uint32_t max_seen;      // most samples the consumer found waiting at once
+    uint32_t max_lag;       // largest lag counter the consumer read mid-run
+    uint32_t end_lag;       // lag counter once both threads are done
+    uint64_t elapsed_ns;
+} ring_stress_result_t;
+
+typedef struct {
+    uint64_t samples;
+    int lossless;
+    uint32_t stall_every;
+    uint32_t stall_us;
+    uint32_t capacity;
+    atomic_int done;
+    ring_stress_result_t *out;
+    // ring
+    imu_ring_t *ring;
+    // queue model
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    bmi270_sample_t *slots;
+    uint32_t q_head;
+    uint32_t q_count;
+    uint32_t q_high;
+} stress_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void make_sample(uint64_t seq, bmi270_sample_t *s)
+{
+    s->ts_us = (int64_t)seq;
+    s->ax = (int16_t)seq;
+    s->ay = (int16_t)(seq >> 16);
+    s->az = (int16_t)~seq;
+    s->gx = (int16_t)(seq * 3u);
+    s->gy = (int16_t)(seq >> 8);
+    s->gz = (int16_t)(seq ^ 0x5a5au);
+}
+
+// Sleeps once for every stall_every samples consumed since the last sleep.
+static void stall(stress_t *st, uint64_t *next_stall)
+{
+    if (st->stall_every && st->out->consumed >= *next_stall) {
+        *next_stall = st->out->consumed + st->stall_every;
+        struct timespec ts = {0, (long)st->stall_us * 1000L};
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void burst_gap(stress_t *st, uint64_t seq)
+{
+    if (!st->lossless && seq % STRESS_BURST == STRESS_BURST - 1) {
+        struct timespec ts = {0, STRESS_BURST_GAP_US * 1000L};
+        nanosleep(&ts, NULL);
+    }
+}
+
+// Checks one received sample against the previous; returns the new expected sequence.
+static uint64_t check_sample(ring_stress_result_t *out, const bmi270_sample_t *s, uint64_t expect)
+{
+    bmi270_sample_t want;
+    uint64_t seq = (uint64_t)s->ts_us;
+    make_sample(seq, &want);
+    // Field by field: the struct's tail padding is not part of a sample.
+    if (s->ts_us < 0 || seq < expect || s->ax != want.ax || s->ay != want.ay || s->az != want.az ||
+        s->gx != want.gx || s->gy != want.gy || s->gz != want.gz) {
+        out->order_errors++;
+        return expect;
+    }
+    out->skipped += seq - expect;
+    out->consumed++;
+    return seq + 1;
+}
+
+static void *ring_producer(void *arg)
+{
+    stress_t *st = arg;
+    bmi270_sample_t s;
+    for (uint64_t seq = 0; seq < st->samples; ++seq) {
+        make_sample(seq, &s);
+        st->out->offered++;
+        while (!imu_ring_push(st->ring, &s) && st->lossless) {
+            sched_yield();
+        }
+        burst_gap(st, seq);
+    }
+    atomic_store(&st->done, 1);
+    return NULL;
+}
+
+static void *ring_consumer(void *arg)
+{
+    stress_t *st = arg;
+    ring_stress_result_t *out = st->out;
+    uint64_t expect = 0;
+    uint64_t next_stall = st->stall_every;
+    for (;;) {
+        int done = atomic_load(&st->done);
+        const bmi270_sample_t *span = NULL;
+        size_t n = imu_ring_peek(st->ring, &span);
+        if (n == 0) {
+            // Nothing before done was read: the ring is drained for good.
+            if (done) break;
+            sched_yield();
+            continue;
+        }
+        if (n > out->max_seen) out->max_seen = (uint32_t)n;
+        imu_ring_stats_t rs;
+        imu_ring_get_stats(st->ring, &rs);
+        if (rs.lag > out->max_lag) out->max_lag = rs.lag;
+        for (size_t i = 0; i < n; ++i) {
+            expect = check_sample(out, &span[i], expect);
+        }
+        imu_ring_commit(st->ring, n);
+        stall(st, &next_stall);
+    }
+    // Samples dropped after the last one received.
+    out->skipped += st->samples - expect;
+    return NULL;
+}
+
+static void *queue_producer(void *arg)
+{
+    stress_t *st = arg;
+    bmi270_sample_t s;
+    for (uint64_t seq = 0; seq < st->samples; ++seq) {
+        make_sample(seq, &s);
+        st->out->offered++;
+        pthread_mutex_lock(&st->lock);
+        while (st->q_count == st->capacity && st->lossless) {
+            st->out->dropped++;
+            pthread_cond_wait(&st->not_full, &st->lock);
+        }
+        if (st->q_count < st->capacity) {
+            // xQueueSend: copy in.
+            memcpy(&st->slots[(st->q_head + st->q_count) % st->capacity], &s, sizeof(s));
+            st->q_count++;
+            if (st->q_count > st->q_high) st->q_high = st->q_count;
+            st->out->pushed++;
+            pthread_cond_signal(&st->not_empty);
+        } else {
+            st->out->dropped++;
+        }
+        pthread_mutex_unlock(&st->lock);
+        burst_gap(st, seq);
+    }
+    pthread_mutex_lock(&st->lock);
+    atomic_store(&st->done, 1);
+    pthread_cond_signal(&st->not_empty);
+    pthread_mutex_unlock(&st->lock);
+    return NULL;
+}
+
+static void *queue_consumer(void *arg)
+{
+    stress_t *st = arg;
+    ring_stress_result_t *out = st->out;
+    uint64_t expect = 0;
+    uint64_t next_stall = st->stall_every;
+    bmi270_sample_t s;
+    for (;;) {
+        // xQueueReceive: one sample per call, copied out under the lock.
+        pthread_mutex_lock(&st->lock);
+        while (st->q_count == 0 && !atomic_load(&st->done)) {
+            pthread_cond_wait(&st->not_empty, &st->lock);
+        }
+        if (st->q_count == 0) {
+            pthread_mutex_unlock(&st->lock);
+            break;
+        }
+        if (st->q_count > out->max_seen) out->max_seen = st->q_count;
+        // The queue's lag is its count.
+        if (st->q_count > out->max_lag) out->max_lag = st->q_count;
+        memcpy(&s, &st->slots[st->q_head], sizeof(s));
+        st->q_head = (st->q_head + 1) % st->capacity;
+        st->q_count--;
+        pthread_cond_signal(&st->not_full);
+        pthread_mutex_unlock(&st->lock);
+        expect = check_sample(out, &s, expect);
+        stall(st, &next_stall);
+    }
+    out->skipped += st->samples - expect;
+    return NULL;
+}
+
+static int run(stress_t *st, void *(*producer)(void *), void *(*consumer)(void *))
+{
+    pthread_t p, c;
+    atomic_init(&st->done, 0);
+    uint64_t t0 = now_ns();
+    if (pthread_create(&c, NULL, consumer, st) != 0) return -1;
+    if (pthread_create(&p, NULL, producer, st) != 0) {
+        atomic_store(&st->done, 1);
+        pthread_mutex_lock(&st->lock);
+        pthread_cond_broadcast(&st->not_empty);
+        pthread_mutex_unlock(&st->lock);
+        pthread_join(c, NULL);
+        return -1;
+    }
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    st->out->elapsed_ns = now_ns() - t0;
+    return 0;
+}
+
+static void setup(stress_t *st, uint32_t capacity, uint64_t samples, int lossless, uint32_t stall_every,
+                  uint32_t stall_us, ring_stress_result_t *out)
+{
+    memset(st, 0, sizeof(*st));
+    memset(out, 0, sizeof(*out));
+    st->samples = samples;
+    st->lossless = lossless;
+    st->stall_every = stall_every;
+    st->stall_us = stall_us;
+    st->capacity = capacity;
+    st->out = out;
+    pthread_mutex_init(&st->lock, NULL);
+    pthread_cond_init(&st->not_empty, NULL);
+    pthread_cond_init(&st->not_full, NULL);
+}
+
+static void teardown(stress_t *st)
+{
+    pthread_mutex_destroy(&st->lock);
+    pthread_cond_destroy(&st->not_empty);
+    pthread_cond_destroy(&st->not_full);
+}
+
+// Returns 0, or -1 on a capacity imu_ring_init() rejects / no memory / no threads.
+int ring_stress(uint32_t capacity, uint64_t samples, int lossless, uint32_t stall_every, uint32_t stall_us,
+                ring_stress_result_t *out)
+{
+    stress_t st;
+    setup(&st, capacity, samples, lossless, stall_every, stall_us, out);
+    // sizeof is a multiple of the cache line (the struct is aligned to it).
+    imu_ring_t *ring = aligned_alloc(IMU_RING_CACHE_LINE, sizeof(imu_ring_t));
+    bmi270_sample_t *storage = calloc(capacity ? capacity : 1, sizeof(bmi270_sample_t));
+    int rc = -1;
+    if (ring && storage && imu_ring_init(ring, storage, capacity)) {
+        st.ring = ring;
+        rc = run(&st, ring_producer, ring_consumer);
+        imu_ring_stats_t rs;
+        imu_ring_get_stats(ring, &rs);
+        // The 32-bit counters wrap; widen them against the offered count.
+        out->pushed = out->offered - (out->offered - rs.pushed) % (1ull << 32);
+        out->dropped = rs.dropped;
+        out->high_watermark = rs.high_watermark;
+        out->end_lag = rs.lag;
+    }
+    free(ring);
+    free(storage);
+    teardown(&st);
+    return rc;
+}
+
+// Same traffic through the mutex + condvar queue model. Returns 0, or -1.
+int queue_stress(uint32_t capacity, uint64_t samples, int lossless, uint32_t stall_every, uint32_t stall_us,
+                 ring_stress_result_t *out)
+{
+    stress_t st;
+    setup(&st, capacity, samples, lossless, stall_every, stall_us, out);
+    st.slots = calloc(capacity ? capacity : 1, sizeof(bmi270_sample_t));
+    int rc = -1;
+    if (st.slots && capacity > 0) {
+        rc = run(&st, queue_producer, queue_consumer);
+        out->high_watermark = st.q_high;
+        out->end_lag = st.q_count;
+    }
+    free(st.slots);
+    teardown(&st);
+    return rc;
+}
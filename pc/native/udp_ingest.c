@@ -0,0 +1,211 @@
+// Batched UDP receive for pc/imu_ingest.py, loaded through
+// native_lib.load_udp_ingest(). One call waits for the socket, takes every
+// queued datagram in one recvmmsg() (a recvfrom() loop where that is missing)
+// and decodes IMU frames (legacy <q6h>, IMU2, IMZ1) straight into the
+// caller's sample ring, stamped with the batch's CLOCK_MONOTONIC arrival time
+// (the clock behind Python's time.monotonic_ns()). Anything else (heartbeats,
+// segment markers, idle summaries) is left in its slot for the caller, with
+// the ring position it arrived at, so markers stay ordered against samples.
+//
+// The ring is only written, never published: the caller advances its head by
+// the samples reported and keeps readers away from the max_samples slots a
+// call may overwrite.
+#define _GNU_SOURCE // recvmmsg
+#include <errno.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <time.h>
+
+#include "imu_codec.h"
+
+#define INGEST_CONTROL 0   // not a sample frame: left in its slot
+#define INGEST_LEGACY 1
+#define INGEST_IMU2 2
+#define INGEST_IMZ1 3
+#define INGEST_BAD 4       // sample frame that failed to decode
+#define INGEST_OVERFLOW 5  // would exceed max_samples: dropped
+
+#define INGEST_MAX_BATCH 256
+#define LEGACY_SIZE 20
+#define IMU2_HEADER 20
+#define IMU2_SAMPLE 16
+#define IMZ1_HEADER 12
+#define INGEST_MAX_IMZ1 512
+
+// Mirrored by _IngestSample / _IngestMsg in imu_ingest.py.
+typedef struct {
+    int64_t ts_us;
+    int16_t ax, ay, az, gx, gy, gz;
+    int16_t reserved[2];
+    int64_t arrival_ns;
+} ingest_sample_t;
+
+typedef struct {
+    uint32_t len;
+    uint32_t addr;       // IPv4, network byte order
+    uint16_t port;       // host byte order
+    uint16_t kind;       // INGEST_*
+    uint32_t seq;        // IMU2 / IMZ1 frame sequence
+    uint32_t samples;    // written to the ring for this datagram
+    uint32_t reserved;
+    uint64_t ring_pos;   // ring position of its first sample (or of the next one)
+} ingest_msg_t;
+
+static uint16_t rd16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+static uint32_t rd32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int64_t rd64(const uint8_t *p) { return (int64_t)((uint64_t)rd32(p) | ((uint64_t)rd32(p + 4) << 32)); }
+
+static void put(ingest_sample_t *ring, size_t cap, uint64_t pos, int64_t ts_us, const uint8_t *axes,
+                int64_t arrival_ns)
+{
+    ingest_sample_t *s = &ring[pos & (cap - 1)];
+    s->ts_us = ts_us;
+    s->ax = (int16_t)rd16(axes);
+    s->ay = (int16_t)rd16(axes + 2);
+    s->az = (int16_t)rd16(axes + 4);
+    s->gx = (int16_t)rd16(axes + 6);
+    s->gy = (int16_t)rd16(axes + 8);
+    s->gz = (int16_t)rd16(axes + 10);
+    s->arrival_ns = arrival_ns;
+}
+
+// Decodes one datagram into the ring at pos; fills kind / seq / samples.
+static void decode(const uint8_t *d, size_t len, ingest_msg_t *m, ingest_sample_t *ring, size_t cap,
+                   uint64_t pos, size_t budget, int64_t arrival_ns)
+{
+    m->samples = 0;
+    m->seq = 0;
+    if (len > IMZ1_HEADER && memcmp(d, "IMZ1", 4) == 0) {
+        size_t count = rd16(d + 8);
+        m->kind = INGEST_IMZ1;
+        m->seq = rd32(d + 4);
+        if (count > budget) {
+            m->kind = INGEST_OVERFLOW;
+            return;
+        }
+        // Every sample takes at least 7 varint bytes, so a full slot fits the stack.
+        bmi270_sample_t out[INGEST_MAX_IMZ1];
+        if (count > INGEST_MAX_IMZ1 ||
+            imu_codec_decode_block(d + IMZ1_HEADER, len - IMZ1_HEADER, count, out, count) != count) {
+            m->kind = INGEST_BAD;
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            ingest_sample_t *s = &ring[(pos + i) & (cap - 1)];
+            s->ts_us = out[i].ts_us;
+            s->ax = out[i].ax;
+            s->ay = out[i].ay;
+            s->az = out[i].az;
+            s->gx = out[i].gx;
+            s->gy = out[i].gy;
+            s->gz = out[i].gz;
+            s->arrival_ns = arrival_ns;
+        }
+        m->samples = (uint32_t)count;
+        return;
+    }
+    if (len >= IMU2_HEADER && memcmp(d, "IMU2", 4) == 0) {
+        size_t count = rd16(d + 16);
+        m->kind = INGEST_IMU2;
+        m->seq = rd32(d + 4);
+        if (len != IMU2_HEADER + count * IMU2_SAMPLE) {
+            m->kind = INGEST_BAD;
+            return;
+        }
+        if (count > budget) {
+            m->kind = INGEST_OVERFLOW;
+            return;
+        }
+        int64_t base = rd64(d + 8);
+        for (size_t i = 0; i < count; ++i) {
+            const uint8_t *p = d + IMU2_HEADER + i * IMU2_SAMPLE;
+            put(ring, cap, pos + i, base + (int64_t)rd32(p), p + 4, arrival_ns);
+        }
+        m->samples = (uint32_t)count;
+        return;
+    }
+    // A segment start marker has the legacy frame's size; markers win, as in
+    // ImuStream.handle_datagram().
+    if (len == LEGACY_SIZE && memcmp(d, "SEGS", 4) != 0) {
+        m->kind = INGEST_LEGACY;
+        if (budget < 1) {
+            m->kind = INGEST_OVERFLOW;
+            return;
+        }
+        put(ring, cap, pos, rd64(d), d + 8, arrival_ns);
+        m->samples = 1;
+        return;
+    }
+    m->kind = INGEST_CONTROL;
+}
+
+// Waits up to timeout_ms for fd, then receives at most max_msgs datagrams
+// (each truncated to slot bytes) into bufs and decodes them into ring
+// (cap a power of two) from position head, writing at most max_samples.
+// Returns datagrams received (0 on timeout), or -errno.
+long udp_ingest_recv(int fd, int timeout_ms, uint8_t *bufs, size_t slot, size_t max_msgs, ingest_msg_t *msgs,
+                     ingest_sample_t *ring, size_t cap, uint64_t head, size_t max_samples)
+{
+    if (cap == 0 || (cap & (cap - 1)) || slot == 0) return -EINVAL;
+    if (max_msgs > INGEST_MAX_BATCH) max_msgs = INGEST_MAX_BATCH;
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready < 0) return errno == EINTR ? 0 : -errno;
+    if (ready == 0) return 0;
+
+    struct sockaddr_in addrs[INGEST_MAX_BATCH];
+    size_t got = 0;
+#ifdef __linux__
+    struct mmsghdr hdrs[INGEST_MAX_BATCH];
+    struct iovec iov[INGEST_MAX_BATCH];
+    for (size_t i = 0; i < max_msgs; ++i) {
+        iov[i].iov_base = bufs + i * slot;
+        iov[i].iov_len = slot;
+        memset(&hdrs[i], 0, sizeof(hdrs[i]));
+        hdrs[i].msg_hdr.msg_iov = &iov[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+        hdrs[i].msg_hdr.msg_name = &addrs[i];
+        hdrs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+    }
+    int n = recvmmsg(fd, hdrs, (unsigned)max_msgs, MSG_DONTWAIT, NULL);
+    if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -errno;
+    got = (size_t)n;
+    for (size_t i = 0; i < got; ++i) msgs[i].len = hdrs[i].msg_len;
+#else
+    while (got < max_msgs) {
+        socklen_t alen = sizeof(addrs[got]);
+        ssize_t n = recvfrom(fd, bufs + got * slot, slot, MSG_DONTWAIT, (struct sockaddr *)&addrs[got], &alen);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+            if (got == 0) return -errno;
+            break;
+        }
+        msgs[got++].len = (uint32_t)n;
+    }
+#endif
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t arrival_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+
+    uint64_t pos = head;
+    for (size_t i = 0; i < got; ++i) {
+        ingest_msg_t *m = &msgs[i];
+        if (m->len > slot) m->len = (uint32_t)slot;
+        m->addr = addrs[i].sin_addr.s_addr;
+        m->port = ntohs(addrs[i].sin_port);
+        m->reserved = 0;
+        m->ring_pos = pos;
+        decode(bufs + i * slot, m->len, m, ring, cap, pos, max_samples - (size_t)(pos - head), arrival_ns);
+        pos += m->samples;
+    }
+    return (long)got;
+}
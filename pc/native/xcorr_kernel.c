@@ -0,0 +1,199 @@
+// Normalized cross-correlation for pc/dtw_baseline.py, loaded through
+// native_lib.load_xcorr_kernel(). The whole lag curve comes from one inverse
+// FFT of the per-axis spectrum products summed over axes; reference spectra
+// are computed once (xcorr_spectrum) and reused for every query. The FFT only
+// locates the best lag: lags within rounding of the maximum are re-scored
+// with the direct dot product in the order max_normalized_xcorr() uses, so
+// best and best_lag match the Python loop exactly. Built with
+// -ffp-contract=off so those dot products round like Python's.
+//
+// Sequences are contiguous doubles, `dims` per point. Spectra hold dims rows
+// of nfft / 2 + 1 complex bins (re, im) of the zero-padded axis.
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define XCORR_MAX_STACK_FFT 1024
+#define XCORR_TOL 1e-9 // relative to |a| |b|, far above the FFT's rounding
+
+// Twiddle table for nfft (a power of two): cos/sin(2 pi k / nfft), k < nfft / 2.
+void xcorr_twiddles(size_t nfft, double *tw)
+{
+    for (size_t k = 0; k < nfft / 2; ++k) {
+        double ang = 2.0 * M_PI * (double)k / (double)nfft;
+        tw[2 * k] = cos(ang);
+        tw[2 * k + 1] = sin(ang);
+    }
+}
+
+// In-place iterative radix-2 FFT on interleaved complex x; sign -1 forward,
+// +1 inverse (unscaled).
+static void fft(double *x, size_t nfft, const double *tw, int sign)
+{
+    for (size_t i = 1, j = 0; i < nfft; ++i) {
+        size_t bit = nfft >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            double tr = x[2 * i];
+            double ti = x[2 * i + 1];
+            x[2 * i] = x[2 * j];
+            x[2 * i + 1] = x[2 * j + 1];
+            x[2 * j] = tr;
+            x[2 * j + 1] = ti;
+        }
+    }
+    for (size_t len = 2; len <= nfft; len <<= 1) {
+        size_t half = len >> 1;
+        size_t step = nfft / len;
+        for (size_t i = 0; i < nfft; i += len) {
+            for (size_t k = 0; k < half; ++k) {
+                double wr = tw[2 * k * step];
+                double wi = sign * tw[2 * k * step + 1];
+                double *u = x + 2 * (i + k);
+                double *v = x + 2 * (i + k + half);
+                double vr = v[0] * wr - v[1] * wi;
+                double vi = v[0] * wi + v[1] * wr;
+                v[0] = u[0] - vr;
+                v[1] = u[1] - vi;
+                u[0] += vr;
+                u[1] += vi;
+            }
+        }
+    }
+}
+
+// Widens float32 points stored `stride` floats apart (the DTW kernel layout,
+// e.g. a reference in a mapped host model) into contiguous doubles.
+void xcorr_widen_f32(const float *src, size_t len, size_t stride, size_t dims, double *dst)
+{
+    for (size_t i = 0; i < len; ++i) {
+        for (size_t d = 0; d < dims; ++d) dst[i * dims + d] = src[i * stride + d];
+    }
+}
+
+static double *scratch(size_t nfft, double *stack_buf)
+{
+    return nfft <= XCORR_MAX_STACK_FFT ? stack_buf : malloc(2 * nfft * sizeof(double));
+}
+
+// Half spectrum of every axis of seq, zero-padded to nfft >= len.
+// Returns 0, or -1 on bad arguments / allocation failure.
+int xcorr_spectrum(const double *seq, size_t len, size_t dims, size_t nfft, const double *tw,
+                   double *spec)
+{
+    if (nfft < 2 || (nfft & (nfft - 1)) || len > nfft) return -1;
+    double stack_buf[2 * XCORR_MAX_STACK_FFT];
+    double *buf = scratch(nfft, stack_buf);
+    if (!buf) return -1;
+    size_t bins = nfft / 2 + 1;
+    for (size_t d = 0; d < dims; ++d) {
+        memset(buf, 0, 2 * nfft * sizeof(double));
+        for (size_t i = 0; i < len; ++i) buf[2 * i] = seq[i * dims + d];
+        fft(buf, nfft, tw, -1);
+        memcpy(spec + d * 2 * bins, buf, 2 * bins * sizeof(double));
+    }
+    if (buf != stack_buf) free(buf);
+    return 0;
+}
+
+static double dot_at(const double *a, const double *b, size_t dims, size_t a0, size_t b0,
+                     size_t overlap)
+{
+    double dot = 0.0;
+    for (size_t i = 0; i < overlap; ++i) {
+        const double *pa = a + (a0 + i) * dims;
+        const double *pb = b + (b0 + i) * dims;
+        for (size_t d = 0; d < dims; ++d) dot += pa[d] * pb[d];
+    }
+    return dot;
+}
+
+static double sum_sq(const double *x, size_t count)
+{
+    double s = 0.0;
+    for (size_t i = 0; i < count; ++i) s += x[i] * x[i];
+    return s;
+}
+
+// Points a[lag + i] / b[i] pair up at this lag, as in max_normalized_xcorr().
+static long overlap_at(long lag, long n, long m)
+{
+    if (lag >= 0) return n - lag < m ? n - lag : m;
+    return n < m + lag ? n : m + lag;
+}
+
+static double clamp1(double v)
+{
+    return v < -1.0 ? -1.0 : (v > 1.0 ? 1.0 : v);
+}
+
+// max_normalized_xcorr() of a (n points) against b (m points) from their
+// spectra. nfft must be >= max(n, m) + max_lag so no lag wraps around.
+// Returns 0, or -1 on bad arguments / allocation failure.
+int xcorr_best_lag(const double *a, size_t n, const double *a_spec, const double *b, size_t m,
+                   const double *b_spec, size_t dims, size_t nfft, const double *tw, long max_lag,
+                   long min_overlap, double *best_out, long *lag_out)
+{
+    if (max_lag < 0) max_lag = 0;
+    if (min_overlap < 1) min_overlap = 1;
+    if (nfft < 2 || (nfft & (nfft - 1)) || (n > m ? n : m) + (size_t)max_lag > nfft) return -1;
+    double stack_buf[2 * XCORR_MAX_STACK_FFT];
+    double *buf = scratch(nfft, stack_buf);
+    if (!buf) return -1;
+
+    // sum over axes of A_d * conj(B_d), mirrored to a full Hermitian spectrum
+    size_t bins = nfft / 2 + 1;
+    memset(buf, 0, 2 * bins * sizeof(double));
+    for (size_t d = 0; d < dims; ++d) {
+        const double *sa = a_spec + d * 2 * bins;
+        const double *sb = b_spec + d * 2 * bins;
+        for (size_t k = 0; k < bins; ++k) {
+            buf[2 * k] += sa[2 * k] * sb[2 * k] + sa[2 * k + 1] * sb[2 * k + 1];
+            buf[2 * k + 1] += sa[2 * k + 1] * sb[2 * k] - sa[2 * k] * sb[2 * k + 1];
+        }
+    }
+    for (size_t k = bins; k < nfft; ++k) {
+        buf[2 * k] = buf[2 * (nfft - k)];
+        buf[2 * k + 1] = -buf[2 * (nfft - k) + 1];
+    }
+    fft(buf, nfft, tw, +1);
+
+    // buf[2 * (lag mod nfft)] * (1 / nfft) = sum_t a[t + lag] . b[t]
+    double scale = 1.0 / (double)nfft;
+    double approx_max = -INFINITY;
+    for (long lag = -max_lag; lag <= max_lag; ++lag) {
+        long overlap = overlap_at(lag, (long)n, (long)m);
+        if (overlap < min_overlap) continue;
+        size_t slot = (size_t)(lag >= 0 ? lag : (long)nfft + lag);
+        double corr = clamp1(buf[2 * slot] * scale / ((double)overlap * (double)dims));
+        buf[2 * slot + 1] = corr; // the imaginary part is spare: keep the estimate there
+        if (corr > approx_max) approx_max = corr;
+    }
+
+    double best = -1.0;
+    long best_lag = 0;
+    if (approx_max > -INFINITY) {
+        double tol = XCORR_TOL * sqrt(sum_sq(a, n * dims) * sum_sq(b, m * dims)) /
+                     ((double)min_overlap * (double)dims);
+        for (long lag = -max_lag; lag <= max_lag; ++lag) {
+            long overlap = overlap_at(lag, (long)n, (long)m);
+            if (overlap < min_overlap) continue;
+            size_t slot = (size_t)(lag >= 0 ? lag : (long)nfft + lag);
+            if (buf[2 * slot + 1] < approx_max - tol) continue;
+            size_t a0 = lag >= 0 ? (size_t)lag : 0;
+            size_t b0 = lag >= 0 ? 0 : (size_t)(-lag);
+            double dot = dot_at(a, b, dims, a0, b0, (size_t)overlap);
+            double corr = clamp1(dot / (double)(overlap * (long)dims));
+            if (corr > best) {
+                best = corr;
+                best_lag = lag;
+            }
+        }
+    }
+    if (buf != stack_buf) free(buf);
+    *best_out = best;
+    *lag_out = best_lag;
+    return 0;
+}
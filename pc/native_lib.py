@@ -0,0 +1,391 @@
+#!/usr/bin/env python3
+# Builds host copies of portable C modules (firmware/main) and host-only kernels
+# (pc/native) on first use and loads them via ctypes.
+# Callers keep a pure-Python fallback for when no C compiler is available.
+import ctypes
+import os
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+REPO_ROOT = Path(__file__).resolve().parents[1]
+FIRMWARE_MAIN = REPO_ROOT / "firmware" / "main"
+PC_NATIVE = Path(__file__).resolve().parent / "native"  # host-only kernels
+BUILD_DIR = Path(__file__).resolve().parent / ".native_build"
+LIB_SUFFIX = ".dylib" if sys.platform == "darwin" else ".so"
+
+_cache: dict[str, ctypes.CDLL | None] = {}
+
+
+class ImuSample(ctypes.Structure):
+    # Mirrors bmi270_sample_t in firmware/main/imu_sample.h.
+    _fields_ = [
+        ("ts_us", ctypes.c_int64),
+        ("ax", ctypes.c_int16),
+        ("ay", ctypes.c_int16),
+        ("az", ctypes.c_int16),
+        ("gx", ctypes.c_int16),
+        ("gy", ctypes.c_int16),
+        ("gz", ctypes.c_int16),
+    ]
+
+
+def load_library(
+    name: str, sources: list[Path], include_dirs: list[Path], cflags: tuple[str, ...] = ()
+) -> ctypes.CDLL | None:
+    if name in _cache:
+        return _cache[name]
+    lib = None
+    if os.environ.get("ACTION_DETECT_NO_NATIVE", "") not in ("", "0"):
+        _cache[name] = None
+        return None
+    out = BUILD_DIR / f"lib{name}{LIB_SUFFIX}"
+    try:
+        newest_src = max(p.stat().st_mtime for p in sources)
+        stale = not out.exists() or out.stat().st_mtime < newest_src
+        if stale:
+            cc = os.environ.get("CC") or shutil.which("cc") or shutil.which("gcc")
+            if cc is None:
+                raise RuntimeError("no C compiler found")
+            BUILD_DIR.mkdir(parents=True, exist_ok=True)
+            cmd = [cc, "-O2", "-std=gnu11", "-shared", "-fPIC", *cflags, "-o", str(out)]
+            cmd += [f"-I{p}" for p in include_dirs]
+            cmd += [str(p) for p in sources]
+            subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+        lib = ctypes.CDLL(str(out))
+    except (OSError, RuntimeError, subprocess.CalledProcessError) as e:
+        print(f"native_lib: {name} unavailable, using Python fallback ({e})")
+        lib = None
+    _cache[name] = lib
+    return lib
+
+
+def load_imu_codec() -> ctypes.CDLL | None:
+    lib = load_library(
+        "imu_codec",
+        sources=[FIRMWARE_MAIN / "imu_codec.c"],
+        include_dirs=[FIRMWARE_MAIN],
+    )
+    if lib is None:
+        return None
+    lib.imu_codec_decode_block.restype = ctypes.c_size_t
+    lib.imu_codec_decode_block.argtypes = [
+        ctypes.c_char_p,
+        ctypes.c_size_t,
+        ctypes.c_size_t,
+        ctypes.POINTER(ImuSample),
+        ctypes.c_size_t,
+    ]
+    lib.imu_codec_encode_blocks.restype = ctypes.c_size_t
+    lib.imu_codec_encode_blocks.argtypes = [
+        ctypes.POINTER(ImuSample),
+        ctypes.c_size_t,
+        ctypes.c_size_t,
+        ctypes.c_char_p,
+        ctypes.c_size_t,
+    ]
+    return lib
+
+
+# motion_trigger_emit_fn
+MotionEmitFn = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.POINTER(ImuSample))
+
+
+def load_motion_trigger() -> ctypes.CDLL | None:
+    lib = load_library(
+        "motion_trigger",
+        sources=[FIRMWARE_MAIN / "motion_trigger.c"],
+        include_dirs=[FIRMWARE_MAIN],
+    )
+    if lib is None:
+        return None
+    lib.motion_trigger_init.restype = ctypes.c_bool
+    lib.motion_trigger_init.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.POINTER(ImuSample)]
+    lib.motion_trigger_push.restype = ctypes.c_int
+    lib.motion_trigger_push.argtypes = [
+        ctypes.c_void_p,
+        ctypes.c_void_p,
+        MotionEmitFn,
+        ctypes.c_void_p,
+    ]
+    return lib
+
+
+def load_action_classifier() -> ctypes.CDLL | None:
+    lib = load_library(
+        "action_classifier",
+        sources=[FIRMWARE_MAIN / "action_classifier.c"],
+        include_dirs=[FIRMWARE_MAIN],
+    )
+    if lib is None:
+        return None
+    lib.action_model_load.restype = ctypes.c_bool
+    lib.action_model_load.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t]
+    lib.action_classifier_prep.restype = ctypes.c_size_t
+    lib.action_classifier_prep.argtypes = [
+        ctypes.c_void_p,
+        ctypes.POINTER(ImuSample),
+        ctypes.c_size_t,
+        ctypes.c_uint32,
+        ctypes.c_void_p,
+    ]
+    lib.action_classifier_classify.restype = None
+    lib.action_classifier_classify.argtypes = [
+        ctypes.c_void_p,
+        ctypes.c_void_p,
+        ctypes.c_size_t,
+        ctypes.c_int,
+        ctypes.c_void_p,
+    ]
+    return lib
+
+
+def load_bmi270_fifo() -> ctypes.CDLL | None:
+    lib = load_library(
+        "bmi270_fifo",
+        sources=[FIRMWARE_MAIN / "bmi270_fifo.c"],
+        include_dirs=[FIRMWARE_MAIN],
+    )
+    if lib is None:
+        return None
+    lib.bmi270_fifo_parser_init.restype = None
+    lib.bmi270_fifo_parser_init.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+    lib.bmi270_fifo_parse.restype = ctypes.c_size_t
+    lib.bmi270_fifo_parse.argtypes = [
+        ctypes.c_void_p,  # bmi270_fifo_parser_t *
+        ctypes.c_char_p,
+        ctypes.c_size_t,
+        ctypes.c_int64,
+        ctypes.POINTER(ImuSample),
+        ctypes.c_size_t,
+    ]
+    return lib
+
+
+def load_imu_ring() -> ctypes.CDLL | None:
+    # imu_ring.c with the two-thread stress harness (pc/native/ring_stress.c).
+    lib = load_library(
+        "imu_ring",
+        sources=[FIRMWARE_MAIN / "imu_ring.c", PC_NATIVE / "ring_stress.c"],
+        include_dirs=[FIRMWARE_MAIN],
+        cflags=("-pthread",),
+    )
+    if lib is None:
+        return None
+    for fn in (lib.ring_stress, lib.queue_stress):
+        fn.restype = ctypes.c_int
+        fn.argtypes = [
+            ctypes.c_uint32,
+            ctypes.c_uint64,
+            ctypes.c_int,
+            ctypes.c_uint32,
+            ctypes.c_uint32,
+            ctypes.c_void_p,  # ring_stress_result_t *
+        ]
+    return lib
+
+
+def load_audio_jitter() -> ctypes.CDLL | None:
+    lib = load_library(
+        "audio_jitter",
+        sources=[FIRMWARE_MAIN / "audio_jitter.c"],
+        include_dirs=[FIRMWARE_MAIN],
+    )
+    if lib is None:
+        return None
+    lib.audio_jb_init.restype = ctypes.c_bool
+    lib.audio_jb_init.argtypes = [
+        ctypes.c_void_p,
+        ctypes.c_void_p,
+        ctypes.POINTER(ctypes.c_int16),
+        ctypes.c_uint16,
+        ctypes.c_uint16,
+    ]
+    lib.audio_jb_start.restype = None
+    lib.audio_jb_start.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+    lib.audio_jb_end.restype = None
+    lib.audio_jb_end.argtypes = [ctypes.c_void_p]
+    lib.audio_jb_put.restype = ctypes.c_int
+    lib.audio_jb_put.argtypes = [
+        ctypes.c_void_p,
+        ctypes.c_uint16,
+        ctypes.POINTER(ctypes.c_int16),
+        ctypes.c_size_t,
+    ]
+    lib.audio_jb_pull.restype = ctypes.c_int
+    lib.audio_jb_pull.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_int16), ctypes.c_size_t]
+    return lib
+
+
+def load_audio_adpcm() -> ctypes.CDLL | None:
+    lib = load_library(
+        "audio_adpcm",
+        sources=[FIRMWARE_MAIN / "audio_adpcm.c"],
+        include_dirs=[FIRMWARE_MAIN],
+    )
+    if lib is None:
+        return None
+    lib.audio_adpcm_encode_block.restype = ctypes.c_size_t
+    lib.audio_adpcm_encode_block.argtypes = [
+        ctypes.POINTER(ctypes.c_int16),
+        ctypes.c_size_t,
+        ctypes.POINTER(ctypes.c_uint8),
+        ctypes.c_char_p,
+        ctypes.c_size_t,
+    ]
+    lib.audio_adpcm_decode_block.restype = ctypes.c_size_t
+    lib.audio_adpcm_decode_block.argtypes = [
+        ctypes.c_char_p,
+        ctypes.c_size_t,
+        ctypes.c_size_t,
+        ctypes.POINTER(ctypes.c_int16),
+    ]
+    return lib
+
+
+def load_dtw_kernel() -> ctypes.CDLL | None:
+    lib = load_library(
+        "dtw_kernel",
+        sources=[PC_NATIVE / "dtw_kernel.c"],
+        include_dirs=[PC_NATIVE],
+    )
+    if lib is None:
+        return None
+    lib.dtw_band_f32.restype = ctypes.c_double
+    lib.dtw_band_f32.argtypes = [
+        ctypes.POINTER(ctypes.c_float),
+        ctypes.c_size_t,
+        ctypes.POINTER(ctypes.c_float),
+        ctypes.c_size_t,
+        ctypes.c_long,
+    ]
+    lib.dtw_dba_accumulate_f32.restype = ctypes.c_double
+    lib.dtw_dba_accumulate_f32.argtypes = [
+        ctypes.POINTER(ctypes.c_float),
+        ctypes.c_size_t,
+        ctypes.POINTER(ctypes.c_float),
+        ctypes.c_size_t,
+        ctypes.c_long,
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.POINTER(ctypes.c_uint),
+    ]
+    lib.spring_push_f32.restype = ctypes.c_size_t
+    lib.spring_push_f32.argtypes = [
+        ctypes.c_void_p,  # const spring_ref_t *
+        ctypes.c_size_t,
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.POINTER(ctypes.c_longlong),
+        ctypes.c_void_p,  # spring_match_t *
+        ctypes.POINTER(ctypes.c_float),
+        ctypes.c_longlong,
+        ctypes.c_void_p,  # spring_match_t *
+        ctypes.POINTER(ctypes.c_longlong),
+    ]
+    lib.dtw_open_end_push_f32.restype = None
+    lib.dtw_open_end_push_f32.argtypes = [
+        ctypes.c_void_p,  # const spring_ref_t *
+        ctypes.c_size_t,
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.POINTER(ctypes.c_float),
+        ctypes.c_int,
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.POINTER(ctypes.c_size_t),
+    ]
+    return lib
+
+
+def load_xcorr_kernel() -> ctypes.CDLL | None:
+    lib = load_library(
+        "xcorr_kernel",
+        sources=[PC_NATIVE / "xcorr_kernel.c"],
+        include_dirs=[PC_NATIVE],
+        # Exact re-scoring must round like the Python dot product.
+        cflags=("-ffp-contract=off",),
+    )
+    if lib is None:
+        return None
+    dbl_p = ctypes.POINTER(ctypes.c_double)
+    lib.xcorr_twiddles.restype = None
+    lib.xcorr_twiddles.argtypes = [ctypes.c_size_t, dbl_p]
+    lib.xcorr_widen_f32.restype = None
+    lib.xcorr_widen_f32.argtypes = [
+        ctypes.POINTER(ctypes.c_float),
+        ctypes.c_size_t,
+        ctypes.c_size_t,
+        ctypes.c_size_t,
+        dbl_p,
+    ]
+    lib.xcorr_spectrum.restype = ctypes.c_int
+    lib.xcorr_spectrum.argtypes = [dbl_p, ctypes.c_size_t, ctypes.c_size_t, ctypes.c_size_t, dbl_p, dbl_p]
+    lib.xcorr_best_lag.restype = ctypes.c_int
+    lib.xcorr_best_lag.argtypes = [
+        dbl_p,
+        ctypes.c_size_t,
+        dbl_p,
+        dbl_p,
+        ctypes.c_size_t,
+        dbl_p,
+        ctypes.c_size_t,
+        ctypes.c_size_t,
+        dbl_p,
+        ctypes.c_long,
+        ctypes.c_long,
+        dbl_p,
+        ctypes.POINTER(ctypes.c_long),
+    ]
+    return lib
+
+
+def load_q16_kernel() -> ctypes.CDLL | None:
+    lib = load_library(
+        "q16_kernel",
+        sources=[PC_NATIVE / "q16_kernel.c"],
+        include_dirs=[PC_NATIVE],
+        # The xcorr's final scaling must round like the Python twin's.
+        cflags=("-ffp-contract=off",),
+    )
+    if lib is None:
+        return None
+    lib.q16_score.restype = ctypes.c_int
+    lib.q16_score.argtypes = [
+        ctypes.POINTER(ctypes.c_int16),
+        ctypes.c_size_t,
+        ctypes.c_void_p,  # const q16_ref_t *
+        ctypes.c_size_t,
+        ctypes.POINTER(ctypes.c_int64),
+        ctypes.c_size_t,
+        ctypes.c_double,
+        ctypes.c_double,
+        ctypes.c_int,
+        ctypes.c_double,
+        ctypes.c_double,
+        ctypes.POINTER(ctypes.c_int64),
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.POINTER(ctypes.c_long),
+    ]
+    return lib
+
+
+def load_udp_ingest() -> ctypes.CDLL | None:
+    lib = load_library(
+        "udp_ingest",
+        sources=[PC_NATIVE / "udp_ingest.c", FIRMWARE_MAIN / "imu_codec.c"],
+        include_dirs=[PC_NATIVE, FIRMWARE_MAIN],
+    )
+    if lib is None:
+        return None
+    lib.udp_ingest_recv.restype = ctypes.c_long
+    lib.udp_ingest_recv.argtypes = [
+        ctypes.c_int,
+        ctypes.c_int,
+        ctypes.c_void_p,
+        ctypes.c_size_t,
+        ctypes.c_size_t,
+        ctypes.c_void_p,  # ingest_msg_t *
+        ctypes.c_void_p,  # ingest_sample_t *
+        ctypes.c_size_t,
+        ctypes.c_uint64,
+        ctypes.c_size_t,
+    ]
+    return lib
@@ -0,0 +1,359 @@
+#!/usr/bin/env python3
+# Reference condensation (build_model.py --condense): each label's captures
+# become a few prototypes, so live scoring, linear in the reference count,
+# gets cheaper. A label's captures are clustered by k-medoids on their
+# pairwise DTW (the calibration matrix build_model.py keeps anyway), each
+# cluster is averaged by DTW barycenter averaging (DBA) from its medoid, and
+# the captures the prototypes still label wrong are kept as they are ("hard"
+# references). Label scores still average each label's per_label_k nearest
+# references, so every label keeps at least that many.
+import argparse
+import ctypes
+import time
+from array import array
+from collections import defaultdict
+from collections.abc import Callable
+from dataclasses import dataclass, field
+from pathlib import Path
+
+from dtw_baseline import (
+    DTW_STRIDE,
+    LabeledSequence,
+    PairMatrix,
+    ScoringEngine,
+    add_seq_cache_args,
+    build_pair_matrix,
+    effective_window,
+    load_labeled_sequences,
+    metrics,
+    pack_sequence,
+    point_cost,
+    points_sequence,
+    read_manifest,
+    seq_cache_path,
+    split_stratified,
+)
+from native_lib import load_dtw_kernel
+
+DBA_ITERATIONS = 10
+# DBA stops early once no prototype coordinate moves more than this.
+DBA_TOLERANCE = 1e-4
+KMEDOIDS_ITERATIONS = 20
+HARD_PER_LABEL = 2
+
+
+@dataclass
+class CondenseReport:
+    refs_in: int = 0
+    prototypes: int = 0
+    hard: int = 0
+    seconds: float = 0.0
+    # label -> (captures, prototypes, hard)
+    per_label: dict = field(default_factory=dict)
+
+    @property
+    def refs_out(self) -> int:
+        return self.prototypes + self.hard
+
+
+def dtw_align_py(
+    a: list[tuple[float, ...]], b: list[tuple[float, ...]], window: int
+) -> tuple[float, list[tuple[int, int]]]:
+    # Banded DTW keeping the whole cost matrix, plus the warping path (0-based
+    # point pairs, last first) walked back like dtw_dba_accumulate_f32().
+    n = len(a)
+    m = len(b)
+    window = effective_window(n, m, window)
+    inf = float("inf")
+    cost = [[inf] * (m + 1) for _ in range(n + 1)]
+    cost[0][0] = 0.0
+    for i in range(1, n + 1):
+        prev = cost[i - 1]
+        curr = cost[i]
+        ai = a[i - 1]
+        for j in range(max(1, i - window), min(m, i + window) + 1):
+            curr[j] = point_cost(ai, b[j - 1]) + min(curr[j - 1], prev[j], prev[j - 1])
+    path: list[tuple[int, int]] = []
+    i, j = n, m
+    while i > 0 and j > 0:
+        path.append((i - 1, j - 1))
+        diag = cost[i - 1][j - 1]
+        up = cost[i - 1][j]
+        left = cost[i][j - 1]
+        if diag <= up and diag <= left:
+            i -= 1
+            j -= 1
+        elif up <= left:
+            i -= 1
+        else:
+            j -= 1
+    return cost[n][m], path
+
+
+def dba(
+    members: list[list[tuple[float, ...]]],
+    init: list[tuple[float, ...]],
+    window_frac: float,
+    iterations: int = DBA_ITERATIONS,
+) -> list[tuple[float, ...]]:
+    # DTW barycenter of members, refined from init (same length throughout):
+    # every round aligns each member to the current centre and moves every
+    # centre point to the mean of the member points matched with it.
+    lib = load_dtw_kernel()
+    dims = len(init[0])
+    n = len(init)
+    center = [tuple(p) for p in init]
+    packed = [pack_sequence(x) for x in members] if lib is not None else []
+    for _ in range(iterations):
+        if lib is not None:
+            sums = (ctypes.c_double * (n * DTW_STRIDE))()
+            counts = (ctypes.c_uint * n)()
+            cp = pack_sequence(center)
+            for seq, sp in zip(members, packed):
+                window = int(round(max(n, len(seq)) * window_frac))
+                lib.dtw_dba_accumulate_f32(cp, n, sp, len(seq), window, sums, counts)
+        else:
+            sums = [0.0] * (n * DTW_STRIDE)
+            counts = [0] * n
+            for seq in members:
+                window = int(round(max(n, len(seq)) * window_frac))
+                for i, j in dtw_align_py(center, seq, window)[1]:
+                    base = i * DTW_STRIDE
+                    for k, v in enumerate(seq[j]):
+                        sums[base + k] += v
+                    counts[i] += 1
+        new = [tuple(sums[i * DTW_STRIDE + k] / counts[i] for k in range(dims)) for i in range(n)]
+        moved = max(abs(x - y) for p, q in zip(new, center) for x, y in zip(p, q))
+        center = new
+        if moved <= DBA_TOLERANCE:
+            break
+    return center
+
+
+def kmedoids(members: list[int], dist: Callable[[int, int], float], k: int) -> list[list[int]]:
+    # k clusters of members (medoid first), deterministic: farthest-first
+    # seeding from the overall medoid, then alternating assignment and
+    # medoid update until nothing moves.
+    if k >= len(members):
+        return [[i] for i in members]
+    medoids = [min(members, key=lambda i: sum(dist(i, j) for j in members))]
+    near = {i: dist(i, medoids[0]) for i in members}
+    while len(medoids) < k:
+        far = max(members, key=lambda i: near[i])
+        medoids.append(far)
+        for i in members:
+            near[i] = min(near[i], dist(i, far))
+    clusters: list[list[int]] = []
+    for _ in range(KMEDOIDS_ITERATIONS):
+        clusters = [[m] for m in medoids]
+        for i in members:
+            if i not in medoids:
+                clusters[min(range(k), key=lambda c: dist(i, medoids[c]))].append(i)
+        new = [min(cl, key=lambda i: sum(dist(i, j) for j in cl)) for cl in clusters]
+        if new == medoids:
+            break
+        medoids = new
+    return [[m] + [i for i in cl if i != m] for m, cl in zip(medoids, clusters)]
+
+
+def prototype_sequence(points: list[tuple[float, ...]]) -> list[tuple[float, ...]]:
+    # float32 like every loaded reference (see load_labeled_sequences()).
+    dims = len(points[0])
+    flat = array("f", bytes(4 * DTW_STRIDE * len(points)))
+    for i, p in enumerate(points):
+        flat[i * DTW_STRIDE : i * DTW_STRIDE + dims] = array("f", p)
+    return points_sequence(flat, dims)
+
+
+def condense_references(
+    refs: list[LabeledSequence],
+    pairs: PairMatrix,
+    prototypes: int,
+    per_label_k: int,
+    window_frac: float,
+    make_engine: Callable[[list[LabeledSequence]], ScoringEngine],
+    score_mode: str,
+    hybrid_alpha: float,
+    hard: int = HARD_PER_LABEL,
+    iterations: int = DBA_ITERATIONS,
+) -> tuple[list[LabeledSequence], CondenseReport]:
+    # pairs: build_pair_matrix() over refs. Each label keeps
+    # max(prototypes, per_label_k) prototypes (a single-capture cluster is
+    # that capture), then up to `hard` of its captures that the prototypes
+    # score as another label, worst first. make_engine(refs) scores captures
+    # against the prototypes for that check.
+    t0 = time.perf_counter()
+    n = len(refs)
+    by_label: dict[str, list[int]] = defaultdict(list)
+    for i, item in enumerate(refs):
+        by_label[item.label].append(i)
+    k = max(prototypes, per_label_k)
+    protos: dict[str, list[LabeledSequence]] = {}
+    for label, members in by_label.items():
+        protos[label] = []
+        for c, cluster in enumerate(kmedoids(members, lambda i, j: pairs.dtw[i * n + j], k)):
+            if len(cluster) == 1:
+                protos[label].append(refs[cluster[0]])
+                continue
+            center = dba([refs[i].seq for i in cluster], refs[cluster[0]].seq, window_frac, iterations)
+            raw = [refs[i].raw_len for i in cluster if refs[i].raw_len > 0]
+            protos[label].append(
+                LabeledSequence(
+                    label=label,
+                    path=Path(f"prototype/{label}_{c + 1:02d}_of_{len(cluster)}"),
+                    seq=prototype_sequence(center),
+                    raw_len=round(sum(raw) / len(raw)) if raw else 0,
+                )
+            )
+
+    kept = {id(x) for rows in protos.values() for x in rows}
+    wrong: dict[str, list[tuple[float, int]]] = defaultdict(list)
+    if hard > 0:
+        with make_engine([x for rows in protos.values() for x in rows]) as engine:
+            for i, item in enumerate(refs):
+                if id(item) in kept:
+                    continue
+                scores = engine.query_scores(item.seq, per_label_k, score_mode, hybrid_alpha)[0]
+                best = min(scores, key=scores.get)
+                if best != item.label:
+                    own = scores.get(item.label, float("inf"))
+                    wrong[item.label].append((own / max(scores[best], 1e-9), i))
+
+    out: list[LabeledSequence] = []
+    report = CondenseReport(refs_in=n)
+    for label, members in by_label.items():
+        extra = [refs[i] for _ratio, i in sorted(wrong[label], reverse=True)[:hard]]
+        out.extend(protos[label])
+        out.extend(extra)
+        report.prototypes += len(protos[label])
+        report.hard += len(extra)
+        report.per_label[label] = (len(members), len(protos[label]), len(extra))
+    report.seconds = time.perf_counter() - t0
+    return out, report
+
+
+@dataclass
+class SplitResult:
+    prototypes: int  # 0 = every training capture
+    refs: int
+    accuracy: float
+    query_ms: float
+
+
+def evaluate_split(
+    train: list[LabeledSequence],
+    test: list[LabeledSequence],
+    settings: list[int],
+    per_label_k: int,
+    window_frac: float,
+    make_engine: Callable[[list[LabeledSequence]], ScoringEngine],
+    score_mode: str,
+    hybrid_alpha: float,
+    hard: int = HARD_PER_LABEL,
+) -> list[SplitResult]:
+    # Test accuracy (best label score, no reject gate) and mean query time of
+    # the full training set, then of the training set condensed to each
+    # prototype count in settings.
+    def run(refs: list[LabeledSequence], k: int) -> SplitResult:
+        with make_engine(refs) as engine:
+            y_pred = []
+            t0 = time.perf_counter()
+            for item in test:
+                scores = engine.query_scores(item.seq, per_label_k, score_mode, hybrid_alpha)[0]
+                y_pred.append(min(scores, key=scores.get))
+            elapsed = time.perf_counter() - t0
+        acc = metrics([x.label for x in test], y_pred)["accuracy"]
+        return SplitResult(k, len(refs), acc, elapsed * 1000 / max(1, len(test)))
+
+    results = [run(train, 0)]
+    with make_engine(train) as engine:
+        pairs = build_pair_matrix(engine)
+    for k in settings:
+        condensed, _report = condense_references(
+            train, pairs, k, per_label_k, window_frac, make_engine, score_mode, hybrid_alpha, hard=hard
+        )
+        results.append(run(condensed, k))
+    return results
+
+
+def format_split(results: list[SplitResult]) -> list[str]:
+    full = results[0]
+    lines = [f"full refs={full.refs} accuracy={full.accuracy:.4f} query_ms={full.query_ms:.2f}"]
+    for r in results[1:]:
+        lines.append(
+            f"condensed prototypes={r.prototypes} refs={r.refs} ({full.refs / max(1, r.refs):.1f}x fewer) "
+            f"accuracy={r.accuracy:.4f} delta={r.accuracy - full.accuracy:+.4f} "
+            f"query_ms={r.query_ms:.2f} speedup={full.query_ms / max(r.query_ms, 1e-9):.1f}x"
+        )
+    return lines
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Accuracy vs reference count of condensed models on a stratified split."
+    )
+    parser.add_argument("--manifest", type=Path, default=Path("data/labels/manifest.jsonl"))
+    parser.add_argument("--session", default="", help="Optional session_id filter")
+    parser.add_argument("--labels", default="", help="Optional comma-separated label filter")
+    parser.add_argument(
+        "--prototypes",
+        default="1,2,4,8",
+        help="Comma-separated prototypes per label to try (raised to --per-label-k)",
+    )
+    parser.add_argument("--hard", type=int, default=HARD_PER_LABEL, help="Hard captures kept per label")
+    parser.add_argument("--test-ratio", type=float, default=0.3)
+    parser.add_argument("--seed", type=int, default=7)
+    parser.add_argument("--max-points", type=int, default=180)
+    parser.add_argument("--no-znorm", action="store_true")
+    add_seq_cache_args(parser)
+    parser.add_argument("--window-frac", type=float, default=0.2)
+    parser.add_argument("--per-label-k", type=int, default=3)
+    parser.add_argument("--score-mode", choices=("dtw", "hybrid", "xcorr"), default="hybrid")
+    parser.add_argument("--hybrid-alpha", type=float, default=0.35)
+    parser.add_argument("--xcorr-max-lag-frac", type=float, default=0.15)
+    parser.add_argument("--xcorr-min-overlap-frac", type=float, default=0.50)
+    parser.add_argument("--workers", type=int, default=0)
+    return parser.parse_args()
+
+
+def main() -> int:
+    args = parse_args()
+    labels = {x.strip().lower() for x in args.labels.split(",") if x.strip()}
+    rows = read_manifest(args.manifest, session=args.session, labels=labels)
+    if not rows:
+        raise ValueError("no samples selected from manifest")
+    items = load_labeled_sequences(
+        rows, max_points=args.max_points, use_znorm=not args.no_znorm, cache_path=seq_cache_path(args)
+    )
+    train, test = split_stratified(items, test_ratio=args.test_ratio, seed=args.seed)
+    print(f"train={len(train)} test={len(test)} labels={sorted({x.label for x in items})}")
+
+    def make_engine(refs: list[LabeledSequence]) -> ScoringEngine:
+        return ScoringEngine(
+            refs,
+            query_len=args.max_points,
+            window_frac=args.window_frac,
+            xcorr_max_lag_frac=args.xcorr_max_lag_frac,
+            xcorr_min_overlap_frac=args.xcorr_min_overlap_frac,
+            workers=args.workers,
+        )
+
+    settings = [int(x) for x in args.prototypes.split(",") if x.strip()]
+    results = evaluate_split(
+        train,
+        test,
+        settings,
+        per_label_k=args.per_label_k,
+        window_frac=args.window_frac,
+        make_engine=make_engine,
+        score_mode=args.score_mode,
+        hybrid_alpha=args.hybrid_alpha,
+        hard=args.hard,
+    )
+    for line in format_split(results):
+        print(line)
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
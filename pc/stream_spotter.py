@@ -0,0 +1,512 @@
+#!/usr/bin/env python3
+# Always-on gesture spotting for live_classify.py --mode stream. The live
+# stream is matched against every model reference with SPRING subsequence DTW
+# (spring_push_f32() in native/dtw_kernel.c, spring_push_py() its twin).
+# Each stream point adds one DTW column per reference, so per-sample cost and
+# memory are fixed by the reference set.
+#
+# The stream is first brought to the references' shape:
+#   - it is thinned to their point density (spot_step raw samples per point);
+#   - for z-normalized models, each point is normalized per axis over the
+#     norm window centred on it, which delays points by half a window.
+#
+# A reference reports a match once no path still overlapping it can do
+# better. Overlapping matches from different references are merged into one
+# detection, keeping the match furthest under its label's spot threshold.
+#
+# Running this file replays a manifest's captures back to back through the
+# native and Python spotters, checks that the two agree, and reports which
+# captures were found.
+import argparse
+import ctypes
+import math
+import time
+from collections import deque
+from dataclasses import dataclass, field
+from pathlib import Path
+
+from capture_file import manifest_capture_path
+from dtw_baseline import (
+    DTW_STRIDE,
+    LabeledSequence,
+    PairMatrix,
+    ScoringEngine,
+    calibrate_label_thresholds,
+    packed_ref,
+    point_cost,
+    read_manifest,
+    read_sequence,
+)
+from model_file import load_model
+from native_lib import load_dtw_kernel
+
+# Longest match kept, in longest-reference lengths; bounds the raw history.
+SPOT_MAX_SPAN = 4
+
+
+class _SpringRef(ctypes.Structure):
+    # Mirrors spring_ref_t in native/dtw_kernel.c.
+    _fields_ = [
+        ("seq", ctypes.POINTER(ctypes.c_float)),
+        ("len", ctypes.c_size_t),
+        ("threshold", ctypes.c_double),
+    ]
+
+
+class _SpringMatch(ctypes.Structure):
+    # Mirrors spring_match_t in native/dtw_kernel.c.
+    _fields_ = [
+        ("dist", ctypes.c_double),
+        ("start", ctypes.c_longlong),
+        ("end", ctypes.c_longlong),
+        ("ref", ctypes.c_size_t),
+    ]
+
+
+@dataclass
+class SpotMatch:
+    ref: int
+    dist: float
+    start: int  # stream points, inclusive
+    end: int
+
+
+@dataclass
+class Detection:
+    label: str  # label of the reference that matched best
+    ref: int
+    dist: float
+    threshold: float
+    start_us: int
+    end_us: int
+    samples: list[tuple[float, ...]]  # raw samples of the matched span
+
+
+@dataclass
+class SpotStats:
+    samples: int = 0
+    points: int = 0
+    matches: int = 0
+    detections: int = 0
+    too_long: int = 0
+    busy_ns: int = 0
+    max_ns: int = 0
+    # Per-sample processing times since the last reset, for percentiles.
+    recent: deque = field(default_factory=lambda: deque(maxlen=8192), repr=False)
+
+    def add_sample(self, ns: int) -> None:
+        self.samples += 1
+        self.busy_ns += ns
+        self.max_ns = max(self.max_ns, ns)
+        self.recent.append(ns)
+
+    def mean_us(self) -> float:
+        return self.busy_ns / self.samples / 1000.0 if self.samples else 0.0
+
+    def percentile_us(self, q: float) -> float:
+        if not self.recent:
+            return 0.0
+        vals = sorted(self.recent)
+        return vals[min(len(vals) - 1, int(q * len(vals)))] / 1000.0
+
+
+def spot_params(
+    engine: ScoringEngine,
+    pairs: PairMatrix | None,
+    q: float,
+    scale: float,
+    queries: list[LabeledSequence] | None = None,
+) -> dict:
+    # Stored in the model params by build_model.py.
+    #   spot_step: raw samples per reference point (the median over
+    #     references of captured / prepped length).
+    #   spot_thresholds: per label, the quantile of each reference's
+    #     leave-one-out nearest same-label DTW distance, times scale. This is
+    #     the reject calibration in "dtw" mode with k = 1, read from the same
+    #     pair matrix (or, for a condensed set, from `queries`; see
+    #     calibrate_label_thresholds()).
+    steps = sorted(x.raw_len / len(x.seq) for x in engine.refs if x.raw_len > 0 and len(x.seq) > 0)
+    thresholds = calibrate_label_thresholds(
+        engine, per_label_k=1, q=q, scale=scale, score_mode="dtw", hybrid_alpha=0.0, pairs=pairs, queries=queries
+    )
+    return {
+        "spot_step": steps[len(steps) // 2] if steps else 1.0,
+        "spot_thresholds": thresholds,
+    }
+
+
+def spring_push_py(
+    refs: list[list[tuple[float, ...]]],
+    thresholds: list[float],
+    d: list[float],
+    s: list[int],
+    cand: list[list],
+    x: tuple[float, ...],
+    t: int,
+) -> tuple[list[SpotMatch], int]:
+    # Same as spring_push_f32(); cand[r] is [dist, start, end].
+    inf = math.inf
+    found: list[SpotMatch] = []
+    open_start = inf
+    off = 0
+    for r, y in enumerate(refs):
+        m = len(y)
+        c = cand[r]
+        left = 0.0
+        left_s = t
+        diag = 0.0
+        diag_s = t
+        blocked = False
+        for j in range(m):
+            up = d[off + j]
+            up_s = s[off + j]
+            best = left
+            best_s = left_s
+            if up < best:
+                best = up
+                best_s = up_s
+            if diag < best:
+                best = diag
+                best_s = diag_s
+            left = point_cost(x, y[j]) + best
+            left_s = best_s
+            d[off + j] = left
+            s[off + j] = left_s
+            if left < c[0] and left_s <= c[2]:
+                blocked = True
+            diag = up
+            diag_s = up_s
+        if c[0] <= thresholds[r] and not blocked:
+            found.append(SpotMatch(ref=r, dist=c[0], start=c[1], end=c[2]))
+            for j in range(m):
+                if s[off + j] <= c[2]:
+                    d[off + j] = inf
+            c[0] = inf
+        last = d[off + m - 1]
+        if last <= thresholds[r] and last < c[0]:
+            c[0] = last
+            c[1] = s[off + m - 1]
+            c[2] = t
+        if c[0] < inf:
+            open_start = min(open_start, c[1])
+        off += m
+    return found, open_start
+
+
+class SpringBank:
+    # The reference side, shared read-only by every StreamSpotter.
+    def __init__(self, refs: list[LabeledSequence], thresholds: dict[str, float], native: bool = True) -> None:
+        self.refs = refs
+        # A label without a spot threshold is never spotted.
+        self.thresholds = [float(thresholds.get(x.label, -1.0)) for x in refs]
+        self.cells = sum(len(x.seq) for x in refs)
+        self.max_len = max((len(x.seq) for x in refs), default=0)
+        self.lib = load_dtw_kernel() if native else None
+        packed = [packed_ref(x) for x in refs] if self.lib is not None else []
+        if self.lib is None or any(p is None for p in packed):
+            self.lib = None
+            self.table = None
+            self.py_refs = [[tuple(p) for p in x.seq] for x in refs]
+            return
+        self._packed = packed
+        self.table = (_SpringRef * len(refs))(
+            *[
+                _SpringRef(ctypes.cast(p, ctypes.POINTER(ctypes.c_float)), len(x.seq), th)
+                for p, x, th in zip(packed, refs, self.thresholds)
+            ]
+        )
+
+
+class StreamSpotter:
+    # One stream's spotting state over a shared SpringBank. push() takes raw
+    # samples (at step raw samples per reference point) and returns the
+    # detections that closed with that sample.
+    def __init__(self, bank: SpringBank, step: float, norm_points: int, use_znorm: bool) -> None:
+        self.bank = bank
+        self.step = max(1.0, step)
+        self.use_znorm = use_znorm
+        self.half = max(1, norm_points // 2) if use_znorm else 0
+        self.max_span = SPOT_MAX_SPAN * max(1, bank.max_len)
+        self.stats = SpotStats()
+        count = len(bank.refs)
+        if bank.lib is not None:
+            self.d = (ctypes.c_double * bank.cells)(*([math.inf] * bank.cells))
+            self.s = (ctypes.c_longlong * bank.cells)()
+            self.cand = (_SpringMatch * count)()
+            for r in range(count):
+                self.cand[r].dist = math.inf
+                self.cand[r].ref = r
+            self.out = (_SpringMatch * max(1, count))()
+            self.point = (ctypes.c_float * DTW_STRIDE)()
+            self.open_start = ctypes.c_longlong()
+        else:
+            self.d = [math.inf] * bank.cells
+            self.s = [0] * bank.cells
+            self.cand = [[math.inf, 0, 0] for _ in range(count)]
+        self.raw: deque = deque()  # (raw index, ts_us, features)
+        self.raw_count = 0
+        self.next_pick = 0.0
+        self.window: deque = deque()  # (raw index, features) of the norm window
+        self.sums: list[float] = []
+        self.sqs: list[float] = []
+        self.point_raw: deque = deque()  # raw index of each recent stream point
+        self.points = 0
+        self.pending: SpotMatch | None = None
+        self.last_end = -1
+        self.last_ts_us = 0
+
+    def set_step(self, step: float) -> None:
+        self.step = max(1.0, step)
+
+    def latency_points(self) -> int:
+        # Stream points a sample waits before its DTW column (normalization).
+        return self.half
+
+    def push(self, ts_us: int, feat: tuple[float, ...]) -> list[Detection]:
+        t0 = time.perf_counter_ns()
+        idx = self.raw_count
+        self.raw_count += 1
+        self.last_ts_us = ts_us
+        self.raw.append((idx, ts_us, feat))
+        keep = int(math.ceil((self.max_span + self.half + 2) * self.step)) + 1
+        while len(self.raw) > keep:
+            self.raw.popleft()
+        out: list[Detection] = []
+        if idx >= self.next_pick:
+            self.next_pick += self.step
+            out = self._thin_point(idx, feat)
+        self.stats.add_sample(time.perf_counter_ns() - t0)
+        return out
+
+    def _thin_point(self, idx: int, feat: tuple[float, ...]) -> list[Detection]:
+        if not self.use_znorm:
+            return self._column(idx, feat)
+        if not self.sums:
+            self.sums = [0.0] * len(feat)
+            self.sqs = [0.0] * len(feat)
+        self.window.append((idx, feat))
+        for i, v in enumerate(feat):
+            self.sums[i] += v
+            self.sqs[i] += v * v
+        if len(self.window) > 2 * self.half + 1:
+            _old_idx, old = self.window.popleft()
+            for i, v in enumerate(old):
+                self.sums[i] -= v
+                self.sqs[i] -= v * v
+        if len(self.window) <= self.half:
+            return []
+        center_idx, center = self.window[-1 - self.half]
+        inv_n = 1.0 / len(self.window)
+        norm = []
+        for i, v in enumerate(center):
+            mean = self.sums[i] * inv_n
+            var = self.sqs[i] * inv_n - mean * mean
+            std = math.sqrt(var) if var > 0 else 1.0
+            norm.append((v - mean) / (std if std > 1e-12 else 1.0))
+        return self._column(center_idx, tuple(norm))
+
+    def _column(self, raw_idx: int, x: tuple[float, ...]) -> list[Detection]:
+        t = self.points
+        self.points += 1
+        self.stats.points += 1
+        self.point_raw.append(raw_idx)
+        if len(self.point_raw) > self.max_span + 1:
+            self.point_raw.popleft()
+        bank = self.bank
+        if bank.lib is not None:
+            pt = self.point
+            for i, v in enumerate(x):
+                pt[i] = v
+            n = bank.lib.spring_push_f32(
+                bank.table, len(bank.refs), self.d, self.s, self.cand, pt, t, self.out, ctypes.byref(self.open_start)
+            )
+            matches = [
+                SpotMatch(ref=self.out[i].ref, dist=self.out[i].dist, start=self.out[i].start, end=self.out[i].end)
+                for i in range(n)
+            ]
+            open_start = self.open_start.value
+        else:
+            # Same float32 points the native kernel sees.
+            x = tuple(ctypes.c_float(v).value for v in x)
+            matches, open_start = spring_push_py(bank.py_refs, bank.thresholds, self.d, self.s, self.cand, x, t)
+
+        out: list[Detection] = []
+        for m in matches:
+            self.stats.matches += 1
+            if m.start <= self.last_end:
+                continue
+            if self.pending is None or m.start > self.pending.end:
+                self._flush(out)
+                self.pending = m
+            elif self._ratio(m) < self._ratio(self.pending):
+                self.pending = m
+        if self.pending is not None and open_start > self.pending.end:
+            self._flush(out)
+        return out
+
+    def _ratio(self, m: SpotMatch) -> float:
+        return m.dist / max(self.bank.thresholds[m.ref], 1e-12)
+
+    def _flush(self, out: list[Detection]) -> None:
+        m = self.pending
+        if m is None:
+            return
+        self.pending = None
+        self.last_end = m.end
+        first_point = self.points - len(self.point_raw)
+        if m.end - m.start + 1 > self.max_span or m.start < first_point:
+            self.stats.too_long += 1
+            return
+        lo = self.point_raw[m.start - first_point]
+        hi = self.point_raw[m.end - first_point]
+        first_raw = self.raw[0][0]
+        if lo < first_raw:
+            self.stats.too_long += 1
+            return
+        span = [self.raw[i - first_raw] for i in range(lo, hi + 1)]
+        self.stats.detections += 1
+        ref = self.bank.refs[m.ref]
+        out.append(
+            Detection(
+                label=ref.label,
+                ref=m.ref,
+                dist=m.dist,
+                threshold=self.bank.thresholds[m.ref],
+                start_us=span[0][1],
+                end_us=span[-1][1],
+                samples=[x[2] for x in span],
+            )
+        )
+
+
+def spotter_for_model(
+    refs: list[LabeledSequence],
+    params: dict,
+    stream_hz: float,
+    native: bool = True,
+    step: float = 0.0,
+    norm_frac: float = 1.0,
+    background: frozenset[str] = frozenset(),
+    bank: SpringBank | None = None,
+) -> StreamSpotter:
+    # step: raw stream samples per reference point (0 = the model's
+    # spot_step, rescaled from the model rate to stream_hz). norm_frac: norm
+    # window as a fraction of the median reference length. background:
+    # labels that describe the stream between gestures (e.g. idle), which
+    # match almost anywhere and are not spotted. bank: one an earlier call
+    # built for the same arguments, to share between streams.
+    if bank is None:
+        grace = max(1.0, float(params.get("reject_threshold_grace", 1.0)))
+        thresholds = {
+            k: float(v) * grace for k, v in (params.get("spot_thresholds") or {}).items() if k not in background
+        }
+        # References of unspotted labels are left out of the bank entirely.
+        bank = SpringBank([x for x in refs if x.label in thresholds], thresholds, native=native)
+    lens = sorted(len(x.seq) for x in refs)
+    norm_points = max(2, int(round(lens[len(lens) // 2] * norm_frac))) if lens else 2
+    return StreamSpotter(
+        bank, stream_step(params, stream_hz, step), norm_points=norm_points, use_znorm=bool(params["use_znorm"])
+    )
+
+
+def stream_step(params: dict, stream_hz: float, step: float = 0.0) -> float:
+    if step > 0:
+        return step
+    model_hz = float(params.get("sample_rate_hz") or 0.0)
+    base = float(params.get("spot_step") or 1.0)
+    return base * stream_hz / model_hz if model_hz > 0 and stream_hz > 0 else base
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Replay captures back to back through the native and Python stream spotters."
+    )
+    parser.add_argument("--model", type=Path, required=True, help="Model from build_model.py (with spot params)")
+    parser.add_argument("--manifest", type=Path, required=True, help="Captures to replay, in manifest order")
+    parser.add_argument("--session", default="", help="Manifest session filter")
+    parser.add_argument("--labels", default="", help="Manifest label filter")
+    parser.add_argument("--background", default="idle", help="Comma-separated labels not spotted")
+    parser.add_argument("--limit", type=int, default=0, help="Replay at most this many captures (0 = all)")
+    parser.add_argument("--no-python", action="store_true", help="Skip the (slow) Python twin")
+    return parser.parse_args()
+
+
+def replay(spotter: StreamSpotter, rows: list[dict], rate_hz: float) -> tuple[list[Detection], list[tuple[int, int, str]]]:
+    # Returns the detections and each capture's (start_us, end_us, label).
+    detections: list[Detection] = []
+    spans: list[tuple[int, int, str]] = []
+    period_us = int(round(1_000_000 / rate_hz))
+    ts = 0
+    for row in rows:
+        seq = read_sequence(manifest_capture_path(row))
+        spans.append((ts, ts + (len(seq) - 1) * period_us, row["label"]))
+        for feat in seq:
+            detections.extend(spotter.push(ts, feat))
+            ts += period_us
+    return detections, spans
+
+
+def main() -> int:
+    args = parse_args()
+    refs, params, _thresholds = load_model(args.model)
+    if not params.get("spot_thresholds"):
+        print(f"{args.model}: no spot params; rebuild it with build_model.py")
+        return 1
+    labels = {x.strip().lower() for x in args.labels.split(",") if x.strip()}
+    rows = read_manifest(args.manifest, session=args.session, labels=labels)
+    if args.limit > 0:
+        rows = rows[: args.limit]
+    rate_hz = float(params.get("sample_rate_hz") or 200.0)
+    background = frozenset(x.strip() for x in args.background.split(",") if x.strip())
+
+    runs = [("native", True)] if load_dtw_kernel() is not None else []
+    if not args.no_python or not runs:
+        runs.append(("python", False))
+    results = {}
+    for name, native in runs:
+        spotter = spotter_for_model(refs, params, rate_hz, native=native, background=background)
+        t0 = time.perf_counter()
+        detections, spans = replay(spotter, rows, rate_hz)
+        elapsed = time.perf_counter() - t0
+        results[name] = detections
+        st = spotter.stats
+        print(
+            f"{name}: samples={st.samples} points={st.points} matches={st.matches} "
+            f"detections={st.detections} too_long={st.too_long} sample_us_mean={st.mean_us():.2f} "
+            f"sample_us_p99={st.percentile_us(0.99):.2f} sample_us_max={st.max_ns / 1000:.1f} "
+            f"realtime_x={st.samples / rate_hz / elapsed:.0f}"
+        )
+
+    detections = results[runs[0][0]]
+    found = 0
+    right = 0
+    for start_us, end_us, label in spans:
+        if label in background:
+            continue
+        hits = [d for d in detections if d.start_us <= end_us and d.end_us >= start_us]
+        if hits:
+            found += 1
+            right += any(d.label == label for d in hits)
+    for d in detections:
+        print(
+            f"detection label={d.label} dist={d.dist:.2f} threshold={d.threshold:.2f} "
+            f"start_s={d.start_us / 1e6:.2f} end_s={d.end_us / 1e6:.2f} samples={len(d.samples)}"
+        )
+    spans = [x for x in spans if x[2] not in background]
+    print(f"captures={len(spans)} overlapped={found} with_label={right}")
+
+    if len(results) == 2:
+        a = [(d.ref, d.start_us, d.end_us) for d in results["native"]]
+        b = [(d.ref, d.start_us, d.end_us) for d in results["python"]]
+        worst = max(
+            (abs(x.dist - y.dist) / max(abs(y.dist), 1e-12) for x, y in zip(results["native"], results["python"])),
+            default=0.0,
+        )
+        print(f"native_vs_python same_detections={a == b} max_relative_dist_diff={worst:.2e}")
+        if a != b or worst > 1e-4:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
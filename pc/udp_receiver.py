@@ -1,16 +1,15 @@
 #!/usr/bin/env python3
 import socket
-import struct
 import time
 from pathlib import Path
 
+from capture_file import CaptureWriter
+from imu_frames import SequenceTracker, decode_packet
+
 HOST = "0.0.0.0"
 PORT = 9000
-OUT = Path("samples.csv")
-
-# Frame: <q6h (little endian) -> ts_us, ax, ay, az, gx, gy, gz
-FMT = "<q6h"
-SIZE = struct.calcsize(FMT)
+# capture_file.py format; `capture_file.py export samples.adcap` for CSV.
+OUT = Path("samples.adcap")
 
 
 def main():
@@ -18,16 +17,23 @@ def main():
     sock.bind((HOST, PORT))
     print(f"listening on {HOST}:{PORT}")
 
-    with OUT.open("w") as f:
-        f.write("ts_us,ax,ay,az,gx,gy,gz\n")
-        while True:
-            data, addr = sock.recvfrom(1024)
-            if len(data) < SIZE:
-                continue
-            ts_us, ax, ay, az, gx, gy, gz = struct.unpack(FMT, data[:SIZE])
-            f.write(f"{ts_us},{ax},{ay},{az},{gx},{gy},{gz}\n")
-            # simple flush for safety during early dev
-            f.flush()
+    tracker = SequenceTracker()
+    # Chunks reach the file as they fill; Ctrl-C writes the rest and the index.
+    with CaptureWriter(OUT) as writer:
+        try:
+            while True:
+                data, addr = sock.recvfrom(2048)
+                seq, samples = decode_packet(data)
+                if not samples:
+                    continue
+                if seq is not None:
+                    lost = tracker.update(seq)
+                    if lost > 0:
+                        print(f"[{time.time():.3f}] lost {lost} frames (total={tracker.lost})")
+                writer.extend(samples)
+        except KeyboardInterrupt:
+            pass
+    print(f"saved {writer.count} samples: {OUT}")
 
 
 if __name__ == "__main__":
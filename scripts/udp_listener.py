@@ -20,6 +20,51 @@ def main():
             print(f"[{ts:.3f}] HB from {addr[0]}:{addr[1]} ts_us={ts_us}")
             continue
 
+        if len(data) == 16 and data[:4] == b"HB02":
+            ts_us, rate_hz, caps = struct.unpack("<qHH", data[4:])
+            print(f"[{ts:.3f}] HB from {addr[0]}:{addr[1]} ts_us={ts_us} rate_hz={rate_hz} caps=0x{caps:04x}")
+            continue
+
+        if len(data) >= 20 and data[:4] == b"IMU2":
+            seq, base_ts_us, count = struct.unpack("<IqH", data[4:18])
+            print(
+                f"[{ts:.3f}] BATCH {addr[0]}:{addr[1]} seq={seq} "
+                f"base_ts_us={base_ts_us} samples={count}"
+            )
+            continue
+
+        if len(data) >= 12 and data[:4] == b"IMZ1":
+            seq, count = struct.unpack("<IH", data[4:10])
+            print(
+                f"[{ts:.3f}] BATCHZ {addr[0]}:{addr[1]} seq={seq} "
+                f"samples={count} bytes={len(data)}"
+            )
+            continue
+
+        if len(data) == 20 and data[:4] == b"SEGS":
+            seg_id, trigger_ts_us, pre = struct.unpack("<IqH", data[4:18])
+            print(
+                f"[{ts:.3f}] SEG START {addr[0]}:{addr[1]} id={seg_id} "
+                f"trigger_ts_us={trigger_ts_us} pre_samples={pre}"
+            )
+            continue
+
+        if len(data) == 24 and data[:4] == b"SEGE":
+            seg_id, end_ts_us, count, reason = struct.unpack("<IqIH", data[4:22])
+            print(
+                f"[{ts:.3f}] SEG END {addr[0]}:{addr[1]} id={seg_id} "
+                f"end_ts_us={end_ts_us} samples={count} reason={reason}"
+            )
+            continue
+
+        if len(data) == 24 and data[:4] == b"IDL1":
+            ts_us, count, peak, ax, ay, az = struct.unpack("<qIH3h", data[4:])
+            print(
+                f"[{ts:.3f}] IDLE {addr[0]}:{addr[1]} ts_us={ts_us} samples={count} "
+                f"peak_gyro={peak} mean_acc=({ax},{ay},{az})"
+            )
+            continue
+
         if len(data) == 20:
             ts_us, ax, ay, az, gx, gy, gz = struct.unpack("<qhhhhhh", data)
             print(